@@ -39,6 +39,65 @@ int pldm_instance_db_init(struct pldm_instance_db **ctx, const char *dbpath);
  * */
 int pldm_instance_db_init_default(struct pldm_instance_db **ctx);
 
+/**
+ * @brief Instantiates an instance ID database object private to the process
+ *
+ * Where a single process owns all PLDM traffic, coordinating allocations
+ * with other processes through the lock database is unnecessary. Instance
+ * IDs allocated from the returned object are instead tracked in a bitmap
+ * per TID, which is updated with atomic operations. Allocation and release
+ * require no system calls, and the object may be used by several threads
+ * concurrently.
+ *
+ * Allocations are not visible to other database objects, so this must not
+ * be used alongside other requesters sharing the same termini.
+ *
+ * @param[out] ctx - *ctx must be NULL, and will point to a PLDM instance ID
+ *		     database object on success.
+ *
+ * @return int - Returns 0 on success. Returns -EINVAL if ctx is NULL or *ctx
+ *		 is not NULL. Returns -ENOMEM if memory couldn't be allocated.
+ * */
+int pldm_instance_db_init_local(struct pldm_instance_db **ctx);
+
+/**
+ * @brief Instantiates an instance ID database object backed by shared memory
+ *
+ * Processes sharing TIDs allocate instance IDs from a segment mapped from
+ * @p shmpath, which holds the owner of each allocated ID for each TID.
+ * Allocation claims an ID with an atomic compare-and-swap on its owner and
+ * release clears it again, neither requiring a system call.
+ *
+ * Each allocated ID is leased to the allocating process, identified by its
+ * PID and start time so that a reused PID isn't mistaken for it. IDs leaked
+ * by processes that exit without releasing them, at any point, are
+ * reclaimed when a TID has no free ID left, which is the only case in which
+ * allocation makes system calls. Destroying the object releases the IDs
+ * allocated through it.
+ *
+ * The segment is created if it does not exist. Place it on a tmpfs, such as
+ * /dev/shm or /run, so it does not persist across boots. All processes
+ * sharing TIDs must use the same segment, and not the lock database used by
+ * pldm_instance_db_init(). A database object must not be used after fork(2)
+ * by the child, which should instantiate its own. Processes are identified
+ * through /proc, so all processes sharing the segment must be in the PID
+ * namespace of the first to map it.
+ *
+ * @param[out] ctx - *ctx must be NULL, and will point to a PLDM instance ID
+ *		     database object on success.
+ * @param[in] shmpath - the path of the shared memory segment
+ *
+ * @return int - Returns 0 on success. Returns -EINVAL if ctx is NULL, *ctx
+ *		 is not NULL or shmpath is NULL. Returns -ENOMEM if memory
+ *		 couldn't be allocated. Returns -EPROTO if shmpath isn't a
+ *		 segment of the expected layout. Returns -EXDEV if the segment
+ *		 is shared with another PID namespace. Returns the negative
+ *		 errno if the segment couldn't be opened, sized or mapped, or
+ *		 the process couldn't be identified.
+ * */
+int pldm_instance_db_init_shared(struct pldm_instance_db **ctx,
+				 const char *shmpath);
+
 /**
  * @brief Destroys an instance ID database object
  *
@@ -67,9 +126,36 @@ int pldm_instance_db_destroy(struct pldm_instance_db *ctx);
 int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 			   pldm_instance_id_t *iid);
 
+/**
+ * @brief Allocates several instance IDs for a destination TID at once
+ *
+ * Allows a requester pipelining requests to a terminus to fill its window in
+ * one step. IDs are allocated in the order pldm_instance_id_alloc() would
+ * allocate them. With the lock database, each run of consecutive candidate
+ * IDs is reserved and tested with one lock operation apiece unless the run is
+ * contended. Each ID is freed individually with pldm_instance_id_free().
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ * @param[in] tid - PLDM TID
+ * @param[in] count - the maximum number of instance IDs to allocate, from 1
+ *		to 32
+ * @param[out] iids - on success, a bitmask in which bit N is set if instance
+ *		ID N was allocated
+ *
+ * @return int - Returns the number of instance IDs allocated, which is at
+ *		 least one and may be fewer than count. Returns -EINVAL if the
+ *		 arguments are invalid. Otherwise returns the errors of
+ *		 pldm_instance_id_alloc().
+ */
+int pldm_instance_id_alloc_batch(struct pldm_instance_db *ctx, pldm_tid_t tid,
+				 unsigned int count, uint32_t *iids);
+
 /**
  * @brief Frees an instance ID previously allocated by pldm_instance_id_alloc
  *
+ * Freeing an instance ID after its allocation expired succeeds without
+ * releasing the ID, as described by pldm_instance_db_set_expiry().
+ *
  * @param[in] ctx - PLDM instance ID database object
  * @param[in] tid - PLDM TID
  * @param[in] iid - If this instance ID was not previously allocated by
@@ -84,6 +170,126 @@ int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 int pldm_instance_id_free(struct pldm_instance_db *ctx, pldm_tid_t tid,
 			  pldm_instance_id_t iid);
 
+/**
+ * @brief Frees all instance IDs allocated for a TID through a database object
+ *
+ * For use when a terminus is removed, releasing the IDs of requests to it
+ * that will never complete.
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ * @param[in] tid - PLDM TID
+ *
+ * @return int - Returns the number of instance IDs freed on success. Returns
+ *		 -EINVAL if ctx is NULL. Otherwise returns the errors of
+ *		 pldm_instance_id_free(), in which case some IDs may remain
+ *		 allocated.
+ */
+int pldm_instance_id_free_all(struct pldm_instance_db *ctx, pldm_tid_t tid);
+
+/**
+ * @brief Expire instance IDs that are never freed
+ *
+ * DSP0240 allows a requester to reuse an instance ID once the instance ID
+ * expiration interval (PT3) has passed since its request was sent. Once an
+ * expiry is set, each instance ID allocated through @p ctx is stamped with
+ * the time of its allocation. When a TID has no free instance ID,
+ * allocation first frees those of its IDs allocated through @p ctx at
+ * least @p expiry_ms ago, so that IDs leaked by the caller don't leave the
+ * TID unusable.
+ *
+ * An expired instance ID may be allocated again before its original holder
+ * frees it. Frees of an instance ID are matched to its allocations in
+ * order, so the late free is consumed by the expired allocation and doesn't
+ * release the new one. If the expired allocation is never freed, the next
+ * free of the ID is consumed instead, and the ID is released once it
+ * expires again. Disabling expiry forgets expired allocations yet to be
+ * freed. Set an expiry only where requests are abandoned within it, as a
+ * safety net for IDs that are leaked. Don't change the expiry concurrently
+ * with allocations.
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ * @param[in] expiry_ms - the age in milliseconds at which instance IDs
+ *		expire, no less than PT3min (5000ms), or zero to disable expiry
+ *
+ * @return int - Returns 0 on success. Returns -EINVAL if ctx is NULL or the
+ *		 expiry is shorter than PT3min. Returns -ENOMEM if memory
+ *		 couldn't be allocated.
+ */
+int pldm_instance_db_set_expiry(struct pldm_instance_db *ctx,
+				uint32_t expiry_ms);
+
+/**
+ * @brief Counters describing contention for instance IDs
+ *
+ * @param allocs - instance IDs allocated
+ * @param probes - candidate instance IDs examined while allocating
+ * @param eagain - allocations that failed with -EAGAIN
+ * @param lock_calls - lock database system calls made
+ * @param lock_ns - nanoseconds spent in lock database system calls
+ * @param peak - the most instance IDs of a TID seen allocated at once. For
+ *		a shared memory database this includes the allocations of
+ *		other processes, otherwise only those through the object.
+ */
+struct pldm_instance_db_stats {
+	uint64_t allocs;
+	uint64_t probes;
+	uint64_t eagain;
+	uint64_t lock_calls;
+	uint64_t lock_ns;
+	uint64_t peak;
+};
+
+/**
+ * @brief Start collecting statistics for the database object
+ *
+ * Statistics are collected for each TID. Don't enable or disable statistics
+ * concurrently with allocations.
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ *
+ * @return int - Returns 0 on success. Returns -EINVAL if ctx is NULL, -EBUSY
+ *		 if statistics are already enabled, or -ENOMEM.
+ */
+int pldm_instance_db_stats_enable(struct pldm_instance_db *ctx);
+
+/**
+ * @brief Stop collecting statistics and release their storage
+ *
+ * Destroying the database object implies this.
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ */
+void pldm_instance_db_stats_disable(struct pldm_instance_db *ctx);
+
+/**
+ * @brief Take a snapshot of the statistics across all TIDs
+ *
+ * Counters are summed across the TIDs, except for peak, which is the
+ * greatest of them. The snapshot may be taken concurrently with allocations.
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ * @param[out] stats - the current statistics
+ *
+ * @return int - Returns 0 on success, -EINVAL for invalid arguments, or
+ *		 -ENODATA if statistics are not enabled.
+ */
+int pldm_instance_db_stats_snapshot(struct pldm_instance_db *ctx,
+				    struct pldm_instance_db_stats *stats);
+
+/**
+ * @brief Take a snapshot of the statistics for a single TID
+ *
+ * @param[in] ctx - PLDM instance ID database object
+ * @param[in] tid - PLDM TID
+ * @param[out] stats - the current statistics
+ *
+ * @return int - Returns 0 on success, -EINVAL for invalid arguments, or
+ *		 -ENODATA if statistics are not enabled.
+ */
+int pldm_instance_db_stats_snapshot_tid(struct pldm_instance_db *ctx,
+					pldm_tid_t tid,
+					struct pldm_instance_db_stats *stats);
+
 #endif /* __STDC_HOSTED__*/
 
 #ifdef __cplusplus
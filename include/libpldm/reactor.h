@@ -0,0 +1,135 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct pldm_transport;
+
+/**
+ * @brief An event loop serving any number of transports and timers
+ *
+ * Registered transports and timers share a single epoll(7) instance, so the
+ * cost of waiting doesn't grow with the number of registrations. Transports
+ * are monitored edge-triggered and drained of all available messages when
+ * they become ready, with each message passed to the handler supplied at
+ * registration.
+ */
+struct pldm_reactor;
+
+/**
+ * @brief A periodic timer registered with a reactor
+ */
+struct pldm_reactor_timer;
+
+/**
+ * @brief Create a reactor
+ *
+ * @param[out] ctx - *ctx must be NULL, and is set to the new reactor on
+ *		success
+ *
+ * @return 0 on success, or a negative errno value on failure
+ */
+int pldm_reactor_init(struct pldm_reactor **ctx);
+
+/**
+ * @brief Destroy a reactor, releasing all registered timers
+ *
+ * Registered transports are not destroyed.
+ *
+ * @param[in] ctx - The reactor to destroy. May be NULL.
+ */
+void pldm_reactor_destroy(struct pldm_reactor *ctx);
+
+/**
+ * @brief Dispatch messages received on a transport to a handler
+ *
+ * The transport's file descriptor is switched to non-blocking mode so it can
+ * be drained.
+ *
+ * If a pool is registered with the transport via pldm_transport_pool_init()
+ * then messages are received into it, otherwise they are allocated.
+ *
+ * @param[in] ctx - The reactor
+ * @param[in] transport - The transport to monitor. It must support polling,
+ *		and must not be registered with the reactor already.
+ * @param[in] handler - Invoked for each received message. The message is only
+ *		valid for the duration of the call.
+ * @param[in] data - Passed to handler
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, -EEXIST if the
+ *	   transport is already registered, -ENOTSUP if the transport cannot
+ *	   be polled, or another negative errno value on failure.
+ */
+int pldm_reactor_add_transport(
+	struct pldm_reactor *ctx, struct pldm_transport *transport,
+	void (*handler)(void *data, struct pldm_transport *transport,
+			pldm_tid_t tid, const void *msg, size_t len),
+	void *data);
+
+/**
+ * @brief Stop monitoring a transport
+ *
+ * May be called from within a handler.
+ *
+ * @param[in] ctx - The reactor
+ * @param[in] transport - A transport registered with
+ *		pldm_reactor_add_transport()
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or -ENOENT if the
+ *	   transport is not registered
+ */
+int pldm_reactor_remove_transport(struct pldm_reactor *ctx,
+				  struct pldm_transport *transport);
+
+/**
+ * @brief Invoke a handler every period_ms milliseconds
+ *
+ * @param[in] ctx - The reactor
+ * @param[in] period_ms - The interval between invocations. Must be non-zero.
+ * @param[in] handler - Invoked each time the timer expires
+ * @param[in] data - Passed to handler
+ * @param[out] timer - Set to the new timer on success
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or another negative
+ *	   errno value on failure
+ */
+int pldm_reactor_add_timer(struct pldm_reactor *ctx, uint32_t period_ms,
+			   void (*handler)(void *data), void *data,
+			   struct pldm_reactor_timer **timer);
+
+/**
+ * @brief Cancel and release a timer
+ *
+ * May be called from within a handler, including the timer's own.
+ *
+ * @param[in] ctx - The reactor
+ * @param[in] timer - A timer returned by pldm_reactor_add_timer()
+ */
+void pldm_reactor_remove_timer(struct pldm_reactor *ctx,
+			       struct pldm_reactor_timer *timer);
+
+/**
+ * @brief Wait for and dispatch events
+ *
+ * @param[in] ctx - The reactor
+ * @param[in] timeout - The maximum time to wait for events in milliseconds,
+ *		with the semantics of epoll_wait(2). The wait is skipped if a
+ *		transport was left with messages pending by an earlier call.
+ *
+ * @return The number of handler invocations, which is zero if the timeout
+ *	   elapsed or the wait was interrupted, or a negative errno value on
+ *	   failure.
+ */
+int pldm_reactor_run_once(struct pldm_reactor *ctx, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,331 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct pldm_transport;
+struct pollfd;
+
+/**
+ * @brief An asynchronous requester multiplexing outstanding requests over a
+ *	  single transport instance
+ *
+ * Outstanding requests are tracked by the tuple (TID, instance ID, PLDM type,
+ * command). Each received response is routed to the completion of the request
+ * it correlates with. Messages that don't correlate with an outstanding
+ * request are retained and handed back to the caller through
+ * pldm_requester_recv(), rather than discarded.
+ */
+struct pldm_requester;
+
+/**
+ * @brief The time-out and retry behaviour for requests to a TID
+ *
+ * The defaults for each TID are a fixed time-out of PT2max (4800ms) without
+ * retries.
+ */
+struct pldm_requester_retry_policy {
+	/* Time to wait for a response to the first transmission (PT2) */
+	uint32_t timeout_ms;
+	/* Number of retransmissions after a time-out (PN1) */
+	uint8_t retries;
+	/* Factor applied to the time-out for each retry, capped at PT2max */
+	uint8_t backoff;
+};
+
+/**
+ * @brief The round-trip estimate for a TID
+ *
+ * The estimate follows RFC 6298, sampling the responses to requests that
+ * weren't retried. A TID is degraded when a request to it exhausts its retry
+ * policy, and recovers when it responds.
+ */
+struct pldm_requester_rtt {
+	/* Smoothed round-trip time, or zero if no sample has been taken */
+	uint32_t srtt_us;
+	/* Round-trip time variation */
+	uint32_t rttvar_us;
+	/* The time-out applied to the next request to the TID */
+	uint32_t timeout_ms;
+	/* Whether the TID failed to respond to its latest request */
+	bool degraded;
+};
+
+/**
+ * @brief Instantiate a requester over a transport instance
+ *
+ * @param[out] ctx - *ctx must be NULL, and will point to the requester on
+ *		     success
+ * @param[in] transport - An initialised transport instance. The transport must
+ *			  outlive the requester.
+ *
+ * @return 0 on success. -EINVAL if ctx is NULL, *ctx is not NULL or transport
+ *	   is NULL. -ENOMEM if the requester could not be allocated. Otherwise,
+ *	   a negative errno value if the time-out timer could not be created.
+ */
+int pldm_requester_init(struct pldm_requester **ctx,
+			struct pldm_transport *transport);
+
+/**
+ * @brief Destroy a requester
+ *
+ * The completion of each outstanding request is invoked with -ECANCELED, and
+ * any retained messages are released.
+ *
+ * @param[in] ctx - The requester to destroy. May be NULL.
+ */
+void pldm_requester_destroy(struct pldm_requester *ctx);
+
+/**
+ * @brief Configure the time-out and retry behaviour for requests to a TID
+ *
+ * Retries are sent with the instance ID of the original request. As such, the
+ * final retry must be transmitted before the instance ID expires at the
+ * responder (PT3min), less the transmission delays (2*PT4max).
+ *
+ * The policy applies to requests submitted after the call, and to the retries
+ * of requests that are already outstanding.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The TID to which the policy applies
+ * @param[in] policy - The policy to apply, copied into the requester
+ *
+ * @return 0 on success. -EINVAL if the arguments are invalid, if the time-out
+ *	   lies outside [PT2min, PT2max], if backoff is zero, or if the final
+ *	   retry would not be sent within PT2max of the first transmission.
+ */
+int pldm_requester_set_retry_policy(
+	struct pldm_requester *ctx, pldm_tid_t tid,
+	const struct pldm_requester_retry_policy *policy);
+
+/**
+ * @brief Share responses between identical requests for a command
+ *
+ * Requests for the command submitted by pldm_requester_submit() while an
+ * identical request is outstanding to the same TID aren't sent. Instead the
+ * caller is attached to the outstanding request, and its completion receives
+ * the same response or error. Requests are identical if they differ at most
+ * in their instance IDs. The response carries the instance ID of the request
+ * that was sent, while the instance ID of an attached request is never used
+ * and may be released on completion as usual.
+ *
+ * Only enable coalescing for commands whose responses don't depend on being
+ * issued separately, such as GetSensorReading or GetStateSensorReadings.
+ * Coalescing is disabled for all commands by default.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] type - The PLDM type of the command
+ * @param[in] command - The PLDM command
+ * @param[in] enable - Whether requests for the command are coalesced
+ *
+ * @return 0 on success, or -EINVAL if the arguments are invalid.
+ */
+int pldm_requester_set_coalescing(struct pldm_requester *ctx, uint8_t type,
+				  uint8_t command, bool enable);
+
+/**
+ * @brief Derive time-outs for a TID from its observed round-trip times
+ *
+ * Once enabled, the time-out of the retry policy for the TID becomes an upper
+ * bound. Requests are instead given the retransmission time-out of RFC 6298
+ * computed from the round-trip estimate, no shorter than PT2min. Requests to
+ * a degraded TID are given PT2min and aren't retried, so an unresponsive
+ * terminus is quickly passed over until it responds again.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The TID to which the setting applies
+ * @param[in] enable - Whether time-outs adapt to the round-trip estimate
+ *
+ * @return 0 on success, or -EINVAL if the arguments are invalid.
+ */
+int pldm_requester_set_adaptive_timeout(struct pldm_requester *ctx,
+					pldm_tid_t tid, bool enable);
+
+/**
+ * @brief Get the round-trip estimate for a TID
+ *
+ * Allows polling loops to skip degraded termini rather than waiting on them.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The TID of interest
+ * @param[out] rtt - The estimate for @p tid
+ *
+ * @return 0 on success, or -EINVAL if the arguments are invalid.
+ */
+int pldm_requester_get_rtt(struct pldm_requester *ctx, pldm_tid_t tid,
+			   struct pldm_requester_rtt *rtt);
+
+/**
+ * @brief Send a request and track it until its response arrives
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The destination TID
+ * @param[in] req_msg - The encoded PLDM request message, including the header.
+ *			The caller retains ownership.
+ * @param[in] req_len - The length of the message at req_msg
+ * @param[in] complete - Invoked once the request is resolved. @p rc is 0 if a
+ *			 correlated response was received, in which case
+ *			 @p resp_msg and @p resp_len describe the response. The
+ *			 response buffer is only valid for the duration of the
+ *			 call. Otherwise @p rc is a negative errno value and
+ *			 @p resp_msg is NULL. -ETIMEDOUT indicates the request
+ *			 exhausted its retry policy, -EIO that a retry could
+ *			 not be sent, and -ECANCELED that the request was
+ *			 cancelled.
+ * @param[in] data - Opaque context passed to @p complete
+ *
+ * @return 0 if the request was sent and is now outstanding, or was attached
+ *	   to an identical outstanding request as configured by
+ *	   pldm_requester_set_coalescing(). -EINVAL if the arguments are
+ *	   invalid or req_msg is not a request. -EBUSY if a request with the
+ *	   same TID and instance ID is already outstanding.
+ *	   -ENOMEM if tracking state could not be allocated. -EIO if the
+ *	   transport failed to send the message.
+ */
+int pldm_requester_submit(struct pldm_requester *ctx, pldm_tid_t tid,
+			  const void *req_msg, size_t req_len,
+			  void (*complete)(void *data, int rc, pldm_tid_t tid,
+					   const void *resp_msg,
+					   size_t resp_len),
+			  void *data);
+
+/**
+ * @brief Abandon an outstanding request
+ *
+ * The completion of the request is invoked with -ECANCELED. A response that
+ * arrives after cancellation is treated as unclaimed.
+ *
+ * A request to which other requests are attached can't be cancelled, as it
+ * remains outstanding on their behalf under its instance ID.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The destination TID of the request
+ * @param[in] req_msg - The request message as provided to
+ *			pldm_requester_submit()
+ * @param[in] req_len - The length of the message at req_msg
+ *
+ * @return 0 on success. -EINVAL if the arguments are invalid. -ENOENT if the
+ *	   request is not outstanding. -EBUSY if other requests are attached
+ *	   to it.
+ */
+int pldm_requester_cancel(struct pldm_requester *ctx, pldm_tid_t tid,
+			  const void *req_msg, size_t req_len);
+
+/**
+ * @brief Wait for the requester to have work available
+ *
+ * Request time-outs that occur while waiting are processed before returning.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] timeout - The timeout in milliseconds, as for poll(2)
+ *
+ * @return 1 if a subsequent call to pldm_requester_recv() will not block, 0
+ *	   on timeout or if only request time-outs were processed,
+ *	   -ECONNRESET if the transport hung up or failed with no messages left
+ *	   to receive, or another negative errno value on failure.
+ */
+int pldm_requester_poll(struct pldm_requester *ctx, int timeout);
+
+/**
+ * @brief Initialise a pollfd for the requester's time-out timer
+ *
+ * For integration with external event loops. All outstanding requests share
+ * a single timer. When the pollfd becomes readable, call
+ * pldm_requester_expire().
+ *
+ * @param[in] ctx - The requester instance
+ * @param[out] pollfd - The pollfd to initialise
+ *
+ * @return 0 on success, or -EINVAL if the arguments are invalid.
+ */
+int pldm_requester_init_pollfd(struct pldm_requester *ctx,
+			       struct pollfd *pollfd);
+
+/**
+ * @brief Process request time-outs
+ *
+ * Requests with retries remaining are retransmitted. Others are completed with
+ * -ETIMEDOUT.
+ *
+ * @param[in] ctx - The requester instance
+ *
+ * @return 0 on success. -EINVAL if ctx is NULL. Otherwise, a negative errno
+ *	   value if the timer could not be serviced.
+ */
+int pldm_requester_expire(struct pldm_requester *ctx);
+
+/**
+ * @brief Route a message received by the caller to an outstanding request
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The source TID of the message
+ * @param[in] msg - A message allocated with malloc(3)
+ * @param[in] len - The length of the message at msg
+ *
+ * @return 0 if the message completed an outstanding request, in which case
+ *	   the requester has taken ownership of msg. 1 if the message doesn't
+ *	   correlate with an outstanding request, in which case ownership
+ *	   remains with the caller. -EINVAL if the arguments are invalid.
+ */
+int pldm_requester_handle_msg(struct pldm_requester *ctx, pldm_tid_t tid,
+			      void *msg, size_t len);
+
+/**
+ * @brief Receive a message and route it to its outstanding request
+ *
+ * Messages retained while waiting in pldm_requester_send_recv() are returned
+ * before any message is read from the transport.
+ *
+ * @param[in] ctx - The requester instance
+ * @param[out] tid - The source TID of an unclaimed message
+ * @param[out] msg - Set to an unclaimed message, which the caller must free(3)
+ * @param[out] len - Set to the length of the unclaimed message
+ *
+ * @return 0 if a message was received and completed an outstanding request.
+ *	   1 if a message was received that doesn't correlate with an
+ *	   outstanding request, in which case it is returned through @p tid,
+ *	   @p msg and @p len. -EINVAL if the arguments are invalid. -EBADMSG if
+ *	   a malformed message was received. -EIO if the transport failed to
+ *	   receive a message.
+ */
+int pldm_requester_recv(struct pldm_requester *ctx, pldm_tid_t *tid,
+			void **msg, size_t *len);
+
+/**
+ * @brief Synchronously exchange a request and response without disturbing other
+ *	  outstanding requests
+ *
+ * Unlike pldm_transport_send_recv_msg(), responses to other outstanding
+ * requests are routed to their completions while waiting, and unclaimed
+ * messages are retained for pldm_requester_recv().
+ *
+ * @param[in] ctx - The requester instance
+ * @param[in] tid - The destination TID
+ * @param[in] req_msg - The encoded PLDM request message
+ * @param[in] req_len - The length of the message at req_msg
+ * @param[out] resp_msg - Set to the response on success, which the caller must
+ *			  free(3)
+ * @param[out] resp_len - Set to the length of the response on success
+ *
+ * @return 0 on success. -ETIMEDOUT if the retry policy for the TID was
+ *	   exhausted without a response. -ECONNRESET if the transport hung up,
+ *	   and -EIO if it failed to receive. Malformed messages are discarded.
+ *	   Otherwise, the errors of pldm_requester_submit() and
+ *	   pldm_requester_recv().
+ */
+int pldm_requester_send_recv(struct pldm_requester *ctx, pldm_tid_t tid,
+			     const void *req_msg, size_t req_len,
+			     void **resp_msg, size_t *resp_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,7 +9,9 @@ extern "C" {
 #include <libpldm/pldm.h>
 
 #include <stddef.h>
+#include <stdint.h>
 
+struct iovec;
 struct pldm_transport;
 
 /**
@@ -54,6 +56,40 @@ pldm_requester_rc_t pldm_transport_send_msg(struct pldm_transport *transport,
 					    const void *pldm_msg,
 					    size_t msg_len);
 
+/**
+ * @brief A PLDM message to be sent by pldm_transport_send_batch()
+ *
+ * @param iov - the message content, gathered in order from the vector. This
+ *		allows e.g. the PLDM header and payload to live in separate
+ *		buffers.
+ * @param iovlen - the number of elements of iov
+ * @param tid - destination PLDM TID
+ */
+struct pldm_transport_msgv {
+	const struct iovec *iov;
+	size_t iovlen;
+	pldm_tid_t tid;
+};
+
+/**
+ * @brief Send several PLDM messages with as few system calls as possible
+ *
+ * @pre The pldm transport instance must be initialised and any TID mappings
+ *	must be set up.
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[in] msgs - an array of count messages to send
+ * @param[in] count - the number of entries in msgs
+ *
+ * @return The number of messages sent, which may be fewer than count if the
+ *	   transport could not accept them all, or a negative errno value if
+ *	   none were sent. -EINVAL is returned if any message is shorter than
+ *	   a PLDM header, in which case none are sent.
+ */
+int pldm_transport_send_batch(struct pldm_transport *transport,
+			      const struct pldm_transport_msgv *msgs,
+			      size_t count);
+
 /**
  * @brief Asynchronously get a PLDM message. Control is immediately returned to the
  * 	  caller.
@@ -81,6 +117,193 @@ pldm_requester_rc_t pldm_transport_recv_msg(struct pldm_transport *transport,
 					    pldm_tid_t *tid, void **pldm_msg,
 					    size_t *msg_len);
 
+/**
+ * @brief A PLDM message received by pldm_transport_recv_batch()
+ *
+ * @param msg - caller owned buffer into which the message is received
+ * @param len - the capacity of msg on input, the length of the received
+ *		message on output
+ * @param tid - the TID of the message source
+ */
+struct pldm_transport_msg {
+	void *msg;
+	size_t len;
+	pldm_tid_t tid;
+};
+
+/**
+ * @brief Receive several PLDM messages with as few system calls as possible
+ *
+ * Blocks until at least one message is available and then receives any
+ * further messages that are immediately available, up to count. Messages that
+ * are truncated, malformed or from an unmapped source are discarded.
+ *
+ * @pre The pldm transport instance must be initialised and any TID mappings
+ *	must be set up.
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[in,out] msgs - an array of count caller-provided buffers. On return
+ *		  the first entries describe the received messages. Entries
+ *		  may be reordered, but each retains its buffer and capacity.
+ * @param[in] count - the number of entries in msgs
+ *
+ * @return The number of messages received, which may be zero if all were
+ *	   discarded, or a negative errno value on failure.
+ */
+int pldm_transport_recv_batch(struct pldm_transport *transport,
+			      struct pldm_transport_msg *msgs, size_t count);
+
+/**
+ * @brief Register a slab of receive buffers with the transport
+ *
+ * Messages received with pldm_transport_recv_pooled() are placed directly in
+ * buffers taken from the slab, avoiding an allocation per message.
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[in] slab - caller owned memory holding count buffers of size bytes.
+ *		It must remain valid until pldm_transport_pool_fini() succeeds.
+ * @param[in] size - the size of each buffer. Must be at least the size of a
+ *		PLDM message header and of a pointer. Messages larger than this
+ *		are discarded.
+ * @param[in] count - the number of buffers in the slab
+ *
+ * @return 0 on success, -EINVAL if the arguments are invalid, -EBUSY if a
+ *	   pool is already registered, or -ENOMEM if the pool's bookkeeping
+ *	   can't be allocated.
+ */
+int pldm_transport_pool_init(struct pldm_transport *transport, void *slab,
+			     size_t size, size_t count);
+
+/**
+ * @brief Unregister the transport's receive buffer pool
+ *
+ * @param[in] transport - pldm transport instance
+ *
+ * @return 0 on success, -EINVAL if no pool is registered, or -EBUSY if
+ *	   buffers have not yet been released
+ */
+int pldm_transport_pool_fini(struct pldm_transport *transport);
+
+/**
+ * @brief Receive messages into buffers taken from the transport's pool
+ *
+ * As for pldm_transport_recv_batch(), but the buffers are supplied by the
+ * pool registered with pldm_transport_pool_init(). Each received message must
+ * be returned with pldm_transport_pool_release().
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[out] msgs - an array of count entries describing the received
+ *		messages
+ * @param[in] count - the number of entries in msgs
+ *
+ * @return The number of messages received, -ENOBUFS if the pool is exhausted,
+ *	   or another negative errno value on failure.
+ */
+int pldm_transport_recv_pooled(struct pldm_transport *transport,
+			       struct pldm_transport_msg *msgs, size_t count);
+
+/**
+ * @brief Return a buffer obtained from pldm_transport_recv_pooled()
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[in] msg - the buffer to return to the pool
+ *
+ * @return 0 on success, or -EINVAL if msg is not a buffer of the pool that is
+ *	   currently handed out
+ */
+int pldm_transport_pool_release(struct pldm_transport *transport, void *msg);
+
+/* The number of buckets in a round-trip latency histogram */
+#define PLDM_TRANSPORT_STATS_RTT_BUCKETS 24
+
+/**
+ * @brief Counters describing the traffic on a transport
+ *
+ * @param tx_msgs - messages sent
+ * @param tx_bytes - bytes of PLDM messages sent
+ * @param rx_msgs - messages received
+ * @param rx_bytes - bytes of PLDM messages received
+ * @param rx_discarded - messages discarded by pldm_transport_send_recv_msg()
+ *		while waiting for a response
+ * @param rx_not_pldm - received messages dropped as not being PLDM messages
+ * @param rx_invalid_len - received messages dropped for an invalid length
+ * @param sndbuf_resizes - socket send buffer resizes to fit messages
+ * @param timeouts - requests that received no response in time
+ * @param rtt - a histogram of round-trip times between a request being sent
+ *		and its response being received. rtt[i] counts round trips
+ *		taking [2^i, 2^(i+1)) microseconds, with rtt[0] also counting
+ *		shorter round trips and the last bucket all longer ones.
+ */
+struct pldm_transport_stats {
+	uint64_t tx_msgs;
+	uint64_t tx_bytes;
+	uint64_t rx_msgs;
+	uint64_t rx_bytes;
+	uint64_t rx_discarded;
+	uint64_t rx_not_pldm;
+	uint64_t rx_invalid_len;
+	uint64_t sndbuf_resizes;
+	uint64_t timeouts;
+	uint64_t rtt[PLDM_TRANSPORT_STATS_RTT_BUCKETS];
+};
+
+/**
+ * @brief Start collecting statistics for the transport
+ *
+ * Statistics are collected for the transport as a whole and for each TID.
+ * Drops of messages whose source is unknown are only counted for the
+ * transport as a whole.
+ *
+ * @param[in] transport - pldm transport instance
+ *
+ * @return 0 on success, -EINVAL if transport is NULL, -EBUSY if statistics
+ *	   are already enabled, or -ENOMEM
+ */
+int pldm_transport_stats_enable(struct pldm_transport *transport);
+
+/**
+ * @brief Stop collecting statistics and release their storage
+ *
+ * Must not be called concurrently with pldm_transport_stats_snapshot() or
+ * pldm_transport_stats_snapshot_tid(). Destroying a transport implies this.
+ *
+ * @param[in] transport - pldm transport instance
+ */
+void pldm_transport_stats_disable(struct pldm_transport *transport);
+
+/**
+ * @brief Take a snapshot of the statistics for the transport as a whole
+ *
+ * The snapshot may be taken from any thread without blocking use of the
+ * transport. Each counter is read atomically, but counters updated together,
+ * such as a message and its bytes, may be observed mid-update.
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[out] stats - the current statistics
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or -ENODATA if
+ *	   statistics are not enabled
+ */
+int pldm_transport_stats_snapshot(struct pldm_transport *transport,
+				  struct pldm_transport_stats *stats);
+
+/**
+ * @brief Take a snapshot of the statistics for a single TID
+ *
+ * As for pldm_transport_stats_snapshot(), but only counting messages sent to
+ * or received from tid.
+ *
+ * @param[in] transport - pldm transport instance
+ * @param[in] tid - the TID of interest
+ * @param[out] stats - the current statistics
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or -ENODATA if
+ *	   statistics are not enabled
+ */
+int pldm_transport_stats_snapshot_tid(struct pldm_transport *transport,
+				      pldm_tid_t tid,
+				      struct pldm_transport_stats *stats);
+
 /**
  * @brief Synchronously send a PLDM request and receive the response. Control is
  * 	  returned to the caller once the response is received.
@@ -88,7 +311,8 @@ pldm_requester_rc_t pldm_transport_recv_msg(struct pldm_transport *transport,
  * pldm_transport_send_recv() will discard messages received on the underlying transport instance
  * that are not a response that matches the request. Do not use this function if you're attempting
  * to use the transport instance asynchronously, as this discard behaviour will affect other
- * responses that you may care about.
+ * responses that you may care about. See pldm_requester_send_recv() in <libpldm/requester.h>
+ * for an alternative that retains unrelated messages.
  *
  * @pre The pldm transport instance must be initialised; otherwise,
  * 	PLDM_REQUESTER_INVALID_SETUP is returned. If the transport requires a
@@ -4,6 +4,8 @@
 #include <libpldm/base.h>
 #include <libpldm/pldm.h>
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -60,6 +62,50 @@ int pldm_transport_af_mctp_unmap_tid_fqe(struct pldm_transport_af_mctp *ctx,
 int pldm_transport_af_mctp_bind(struct pldm_transport_af_mctp *transport,
 				const struct sockaddr_mctp *smctp, size_t len);
 
+/**
+ * @brief Move the transport's data path onto io_uring(7)
+ *
+ * A multishot receive is kept posted against a ring of provided buffers, and
+ * sends are submitted through the ring. Received messages are collected from
+ * the completion queue without system calls, and batches of messages passed to
+ * pldm_transport_send_batch() are submitted with a single system call. The
+ * io_uring file descriptor replaces the socket for polling.
+ *
+ * Receiving through the transport never blocks once the io_uring data path is
+ * enabled: pldm_transport_poll() or equivalent must be used to wait for
+ * messages.
+ *
+ * On failure the transport is left unmodified, so callers may continue to
+ * use the socket-based data path.
+ *
+ * @param[in] ctx - The transport instance
+ * @param[in] max_msg_len - The size of the largest PLDM message to receive or
+ *		send. Larger received messages are discarded.
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, -EBUSY if already
+ *	   enabled, -EOPNOTSUPP if the kernel lacks the required io_uring
+ *	   support, or another negative errno value on failure.
+ */
+int pldm_transport_af_mctp_enable_uring(struct pldm_transport_af_mctp *ctx,
+					size_t max_msg_len);
+
+/**
+ * @brief Size the socket send buffer for messages of up to a given length
+ *
+ * The send buffer otherwise grows on demand, adjusting the socket in the
+ * middle of a transfer. Callers about to move large objects, such as firmware
+ * images or BIOS tables, may size it up front from the negotiated maximum
+ * transfer size. The buffer is limited by the system's net.core.wmem_max.
+ *
+ * @param[in] ctx - The transport instance
+ * @param[in] max_msg_len - The length of the largest PLDM message to be sent
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or another negative
+ *	   errno value if the buffer cannot be resized.
+ */
+int pldm_transport_af_mctp_reserve_send_buffer(
+	struct pldm_transport_af_mctp *ctx, size_t max_msg_len);
+
 #ifdef __cplusplus
 }
 #endif
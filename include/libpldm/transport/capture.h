@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A capture is a file header followed by a record for each message. All
+ * fields are little-endian.
+ *
+ * The file header is the 8-byte magic PLDM_TRANSPORT_CAPTURE_MAGIC, followed
+ * by a 32-bit version and 32 reserved bits.
+ *
+ * Each record is a 64-bit CLOCK_MONOTONIC timestamp in nanoseconds, the
+ * 32-bit message length, the 8-bit remote TID, the 8-bit direction from enum
+ * pldm_transport_capture_direction and 16 reserved bits, followed by the
+ * message itself.
+ */
+#define PLDM_TRANSPORT_CAPTURE_MAGIC "PLDMCAP"
+#define PLDM_TRANSPORT_CAPTURE_VERSION 1
+
+enum pldm_transport_capture_direction {
+	PLDM_TRANSPORT_CAPTURE_TX = 0,
+	PLDM_TRANSPORT_CAPTURE_RX = 1,
+};
+
+struct pldm_transport_capture;
+
+/**
+ * @brief Record the traffic of a transport
+ *
+ * Messages sent and received through the returned transport are passed to
+ * @p inner and appended to @p fd. Records are buffered, and are written out
+ * when the buffer fills, by pldm_transport_capture_flush() and on destroy.
+ * The file header is written if @p fd is empty, so captures may be resumed
+ * by opening an existing capture with O_APPEND.
+ *
+ * @param[out] ctx - the capturing transport, must point to NULL
+ * @param[in] inner - the transport carrying the traffic, which must outlive
+ *		      @p ctx
+ * @param[in] fd - the file receiving the capture, which is not closed
+ *
+ * @return 0 on success, -EINVAL if the arguments are invalid, or another
+ *	   negative errno value on failure
+ */
+int pldm_transport_capture_init(struct pldm_transport_capture **ctx,
+				struct pldm_transport *inner, int fd);
+
+/* Flush outstanding records and destroy the capturing transport */
+void pldm_transport_capture_destroy(struct pldm_transport_capture *ctx);
+
+/* Get the core pldm transport struct */
+struct pldm_transport *
+pldm_transport_capture_core(struct pldm_transport_capture *ctx);
+
+/**
+ * @brief Write out buffered records
+ *
+ * Failing to write the capture doesn't disturb the traffic. Instead capture
+ * stops and the error is reported by this function.
+ *
+ * @param[in] ctx - the capturing transport
+ *
+ * @return 0 on success, -EINVAL if @p ctx is NULL, or the negative errno
+ *	   value of the first failed write
+ */
+int pldm_transport_capture_flush(struct pldm_transport_capture *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pldm_transport_loopback;
+
+/**
+ * @brief Create a connected pair of in-process transports
+ *
+ * Messages sent on one end are received on the other without system calls:
+ * each direction is a single-producer, single-consumer ring of message
+ * pointers, and each end exposes an eventfd for pldm_transport_poll().
+ * Each end may be driven by a different thread, but an end must not be used
+ * by more than one thread at a time.
+ *
+ * @param[out] a - the first end of the pair, must point to NULL
+ * @param[in] a_tid - the TID by which @p b addresses @p a, and the source TID
+ *		      reported by @p b for messages sent by @p a
+ * @param[out] b - the second end of the pair, must point to NULL
+ * @param[in] b_tid - the TID by which @p a addresses @p b, and the source TID
+ *		      reported by @p a for messages sent by @p b
+ * @param[in] depth - the number of messages each direction can hold, rounded
+ *		      up to a power of two
+ *
+ * @return 0 on success, -EINVAL if the arguments are invalid, -ENOMEM or
+ *	   another negative errno value if allocating the pair fails
+ */
+int pldm_transport_loopback_init_pair(struct pldm_transport_loopback **a,
+				      pldm_tid_t a_tid,
+				      struct pldm_transport_loopback **b,
+				      pldm_tid_t b_tid, size_t depth);
+
+/**
+ * @brief Destroy one end of a loopback pair
+ *
+ * The rings shared by the pair are released along with the second end to be
+ * destroyed. Messages still queued to either end are discarded.
+ *
+ * @param[in] ctx - the end to destroy, may be NULL
+ */
+void pldm_transport_loopback_destroy(struct pldm_transport_loopback *ctx);
+
+/* Get the core pldm transport struct */
+struct pldm_transport *
+pldm_transport_loopback_core(struct pldm_transport_loopback *ctx);
+
+struct pollfd;
+/* Init pollfd for async calls */
+int pldm_transport_loopback_init_pollfd(struct pldm_transport *t,
+					struct pollfd *pollfd);
+
+#ifdef __cplusplus
+}
+#endif
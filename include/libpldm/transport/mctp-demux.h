@@ -4,6 +4,8 @@
 #include <libpldm/base.h>
 #include <libpldm/pldm.h>
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -33,6 +35,46 @@ int pldm_transport_mctp_demux_map_tid(struct pldm_transport_mctp_demux *ctx,
 int pldm_transport_mctp_demux_unmap_tid(struct pldm_transport_mctp_demux *ctx,
 					pldm_tid_t tid, mctp_eid_t eid);
 
+/**
+ * @brief Receive each message with a single system call
+ *
+ * By default the transport peeks at the length of each message before
+ * receiving it into an allocation of that size. Once enabled, messages are
+ * instead received directly into a buffer preallocated for the largest
+ * message, and copied into an exact-sized allocation before being returned.
+ * This halves the system calls per received message at the cost of holding
+ * the buffer for the lifetime of the transport.
+ *
+ * Callers wishing to avoid the allocation as well should receive through
+ * pldm_transport_recv_pooled().
+ *
+ * @param[in] ctx - The transport instance
+ * @param[in] max_msg_len - The size of the largest PLDM message to receive.
+ *		Larger received messages are discarded.
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, -EBUSY if already
+ *	   enabled, or -ENOMEM if the buffer cannot be allocated.
+ */
+int pldm_transport_mctp_demux_enable_recv_buffer(
+	struct pldm_transport_mctp_demux *ctx, size_t max_msg_len);
+
+/**
+ * @brief Size the socket send buffer for messages of up to a given length
+ *
+ * The send buffer otherwise grows on demand, adjusting the socket in the
+ * middle of a transfer. Callers about to move large objects, such as firmware
+ * images or BIOS tables, may size it up front from the negotiated maximum
+ * transfer size. The buffer is limited by the system's net.core.wmem_max.
+ *
+ * @param[in] ctx - The transport instance
+ * @param[in] max_msg_len - The length of the largest PLDM message to be sent
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or another negative
+ *	   errno value if the buffer cannot be resized.
+ */
+int pldm_transport_mctp_demux_reserve_send_buffer(
+	struct pldm_transport_mctp_demux *ctx, size_t max_msg_len);
+
 #ifdef __cplusplus
 }
 #endif
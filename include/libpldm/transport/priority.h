@@ -0,0 +1,92 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Receive lanes, served in order of increasing value */
+enum pldm_transport_priority_lane {
+	PLDM_TRANSPORT_PRIORITY_HIGH = 0,
+	PLDM_TRANSPORT_PRIORITY_NORMAL = 1,
+	PLDM_TRANSPORT_PRIORITY_LOW = 2,
+};
+
+#define PLDM_TRANSPORT_PRIORITY_LANES 3
+
+struct pldm_transport_priority;
+
+/**
+ * @brief Receive messages in order of priority rather than arrival
+ *
+ * Receiving through the returned transport pulls the messages already
+ * available from @p inner, and sorts them into lanes by the PLDM type and
+ * command in their headers. Each receive returns the oldest message of the
+ * highest priority lane holding one, so urgent traffic overtakes bulk
+ * transfers that arrived ahead of it. Messages within a lane retain their
+ * order.
+ *
+ * Initially PlatformEventMessage, PollForPlatformEventMessage and firmware
+ * update traffic are classified PLDM_TRANSPORT_PRIORITY_HIGH, GetPDR and
+ * GetBIOSTable as PLDM_TRANSPORT_PRIORITY_LOW, and everything else as
+ * PLDM_TRANSPORT_PRIORITY_NORMAL. Requests and responses are classified
+ * alike.
+ *
+ * The transport's pollfd is readable while @p inner's is ready or messages
+ * are held in the lanes, so callers may poll after receiving only some of
+ * the available messages. Sends are passed directly to @p inner.
+ *
+ * @param[out] ctx - the prioritising transport, must point to NULL
+ * @param[in] inner - the transport carrying the traffic, which must outlive
+ *		      @p ctx
+ * @param[in] max_msg_len - the size of the largest PLDM message to receive
+ *		when @p inner supports pldm_transport_recv_batch(). Larger
+ *		messages are discarded.
+ *
+ * @return 0 on success, -EINVAL if the arguments are invalid, -ENOMEM, or
+ *	   another negative errno value if the pollfd can't be created
+ */
+int pldm_transport_priority_init(struct pldm_transport_priority **ctx,
+				 struct pldm_transport *inner,
+				 size_t max_msg_len);
+
+/* Discard held messages and destroy the prioritising transport */
+void pldm_transport_priority_destroy(struct pldm_transport_priority *ctx);
+
+/* Get the core pldm transport struct */
+struct pldm_transport *
+pldm_transport_priority_core(struct pldm_transport_priority *ctx);
+
+/**
+ * @brief Assign messages of a PLDM type and command to a lane
+ *
+ * @param[in] ctx - the prioritising transport
+ * @param[in] type - the PLDM type
+ * @param[in] command - the PLDM command
+ * @param[in] lane - the lane receiving the messages
+ *
+ * @return 0 on success, or -EINVAL if the arguments are invalid
+ */
+int pldm_transport_priority_classify(struct pldm_transport_priority *ctx,
+				     uint8_t type, uint8_t command,
+				     enum pldm_transport_priority_lane lane);
+
+/**
+ * @brief Get the number of received messages held in the lanes
+ *
+ * @param[in] ctx - the prioritising transport
+ *
+ * @return The number of messages held
+ */
+size_t
+pldm_transport_priority_pending(const struct pldm_transport_priority *ctx);
+
+#ifdef __cplusplus
+}
+#endif
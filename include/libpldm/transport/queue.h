@@ -0,0 +1,83 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pldm_transport_queue;
+
+/**
+ * @brief Queue outbound messages that the transport cannot yet accept
+ *
+ * Messages sent through the returned transport are passed to @p inner. Where
+ * @p inner fails a send with errno set to EAGAIN or EWOULDBLOCK, the message
+ * is copied onto a queue for its destination TID and the send succeeds. Once
+ * any message is queued, subsequent sends are queued behind it so ordering
+ * is preserved.
+ *
+ * Queued messages are sent by pldm_transport_queue_flush(), which serves the
+ * destination TIDs round-robin so that one busy terminus cannot starve the
+ * others. While messages are queued, the pollfd initialised for the transport
+ * also requests POLLOUT, and the caller should flush when it is reported.
+ *
+ * Note that as sends may be deferred, pldm_transport_send_recv_msg() is only
+ * suitable when nothing is queued.
+ *
+ * @param[out] ctx - the queueing transport, must point to NULL
+ * @param[in] inner - the transport carrying the traffic, which must outlive
+ *		      @p ctx
+ * @param[in] max_depth - the number of messages that may be queued for each
+ *		TID. Further sends fail with errno set to ENOBUFS.
+ *
+ * @return 0 on success, -EINVAL if the arguments are invalid, or -ENOMEM
+ */
+int pldm_transport_queue_init(struct pldm_transport_queue **ctx,
+			      struct pldm_transport *inner, size_t max_depth);
+
+/* Discard queued messages and destroy the queueing transport */
+void pldm_transport_queue_destroy(struct pldm_transport_queue *ctx);
+
+/* Get the core pldm transport struct */
+struct pldm_transport *
+pldm_transport_queue_core(struct pldm_transport_queue *ctx);
+
+/**
+ * @brief Send queued messages until the inner transport would block
+ *
+ * @param[in] ctx - the queueing transport
+ *
+ * @return The number of messages sent, -EINVAL if @p ctx is NULL, or the
+ *	   negative errno value with which the inner transport failed a send.
+ *	   The failed message is discarded.
+ */
+int pldm_transport_queue_flush(struct pldm_transport_queue *ctx);
+
+/**
+ * @brief Get the number of messages queued for a TID
+ *
+ * @param[in] ctx - the queueing transport
+ * @param[in] tid - the destination TID
+ *
+ * @return The number of messages queued for @p tid
+ */
+size_t pldm_transport_queue_depth(const struct pldm_transport_queue *ctx,
+				  pldm_tid_t tid);
+
+/**
+ * @brief Get the number of messages queued across all TIDs
+ *
+ * @param[in] ctx - the queueing transport
+ *
+ * @return The number of messages queued
+ */
+size_t pldm_transport_queue_pending(const struct pldm_transport_queue *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The maximum number of endpoints sharing a region */
+#define PLDM_TRANSPORT_SHM_ENDPOINTS_MAX 64
+
+struct pldm_transport_shm;
+
+/**
+ * @brief Create a shared-memory region for co-located PLDM endpoints
+ *
+ * The region holds one inbound ring for each TID in @p tids. Any endpoint
+ * may write messages in place into any ring, and each ring is drained by the
+ * endpoint that owns it. The region is sealed against resizing so a peer
+ * cannot truncate it under the others.
+ *
+ * @param[in] tids - the TIDs of the endpoints sharing the region
+ * @param[in] count - the number of entries in @p tids, at most
+ *		      PLDM_TRANSPORT_SHM_ENDPOINTS_MAX
+ * @param[in] ring_size - the size in bytes of each ring, a power of two of at
+ *			  least 256. A message may occupy at most half a ring.
+ *
+ * @return a memfd for the region on success, to be shared with each endpoint
+ *	   and closed by the caller, or a negative errno value on failure
+ */
+int pldm_transport_shm_region_create(const pldm_tid_t *tids, size_t count,
+				     size_t ring_size);
+
+/**
+ * @brief Attach an endpoint to a shared-memory region
+ *
+ * Each ring is paired with an eventfd through which its owner is woken. The
+ * caller is responsible for distributing the memfd and eventfds to every
+ * endpoint, for instance by inheritance or SCM_RIGHTS. All file descriptors
+ * are duplicated, so the caller retains ownership of those passed in.
+ *
+ * @param[out] ctx - the endpoint, must point to NULL
+ * @param[in] memfd - the region returned by pldm_transport_shm_region_create()
+ * @param[in] tid - the TID of this endpoint in the region
+ * @param[in] efds - an eventfd for each endpoint, in the order of the TIDs
+ *		     passed to pldm_transport_shm_region_create()
+ * @param[in] count - the number of entries in @p efds
+ *
+ * @return 0 on success, -EINVAL if the arguments don't match the region,
+ *	   -EPROTO if the region is malformed, or another negative errno value
+ */
+int pldm_transport_shm_init(struct pldm_transport_shm **ctx, int memfd,
+			    pldm_tid_t tid, const int *efds, size_t count);
+
+/* Destroy the transport backend */
+void pldm_transport_shm_destroy(struct pldm_transport_shm *ctx);
+
+/* Get the core pldm transport struct */
+struct pldm_transport *pldm_transport_shm_core(struct pldm_transport_shm *ctx);
+
+struct pollfd;
+/* Init pollfd for async calls */
+int pldm_transport_shm_init_pollfd(struct pldm_transport *t,
+				   struct pollfd *pollfd);
+
+#ifdef __cplusplus
+}
+#endif
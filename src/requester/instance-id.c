@@ -1,13 +1,23 @@
 /* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
 #include "environ/errno.h"
+#include "environ/time.h"
 
 // NOLINTNEXTLINE(bugprone-reserved-identifier,cert-dcl37-c,cert-dcl51-cpp)
 #include <libpldm/instance-id.h>
 #include <libpldm/pldm.h>
 
+#include <assert.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #define BIT(i) (1UL << (i))
@@ -15,6 +25,9 @@
 #define PLDM_TID_MAX	 256
 #define PLDM_INST_ID_MAX 32
 
+/* The instance ID expiration interval (PT3min), per DSP0240 */
+#define PLDM_INST_ID_PT3_MIN_MS 5000
+
 /* We need to track our allocations explicitly due to OFD lock merging/splitting
  */
 struct pldm_tid_state {
@@ -22,9 +35,89 @@ struct pldm_tid_state {
 	uint32_t allocations;
 };
 
+/* Identifies a shared memory database segment, "PIID" */
+#define PLDM_INSTANCE_DB_SHM_MAGIC   0x44494950
+#define PLDM_INSTANCE_DB_SHM_VERSION 2
+
+/*
+ * A lease's owner identifies a process by its PID and start time, so that a
+ * reused PID doesn't keep the leases of the process that exited. The top bit
+ * marks a lease being reclaimed by the identified process.
+ */
+#define PLDM_INSTANCE_DB_SHM_PID_BITS   22
+#define PLDM_INSTANCE_DB_SHM_PID_MASK                                          \
+	((UINT64_C(1) << PLDM_INSTANCE_DB_SHM_PID_BITS) - 1)
+#define PLDM_INSTANCE_DB_SHM_RECLAIMING (UINT64_C(1) << 63)
+
+/*
+ * Describes the layout of a shared memory database segment, which is shared
+ * between processes that may be linked against different builds of libpldm.
+ * A zero-filled header is stamped by the first process to map the segment.
+ * Owners are only meaningful within the PID namespace stamped in pid_ns.
+ */
+struct pldm_instance_db_shm_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t pid_ns;
+};
+
+/*
+ * The allocations for a TID in a shared memory database. Each allocated ID is
+ * leased to the process stamped in owners. The owner is stamped before the
+ * ID's bit is set in allocations and cleared after the bit, so a lease left
+ * by a process exiting at any point has an owner to reclaim it from. A
+ * zero-filled segment is a valid, empty database.
+ */
+struct pldm_instance_db_shm_tid {
+	uint32_t allocations;
+	uint64_t owners[PLDM_INST_ID_MAX];
+	uint8_t next;
+};
+
+struct pldm_instance_db_shm {
+	struct pldm_instance_db_shm_hdr hdr;
+	struct pldm_instance_db_shm_tid tids[PLDM_TID_MAX];
+};
+
+#define PLDM_INSTANCE_DB_STATS_COUNTERS                                        \
+	(sizeof(struct pldm_instance_db_stats) / sizeof(uint64_t))
+
+static_assert(sizeof(struct pldm_instance_db_stats) % sizeof(uint64_t) == 0,
+	      "pldm_instance_db_stats must consist only of counters");
+
+/* The index of a counter in struct pldm_instance_db_stats */
+#define PLDM_INSTANCE_DB_STAT(field)                                           \
+	(offsetof(struct pldm_instance_db_stats, field) / sizeof(uint64_t))
+
+/*
+ * Without a lock database the allocations of each TID are only accessed
+ * atomically, so the database may be shared between threads. They are
+ * authoritative unless a shared memory segment is mapped, in which case they
+ * record the IDs allocated through this object.
+ */
 struct pldm_instance_db {
 	struct pldm_tid_state state[PLDM_TID_MAX];
 	int lock_db_fd;
+	struct pldm_instance_db_shm *shm;
+	/* Our owner value in a shared memory database */
+	uint64_t owner;
+	/*
+	 * The monotonic time in milliseconds at which each ID allocated through
+	 * this object was allocated, or zero while it is being allocated or
+	 * released. Only allocated once an expiry is set.
+	 */
+	uint64_t (*leases)[PLDM_INST_ID_MAX];
+	/*
+	 * The number of expired allocations of each ID that are yet to be
+	 * freed. Frees of an ID are matched to its allocations in order, so
+	 * these are consumed without releasing a later allocation of the ID.
+	 * Allocated with the leases.
+	 */
+	uint32_t (*late)[PLDM_INST_ID_MAX];
+	uint32_t expiry_ms;
+	/* Per-TID counters allocated by pldm_instance_db_stats_enable() */
+	uint64_t (*stats)[PLDM_INSTANCE_DB_STATS_COUNTERS];
 };
 
 static inline int iid_next(pldm_instance_id_t cur)
@@ -32,6 +125,51 @@ static inline int iid_next(pldm_instance_id_t cur)
 	return (cur + 1) % PLDM_INST_ID_MAX;
 }
 
+static inline void pldm_instance_db_count(struct pldm_instance_db *ctx,
+					  pldm_tid_t tid, size_t counter,
+					  uint64_t n)
+{
+	if (ctx->stats) {
+		__atomic_fetch_add(&ctx->stats[tid][counter], n,
+				   __ATOMIC_RELAXED);
+	}
+}
+
+static uint64_t pldm_instance_db_clock_ns(void)
+{
+	struct timespec now;
+
+	if (libpldm_clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+		return 0;
+	}
+
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Apply a lock operation to the lock database, timing it if required */
+static int pldm_instance_db_lock(struct pldm_instance_db *ctx, int cmd,
+				 struct flock *flop)
+{
+	pldm_tid_t tid = flop->l_start / PLDM_INST_ID_MAX;
+	uint64_t start;
+	int saved;
+	int rc;
+
+	if (!ctx->stats) {
+		return fcntl(ctx->lock_db_fd, cmd, flop);
+	}
+
+	start = pldm_instance_db_clock_ns();
+	rc = fcntl(ctx->lock_db_fd, cmd, flop);
+	saved = errno;
+	pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(lock_ns),
+			       pldm_instance_db_clock_ns() - start);
+	pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(lock_calls), 1);
+	errno = saved;
+
+	return rc;
+}
+
 LIBPLDM_ABI_STABLE
 int pldm_instance_db_init(struct pldm_instance_db **ctx, const char *dbpath)
 {
@@ -88,13 +226,258 @@ int pldm_instance_db_init_default(struct pldm_instance_db **ctx)
 				     "/usr/share/libpldm/instance-db/default");
 }
 
+LIBPLDM_ABI_TESTING
+int pldm_instance_db_init_local(struct pldm_instance_db **ctx)
+{
+	struct pldm_instance_db *l_ctx;
+
+	if (!ctx || *ctx) {
+		return -EINVAL;
+	}
+
+	l_ctx = calloc(1, sizeof(struct pldm_instance_db));
+	if (!l_ctx) {
+		return -ENOMEM;
+	}
+
+	/* Initialise previous ID values so the next one is zero */
+	for (int i = 0; i < PLDM_TID_MAX; i++) {
+		l_ctx->state[i].prev = 31;
+	}
+
+	l_ctx->lock_db_fd = -1;
+	*ctx = l_ctx;
+
+	return 0;
+}
+
+/* Stamp a header field unless set, returning whether it holds the value */
+static bool pldm_instance_db_shm_stamp(uint32_t *field, uint32_t value)
+{
+	uint32_t expected = 0;
+
+	return __atomic_compare_exchange_n(field, &expected, value, false,
+					   __ATOMIC_ACQ_REL,
+					   __ATOMIC_ACQUIRE) ||
+	       expected == value;
+}
+
+/* Read a process' start time, in clock ticks since boot */
+static int pldm_instance_db_shm_start(pid_t pid, uint64_t *start)
+{
+	char path[32];
+	char buf[512];
+	ssize_t len;
+	char *field;
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0) {
+		return len < 0 ? -errno : -EPROTO;
+	}
+	buf[len] = '\0';
+
+	/* The command name may hold spaces, so count fields from its end */
+	field = strrchr(buf, ')');
+	for (int i = 3; field && i <= 22; i++) {
+		field = strchr(field + 1, ' ');
+	}
+	if (!field) {
+		return -EPROTO;
+	}
+
+	*start = strtoull(field + 1, NULL, 10);
+
+	return 0;
+}
+
+static uint64_t pldm_instance_db_shm_owner(pid_t pid, uint64_t start)
+{
+	return ((start << PLDM_INSTANCE_DB_SHM_PID_BITS) |
+		((uint64_t)pid & PLDM_INSTANCE_DB_SHM_PID_MASK)) &
+	       ~PLDM_INSTANCE_DB_SHM_RECLAIMING;
+}
+
+/*
+ * Returns whether the process identified by owner has exited. A process whose
+ * start time can't be read, for instance under hidepid, is assumed alive.
+ */
+static bool pldm_instance_db_shm_exited(uint64_t owner)
+{
+	pid_t pid = owner & PLDM_INSTANCE_DB_SHM_PID_MASK;
+	uint64_t start;
+
+	if (kill(pid, 0) < 0 && errno == ESRCH) {
+		return true;
+	}
+
+	/* The PID may have been reused by another process */
+	if (pldm_instance_db_shm_start(pid, &start)) {
+		return false;
+	}
+
+	return pldm_instance_db_shm_owner(pid, start) !=
+	       (owner & ~PLDM_INSTANCE_DB_SHM_RECLAIMING);
+}
+
+/*
+ * Racing processes stamp the same values, in any order, so each either stamps
+ * a field or finds the value it would have stamped.
+ */
+static int pldm_instance_db_shm_validate(struct pldm_instance_db_shm *shm,
+					 uint32_t pid_ns)
+{
+	struct pldm_instance_db_shm_hdr *hdr = &shm->hdr;
+	uint32_t magic = __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE);
+
+	/* Don't stamp segments of some other kind */
+	if (magic && magic != PLDM_INSTANCE_DB_SHM_MAGIC) {
+		return -EPROTO;
+	}
+
+	if (!pldm_instance_db_shm_stamp(&hdr->size, sizeof(*shm)) ||
+	    !pldm_instance_db_shm_stamp(&hdr->version,
+					PLDM_INSTANCE_DB_SHM_VERSION) ||
+	    !pldm_instance_db_shm_stamp(&hdr->magic,
+					PLDM_INSTANCE_DB_SHM_MAGIC)) {
+		return -EPROTO;
+	}
+
+	/* PIDs of other namespaces can't be told apart from our own */
+	if (!pldm_instance_db_shm_stamp(&hdr->pid_ns, pid_ns)) {
+		return -EXDEV;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_db_init_shared(struct pldm_instance_db **ctx,
+				 const char *shmpath)
+{
+	struct pldm_instance_db *l_ctx;
+	struct stat statbuf;
+	uint64_t start;
+	uint32_t pid_ns;
+	void *shm;
+	int rc;
+	int fd;
+
+	if (!ctx || *ctx || !shmpath) {
+		return -EINVAL;
+	}
+
+	if (stat("/proc/self/ns/pid", &statbuf) < 0) {
+		return -errno;
+	}
+	pid_ns = statbuf.st_ino;
+
+	rc = pldm_instance_db_shm_start(getpid(), &start);
+	if (rc) {
+		return rc;
+	}
+
+	fd = open(shmpath, O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	/* Racing creators extend the segment to the same, zero-filled size */
+	if (fstat(fd, &statbuf) < 0) {
+		rc = -errno;
+		goto cleanup_fd;
+	}
+
+	/* Only extend new segments, not files of some other kind */
+	if (statbuf.st_size > 0 &&
+	    statbuf.st_size < (off_t)sizeof(struct pldm_instance_db_shm)) {
+		rc = -EPROTO;
+		goto cleanup_fd;
+	}
+
+	if (!statbuf.st_size &&
+	    ftruncate(fd, sizeof(struct pldm_instance_db_shm)) < 0) {
+		rc = -errno;
+		goto cleanup_fd;
+	}
+
+	shm = mmap(NULL, sizeof(struct pldm_instance_db_shm),
+		   PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED) {
+		rc = -errno;
+		goto cleanup_fd;
+	}
+
+	rc = pldm_instance_db_shm_validate(shm, pid_ns);
+	if (rc) {
+		goto cleanup_shm;
+	}
+
+	l_ctx = calloc(1, sizeof(struct pldm_instance_db));
+	if (!l_ctx) {
+		rc = -ENOMEM;
+		goto cleanup_shm;
+	}
+
+	l_ctx->lock_db_fd = -1;
+	l_ctx->shm = shm;
+	l_ctx->owner = pldm_instance_db_shm_owner(getpid(), start);
+	close(fd);
+	*ctx = l_ctx;
+
+	return 0;
+
+cleanup_shm:
+	munmap(shm, sizeof(struct pldm_instance_db_shm));
+cleanup_fd:
+	close(fd);
+
+	return rc;
+}
+
+static void pldm_instance_db_shm_release(struct pldm_instance_db_shm_tid *tid,
+					 pldm_instance_id_t iid)
+{
+	__atomic_fetch_and(&tid->allocations, ~(uint32_t)BIT(iid),
+			   __ATOMIC_RELEASE);
+	__atomic_store_n(&tid->owners[iid], 0, __ATOMIC_RELEASE);
+}
+
 LIBPLDM_ABI_STABLE
 int pldm_instance_db_destroy(struct pldm_instance_db *ctx)
 {
 	if (!ctx) {
 		return 0;
 	}
-	close(ctx->lock_db_fd);
+	if (ctx->lock_db_fd >= 0) {
+		close(ctx->lock_db_fd);
+	}
+	if (ctx->shm) {
+		/* Release our leases, as closing the lock database would */
+		for (int tid = 0; tid < PLDM_TID_MAX; tid++) {
+			struct pldm_instance_db_shm_tid *shared;
+			uint32_t allocations;
+
+			shared = &ctx->shm->tids[tid];
+			allocations = ctx->state[tid].allocations;
+			while (allocations) {
+				pldm_instance_db_shm_release(
+					shared, __builtin_ctz(allocations));
+				allocations &= allocations - 1;
+			}
+		}
+		munmap(ctx->shm, sizeof(struct pldm_instance_db_shm));
+	}
+	free(ctx->leases);
+	free(ctx->late);
+	free(ctx->stats);
 	free(ctx);
 	return 0;
 }
@@ -117,14 +500,202 @@ static const struct flock pldm_instance_id_cflu = {
 	.l_len = 1,
 };
 
-LIBPLDM_ABI_STABLE
-int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
-			   pldm_instance_id_t *iid)
+static inline uint32_t rotr32(uint32_t val, unsigned int shift)
+{
+	return shift ? (val >> shift) | (val << (32 - shift)) : val;
+}
+
+/*
+ * Atomically claim up to count free IDs in the bitmap, searching from start
+ * onwards. The last ID claimed in the order of the search is set in last.
+ */
+static int pldm_iid_claim(uint32_t *bitmap, unsigned int start,
+			  unsigned int count, uint32_t *claimed,
+			  pldm_instance_id_t *last)
+{
+	uint32_t allocations;
+	uint32_t free_ids;
+	unsigned int n;
+	uint32_t mask;
+
+	allocations = __atomic_load_n(bitmap, __ATOMIC_RELAXED);
+	do {
+		if (allocations == UINT32_MAX) {
+			return -EAGAIN;
+		}
+
+		free_ids = ~rotr32(allocations, start);
+		mask = 0;
+		for (n = 0; free_ids && n < count; n++) {
+			*last = (start + __builtin_ctz(free_ids)) %
+				PLDM_INST_ID_MAX;
+			mask |= (uint32_t)BIT(*last);
+			free_ids &= free_ids - 1;
+		}
+	} while (!__atomic_compare_exchange_n(bitmap, &allocations,
+					      allocations | mask, true,
+					      __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+
+	*claimed = mask;
+
+	return 0;
+}
+
+/* Count the candidates examined by a search from start that ended at last */
+static void pldm_iid_count_probes(struct pldm_instance_db *ctx, pldm_tid_t tid,
+				  unsigned int start, pldm_instance_id_t last)
+{
+	pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(probes),
+			       (last + PLDM_INST_ID_MAX - start) %
+					       PLDM_INST_ID_MAX +
+				       1);
+}
+
+static int pldm_instance_id_alloc_local(struct pldm_instance_db *ctx,
+					pldm_tid_t tid, unsigned int count,
+					uint32_t *iids)
+{
+	struct pldm_tid_state *state = &ctx->state[tid];
+	pldm_instance_id_t last;
+	unsigned int start;
+	int rc;
+
+	/* Search from the ID following the previous allocation */
+	start = iid_next(__atomic_load_n(&state->prev, __ATOMIC_RELAXED));
+	rc = pldm_iid_claim(&state->allocations, start, count, iids, &last);
+	if (!rc) {
+		__atomic_store_n(&state->prev, last, __ATOMIC_RELAXED);
+		pldm_iid_count_probes(ctx, tid, start, last);
+	}
+
+	return rc;
+}
+
+/* Release the leases of processes that have exited */
+static bool pldm_instance_db_shm_reclaim(struct pldm_instance_db_shm_tid *tid,
+					 uint64_t self)
+{
+	bool reclaimed = false;
+
+	for (int iid = 0; iid < PLDM_INST_ID_MAX; iid++) {
+		uint64_t owner;
+
+		/* Leases being reclaimed by an exited process are taken over */
+		owner = __atomic_load_n(&tid->owners[iid], __ATOMIC_ACQUIRE);
+		if (!owner || !pldm_instance_db_shm_exited(owner)) {
+			continue;
+		}
+
+		/* Keep the ID from being claimed until its bit is clear */
+		if (!__atomic_compare_exchange_n(
+			    &tid->owners[iid], &owner,
+			    self | PLDM_INSTANCE_DB_SHM_RECLAIMING, false,
+			    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			continue;
+		}
+
+		pldm_instance_db_shm_release(tid, iid);
+		reclaimed = true;
+	}
+
+	return reclaimed;
+}
+
+/*
+ * Claim up to count IDs by stamping ourselves as their owner, searching from
+ * start onwards. The last ID claimed in the order of the search is set in
+ * last.
+ */
+static int pldm_instance_db_shm_claim(struct pldm_instance_db_shm_tid *tid,
+				      uint64_t self, unsigned int start,
+				      unsigned int count, uint32_t *claimed,
+				      pldm_instance_id_t *last)
 {
+	uint32_t mask = 0;
+	unsigned int n = 0;
+
+	for (unsigned int i = 0; i < PLDM_INST_ID_MAX && n < count; i++) {
+		pldm_instance_id_t iid = (start + i) % PLDM_INST_ID_MAX;
+		uint64_t owner = 0;
+
+		if (__atomic_load_n(&tid->owners[iid], __ATOMIC_RELAXED) ||
+		    !__atomic_compare_exchange_n(&tid->owners[iid], &owner,
+						 self, false, __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED)) {
+			continue;
+		}
+
+		mask |= (uint32_t)BIT(iid);
+		*last = iid;
+		n++;
+	}
+
+	if (!mask) {
+		return -EAGAIN;
+	}
+
+	__atomic_fetch_or(&tid->allocations, mask, __ATOMIC_RELEASE);
+	*claimed = mask;
+
+	return 0;
+}
+
+static int pldm_instance_id_alloc_shared(struct pldm_instance_db *ctx,
+					 pldm_tid_t tid, unsigned int count,
+					 uint32_t *iids)
+{
+	struct pldm_instance_db_shm_tid *shared = &ctx->shm->tids[tid];
+	pldm_instance_id_t last;
+	unsigned int start;
+	int rc;
+
+	start = __atomic_load_n(&shared->next, __ATOMIC_RELAXED) %
+		PLDM_INST_ID_MAX;
+	rc = pldm_instance_db_shm_claim(shared, ctx->owner, start, count, iids,
+					&last);
+	if (rc == -EAGAIN && pldm_instance_db_shm_reclaim(shared, ctx->owner)) {
+		rc = pldm_instance_db_shm_claim(shared, ctx->owner, start,
+						count, iids, &last);
+	}
+
+	if (rc) {
+		return rc;
+	}
+
+	__atomic_store_n(&shared->next, iid_next(last), __ATOMIC_RELAXED);
+	__atomic_fetch_or(&ctx->state[tid].allocations, *iids,
+			  __ATOMIC_RELAXED);
+	pldm_iid_count_probes(ctx, tid, start, last);
+
+	return 0;
+}
+
+/* Allocate from the bitmaps of a database without a lock database */
+static int pldm_instance_id_alloc_atomic(struct pldm_instance_db *ctx,
+					 pldm_tid_t tid, unsigned int count,
+					 uint32_t *iids)
+{
+	if (ctx->shm) {
+		return pldm_instance_id_alloc_shared(ctx, tid, count, iids);
+	}
+
+	return pldm_instance_id_alloc_local(ctx, tid, count, iids);
+}
+
+static int pldm_instance_id_alloc_db(struct pldm_instance_db *ctx,
+				     pldm_tid_t tid, pldm_instance_id_t *iid)
+{
+	uint32_t iids;
 	uint8_t l_iid;
 
-	if (!ctx || !iid) {
-		return -EINVAL;
+	if (ctx->lock_db_fd < 0) {
+		if (pldm_instance_id_alloc_atomic(ctx, tid, 1, &iids)) {
+			return -EAGAIN;
+		}
+
+		*iid = __builtin_ctz(iids);
+		return 0;
 	}
 
 	l_iid = ctx->state[tid].prev;
@@ -137,6 +708,9 @@ int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 		off_t loff;
 		int rc;
 
+		pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(probes),
+				       1);
+
 		/* Have we already allocated this instance ID? */
 		if (ctx->state[tid].allocations & BIT(l_iid)) {
 			continue;
@@ -148,7 +722,7 @@ int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 		/* Reserving the TID's IID. Done via a shared lock */
 		flop = pldm_instance_id_cfls;
 		flop.l_start = loff;
-		rc = fcntl(ctx->lock_db_fd, F_OFD_SETLK, &flop);
+		rc = pldm_instance_db_lock(ctx, F_OFD_SETLK, &flop);
 		if (rc < 0) {
 			if (errno == EAGAIN || errno == EINTR) {
 				return -EAGAIN;
@@ -170,7 +744,7 @@ int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 		 */
 		flop = pldm_instance_id_cflx;
 		flop.l_start = loff;
-		rc = fcntl(ctx->lock_db_fd, F_OFD_GETLK, &flop);
+		rc = pldm_instance_db_lock(ctx, F_OFD_GETLK, &flop);
 		if (rc < 0) {
 			if (errno == EAGAIN || errno == EINTR) {
 				rc = -EAGAIN;
@@ -196,7 +770,7 @@ int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 	release_cfls:
 		flop = pldm_instance_id_cflu;
 		flop.l_start = loff;
-		if (fcntl(ctx->lock_db_fd, F_OFD_SETLK, &flop) < 0) {
+		if (pldm_instance_db_lock(ctx, F_OFD_SETLK, &flop) < 0) {
 			if (errno == EAGAIN || errno == EINTR) {
 				return -EAGAIN;
 			}
@@ -213,18 +787,375 @@ int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
 	return -EAGAIN;
 }
 
+static uint64_t pldm_instance_id_now_ms(void)
+{
+	struct timespec now;
+
+	if (libpldm_clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+		return 1;
+	}
+
+	/* Offset so that no lease is stamped with zero */
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000 + 1;
+}
+
+static int pldm_instance_id_release(struct pldm_instance_db *ctx,
+				    pldm_tid_t tid, pldm_instance_id_t iid);
+
+/* Release the IDs allocated through ctx whose leases have expired */
+static bool pldm_instance_id_expire(struct pldm_instance_db *ctx,
+				    pldm_tid_t tid)
+{
+	uint64_t now = pldm_instance_id_now_ms();
+	uint32_t allocations;
+	bool expired = false;
+
+	allocations =
+		__atomic_load_n(&ctx->state[tid].allocations, __ATOMIC_RELAXED);
+	while (allocations) {
+		int iid = __builtin_ctz(allocations);
+		uint64_t *lease = &ctx->leases[tid][iid];
+		uint64_t stamp;
+
+		allocations &= allocations - 1;
+
+		stamp = __atomic_load_n(lease, __ATOMIC_RELAXED);
+		if (!stamp || now - stamp < ctx->expiry_ms) {
+			continue;
+		}
+
+		/* Don't race the owner releasing the ID */
+		if (!__atomic_compare_exchange_n(lease, &stamp, 0, false,
+						 __ATOMIC_RELAXED,
+						 __ATOMIC_RELAXED)) {
+			continue;
+		}
+
+		/* Account for the late free before the ID can be reallocated */
+		__atomic_fetch_add(&ctx->late[tid][iid], 1, __ATOMIC_RELAXED);
+		if (!pldm_instance_id_release(ctx, tid, iid)) {
+			expired = true;
+		} else {
+			__atomic_fetch_sub(&ctx->late[tid][iid], 1,
+					   __ATOMIC_RELAXED);
+		}
+	}
+
+	return expired;
+}
+
+/* Record the outcome of an allocation in the statistics */
+static void pldm_instance_db_account(struct pldm_instance_db *ctx,
+				     pldm_tid_t tid, int rc, uint32_t allocated)
+{
+	uint64_t *peak;
+	uint32_t held;
+	uint64_t seen;
+
+	if (!ctx->stats) {
+		return;
+	}
+
+	if (rc == -EAGAIN) {
+		pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(eagain),
+				       1);
+		return;
+	}
+
+	if (rc) {
+		return;
+	}
+
+	pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(allocs),
+			       __builtin_popcount(allocated));
+
+	/* A shared database tracks the allocations of every process */
+	held = __atomic_load_n(ctx->shm ? &ctx->shm->tids[tid].allocations :
+					  &ctx->state[tid].allocations,
+			       __ATOMIC_RELAXED);
+	peak = &ctx->stats[tid][PLDM_INSTANCE_DB_STAT(peak)];
+	seen = __atomic_load_n(peak, __ATOMIC_RELAXED);
+	while (seen < (uint64_t)__builtin_popcount(held) &&
+	       !__atomic_compare_exchange_n(peak, &seen,
+					    __builtin_popcount(held), true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
 LIBPLDM_ABI_STABLE
-int pldm_instance_id_free(struct pldm_instance_db *ctx, pldm_tid_t tid,
-			  pldm_instance_id_t iid)
+int pldm_instance_id_alloc(struct pldm_instance_db *ctx, pldm_tid_t tid,
+			   pldm_instance_id_t *iid)
+{
+	int rc;
+
+	if (!ctx || !iid) {
+		return -EINVAL;
+	}
+
+	rc = pldm_instance_id_alloc_db(ctx, tid, iid);
+	if (rc == -EAGAIN && ctx->leases && pldm_instance_id_expire(ctx, tid)) {
+		rc = pldm_instance_id_alloc_db(ctx, tid, iid);
+	}
+
+	if (!rc && ctx->leases) {
+		__atomic_store_n(&ctx->leases[tid][*iid],
+				 pldm_instance_id_now_ms(), __ATOMIC_RELAXED);
+	}
+
+	pldm_instance_db_account(ctx, tid, rc, rc ? 0 : BIT(*iid));
+
+	return rc;
+}
+
+static int pldm_instance_id_unlock(struct pldm_instance_db *ctx, off_t start,
+				   off_t len)
+{
+	struct flock flop = pldm_instance_id_cflu;
+
+	flop.l_start = start;
+	flop.l_len = len;
+	if (pldm_instance_db_lock(ctx, F_OFD_SETLK, &flop) < 0) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return -EAGAIN;
+		}
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+/* Test whether a range of the lock database is reserved only by us */
+static int pldm_instance_id_test(struct pldm_instance_db *ctx, off_t start,
+				 off_t len, bool *exclusive)
+{
+	struct flock flop = pldm_instance_id_cflx;
+
+	flop.l_start = start;
+	flop.l_len = len;
+	if (pldm_instance_db_lock(ctx, F_OFD_GETLK, &flop) < 0) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return -EAGAIN;
+		}
+		return -EPROTO;
+	}
+
+	if (flop.l_type != F_UNLCK && flop.l_type != F_RDLCK) {
+		return -EPROTO;
+	}
+
+	*exclusive = flop.l_type == F_UNLCK;
+
+	return 0;
+}
+
+/*
+ * Reserve a run of consecutive IDs in the lock database, setting those
+ * reserved only by us in acquired. An uncontended run takes two system calls
+ * regardless of its length.
+ */
+static int pldm_instance_id_lock_run(struct pldm_instance_db *ctx,
+				     pldm_tid_t tid, unsigned int first,
+				     unsigned int len, uint32_t *acquired)
 {
+	off_t loff = tid * PLDM_INST_ID_MAX + first;
 	struct flock flop;
+	bool exclusive;
 	int rc;
 
-	/* check if provided context is null */
-	if (!ctx) {
+	flop = pldm_instance_id_cfls;
+	flop.l_start = loff;
+	flop.l_len = len;
+	if (pldm_instance_db_lock(ctx, F_OFD_SETLK, &flop) < 0) {
+		if (errno == EAGAIN || errno == EINTR) {
+			return -EAGAIN;
+		}
+		return -EPROTO;
+	}
+
+	*acquired = 0;
+	rc = pldm_instance_id_test(ctx, loff, len, &exclusive);
+	if (rc) {
+		goto release_run;
+	}
+
+	if (exclusive) {
+		*acquired = (uint32_t)(BIT(len) - 1) << first;
+		return 0;
+	}
+
+	/* The run is contended, so keep the IDs reserved only by us */
+	for (unsigned int i = 0; i < len; i++) {
+		exclusive = false;
+		if (len > 1) {
+			rc = pldm_instance_id_test(ctx, loff + i, 1,
+						   &exclusive);
+			if (rc) {
+				goto release_run;
+			}
+		}
+
+		if (exclusive) {
+			*acquired |= (uint32_t)BIT(first + i);
+			continue;
+		}
+
+		rc = pldm_instance_id_unlock(ctx, loff + i, 1);
+		if (rc) {
+			goto release_run;
+		}
+	}
+
+	return 0;
+
+release_run:
+	pldm_instance_id_unlock(ctx, loff, len);
+	*acquired = 0;
+
+	return rc;
+}
+
+static int pldm_instance_id_alloc_batch_ofd(struct pldm_instance_db *ctx,
+					    pldm_tid_t tid, unsigned int count,
+					    uint32_t *iids)
+{
+	struct pldm_tid_state *state = &ctx->state[tid];
+	unsigned int scanned = 0;
+	uint32_t claimed = 0;
+	unsigned int l_iid;
+	uint32_t acquired;
+	unsigned int len;
+	int rc;
+
+	if (state->prev >= PLDM_INST_ID_MAX) {
+		return -EPROTO;
+	}
+
+	l_iid = iid_next(state->prev);
+	while (scanned < PLDM_INST_ID_MAX && count) {
+		/* Skip the IDs we have already allocated */
+		if (state->allocations & BIT(l_iid)) {
+			l_iid = iid_next(l_iid);
+			scanned++;
+			continue;
+		}
+
+		/* Gather a run of IDs to reserve, which can't wrap around */
+		len = 1;
+		while (len < count && scanned + len < PLDM_INST_ID_MAX &&
+		       l_iid + len < PLDM_INST_ID_MAX &&
+		       !(state->allocations & BIT(l_iid + len))) {
+			len++;
+		}
+
+		rc = pldm_instance_id_lock_run(ctx, tid, l_iid, len, &acquired);
+		if (rc) {
+			goto release_claimed;
+		}
+
+		if (acquired) {
+			state->prev = 31 - __builtin_clz(acquired);
+		}
+		claimed |= acquired;
+		count -= __builtin_popcount(acquired);
+		scanned += len;
+		l_iid = (l_iid + len) % PLDM_INST_ID_MAX;
+	}
+	pldm_instance_db_count(ctx, tid, PLDM_INSTANCE_DB_STAT(probes),
+			       scanned);
+
+	if (!claimed) {
+		return -EAGAIN;
+	}
+
+	state->allocations |= claimed;
+	*iids = claimed;
+
+	return 0;
+
+release_claimed:
+	for (; claimed; claimed &= claimed - 1) {
+		pldm_instance_id_unlock(ctx,
+					tid * PLDM_INST_ID_MAX +
+						__builtin_ctz(claimed),
+					1);
+	}
+
+	return rc;
+}
+
+static int pldm_instance_id_alloc_batch_db(struct pldm_instance_db *ctx,
+					   pldm_tid_t tid, unsigned int count,
+					   uint32_t *iids)
+{
+	if (ctx->lock_db_fd < 0) {
+		return pldm_instance_id_alloc_atomic(ctx, tid, count, iids);
+	}
+
+	return pldm_instance_id_alloc_batch_ofd(ctx, tid, count, iids);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_id_alloc_batch(struct pldm_instance_db *ctx, pldm_tid_t tid,
+				 unsigned int count, uint32_t *iids)
+{
+	uint32_t claimed;
+	uint64_t now;
+	int rc;
+
+	if (!ctx || !iids || !count || count > PLDM_INST_ID_MAX) {
 		return -EINVAL;
 	}
 
+	rc = pldm_instance_id_alloc_batch_db(ctx, tid, count, iids);
+	if (rc == -EAGAIN && ctx->leases && pldm_instance_id_expire(ctx, tid)) {
+		rc = pldm_instance_id_alloc_batch_db(ctx, tid, count, iids);
+	}
+
+	pldm_instance_db_account(ctx, tid, rc, rc ? 0 : *iids);
+	if (rc) {
+		return rc;
+	}
+
+	if (ctx->leases) {
+		now = pldm_instance_id_now_ms();
+		for (claimed = *iids; claimed; claimed &= claimed - 1) {
+			__atomic_store_n(
+				&ctx->leases[tid][__builtin_ctz(claimed)], now,
+				__ATOMIC_RELAXED);
+		}
+	}
+
+	return __builtin_popcount(*iids);
+}
+
+static int pldm_instance_id_release(struct pldm_instance_db *ctx,
+				    pldm_tid_t tid, pldm_instance_id_t iid)
+{
+	struct flock flop;
+	int rc;
+
+	if (ctx->lock_db_fd < 0) {
+		uint32_t prev;
+
+		if (ctx->leases) {
+			__atomic_store_n(&ctx->leases[tid][iid], 0,
+					 __ATOMIC_RELAXED);
+		}
+
+		prev = __atomic_fetch_and(&ctx->state[tid].allocations,
+					  ~(uint32_t)BIT(iid),
+					  __ATOMIC_RELEASE);
+		if (!(prev & BIT(iid))) {
+			return -EINVAL;
+		}
+
+		if (ctx->shm) {
+			pldm_instance_db_shm_release(&ctx->shm->tids[tid], iid);
+		}
+
+		return 0;
+	}
+
 	/* Trying to free an instance ID that is not currently allocated */
 	if (!(ctx->state[tid].allocations & BIT(iid))) {
 		return -EINVAL;
@@ -232,7 +1163,7 @@ int pldm_instance_id_free(struct pldm_instance_db *ctx, pldm_tid_t tid,
 
 	flop = pldm_instance_id_cflu;
 	flop.l_start = tid * PLDM_INST_ID_MAX + iid;
-	rc = fcntl(ctx->lock_db_fd, F_OFD_SETLK, &flop);
+	rc = pldm_instance_db_lock(ctx, F_OFD_SETLK, &flop);
 	if (rc < 0) {
 		if (errno == EAGAIN || errno == EINTR) {
 			return -EAGAIN;
@@ -242,6 +1173,197 @@ int pldm_instance_id_free(struct pldm_instance_db *ctx, pldm_tid_t tid,
 
 	/* Mark the instance ID as no-longer allocated */
 	ctx->state[tid].allocations &= ~BIT(iid);
+	if (ctx->leases) {
+		ctx->leases[tid][iid] = 0;
+	}
+
+	return 0;
+}
+
+/* Consume a late free of an expired allocation of the ID, if any */
+static bool pldm_instance_id_free_late(struct pldm_instance_db *ctx,
+				       pldm_tid_t tid, pldm_instance_id_t iid)
+{
+	uint32_t *late = &ctx->late[tid][iid];
+	uint32_t pending;
+
+	pending = __atomic_load_n(late, __ATOMIC_RELAXED);
+	do {
+		if (!pending) {
+			return false;
+		}
+	} while (!__atomic_compare_exchange_n(late, &pending, pending - 1, true,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	return true;
+}
+
+LIBPLDM_ABI_STABLE
+int pldm_instance_id_free(struct pldm_instance_db *ctx, pldm_tid_t tid,
+			  pldm_instance_id_t iid)
+{
+	/* check if provided context is null */
+	if (!ctx || iid >= PLDM_INST_ID_MAX) {
+		return -EINVAL;
+	}
+
+	if (ctx->late && pldm_instance_id_free_late(ctx, tid, iid)) {
+		return 0;
+	}
+
+	return pldm_instance_id_release(ctx, tid, iid);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_id_free_all(struct pldm_instance_db *ctx, pldm_tid_t tid)
+{
+	uint32_t allocations;
+	int freed = 0;
+	int rc;
+
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	allocations =
+		__atomic_load_n(&ctx->state[tid].allocations, __ATOMIC_RELAXED);
+	while (allocations) {
+		rc = pldm_instance_id_release(ctx, tid,
+					      __builtin_ctz(allocations));
+		/* -EINVAL if the ID was released concurrently */
+		if (!rc) {
+			freed++;
+		} else if (rc != -EINVAL) {
+			return rc;
+		}
+		allocations &= allocations - 1;
+	}
+
+	return freed;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_db_set_expiry(struct pldm_instance_db *ctx,
+				uint32_t expiry_ms)
+{
+	if (!ctx || (expiry_ms && expiry_ms < PLDM_INST_ID_PT3_MIN_MS)) {
+		return -EINVAL;
+	}
+
+	if (expiry_ms && !ctx->leases) {
+		/* Leases of IDs already allocated are left unstamped */
+		ctx->leases = calloc(PLDM_TID_MAX, sizeof(*ctx->leases));
+		ctx->late = calloc(PLDM_TID_MAX, sizeof(*ctx->late));
+		if (!ctx->leases || !ctx->late) {
+			free(ctx->leases);
+			ctx->leases = NULL;
+			free(ctx->late);
+			ctx->late = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	ctx->expiry_ms = expiry_ms;
+	if (!expiry_ms) {
+		free(ctx->leases);
+		ctx->leases = NULL;
+		free(ctx->late);
+		ctx->late = NULL;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_db_stats_enable(struct pldm_instance_db *ctx)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	if (ctx->stats) {
+		return -EBUSY;
+	}
+
+	ctx->stats = calloc(PLDM_TID_MAX, sizeof(*ctx->stats));
+	if (!ctx->stats) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_instance_db_stats_disable(struct pldm_instance_db *ctx)
+{
+	if (!ctx) {
+		return;
+	}
+
+	free(ctx->stats);
+	ctx->stats = NULL;
+}
+
+static void pldm_instance_db_stats_load(struct pldm_instance_db *ctx,
+					pldm_tid_t tid, uint64_t *counters)
+{
+	for (size_t i = 0; i < PLDM_INSTANCE_DB_STATS_COUNTERS; i++) {
+		counters[i] = __atomic_load_n(&ctx->stats[tid][i],
+					      __ATOMIC_RELAXED);
+	}
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_db_stats_snapshot(struct pldm_instance_db *ctx,
+				    struct pldm_instance_db_stats *stats)
+{
+	uint64_t total[PLDM_INSTANCE_DB_STATS_COUNTERS] = { 0 };
+	uint64_t counters[PLDM_INSTANCE_DB_STATS_COUNTERS];
+	const size_t peak = PLDM_INSTANCE_DB_STAT(peak);
+
+	if (!ctx || !stats) {
+		return -EINVAL;
+	}
+
+	if (!ctx->stats) {
+		return -ENODATA;
+	}
+
+	for (int tid = 0; tid < PLDM_TID_MAX; tid++) {
+		pldm_instance_db_stats_load(ctx, tid, counters);
+		for (size_t i = 0; i < PLDM_INSTANCE_DB_STATS_COUNTERS; i++) {
+			if (i != peak) {
+				total[i] += counters[i];
+			}
+		}
+		if (counters[peak] > total[peak]) {
+			total[peak] = counters[peak];
+		}
+	}
+
+	memcpy(stats, total, sizeof(*stats));
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_instance_db_stats_snapshot_tid(struct pldm_instance_db *ctx,
+					pldm_tid_t tid,
+					struct pldm_instance_db_stats *stats)
+{
+	uint64_t counters[PLDM_INSTANCE_DB_STATS_COUNTERS];
+
+	if (!ctx || !stats) {
+		return -EINVAL;
+	}
+
+	if (!ctx->stats) {
+		return -ENODATA;
+	}
+
+	pldm_instance_db_stats_load(ctx, tid, counters);
+	memcpy(stats, counters, sizeof(*stats));
 
 	return 0;
 }
@@ -0,0 +1,1043 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "compiler.h"
+#include "environ/errno.h"
+#include "environ/time.h"
+#include "requester/timer-wheel.h"
+#include "transport/container-of.h"
+#include "transport/transport.h"
+
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include <libpldm/requester.h>
+#include <libpldm/transport.h>
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Timing parameters from the "Timing specification" table of DSP0240.
+ *
+ * PT2min = PT1max + 2*PT4max = 300ms
+ * PT2max = PT3min - 2*PT4max = 4800ms
+ */
+#define PLDM_REQUESTER_PT2_MIN_MS 300
+#define PLDM_REQUESTER_PT2_MAX_MS 4800
+
+/* RFC 6298 gains for the round-trip estimator, as shifts */
+#define PLDM_REQUESTER_RTT_ALPHA_SHIFT 3
+#define PLDM_REQUESTER_RTT_BETA_SHIFT 2
+
+/* The number of PLDM types expressible in the 6-bit header field */
+#define PLDM_REQUESTER_TYPES 64
+
+/* A caller attached to an identical request already outstanding */
+struct pldm_requester_follower {
+	struct pldm_requester_follower *next;
+	void (*complete)(void *data, int rc, pldm_tid_t tid,
+			 const void *resp_msg, size_t resp_len);
+	void *data;
+	/* The instance ID of the caller's request, which is never sent */
+	uint8_t instance_id;
+};
+
+struct pldm_requester_req {
+	struct pldm_timer timer;
+	struct pldm_msg_hdr hdr;
+	pldm_tid_t tid;
+	uint8_t attempt;
+	/* When the latest attempt was sent, for round-trip estimation */
+	uint64_t sent_us;
+	void (*complete)(void *data, int rc, pldm_tid_t tid,
+			 const void *resp_msg, size_t resp_len);
+	void *data;
+	/* Retained for retransmission */
+	const void *req_msg;
+	size_t req_len;
+	/* Response storage for requests submitted without a completion */
+	void *resp_msg;
+	size_t resp_len;
+	int rc;
+	bool done;
+	/* Callers sharing the response, in order of submission */
+	struct pldm_requester_follower *followers;
+};
+
+/* A received message that didn't correlate with an outstanding request */
+struct pldm_requester_msg {
+	struct pldm_requester_msg *next;
+	void *msg;
+	size_t len;
+	pldm_tid_t tid;
+};
+
+/* Round-trip estimation for a TID, in microseconds */
+struct pldm_requester_rtt_state {
+	uint32_t srtt;
+	uint32_t rttvar;
+	bool valid;
+	bool degraded;
+	bool adaptive;
+};
+
+struct pldm_requester {
+	struct pldm_transport *transport;
+	struct pldm_requester_req
+		*inflight[PLDM_MAX_TIDS][PLDM_INSTANCE_MAX + 1];
+	struct pldm_requester_msg *unclaimed;
+	struct pldm_requester_msg **unclaimed_tail;
+	struct pldm_requester_retry_policy policy[PLDM_MAX_TIDS];
+	struct pldm_requester_rtt_state rtt[PLDM_MAX_TIDS];
+	struct pldm_timer_wheel wheel;
+	/* The tick for which timerfd is armed, or zero if disarmed */
+	uint64_t armed;
+	size_t timeouts;
+	int timerfd;
+	/* Bitmaps of the commands of each type that may be coalesced */
+	uint8_t coalesce[PLDM_REQUESTER_TYPES][256 / 8];
+	/* Bitmaps of the instance IDs held by attached requests */
+	uint32_t attached[PLDM_MAX_TIDS];
+};
+
+#define timer_to_req(ptr) container_of(ptr, struct pldm_requester_req, timer)
+
+static const struct pldm_requester_retry_policy pldm_requester_default = {
+	.timeout_ms = PLDM_REQUESTER_PT2_MAX_MS,
+	.retries = 0,
+	.backoff = 1,
+};
+
+static struct pldm_requester_req **
+pldm_requester_slot(struct pldm_requester *ctx, pldm_tid_t tid,
+		    const struct pldm_msg_hdr *hdr)
+{
+	return &ctx->inflight[tid][hdr->instance_id];
+}
+
+static int pldm_requester_now_ms(uint64_t *now)
+{
+	struct timespec ts;
+
+	if (libpldm_clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+		return -errno;
+	}
+
+	*now = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+
+	return 0;
+}
+
+/* Only issue timerfd_settime(2) when the earliest deadline changes */
+static int pldm_requester_arm(struct pldm_requester *ctx)
+{
+	struct itimerspec its = { 0 };
+	uint64_t tick;
+
+	if (!pldm_timer_wheel_next(&ctx->wheel, &tick)) {
+		tick = 0;
+	}
+
+	if (tick == ctx->armed) {
+		return 0;
+	}
+
+	if (tick) {
+		its.it_value.tv_sec = (time_t)(tick / 1000);
+		its.it_value.tv_nsec = (long)(tick % 1000) * 1000000;
+	}
+
+	if (timerfd_settime(ctx->timerfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		return -errno;
+	}
+
+	ctx->armed = tick;
+
+	return 0;
+}
+
+static uint32_t
+pldm_requester_backoff(const struct pldm_requester_retry_policy *policy,
+		       uint32_t wait, uint8_t attempt)
+{
+	while (attempt-- && wait < PLDM_REQUESTER_PT2_MAX_MS) {
+		wait *= policy->backoff;
+	}
+
+	return wait < PLDM_REQUESTER_PT2_MAX_MS ? wait :
+						  PLDM_REQUESTER_PT2_MAX_MS;
+}
+
+static uint32_t
+pldm_requester_policy_wait(const struct pldm_requester_retry_policy *policy,
+			   uint8_t attempt)
+{
+	return pldm_requester_backoff(policy, policy->timeout_ms, attempt);
+}
+
+/* The retransmission time-out of RFC 6298, bounded by PT2min and the policy */
+static uint32_t
+pldm_requester_rtt_timeout(const struct pldm_requester_retry_policy *policy,
+			   const struct pldm_requester_rtt_state *rtt)
+{
+	uint64_t rttvar4 = 4 * (uint64_t)rtt->rttvar;
+	uint64_t rto;
+
+	if (!rtt->adaptive) {
+		return policy->timeout_ms;
+	}
+
+	/* Degraded termini are only probed */
+	if (rtt->degraded) {
+		return PLDM_REQUESTER_PT2_MIN_MS;
+	}
+
+	if (!rtt->valid) {
+		return policy->timeout_ms;
+	}
+
+	/* The clock granularity term is one millisecond */
+	rto = (uint64_t)rtt->srtt + (rttvar4 > 1000 ? rttvar4 : 1000);
+	rto = (rto + 999) / 1000;
+
+	if (rto < PLDM_REQUESTER_PT2_MIN_MS) {
+		return PLDM_REQUESTER_PT2_MIN_MS;
+	}
+
+	return rto < policy->timeout_ms ? (uint32_t)rto : policy->timeout_ms;
+}
+
+/* Stamp a send whose round trip is measured, otherwise return 0 */
+static uint64_t pldm_requester_stamp(struct pldm_requester *ctx, pldm_tid_t tid)
+{
+	if (ctx->rtt[tid].adaptive) {
+		return pldm_transport_stats_clock_us();
+	}
+
+	return pldm_transport_stats_stamp(ctx->transport);
+}
+
+static void pldm_requester_rtt_sample(struct pldm_requester_rtt_state *rtt,
+				      uint64_t sample)
+{
+	uint32_t r = sample > UINT32_MAX ? UINT32_MAX : (uint32_t)sample;
+	uint32_t delta;
+
+	rtt->degraded = false;
+
+	if (!rtt->valid) {
+		rtt->srtt = r;
+		rtt->rttvar = r / 2;
+		rtt->valid = true;
+		return;
+	}
+
+	delta = rtt->srtt > r ? rtt->srtt - r : r - rtt->srtt;
+	rtt->rttvar = rtt->rttvar -
+		      (rtt->rttvar >> PLDM_REQUESTER_RTT_BETA_SHIFT) +
+		      (delta >> PLDM_REQUESTER_RTT_BETA_SHIFT);
+	rtt->srtt = rtt->srtt - (rtt->srtt >> PLDM_REQUESTER_RTT_ALPHA_SHIFT) +
+		    (r >> PLDM_REQUESTER_RTT_ALPHA_SHIFT);
+}
+
+static int pldm_requester_schedule(struct pldm_requester *ctx,
+				   struct pldm_requester_req *req)
+{
+	const struct pldm_requester_retry_policy *policy;
+	uint64_t now;
+	uint32_t wait;
+	int rc;
+
+	rc = pldm_requester_now_ms(&now);
+	if (rc) {
+		return rc;
+	}
+
+	policy = &ctx->policy[req->tid];
+	wait = pldm_requester_rtt_timeout(policy, &ctx->rtt[req->tid]);
+	pldm_timer_wheel_add(&ctx->wheel, &req->timer,
+			     now + pldm_requester_backoff(policy, wait,
+							  req->attempt));
+
+	return pldm_requester_arm(ctx);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_init(struct pldm_requester **ctx,
+			struct pldm_transport *transport)
+{
+	struct pldm_requester *requester;
+	uint64_t now;
+	int rc;
+
+	if (!ctx || *ctx || !transport) {
+		return -EINVAL;
+	}
+
+	rc = pldm_requester_now_ms(&now);
+	if (rc) {
+		return rc;
+	}
+
+	requester = calloc(1, sizeof(*requester));
+	if (!requester) {
+		return -ENOMEM;
+	}
+
+	requester->transport = transport;
+	requester->unclaimed_tail = &requester->unclaimed;
+	for (size_t tid = 0; tid < PLDM_MAX_TIDS; tid++) {
+		requester->policy[tid] = pldm_requester_default;
+	}
+	pldm_timer_wheel_init(&requester->wheel, now);
+
+	requester->timerfd =
+		timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (requester->timerfd < 0) {
+		rc = -errno;
+		goto cleanup_requester;
+	}
+
+	*ctx = requester;
+
+	return 0;
+
+cleanup_requester:
+	free(requester);
+	return rc;
+}
+
+static void pldm_requester_untrack(struct pldm_requester *ctx,
+				   struct pldm_requester_req *req)
+{
+	struct pldm_requester_follower *follower;
+
+	*pldm_requester_slot(ctx, req->tid, &req->hdr) = NULL;
+	for (follower = req->followers; follower; follower = follower->next) {
+		ctx->attached[req->tid] &= ~(UINT32_C(1)
+					     << follower->instance_id);
+	}
+	pldm_timer_wheel_del(&ctx->wheel, &req->timer);
+}
+
+static void pldm_requester_resolve(struct pldm_requester_req *req, int rc,
+				   void *resp_msg, size_t resp_len)
+{
+	struct pldm_requester_follower *follower;
+
+	while ((follower = req->followers)) {
+		req->followers = follower->next;
+		follower->complete(follower->data, rc, req->tid, resp_msg,
+				   resp_len);
+		free(follower);
+	}
+
+	if (!req->complete) {
+		/* The waiter in pldm_requester_send_recv() releases req */
+		req->resp_msg = resp_msg;
+		req->resp_len = resp_len;
+		req->rc = rc;
+		req->done = true;
+		return;
+	}
+
+	req->complete(req->data, rc, req->tid, resp_msg, resp_len);
+	free(resp_msg);
+	free(req);
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_requester_destroy(struct pldm_requester *ctx)
+{
+	struct pldm_requester_msg *msg;
+
+	if (!ctx) {
+		return;
+	}
+
+	for (size_t tid = 0; tid < PLDM_MAX_TIDS; tid++) {
+		for (size_t iid = 0; iid <= PLDM_INSTANCE_MAX; iid++) {
+			struct pldm_requester_req *req;
+
+			req = ctx->inflight[tid][iid];
+			if (!req) {
+				continue;
+			}
+
+			pldm_requester_untrack(ctx, req);
+			pldm_requester_resolve(req, -ECANCELED, NULL, 0);
+		}
+	}
+
+	while ((msg = ctx->unclaimed)) {
+		ctx->unclaimed = msg->next;
+		free(msg->msg);
+		free(msg);
+	}
+
+	close(ctx->timerfd);
+	free(ctx);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_set_retry_policy(
+	struct pldm_requester *ctx, pldm_tid_t tid,
+	const struct pldm_requester_retry_policy *policy)
+{
+	uint32_t elapsed = 0;
+
+	if (!ctx || !policy) {
+		return -EINVAL;
+	}
+
+	if (policy->timeout_ms < PLDM_REQUESTER_PT2_MIN_MS ||
+	    policy->timeout_ms > PLDM_REQUESTER_PT2_MAX_MS ||
+	    !policy->backoff) {
+		return -EINVAL;
+	}
+
+	/* The final retry must be issued before the instance ID expires */
+	for (uint8_t attempt = 0; attempt < policy->retries; attempt++) {
+		elapsed += pldm_requester_policy_wait(policy, attempt);
+		if (elapsed > PLDM_REQUESTER_PT2_MAX_MS) {
+			return -EINVAL;
+		}
+	}
+
+	ctx->policy[tid] = *policy;
+
+	return 0;
+}
+
+static int pldm_requester_track(struct pldm_requester *ctx, pldm_tid_t tid,
+				const void *req_msg, size_t req_len,
+				struct pldm_requester_req *req)
+{
+	const struct pldm_msg_hdr *hdr = req_msg;
+	struct pldm_requester_req **slot;
+	pldm_requester_rc_t rc;
+	int ret;
+
+	if (!hdr->request) {
+		return -EINVAL;
+	}
+
+	slot = pldm_requester_slot(ctx, tid, hdr);
+	if (*slot || (ctx->attached[tid] & (UINT32_C(1) << hdr->instance_id))) {
+		return -EBUSY;
+	}
+
+	req->hdr = *hdr;
+	req->tid = tid;
+	req->req_msg = req_msg;
+	req->req_len = req_len;
+
+	/* Track before sending so a fast response can't race the insertion */
+	*slot = req;
+
+	req->sent_us = pldm_requester_stamp(ctx, tid);
+	rc = pldm_transport_send_msg(ctx->transport, tid, req_msg, req_len);
+	if (rc != PLDM_REQUESTER_SUCCESS) {
+		*slot = NULL;
+		return -EIO;
+	}
+
+	ret = pldm_requester_schedule(ctx, req);
+	if (ret) {
+		pldm_requester_untrack(ctx, req);
+		return ret;
+	}
+
+	return 0;
+}
+
+static bool pldm_requester_coalescable(struct pldm_requester *ctx,
+				       const struct pldm_msg_hdr *hdr)
+{
+	return ctx->coalesce[hdr->type][hdr->command / 8] &
+	       (1 << (hdr->command % 8));
+}
+
+/* Find an outstanding request to @tid identical to @req_msg but for its IID */
+static struct pldm_requester_req *
+pldm_requester_identical(struct pldm_requester *ctx, pldm_tid_t tid,
+			 const void *req_msg, size_t req_len)
+{
+	const struct pldm_msg_hdr *hdr = req_msg;
+	const size_t hdr_len = sizeof(*hdr);
+	struct pldm_requester_req *req;
+
+	for (size_t iid = 0; iid <= PLDM_INSTANCE_MAX; iid++) {
+		req = ctx->inflight[tid][iid];
+
+		/* Requests awaited by pldm_requester_send_recv() don't share */
+		if (!req || !req->complete) {
+			continue;
+		}
+
+		if (req->hdr.type != hdr->type ||
+		    req->hdr.command != hdr->command ||
+		    req->req_len != req_len) {
+			continue;
+		}
+
+		if (!memcmp((const uint8_t *)req->req_msg + hdr_len,
+			    (const uint8_t *)req_msg + hdr_len,
+			    req_len - hdr_len)) {
+			return req;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Attach the caller to an identical outstanding request if the command may be
+ * coalesced. Returns 0 if attached, 1 if the request must be sent, or a
+ * negative errno value.
+ */
+static int pldm_requester_coalesce(
+	struct pldm_requester *ctx, pldm_tid_t tid, const void *req_msg,
+	size_t req_len,
+	void (*complete)(void *data, int rc, pldm_tid_t tid,
+			 const void *resp_msg, size_t resp_len),
+	void *data)
+{
+	const struct pldm_msg_hdr *hdr = req_msg;
+	struct pldm_requester_follower *follower;
+	struct pldm_requester_follower **tail;
+	struct pldm_requester_req *leader;
+
+	if (!hdr->request || !pldm_requester_coalescable(ctx, hdr)) {
+		return 1;
+	}
+
+	/* The caller's instance ID must be as available as if it were sent */
+	if (*pldm_requester_slot(ctx, tid, hdr) ||
+	    (ctx->attached[tid] & (UINT32_C(1) << hdr->instance_id))) {
+		return -EBUSY;
+	}
+
+	leader = pldm_requester_identical(ctx, tid, req_msg, req_len);
+	if (!leader) {
+		return 1;
+	}
+
+	follower = malloc(sizeof(*follower));
+	if (!follower) {
+		return -ENOMEM;
+	}
+
+	follower->next = NULL;
+	follower->complete = complete;
+	follower->data = data;
+	follower->instance_id = hdr->instance_id;
+
+	for (tail = &leader->followers; *tail; tail = &(*tail)->next) {
+		;
+	}
+	*tail = follower;
+	ctx->attached[tid] |= UINT32_C(1) << hdr->instance_id;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_set_coalescing(struct pldm_requester *ctx, uint8_t type,
+				  uint8_t command, bool enable)
+{
+	uint8_t mask = 1 << (command % 8);
+
+	if (!ctx || type >= PLDM_REQUESTER_TYPES) {
+		return -EINVAL;
+	}
+
+	if (enable) {
+		ctx->coalesce[type][command / 8] |= mask;
+	} else {
+		ctx->coalesce[type][command / 8] &= ~mask;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_submit(struct pldm_requester *ctx, pldm_tid_t tid,
+			  const void *req_msg, size_t req_len,
+			  void (*complete)(void *data, int rc, pldm_tid_t tid,
+					   const void *resp_msg,
+					   size_t resp_len),
+			  void *data)
+{
+	struct pldm_requester_req *req;
+	int rc;
+
+	if (!ctx || !req_msg || req_len < sizeof(struct pldm_msg_hdr) ||
+	    !complete) {
+		return -EINVAL;
+	}
+
+	rc = pldm_requester_coalesce(ctx, tid, req_msg, req_len, complete,
+				     data);
+	if (rc <= 0) {
+		return rc;
+	}
+
+	/* Keep a copy of the request with the tracking state for retries */
+	req = calloc(1, sizeof(*req) + req_len);
+	if (!req) {
+		return -ENOMEM;
+	}
+
+	memcpy(req + 1, req_msg, req_len);
+	req->complete = complete;
+	req->data = data;
+
+	rc = pldm_requester_track(ctx, tid, req + 1, req_len, req);
+	if (rc) {
+		free(req);
+		return rc;
+	}
+
+	return 0;
+}
+
+static int pldm_requester_cancel_follower(struct pldm_requester *ctx,
+					  pldm_tid_t tid,
+					  const struct pldm_msg_hdr *hdr)
+{
+	struct pldm_requester_follower **link;
+	struct pldm_requester_follower *follower;
+	struct pldm_requester_req *req;
+
+	if (!(ctx->attached[tid] & (UINT32_C(1) << hdr->instance_id))) {
+		return -ENOENT;
+	}
+
+	for (size_t iid = 0; iid <= PLDM_INSTANCE_MAX; iid++) {
+		req = ctx->inflight[tid][iid];
+		if (!req || req->hdr.type != hdr->type ||
+		    req->hdr.command != hdr->command) {
+			continue;
+		}
+
+		for (link = &req->followers; (follower = *link);
+		     link = &follower->next) {
+			if (follower->instance_id != hdr->instance_id) {
+				continue;
+			}
+
+			*link = follower->next;
+			ctx->attached[tid] &= ~(UINT32_C(1)
+						<< follower->instance_id);
+			follower->complete(follower->data, -ECANCELED, tid,
+					   NULL, 0);
+			free(follower);
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_cancel(struct pldm_requester *ctx, pldm_tid_t tid,
+			  const void *req_msg, size_t req_len)
+{
+	const struct pldm_msg_hdr *hdr = req_msg;
+	struct pldm_requester_req *req;
+
+	if (!ctx || !req_msg || req_len < sizeof(*hdr)) {
+		return -EINVAL;
+	}
+
+	req = *pldm_requester_slot(ctx, tid, hdr);
+	if (!req || req->hdr.type != hdr->type ||
+	    req->hdr.command != hdr->command) {
+		return pldm_requester_cancel_follower(ctx, tid, hdr);
+	}
+
+	/*
+	 * The request is on the wire under the caller's instance ID, which the
+	 * caller is free to reuse once it's cancelled
+	 */
+	if (req->followers) {
+		return -EBUSY;
+	}
+
+	pldm_requester_untrack(ctx, req);
+	pldm_requester_resolve(req, -ECANCELED, NULL, 0);
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_init_pollfd(struct pldm_requester *ctx,
+			       struct pollfd *pollfd)
+{
+	if (!ctx || !pollfd) {
+		return -EINVAL;
+	}
+
+	pollfd->fd = ctx->timerfd;
+	pollfd->events = POLLIN;
+
+	return 0;
+}
+
+static void pldm_requester_timeout(struct pldm_requester *ctx,
+				   struct pldm_requester_req *req)
+{
+	const struct pldm_requester_retry_policy *policy =
+		&ctx->policy[req->tid];
+	pldm_requester_rc_t rc;
+
+	const struct pldm_requester_rtt_state *rtt = &ctx->rtt[req->tid];
+
+	ctx->timeouts++;
+	pldm_transport_stats_count(ctx->transport, req->tid,
+				   PLDM_TRANSPORT_STAT(timeouts), 1);
+
+	/* Probes of degraded termini aren't retried */
+	if (req->attempt < policy->retries &&
+	    !(rtt->adaptive && rtt->degraded)) {
+		/* DSP0240 requires retries to use the original instance ID */
+		req->attempt++;
+		req->sent_us = pldm_requester_stamp(ctx, req->tid);
+		rc = pldm_transport_send_msg(ctx->transport, req->tid,
+					     req->req_msg, req->req_len);
+		if (rc == PLDM_REQUESTER_SUCCESS &&
+		    !pldm_requester_schedule(ctx, req)) {
+			return;
+		}
+
+		pldm_requester_untrack(ctx, req);
+		pldm_requester_resolve(req, -EIO, NULL, 0);
+		return;
+	}
+
+	ctx->rtt[req->tid].degraded = true;
+	pldm_requester_untrack(ctx, req);
+	pldm_requester_resolve(req, -ETIMEDOUT, NULL, 0);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_expire(struct pldm_requester *ctx)
+{
+	struct pldm_timer *expired;
+	uint64_t expirations;
+	uint64_t now;
+	int rc;
+
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	/* Acknowledge the expiration. EAGAIN indicates a spurious call */
+	if (read(ctx->timerfd, &expirations, sizeof(expirations)) < 0 &&
+	    errno != EAGAIN) {
+		return -errno;
+	}
+
+	/* Force a re-arm as the timerfd is no-longer armed */
+	ctx->armed = 0;
+
+	rc = pldm_requester_now_ms(&now);
+	if (rc) {
+		return rc;
+	}
+
+	expired = pldm_timer_wheel_advance(&ctx->wheel, now);
+	while (expired) {
+		struct pldm_requester_req *req = timer_to_req(expired);
+
+		expired = expired->next;
+		req->timer.next = NULL;
+		pldm_requester_timeout(ctx, req);
+	}
+
+	return pldm_requester_arm(ctx);
+}
+
+/*
+ * Wait for the transport to become readable while servicing request time-outs.
+ * Returns 1 if the transport is readable, 0 otherwise, or -ECONNRESET if it
+ * hung up or failed with nothing left to read
+ */
+static int pldm_requester_wait(struct pldm_requester *ctx, int timeout)
+{
+	struct pollfd pollfds[2];
+	int rc;
+
+	/* If polling isn't supported then the transport is always ready */
+	if (!ctx->transport->init_pollfd) {
+		return 1;
+	}
+
+	if (ctx->transport->init_pollfd(ctx->transport, &pollfds[0]) < 0) {
+		return -EIO;
+	}
+
+	pldm_requester_init_pollfd(ctx, &pollfds[1]);
+
+	do {
+		size_t timeouts = ctx->timeouts;
+
+		rc = poll(pollfds, 2, timeout);
+		if (rc < 0) {
+			return -errno;
+		}
+
+		if (!(pollfds[1].revents & POLLIN)) {
+			break;
+		}
+
+		rc = pldm_requester_expire(ctx);
+		if (rc < 0) {
+			return rc;
+		}
+
+		/*
+		 * The timer also fires to cascade the wheel. Don't surface
+		 * those wake-ups to callers waiting indefinitely.
+		 */
+		if (ctx->timeouts != timeouts) {
+			break;
+		}
+	} while (timeout < 0 &&
+		 !(pollfds[0].revents & (POLLIN | POLLHUP | POLLERR)));
+
+	/* Messages queued ahead of a hang-up are still delivered */
+	if (pollfds[0].revents & POLLIN) {
+		return 1;
+	}
+
+	if (pollfds[0].revents & (POLLHUP | POLLERR)) {
+		return -ECONNRESET;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_poll(struct pldm_requester *ctx, int timeout)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	if (ctx->unclaimed) {
+		return 1;
+	}
+
+	return pldm_requester_wait(ctx, timeout);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_set_adaptive_timeout(struct pldm_requester *ctx,
+					pldm_tid_t tid, bool enable)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	ctx->rtt[tid].adaptive = enable;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_get_rtt(struct pldm_requester *ctx, pldm_tid_t tid,
+			   struct pldm_requester_rtt *rtt)
+{
+	const struct pldm_requester_rtt_state *state;
+
+	if (!ctx || !rtt) {
+		return -EINVAL;
+	}
+
+	state = &ctx->rtt[tid];
+	rtt->srtt_us = state->valid ? state->srtt : 0;
+	rtt->rttvar_us = state->valid ? state->rttvar : 0;
+	rtt->timeout_ms = pldm_requester_rtt_timeout(&ctx->policy[tid], state);
+	rtt->degraded = state->degraded;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_handle_msg(struct pldm_requester *ctx, pldm_tid_t tid,
+			      void *msg, size_t len)
+{
+	const struct pldm_msg_hdr *hdr = msg;
+	struct pldm_requester_req *req;
+
+	if (!ctx || !msg || len < sizeof(*hdr)) {
+		return -EINVAL;
+	}
+
+	if (hdr->request) {
+		return 1;
+	}
+
+	req = *pldm_requester_slot(ctx, tid, hdr);
+	if (!req || !pldm_msg_hdr_correlate_response(&req->hdr, hdr)) {
+		return 1;
+	}
+
+	/* Responses to retries are ambiguous, so aren't sampled (Karn) */
+	if (ctx->rtt[tid].adaptive && !req->attempt && req->sent_us) {
+		uint64_t now = pldm_transport_stats_clock_us();
+
+		if (now > req->sent_us) {
+			pldm_requester_rtt_sample(&ctx->rtt[tid],
+						  now - req->sent_us);
+		}
+	} else {
+		ctx->rtt[tid].degraded = false;
+	}
+
+	pldm_transport_stats_rtt(ctx->transport, tid, req->sent_us);
+	pldm_requester_untrack(ctx, req);
+	pldm_requester_resolve(req, 0, msg, len);
+
+	return 0;
+}
+
+static int pldm_requester_recv_transport(struct pldm_requester *ctx,
+					 pldm_tid_t *tid, void **msg,
+					 size_t *len)
+{
+	pldm_requester_rc_t rc;
+
+	rc = pldm_transport_recv_msg(ctx->transport, tid, msg, len);
+	switch (rc) {
+	case PLDM_REQUESTER_SUCCESS:
+		break;
+	case PLDM_REQUESTER_NOT_PLDM_MSG:
+	case PLDM_REQUESTER_INVALID_RECV_LEN:
+		return -EBADMSG;
+	default:
+		return -EIO;
+	}
+
+	return pldm_requester_handle_msg(ctx, *tid, *msg, *len);
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_recv(struct pldm_requester *ctx, pldm_tid_t *tid,
+			void **msg, size_t *len)
+{
+	struct pldm_requester_msg *unclaimed;
+
+	if (!ctx || !tid || !msg || !len) {
+		return -EINVAL;
+	}
+
+	unclaimed = ctx->unclaimed;
+	if (unclaimed) {
+		ctx->unclaimed = unclaimed->next;
+		if (!ctx->unclaimed) {
+			ctx->unclaimed_tail = &ctx->unclaimed;
+		}
+
+		*tid = unclaimed->tid;
+		*msg = unclaimed->msg;
+		*len = unclaimed->len;
+		free(unclaimed);
+
+		return 1;
+	}
+
+	return pldm_requester_recv_transport(ctx, tid, msg, len);
+}
+
+static int pldm_requester_retain(struct pldm_requester *ctx, pldm_tid_t tid,
+				 void *msg, size_t len)
+{
+	struct pldm_requester_msg *unclaimed;
+
+	unclaimed = malloc(sizeof(*unclaimed));
+	if (!unclaimed) {
+		return -ENOMEM;
+	}
+
+	unclaimed->next = NULL;
+	unclaimed->msg = msg;
+	unclaimed->len = len;
+	unclaimed->tid = tid;
+
+	*ctx->unclaimed_tail = unclaimed;
+	ctx->unclaimed_tail = &unclaimed->next;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_requester_send_recv(struct pldm_requester *ctx, pldm_tid_t tid,
+			     const void *req_msg, size_t req_len,
+			     void **resp_msg, size_t *resp_len)
+{
+	struct pldm_requester_req waiter = { 0 };
+	int rc;
+
+	if (!ctx || !req_msg || req_len < sizeof(struct pldm_msg_hdr) ||
+	    !resp_msg || !resp_len) {
+		return -EINVAL;
+	}
+
+	rc = pldm_requester_track(ctx, tid, req_msg, req_len, &waiter);
+	if (rc) {
+		return rc;
+	}
+
+	/* The waiter's timer bounds the wait, so block indefinitely */
+	while (!waiter.done) {
+		pldm_tid_t src;
+		size_t len;
+		void *msg;
+
+		rc = pldm_requester_wait(ctx, -1);
+		if (rc < 0) {
+			goto cleanup_waiter;
+		}
+
+		if (rc == 0) {
+			continue;
+		}
+
+		rc = pldm_requester_recv_transport(ctx, &src, &msg, &len);
+		if (rc == -EIO) {
+			goto cleanup_waiter;
+		}
+
+		if (rc == 1) {
+			rc = pldm_requester_retain(ctx, src, msg, len);
+			if (rc) {
+				free(msg);
+				goto cleanup_waiter;
+			}
+		}
+	}
+
+	if (waiter.rc) {
+		return waiter.rc;
+	}
+
+	*resp_msg = waiter.resp_msg;
+	*resp_len = waiter.resp_len;
+
+	return 0;
+
+cleanup_waiter:
+	if (!waiter.done) {
+		pldm_requester_untrack(ctx, &waiter);
+	}
+
+	return rc;
+}
@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "timer-wheel.h"
+
+#include <assert.h>
+#include <string.h>
+
+#define LEVEL_SHIFT(l) (PLDM_TIMER_WHEEL_BITS * (l))
+
+/* The largest interval that can be represented without parking */
+#define PLDM_TIMER_WHEEL_RANGE                                                 \
+	((UINT64_C(1) << LEVEL_SHIFT(PLDM_TIMER_WHEEL_LEVELS)) - 1)
+
+void pldm_timer_wheel_init(struct pldm_timer_wheel *wheel, uint64_t now)
+{
+	memset(wheel->slots, 0, sizeof(wheel->slots));
+	wheel->now = now;
+	wheel->count = 0;
+}
+
+static void pldm_timer_link(struct pldm_timer **head, struct pldm_timer *timer)
+{
+	timer->next = *head;
+	if (timer->next) {
+		timer->next->pprev = &timer->next;
+	}
+	timer->pprev = head;
+	*head = timer;
+}
+
+static void pldm_timer_unlink(struct pldm_timer *timer)
+{
+	*timer->pprev = timer->next;
+	if (timer->next) {
+		timer->next->pprev = timer->pprev;
+	}
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/*
+ * @p base is the earliest tick that may yet be processed. Timers that are
+ * already due are placed so they expire at @p base.
+ */
+static void pldm_timer_wheel_place(struct pldm_timer_wheel *wheel,
+				   struct pldm_timer *timer, uint64_t base)
+{
+	uint64_t expires = timer->expires > base ? timer->expires : base;
+	uint64_t delta = expires - base;
+	unsigned int level;
+
+	if (delta > PLDM_TIMER_WHEEL_RANGE) {
+		delta = PLDM_TIMER_WHEEL_RANGE;
+		expires = base + delta;
+	}
+
+	for (level = 0; level < PLDM_TIMER_WHEEL_LEVELS - 1; level++) {
+		if (delta < (UINT64_C(1) << LEVEL_SHIFT(level + 1))) {
+			break;
+		}
+	}
+
+	pldm_timer_link(&wheel->slots[level][(expires >> LEVEL_SHIFT(level)) &
+					     PLDM_TIMER_WHEEL_MASK],
+			timer);
+}
+
+void pldm_timer_wheel_add(struct pldm_timer_wheel *wheel,
+			  struct pldm_timer *timer, uint64_t expires)
+{
+	assert(!pldm_timer_pending(timer));
+
+	timer->expires = expires;
+	pldm_timer_wheel_place(wheel, timer, wheel->now + 1);
+	wheel->count++;
+}
+
+void pldm_timer_wheel_del(struct pldm_timer_wheel *wheel,
+			  struct pldm_timer *timer)
+{
+	if (!pldm_timer_pending(timer)) {
+		return;
+	}
+
+	pldm_timer_unlink(timer);
+	assert(wheel->count);
+	wheel->count--;
+}
+
+bool pldm_timer_wheel_next(const struct pldm_timer_wheel *wheel,
+			   uint64_t *tick)
+{
+	bool found = false;
+	uint64_t best = 0;
+
+	if (!wheel->count) {
+		return false;
+	}
+
+	for (unsigned int level = 0; level < PLDM_TIMER_WHEEL_LEVELS; level++) {
+		uint64_t cur = wheel->now >> LEVEL_SHIFT(level);
+
+		/*
+		 * Slots at level 0 expire at their tick. Slots at upper levels
+		 * cascade when the lower levels wrap to zero.
+		 */
+		for (uint64_t k = 1; k <= PLDM_TIMER_WHEEL_SLOTS; k++) {
+			uint64_t candidate = (cur + k) << LEVEL_SHIFT(level);
+
+			if (found && candidate >= best) {
+				break;
+			}
+
+			if (wheel->slots[level]
+					[(cur + k) & PLDM_TIMER_WHEEL_MASK]) {
+				best = candidate;
+				found = true;
+				break;
+			}
+		}
+	}
+
+	assert(found);
+	*tick = best;
+
+	return found;
+}
+
+static void pldm_timer_wheel_cascade(struct pldm_timer_wheel *wheel,
+				     uint64_t tick)
+{
+	for (unsigned int level = 1; level < PLDM_TIMER_WHEEL_LEVELS; level++) {
+		struct pldm_timer **slot;
+		struct pldm_timer *timer;
+
+		if (tick & ((UINT64_C(1) << LEVEL_SHIFT(level)) - 1)) {
+			break;
+		}
+
+		slot = &wheel->slots[level][(tick >> LEVEL_SHIFT(level)) &
+					    PLDM_TIMER_WHEEL_MASK];
+		while ((timer = *slot)) {
+			pldm_timer_unlink(timer);
+			pldm_timer_wheel_place(wheel, timer, tick);
+		}
+	}
+}
+
+struct pldm_timer *pldm_timer_wheel_advance(struct pldm_timer_wheel *wheel,
+					    uint64_t now)
+{
+	struct pldm_timer *expired = NULL;
+	struct pldm_timer **tail = &expired;
+	uint64_t tick;
+
+	/* Skip directly to the ticks where there's work to do */
+	while (pldm_timer_wheel_next(wheel, &tick) && tick <= now) {
+		struct pldm_timer **slot;
+		struct pldm_timer *timer;
+
+		wheel->now = tick;
+		pldm_timer_wheel_cascade(wheel, tick);
+
+		slot = &wheel->slots[0][tick & PLDM_TIMER_WHEEL_MASK];
+		while ((timer = *slot)) {
+			pldm_timer_unlink(timer);
+			wheel->count--;
+			*tail = timer;
+			tail = &timer->next;
+		}
+	}
+
+	if (wheel->now < now) {
+		wheel->now = now;
+	}
+
+	return expired;
+}
@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A hierarchical timer wheel. Each level holds 64 slots, and each slot of a
+ * level spans the entire range of the level below it. With millisecond ticks
+ * the four levels cover a little over four and a half hours, beyond which
+ * timers are parked in the final slot of the top level until they cascade.
+ *
+ * Insertion and removal are O(1). Advancing the wheel only touches the slots
+ * holding timers that expire or cascade in the elapsed interval.
+ */
+#define PLDM_TIMER_WHEEL_BITS	6
+#define PLDM_TIMER_WHEEL_SLOTS	(1U << PLDM_TIMER_WHEEL_BITS)
+#define PLDM_TIMER_WHEEL_MASK	(PLDM_TIMER_WHEEL_SLOTS - 1)
+#define PLDM_TIMER_WHEEL_LEVELS 4
+
+struct pldm_timer {
+	struct pldm_timer *next;
+	struct pldm_timer **pprev;
+	uint64_t expires;
+};
+
+struct pldm_timer_wheel {
+	struct pldm_timer
+		*slots[PLDM_TIMER_WHEEL_LEVELS][PLDM_TIMER_WHEEL_SLOTS];
+	/* The most recently processed tick */
+	uint64_t now;
+	size_t count;
+};
+
+void pldm_timer_wheel_init(struct pldm_timer_wheel *wheel, uint64_t now);
+
+static inline bool pldm_timer_pending(const struct pldm_timer *timer)
+{
+	return timer->pprev != NULL;
+}
+
+/* Schedule @p timer to expire at tick @p expires. It must not be pending */
+void pldm_timer_wheel_add(struct pldm_timer_wheel *wheel,
+			  struct pldm_timer *timer, uint64_t expires);
+
+/* Cancel @p timer. It is not an error if @p timer is not pending */
+void pldm_timer_wheel_del(struct pldm_timer_wheel *wheel,
+			  struct pldm_timer *timer);
+
+/*
+ * Process all ticks up to and including @p now. The expired timers are
+ * returned as a list linked through their next members, and are no longer
+ * pending.
+ */
+struct pldm_timer *pldm_timer_wheel_advance(struct pldm_timer_wheel *wheel,
+					    uint64_t now);
+
+/*
+ * Find the next tick at which the wheel must be advanced. The result is a lower
+ * bound on the earliest expiry, as a timer on an upper level may cascade
+ * rather than expire. Returns false if no timers are pending.
+ */
+bool pldm_timer_wheel_next(const struct pldm_timer_wheel *wheel,
+			   uint64_t *tick);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,10 +1,16 @@
 /* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "environ/errno.h"
 #include "responder.h"
 
 #include <libpldm/base.h>
 #include <libpldm/pldm.h>
 
+#include <stdalign.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 static bool pldm_responder_cookie_eq(const struct pldm_responder_cookie *left,
 				     const struct pldm_responder_cookie *right)
@@ -14,57 +20,220 @@ static bool pldm_responder_cookie_eq(const struct pldm_responder_cookie *left,
 	       left->type == right->type && left->command == right->command;
 }
 
-int pldm_responder_cookie_track(struct pldm_responder_cookie *jar,
+static struct pldm_responder_cookie **
+pldm_responder_cookie_bucket(struct pldm_responder_cookie_jar *jar,
+			     const struct pldm_responder_cookie *cookie)
+{
+	uint32_t key = (uint32_t)cookie->tid |
+		       ((uint32_t)cookie->instance_id << 8) |
+		       ((uint32_t)cookie->type << 13) |
+		       ((uint32_t)cookie->command << 19);
+
+	/* Fibonacci hashing */
+	key *= UINT32_C(2654435761);
+
+	return &jar->buckets[key >> (32 - PLDM_RESPONDER_COOKIE_BUCKET_BITS)];
+}
+
+static struct pldm_responder_cookie **
+pldm_responder_cookie_find(struct pldm_responder_cookie_jar *jar,
+			   const struct pldm_responder_cookie *cookie)
+{
+	struct pldm_responder_cookie **link;
+
+	link = pldm_responder_cookie_bucket(jar, cookie);
+	while (*link && !pldm_responder_cookie_eq(*link, cookie)) {
+		link = &(*link)->next;
+	}
+
+	return link;
+}
+
+/* Remove the cookie at @p link from its bucket and from the age order */
+static struct pldm_responder_cookie *
+pldm_responder_cookie_unlink(struct pldm_responder_cookie_jar *jar,
+			     struct pldm_responder_cookie **link)
+{
+	struct pldm_responder_cookie *cookie = *link;
+
+	*link = cookie->next;
+	cookie->next = NULL;
+
+	if (cookie->older) {
+		cookie->older->newer = cookie->newer;
+	} else {
+		jar->oldest = cookie->newer;
+	}
+
+	if (cookie->newer) {
+		cookie->newer->older = cookie->older;
+	} else {
+		jar->newest = cookie->older;
+	}
+
+	cookie->older = NULL;
+	cookie->newer = NULL;
+
+	return cookie;
+}
+
+static bool
+pldm_responder_cookie_in_slab(struct pldm_responder_cookie_jar *jar,
+			      struct pldm_responder_cookie *cookie)
+{
+	uintptr_t base = (uintptr_t)jar->slab;
+	uintptr_t addr = (uintptr_t)cookie;
+
+	return jar->slab && addr >= base &&
+	       addr - base < jar->size * jar->count;
+}
+
+int pldm_responder_cookie_jar_init(struct pldm_responder_cookie_jar *jar,
+				   size_t size, size_t count)
+{
+	if (!jar || size < sizeof(struct pldm_responder_cookie) || !count) {
+		return -EINVAL;
+	}
+
+	if (jar->slab) {
+		return -EBUSY;
+	}
+
+	/* Keep each cookie suitably aligned */
+	size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+	if (count > SIZE_MAX / size) {
+		return -EINVAL;
+	}
+
+	jar->slab = malloc(size * count);
+	if (!jar->slab) {
+		return -ENOMEM;
+	}
+
+	jar->size = size;
+	jar->count = count;
+	jar->free = NULL;
+
+	for (size_t i = count; i > 0; i--) {
+		unsigned char *cookie = (unsigned char *)jar->slab +
+					(i - 1) * size;
+
+		pldm_responder_cookie_free(
+			jar, (struct pldm_responder_cookie *)cookie);
+	}
+
+	return 0;
+}
+
+void pldm_responder_cookie_jar_fini(struct pldm_responder_cookie_jar *jar)
+{
+	if (!jar) {
+		return;
+	}
+
+	free(jar->slab);
+	memset(jar, 0, sizeof(*jar));
+}
+
+struct pldm_responder_cookie *
+pldm_responder_cookie_alloc(struct pldm_responder_cookie_jar *jar)
+{
+	struct pldm_responder_cookie *cookie;
+
+	if (!jar) {
+		return NULL;
+	}
+
+	/* Reclaim the cookie of the request left unanswered the longest */
+	if (!jar->free) {
+		cookie = jar->oldest;
+		if (!cookie || !pldm_responder_cookie_in_slab(jar, cookie)) {
+			return NULL;
+		}
+
+		return pldm_responder_cookie_unlink(
+			jar, pldm_responder_cookie_find(jar, cookie));
+	}
+
+	cookie = jar->free;
+	jar->free = cookie->next;
+	cookie->next = NULL;
+
+	return cookie;
+}
+
+void pldm_responder_cookie_free(struct pldm_responder_cookie_jar *jar,
+				struct pldm_responder_cookie *cookie)
+{
+	if (!jar || !cookie) {
+		return;
+	}
+
+	cookie->next = jar->free;
+	jar->free = cookie;
+}
+
+int pldm_responder_cookie_track(struct pldm_responder_cookie_jar *jar,
 				struct pldm_responder_cookie *cookie)
 {
-	struct pldm_responder_cookie *current;
-	struct pldm_responder_cookie *next;
+	struct pldm_responder_cookie **link;
+	struct pldm_responder_cookie *stale;
 
 	if (!jar || !cookie) {
 		return PLDM_REQUESTER_INVALID_SETUP;
 	}
 
-	current = jar;
-	next = current->next;
-	while (next) {
-		/* Cookie must not already be known */
-		if (pldm_responder_cookie_eq(next, cookie)) {
-			return PLDM_REQUESTER_INVALID_SETUP;
+	link = pldm_responder_cookie_find(jar, cookie);
+	if (*link == cookie) {
+		return PLDM_REQUESTER_INVALID_SETUP;
+	}
+
+	/*
+	 * The key was reused before the earlier request was answered, either
+	 * by a retry or after the instance ID wrapped. Only the latest request
+	 * can be responded to.
+	 */
+	if (*link) {
+		stale = pldm_responder_cookie_unlink(jar, link);
+		if (pldm_responder_cookie_in_slab(jar, stale)) {
+			pldm_responder_cookie_free(jar, stale);
 		}
-		current = next;
-		next = next->next;
 	}
 
-	cookie->next = NULL;
-	current->next = cookie;
+	link = pldm_responder_cookie_bucket(jar, cookie);
+	cookie->next = *link;
+	*link = cookie;
+
+	cookie->older = jar->newest;
+	cookie->newer = NULL;
+	if (jar->newest) {
+		jar->newest->newer = cookie;
+	} else {
+		jar->oldest = cookie;
+	}
+	jar->newest = cookie;
 
 	return PLDM_REQUESTER_SUCCESS;
 }
 
 struct pldm_responder_cookie *
-pldm_responder_cookie_untrack(struct pldm_responder_cookie *jar, pldm_tid_t tid,
-			      pldm_instance_id_t instance_id, uint8_t type,
-			      uint8_t command)
+pldm_responder_cookie_untrack(struct pldm_responder_cookie_jar *jar,
+			      pldm_tid_t tid, pldm_instance_id_t instance_id,
+			      uint8_t type, uint8_t command)
 {
-	const struct pldm_responder_cookie cookie = { tid, instance_id, type,
-						      command, NULL };
-	struct pldm_responder_cookie *current;
-	struct pldm_responder_cookie *next;
+	const struct pldm_responder_cookie cookie = {
+		tid, instance_id, type, command, NULL, NULL, NULL
+	};
+	struct pldm_responder_cookie **link;
 
 	if (!jar) {
 		return NULL;
 	}
 
-	current = jar;
-	next = current->next;
-	while (next && !pldm_responder_cookie_eq(next, &cookie)) {
-		current = next;
-		next = next->next;
-	}
-
-	if (next) {
-		current->next = next->next;
+	link = pldm_responder_cookie_find(jar, &cookie);
+	if (!*link) {
+		return NULL;
 	}
 
-	return next;
+	return pldm_responder_cookie_unlink(jar, link);
 }
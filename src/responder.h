@@ -4,20 +4,68 @@
 #include <libpldm/base.h>
 #include <libpldm/instance-id.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
+#define PLDM_RESPONDER_COOKIE_BUCKET_BITS 8
+#define PLDM_RESPONDER_COOKIE_BUCKETS (1 << PLDM_RESPONDER_COOKIE_BUCKET_BITS)
+
 struct pldm_responder_cookie {
 	pldm_tid_t tid;
 	pldm_instance_id_t instance_id;
 	uint8_t type;
 	uint8_t command;
 	struct pldm_responder_cookie *next;
+	/* Neighbours in the order tracked, maintained by the jar */
+	struct pldm_responder_cookie *older;
+	struct pldm_responder_cookie *newer;
+};
+
+/*
+ * Tracks cookies hashed by (tid, instance_id, type, command). A zeroed jar
+ * tracks caller-allocated cookies; pldm_responder_cookie_jar_init() also
+ * provides a slab to allocate cookies from.
+ *
+ * Requests may never be answered, so tracking a cookie replaces any cookie
+ * with the same key, and an exhausted slab reclaims the oldest cookie.
+ */
+struct pldm_responder_cookie_jar {
+	struct pldm_responder_cookie *buckets[PLDM_RESPONDER_COOKIE_BUCKETS];
+	void *slab;
+	size_t size;
+	size_t count;
+	struct pldm_responder_cookie *free;
+	struct pldm_responder_cookie *oldest;
+	struct pldm_responder_cookie *newest;
 };
 
-int pldm_responder_cookie_track(struct pldm_responder_cookie *jar,
+/*
+ * Allocate a slab of @p count cookies of @p size bytes, each starting with a
+ * struct pldm_responder_cookie.
+ */
+int pldm_responder_cookie_jar_init(struct pldm_responder_cookie_jar *jar,
+				   size_t size, size_t count);
+
+void pldm_responder_cookie_jar_fini(struct pldm_responder_cookie_jar *jar);
+
+/*
+ * If the slab is exhausted the oldest tracked cookie is untracked and
+ * reused. Returns NULL if there is no slab, or no cookie to reclaim.
+ */
+struct pldm_responder_cookie *
+pldm_responder_cookie_alloc(struct pldm_responder_cookie_jar *jar);
+
+void pldm_responder_cookie_free(struct pldm_responder_cookie_jar *jar,
+				struct pldm_responder_cookie *cookie);
+
+/*
+ * A tracked cookie with the same key is replaced, and freed if it belongs to
+ * the slab.
+ */
+int pldm_responder_cookie_track(struct pldm_responder_cookie_jar *jar,
 				struct pldm_responder_cookie *cookie);
 
 struct pldm_responder_cookie *
-pldm_responder_cookie_untrack(struct pldm_responder_cookie *jar, pldm_tid_t tid,
-			      pldm_instance_id_t instance_id, uint8_t type,
-			      uint8_t command);
+pldm_responder_cookie_untrack(struct pldm_responder_cookie_jar *jar,
+			      pldm_tid_t tid, pldm_instance_id_t instance_id,
+			      uint8_t type, uint8_t command);
@@ -10,6 +10,8 @@
 #include <linux/mctp.h>
 #include <stdbool.h>
 
+struct pollfd;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,13 +23,37 @@ struct mctp_fq_addr {
 };
 #endif
 
+struct pldm_transport_af_mctp_uring;
+
+/* The number of requests a bound transport can await responses for */
+#define PLDM_AF_MCTP_COOKIES_MAX 512
+
+/* Open-addressed with linear probing, so at most half full */
+#define PLDM_AF_MCTP_TID_INDEX_BITS 9
+#define PLDM_AF_MCTP_TID_INDEX_SIZE (1 << PLDM_AF_MCTP_TID_INDEX_BITS)
+
+/* Maps a (network, EID) pair to a TID. Slots with a zero EID are empty */
+struct pldm_transport_af_mctp_tid_slot {
+	uint32_t net;
+	mctp_eid_t eid;
+	pldm_tid_t tid;
+};
+
 struct pldm_transport_af_mctp {
 	struct pldm_transport transport;
 	int socket;
 	struct mctp_fq_addr tid_map[PLDM_MAX_TIDS];
+	/* Reverse of tid_map, resolving the lowest TID mapped to an address */
+	struct pldm_transport_af_mctp_tid_slot
+		tid_index[PLDM_AF_MCTP_TID_INDEX_SIZE];
 	struct pldm_socket_sndbuf socket_send_buf;
 	bool bound;
-	struct pldm_responder_cookie cookie_jar;
+	struct pldm_responder_cookie_jar cookie_jar;
+	/* Set if the io_uring data path is enabled */
+	struct pldm_transport_af_mctp_uring *uring;
+	/* See pldm_transport_af_mctp_init_standin() */
+	bool standin;
+	struct sockaddr_mctp standin_peer;
 };
 
 struct pldm_responder_cookie_af_mctp {
@@ -39,6 +65,37 @@ int pldm_transport_af_mctp_get_tid(struct pldm_transport_af_mctp *ctx,
 				   uint32_t network, mctp_eid_t eid,
 				   pldm_tid_t *tid);
 
+/*
+ * Resolve the source TID of a received message, tracking requests if the
+ * transport is bound.
+ */
+int pldm_transport_af_mctp_accept(struct pldm_transport_af_mctp *af_mctp,
+				  const struct sockaddr_mctp *addr,
+				  const struct pldm_msg_hdr *hdr,
+				  pldm_tid_t *tid);
+
+/* Determine the destination address of a message sent to @p tid */
+int pldm_transport_af_mctp_route(struct pldm_transport_af_mctp *af_mctp,
+				 pldm_tid_t tid, const struct pldm_msg_hdr *hdr,
+				 struct sockaddr_mctp *addr);
+
+/*
+ * Create a transport over a connected socket, such as one end of a
+ * socketpair(2), standing in for an AF_MCTP socket. Received messages carry
+ * no MCTP address, so the io_uring data path attributes them to @p peer, and
+ * messages are sent without a destination address.
+ */
+int pldm_transport_af_mctp_init_standin(struct pldm_transport_af_mctp **ctx,
+					int fd,
+					const struct sockaddr_mctp *peer);
+
+#if HAVE_IO_URING_BUF_RING
+int pldm_transport_af_mctp_uring_init_pollfd(struct pldm_transport_af_mctp *ctx,
+					     struct pollfd *pollfd);
+
+void pldm_transport_af_mctp_uring_destroy(struct pldm_transport_af_mctp *ctx);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,813 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "af-mctp-internal.h"
+#include "compiler.h"
+#include "container-of.h"
+#include "environ/errno.h"
+#include "socket.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/af-mctp.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <linux/mctp.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* Submission queue entries, and the number of concurrent sends */
+#define PLDM_URING_ENTRIES 64
+/* Provided receive buffers. Must be a power of two */
+#define PLDM_URING_BUFS 64
+#define PLDM_URING_BGID 0
+/* Bound the lengths we'll go to while tearing down */
+#define PLDM_URING_DRAIN_ATTEMPTS 64
+
+/* Send completions are identified by their slot index */
+#define PLDM_URING_UD_RECV   UINT64_MAX
+#define PLDM_URING_UD_CANCEL (UINT64_MAX - 1)
+#define PLDM_URING_UD_NOP    (UINT64_MAX - 2)
+
+#define transport_to_af_mctp(ptr)                                              \
+	container_of(ptr, struct pldm_transport_af_mctp, transport)
+
+struct pldm_uring_send {
+	struct msghdr msg;
+	struct iovec iov;
+	struct sockaddr_mctp addr;
+	int res;
+	bool busy;
+	bool done;
+};
+
+/* A receive completion set aside while looking for send completions */
+struct pldm_uring_stashed {
+	int res;
+	uint16_t bid;
+};
+
+struct pldm_transport_af_mctp_uring {
+	int fd;
+
+	void *ring;
+	size_t ring_len;
+	struct io_uring_sqe *sqes;
+	size_t sqes_len;
+
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int sq_mask;
+	unsigned int sq_entries;
+
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int cq_mask;
+	struct io_uring_cqe *cqes;
+
+	struct io_uring_buf_ring *br;
+	size_t br_len;
+	uint16_t br_tail;
+	unsigned char *bufs;
+	size_t buf_size;
+
+	/* The template for the multishot receive */
+	struct msghdr recv_msg;
+	bool recv_armed;
+	/* The error with which the multishot receive last failed */
+	int recv_err;
+
+	struct pldm_uring_stashed stash[PLDM_URING_BUFS];
+	unsigned int stash_head;
+	unsigned int stash_count;
+
+	struct pldm_uring_send sends[PLDM_URING_ENTRIES];
+	unsigned char *send_bufs;
+	unsigned int sends_busy;
+	size_t max_msg_len;
+};
+
+static int pldm_uring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int pldm_uring_enter(struct pldm_transport_af_mctp_uring *u,
+			    unsigned int to_submit, unsigned int min_complete,
+			    unsigned int flags)
+{
+	long rc;
+
+	rc = syscall(__NR_io_uring_enter, u->fd, to_submit, min_complete, flags,
+		     NULL, 0);
+
+	return rc < 0 ? -errno : (int)rc;
+}
+
+static int pldm_uring_register(struct pldm_transport_af_mctp_uring *u,
+			       unsigned int opcode, void *arg,
+			       unsigned int nr_args)
+{
+	long rc;
+
+	rc = syscall(__NR_io_uring_register, u->fd, opcode, arg, nr_args);
+
+	return rc < 0 ? -errno : (int)rc;
+}
+
+static struct io_uring_sqe *
+pldm_uring_get_sqe(struct pldm_transport_af_mctp_uring *u)
+{
+	unsigned int head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+	unsigned int tail = *u->sq_tail;
+	struct io_uring_sqe *sqe;
+
+	if (tail - head >= u->sq_entries) {
+		return NULL;
+	}
+
+	/* The SQ array is an identity mapping established at setup */
+	sqe = &u->sqes[tail & u->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+
+	return sqe;
+}
+
+static void pldm_uring_commit_sqe(struct pldm_transport_af_mctp_uring *u)
+{
+	__atomic_store_n(u->sq_tail, *u->sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static void pldm_uring_recycle(struct pldm_transport_af_mctp_uring *u,
+			       uint16_t bid)
+{
+	struct io_uring_buf *buf;
+
+	buf = &u->br->bufs[u->br_tail & (PLDM_URING_BUFS - 1)];
+	buf->addr = (uintptr_t)(u->bufs + (size_t)bid * u->buf_size);
+	buf->len = (uint32_t)u->buf_size;
+	buf->bid = bid;
+	u->br_tail++;
+	__atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+}
+
+static int pldm_uring_arm_recv(struct pldm_transport_af_mctp *af_mctp)
+{
+	struct pldm_transport_af_mctp_uring *u = af_mctp->uring;
+	struct io_uring_sqe *sqe;
+	int rc;
+
+	if (u->recv_armed) {
+		return 0;
+	}
+
+	sqe = pldm_uring_get_sqe(u);
+	if (!sqe) {
+		return -EBUSY;
+	}
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = af_mctp->socket;
+	sqe->addr = (uintptr_t)&u->recv_msg;
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = PLDM_URING_BGID;
+	sqe->user_data = PLDM_URING_UD_RECV;
+	pldm_uring_commit_sqe(u);
+	u->recv_err = 0;
+
+	rc = pldm_uring_enter(u, 1, 0, 0);
+	if (rc < 0) {
+		return rc;
+	}
+
+	u->recv_armed = true;
+
+	return 0;
+}
+
+/*
+ * Process completions. Receive completions are returned through @p recv one
+ * at a time, leaving any further completions queued, unless @p recv is NULL,
+ * in which case they're stashed so send completions can be found.
+ *
+ * Returns 1 if a receive completion was returned, otherwise 0.
+ */
+static int pldm_uring_reap(struct pldm_transport_af_mctp_uring *u,
+			   struct pldm_uring_stashed *recv)
+{
+	unsigned int head = *u->cq_head;
+	unsigned int tail;
+	int found = 0;
+
+	tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail && !found) {
+		struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+		struct pldm_uring_stashed entry = { .res = cqe->res };
+
+		head++;
+
+		if (cqe->user_data == PLDM_URING_UD_RECV) {
+			if (!(cqe->flags & IORING_CQE_F_MORE)) {
+				u->recv_armed = false;
+			}
+
+			if (!(cqe->flags & IORING_CQE_F_BUFFER)) {
+				if (!(cqe->flags & IORING_CQE_F_MORE) &&
+				    cqe->res < 0) {
+					u->recv_err = cqe->res;
+				}
+				continue;
+			}
+
+			entry.bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			if (recv) {
+				*recv = entry;
+				found = 1;
+			} else {
+				unsigned int slot =
+					(u->stash_head + u->stash_count) &
+					(PLDM_URING_BUFS - 1);
+
+				/* Each buffer is stashed at most once */
+				u->stash[slot] = entry;
+				u->stash_count++;
+			}
+		} else if (cqe->user_data < PLDM_URING_ENTRIES) {
+			struct pldm_uring_send *send =
+				&u->sends[cqe->user_data];
+
+			send->res = cqe->res;
+			send->done = true;
+			send->busy = false;
+			u->sends_busy--;
+		}
+	}
+
+	__atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+
+	return found;
+}
+
+/*
+ * Extract the next valid message. Returns 0 and the buffer holding the
+ * message, which must be recycled, or -EAGAIN if none are available.
+ */
+static int pldm_uring_next(struct pldm_transport_af_mctp *af_mctp,
+			   pldm_tid_t *tid, const void **msg, size_t *len,
+			   uint16_t *bid)
+{
+	struct pldm_transport_af_mctp_uring *u = af_mctp->uring;
+	const size_t namelen = u->recv_msg.msg_namelen;
+	struct pldm_transport *t = &af_mctp->transport;
+
+	for (;;) {
+		const struct io_uring_recvmsg_out *out;
+		struct pldm_uring_stashed entry;
+		struct sockaddr_mctp addr;
+		const unsigned char *buf;
+
+		if (u->stash_count) {
+			entry = u->stash[u->stash_head];
+			u->stash_head = (u->stash_head + 1) &
+					(PLDM_URING_BUFS - 1);
+			u->stash_count--;
+		} else if (!pldm_uring_reap(u, &entry)) {
+			/* Multishot receives end when buffers run out */
+			pldm_uring_arm_recv(af_mctp);
+			return -EAGAIN;
+		}
+
+		buf = u->bufs + (size_t)entry.bid * u->buf_size;
+		out = (const struct io_uring_recvmsg_out *)buf;
+
+		if (entry.res < (int)(sizeof(*out) + namelen) ||
+		    (out->flags & MSG_TRUNC) ||
+		    out->payloadlen < sizeof(struct pldm_msg_hdr) ||
+		    out->payloadlen > entry.res - sizeof(*out) - namelen) {
+			pldm_transport_stats_count(
+				t, PLDM_TRANSPORT_STATS_NO_TID,
+				PLDM_TRANSPORT_STAT(rx_invalid_len), 1);
+			pldm_uring_recycle(u, entry.bid);
+			continue;
+		}
+
+		if (out->namelen) {
+			memcpy(&addr, buf + sizeof(*out), sizeof(addr));
+		} else if (af_mctp->standin) {
+			addr = af_mctp->standin_peer;
+		} else {
+			pldm_uring_recycle(u, entry.bid);
+			continue;
+		}
+
+		*msg = buf + sizeof(*out) + namelen;
+		*len = out->payloadlen;
+
+		if (pldm_transport_af_mctp_accept(af_mctp, &addr, *msg, tid)) {
+			pldm_uring_recycle(u, entry.bid);
+			continue;
+		}
+
+		*bid = entry.bid;
+
+		return 0;
+	}
+}
+
+static pldm_requester_rc_t pldm_uring_recv(struct pldm_transport *t,
+					   pldm_tid_t *tid, void **pldm_msg,
+					   size_t *msg_len)
+{
+	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
+	const void *msg;
+	uint16_t bid;
+	size_t len;
+	void *copy;
+
+	if (pldm_uring_next(af_mctp, tid, &msg, &len, &bid)) {
+		errno = EAGAIN;
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	copy = malloc(len);
+	if (copy) {
+		memcpy(copy, msg, len);
+	}
+	pldm_uring_recycle(af_mctp->uring, bid);
+
+	if (!copy) {
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	*pldm_msg = copy;
+	*msg_len = len;
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+static int pldm_uring_recv_batch(struct pldm_transport *t,
+				 struct pldm_transport_msg *msgs, size_t count)
+{
+	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
+	size_t n = 0;
+
+	while (n < count) {
+		const void *msg;
+		pldm_tid_t tid;
+		uint16_t bid;
+		size_t len;
+
+		if (pldm_uring_next(af_mctp, &tid, &msg, &len, &bid)) {
+			break;
+		}
+
+		if (len <= msgs[n].len) {
+			memcpy(msgs[n].msg, msg, len);
+			pldm_transport_msg_keep(msgs, n, n, tid, len);
+			n++;
+		}
+
+		pldm_uring_recycle(af_mctp->uring, bid);
+	}
+
+	return n ? (int)n : -EAGAIN;
+}
+
+/* Find an idle send slot, waiting for a completion if required */
+static struct pldm_uring_send *
+pldm_uring_get_send(struct pldm_transport_af_mctp_uring *u)
+{
+	for (int attempt = 0; attempt < 2; attempt++) {
+		if (u->sends_busy == PLDM_URING_ENTRIES) {
+			pldm_uring_reap(u, NULL);
+		}
+
+		if (u->sends_busy == PLDM_URING_ENTRIES) {
+			if (pldm_uring_enter(u, 0, 1, IORING_ENTER_GETEVENTS) <
+			    0) {
+				return NULL;
+			}
+			continue;
+		}
+
+		for (size_t i = 0; i < PLDM_URING_ENTRIES; i++) {
+			if (!u->sends[i].busy) {
+				return &u->sends[i];
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Queue, but don't submit, a message. Returns the slot or NULL */
+static struct pldm_uring_send *
+pldm_uring_queue_send(struct pldm_transport_af_mctp *af_mctp, pldm_tid_t tid,
+		      const struct pldm_transport_msgv *msg)
+{
+	struct pldm_transport_af_mctp_uring *u = af_mctp->uring;
+	size_t len = pldm_transport_msgv_len(msg);
+	struct pldm_uring_send *send;
+	struct pldm_msg_hdr hdr;
+	struct io_uring_sqe *sqe;
+	unsigned char *buf;
+	size_t index;
+
+	if (len < sizeof(hdr) || len > u->max_msg_len || len > INT_MAX) {
+		return NULL;
+	}
+
+	if (pldm_socket_sndbuf_accomodate(&af_mctp->socket_send_buf,
+					  (int)len)) {
+		return NULL;
+	}
+
+	send = pldm_uring_get_send(u);
+	if (!send) {
+		return NULL;
+	}
+
+	sqe = pldm_uring_get_sqe(u);
+	if (!sqe) {
+		return NULL;
+	}
+
+	pldm_transport_msgv_peek(msg, &hdr, sizeof(hdr));
+	if (pldm_transport_af_mctp_route(af_mctp, tid, &hdr, &send->addr)) {
+		return NULL;
+	}
+
+	/* The caller's buffers may be reused once we return */
+	index = send - u->sends;
+	buf = u->send_bufs + index * u->max_msg_len;
+	pldm_transport_msgv_peek(msg, buf, len);
+
+	memset(&send->msg, 0, sizeof(send->msg));
+	send->iov.iov_base = buf;
+	send->iov.iov_len = len;
+	send->msg.msg_iov = &send->iov;
+	send->msg.msg_iovlen = 1;
+	if (!af_mctp->standin) {
+		send->msg.msg_name = &send->addr;
+		send->msg.msg_namelen = sizeof(send->addr);
+	}
+	send->busy = true;
+	send->done = false;
+	u->sends_busy++;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = af_mctp->socket;
+	sqe->addr = (uintptr_t)&send->msg;
+	sqe->len = 1;
+	sqe->user_data = index;
+	pldm_uring_commit_sqe(u);
+
+	return send;
+}
+
+static pldm_requester_rc_t pldm_uring_send(struct pldm_transport *t,
+					   pldm_tid_t tid, const void *pldm_msg,
+					   size_t msg_len)
+{
+	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
+	struct pldm_transport_af_mctp_uring *u = af_mctp->uring;
+	const struct iovec iov = {
+		.iov_base = (void *)pldm_msg,
+		.iov_len = msg_len,
+	};
+	const struct pldm_transport_msgv msg = {
+		.iov = &iov,
+		.iovlen = 1,
+		.tid = tid,
+	};
+	struct pldm_uring_send *send;
+
+	send = pldm_uring_queue_send(af_mctp, tid, &msg);
+	if (!send) {
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	if (pldm_uring_enter(u, 1, 0, 0) < 0) {
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	/* Datagram sends typically complete inline, so report what we can */
+	pldm_uring_reap(u, NULL);
+	if (send->done && send->res < 0) {
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+static int pldm_uring_send_batch(struct pldm_transport *t,
+				 const struct pldm_transport_msgv *msgs,
+				 size_t count)
+{
+	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
+	struct pldm_transport_af_mctp_uring *u = af_mctp->uring;
+	unsigned int queued = 0;
+	size_t sent = 0;
+	int rc;
+
+	while (sent < count) {
+		if (queued == u->sq_entries ||
+		    !pldm_uring_queue_send(af_mctp, msgs[sent].tid,
+					   &msgs[sent])) {
+			if (!queued) {
+				break;
+			}
+
+			/* Flush the queue before trying again */
+			rc = pldm_uring_enter(u, queued, 0, 0);
+			if (rc < 0) {
+				return sent - queued ? (int)(sent - queued) :
+						       rc;
+			}
+			queued = 0;
+			continue;
+		}
+
+		queued++;
+		sent++;
+	}
+
+	if (queued) {
+		rc = pldm_uring_enter(u, queued, 0, 0);
+		if (rc < 0) {
+			sent -= queued;
+			return sent ? (int)sent : rc;
+		}
+	}
+
+	pldm_uring_reap(u, NULL);
+
+	return sent ? (int)sent : -EIO;
+}
+
+int pldm_transport_af_mctp_uring_init_pollfd(struct pldm_transport_af_mctp *ctx,
+					     struct pollfd *pollfd)
+{
+	struct pldm_transport_af_mctp_uring *u = ctx->uring;
+	unsigned int head;
+	unsigned int tail;
+
+	pldm_uring_arm_recv(ctx);
+
+	/*
+	 * Stashed messages don't make the ring readable, so post a no-op
+	 * completion to ensure the caller doesn't wait for them.
+	 */
+	head = *u->cq_head;
+	tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+	if (u->stash_count && head == tail) {
+		struct io_uring_sqe *sqe = pldm_uring_get_sqe(u);
+
+		if (sqe) {
+			sqe->opcode = IORING_OP_NOP;
+			sqe->user_data = PLDM_URING_UD_NOP;
+			pldm_uring_commit_sqe(u);
+			pldm_uring_enter(u, 1, 0, 0);
+		}
+	}
+
+	pollfd->fd = u->fd;
+	pollfd->events = POLLIN;
+
+	return 0;
+}
+
+static void pldm_uring_free(struct pldm_transport_af_mctp_uring *u)
+{
+	if (u->fd >= 0) {
+		close(u->fd);
+	}
+	if (u->ring != MAP_FAILED) {
+		munmap(u->ring, u->ring_len);
+	}
+	if (u->sqes != MAP_FAILED) {
+		munmap(u->sqes, u->sqes_len);
+	}
+	if (u->br != MAP_FAILED) {
+		munmap(u->br, u->br_len);
+	}
+	free(u->bufs);
+	free(u->send_bufs);
+	free(u);
+}
+
+static int pldm_uring_map(struct pldm_transport_af_mctp_uring *u,
+			  const struct io_uring_params *p)
+{
+	unsigned char *ring;
+	size_t cq_len;
+
+	u->ring_len = p->sq_off.array + p->sq_entries * sizeof(unsigned int);
+	cq_len = p->cq_off.cqes + p->cq_entries * sizeof(struct io_uring_cqe);
+	if (cq_len > u->ring_len) {
+		u->ring_len = cq_len;
+	}
+
+	u->ring = mmap(NULL, u->ring_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+	if (u->ring == MAP_FAILED) {
+		return -errno;
+	}
+
+	u->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+	u->sqes = mmap(NULL, u->sqes_len, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+	if (u->sqes == MAP_FAILED) {
+		return -errno;
+	}
+
+	ring = u->ring;
+	u->sq_head = (unsigned int *)(ring + p->sq_off.head);
+	u->sq_tail = (unsigned int *)(ring + p->sq_off.tail);
+	u->sq_mask = *(unsigned int *)(ring + p->sq_off.ring_mask);
+	u->sq_entries = p->sq_entries;
+	u->cq_head = (unsigned int *)(ring + p->cq_off.head);
+	u->cq_tail = (unsigned int *)(ring + p->cq_off.tail);
+	u->cq_mask = *(unsigned int *)(ring + p->cq_off.ring_mask);
+	u->cqes = (struct io_uring_cqe *)(ring + p->cq_off.cqes);
+
+	for (unsigned int i = 0; i < p->sq_entries; i++) {
+		((unsigned int *)(ring + p->sq_off.array))[i] = i;
+	}
+
+	return 0;
+}
+
+static int pldm_uring_provide(struct pldm_transport_af_mctp_uring *u)
+{
+	struct io_uring_buf_reg reg = { 0 };
+	int rc;
+
+	u->br_len = PLDM_URING_BUFS * sizeof(struct io_uring_buf);
+	u->br = mmap(NULL, u->br_len, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (u->br == MAP_FAILED) {
+		return -errno;
+	}
+
+	u->bufs = malloc(PLDM_URING_BUFS * u->buf_size);
+	if (!u->bufs) {
+		return -ENOMEM;
+	}
+
+	reg.ring_addr = (uintptr_t)u->br;
+	reg.ring_entries = PLDM_URING_BUFS;
+	reg.bgid = PLDM_URING_BGID;
+	rc = pldm_uring_register(u, IORING_REGISTER_PBUF_RING, &reg, 1);
+	if (rc < 0) {
+		return rc == -EINVAL ? -EOPNOTSUPP : rc;
+	}
+
+	for (uint16_t bid = 0; bid < PLDM_URING_BUFS; bid++) {
+		pldm_uring_recycle(u, bid);
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_af_mctp_enable_uring(struct pldm_transport_af_mctp *ctx,
+					size_t max_msg_len)
+{
+	struct pldm_transport_af_mctp_uring *u;
+	struct io_uring_params params = { 0 };
+	int rc;
+
+	if (!ctx || max_msg_len < sizeof(struct pldm_msg_hdr) ||
+	    max_msg_len > INT_MAX) {
+		return -EINVAL;
+	}
+
+	if (ctx->uring) {
+		return -EBUSY;
+	}
+
+	u = calloc(1, sizeof(*u));
+	if (!u) {
+		return -ENOMEM;
+	}
+
+	u->fd = -1;
+	u->ring = MAP_FAILED;
+	u->sqes = MAP_FAILED;
+	u->br = MAP_FAILED;
+	u->max_msg_len = max_msg_len;
+	u->recv_msg.msg_namelen = sizeof(struct sockaddr_mctp);
+	u->buf_size = sizeof(struct io_uring_recvmsg_out) +
+		      u->recv_msg.msg_namelen + max_msg_len;
+
+	/* Leave room for multishot receives alongside a full set of sends */
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = 4 * PLDM_URING_ENTRIES;
+	u->fd = pldm_uring_setup(PLDM_URING_ENTRIES, &params);
+	if (u->fd < 0) {
+		rc = (errno == ENOSYS || errno == EPERM) ? -EOPNOTSUPP : -errno;
+		goto cleanup_uring;
+	}
+
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+	    !(params.features & IORING_FEAT_NODROP)) {
+		rc = -EOPNOTSUPP;
+		goto cleanup_uring;
+	}
+
+	rc = pldm_uring_map(u, &params);
+	if (rc) {
+		goto cleanup_uring;
+	}
+
+	rc = pldm_uring_provide(u);
+	if (rc) {
+		goto cleanup_uring;
+	}
+
+	u->send_bufs = malloc(PLDM_URING_ENTRIES * max_msg_len);
+	if (!u->send_bufs) {
+		rc = -ENOMEM;
+		goto cleanup_uring;
+	}
+
+	ctx->uring = u;
+
+	rc = pldm_uring_arm_recv(ctx);
+	if (rc) {
+		goto cleanup_ctx;
+	}
+
+	/*
+	 * Kernels without multishot receive support fail the request. Messages
+	 * already queued on the socket may complete it immediately, and are
+	 * stashed for the first receive.
+	 */
+	pldm_uring_reap(u, NULL);
+	if (u->recv_err < 0) {
+		rc = -EOPNOTSUPP;
+		goto cleanup_ctx;
+	}
+
+	ctx->transport.recv = pldm_uring_recv;
+	ctx->transport.send = pldm_uring_send;
+	ctx->transport.recv_batch = pldm_uring_recv_batch;
+	ctx->transport.send_batch = pldm_uring_send_batch;
+
+	return 0;
+
+cleanup_ctx:
+	/* Cancel the receive before its buffers are released */
+	pldm_transport_af_mctp_uring_destroy(ctx);
+	return rc;
+cleanup_uring:
+	pldm_uring_free(u);
+	return rc;
+}
+
+void pldm_transport_af_mctp_uring_destroy(struct pldm_transport_af_mctp *ctx)
+{
+	struct pldm_transport_af_mctp_uring *u = ctx->uring;
+	struct io_uring_sqe *sqe;
+
+	if (!u) {
+		return;
+	}
+
+	/* Requests in flight reference our buffers, so wait them out */
+	sqe = pldm_uring_get_sqe(u);
+	if (sqe) {
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		sqe->user_data = PLDM_URING_UD_CANCEL;
+		pldm_uring_commit_sqe(u);
+		pldm_uring_enter(u, 1, 0, 0);
+	}
+
+	for (int attempt = 0; attempt < PLDM_URING_DRAIN_ATTEMPTS &&
+			      (u->recv_armed || u->sends_busy);
+	     attempt++) {
+		u->stash_count = 0;
+		pldm_uring_reap(u, NULL);
+		if (u->recv_armed || u->sends_busy) {
+			pldm_uring_enter(u, 0, 1, IORING_ENTER_GETEVENTS);
+		}
+	}
+
+	ctx->uring = NULL;
+	pldm_uring_free(u);
+}
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
@@ -41,6 +42,11 @@ int pldm_transport_af_mctp_init_pollfd(struct pldm_transport *t,
 				       struct pollfd *pollfd)
 {
 	struct pldm_transport_af_mctp *ctx = transport_to_af_mctp(t);
+#if HAVE_IO_URING_BUF_RING
+	if (ctx->uring) {
+		return pldm_transport_af_mctp_uring_init_pollfd(ctx, pollfd);
+	}
+#endif
 	pollfd->fd = ctx->socket;
 	pollfd->events = POLLIN;
 	return 0;
@@ -58,18 +64,121 @@ static int pldm_transport_af_mctp_lookup_fqe(struct pldm_transport_af_mctp *ctx,
 	return 0;
 }
 
-static int pldm_transport_af_mctp_find_tid(struct pldm_transport_af_mctp *ctx,
-					   uint32_t network, mctp_eid_t eid,
-					   pldm_tid_t *tid)
+static size_t pldm_transport_af_mctp_hash(uint32_t network, mctp_eid_t eid)
 {
+	uint32_t key = (network << 8) ^ eid;
+
+	/* Fibonacci hashing */
+	return (key * UINT32_C(2654435761)) >>
+	       (32 - PLDM_AF_MCTP_TID_INDEX_BITS);
+}
+
+/* Find the slot holding the address, or the empty slot ending its probe */
+static struct pldm_transport_af_mctp_tid_slot *
+pldm_transport_af_mctp_probe(struct pldm_transport_af_mctp *ctx,
+			     uint32_t network, mctp_eid_t eid)
+{
+	size_t i = pldm_transport_af_mctp_hash(network, eid);
+
+	for (;;) {
+		struct pldm_transport_af_mctp_tid_slot *slot =
+			&ctx->tid_index[i];
+
+		if (!slot->eid || (slot->net == network && slot->eid == eid)) {
+			return slot;
+		}
+
+		i = (i + 1) & (PLDM_AF_MCTP_TID_INDEX_SIZE - 1);
+	}
+}
+
+/* Remove a slot, shifting back entries displaced past it */
+static void
+pldm_transport_af_mctp_index_remove(struct pldm_transport_af_mctp *ctx,
+				    size_t i)
+{
+	const size_t mask = PLDM_AF_MCTP_TID_INDEX_SIZE - 1;
+	size_t j = i;
+
+	for (;;) {
+		struct pldm_transport_af_mctp_tid_slot *next;
+		size_t home;
+
+		j = (j + 1) & mask;
+		next = &ctx->tid_index[j];
+		if (!next->eid) {
+			break;
+		}
+
+		/* Move the entry if its home isn't cyclically within (i, j] */
+		home = pldm_transport_af_mctp_hash(next->net, next->eid);
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			ctx->tid_index[i] = *next;
+			i = j;
+		}
+	}
+
+	memset(&ctx->tid_index[i], 0, sizeof(ctx->tid_index[i]));
+}
+
+/*
+ * Re-resolve an address after the TID map changed. Mapping is not on the
+ * message path, so simply search for the lowest TID that remains mapped to
+ * the address, as lookups did before the index existed.
+ */
+static void
+pldm_transport_af_mctp_index_update(struct pldm_transport_af_mctp *ctx,
+				    uint32_t network, mctp_eid_t eid)
+{
+	struct pldm_transport_af_mctp_tid_slot *slot;
+
+	/* EID 0 is never resolved */
+	if (!eid) {
+		return;
+	}
+
+	slot = pldm_transport_af_mctp_probe(ctx, network, eid);
 	for (int i = 0; i < PLDM_MAX_TIDS; i++) {
 		if (ctx->tid_map[i].net == network &&
 		    ctx->tid_map[i].eid == eid) {
-			*tid = i;
-			return 0;
+			slot->net = network;
+			slot->eid = eid;
+			slot->tid = i;
+			return;
 		}
 	}
-	return -1;
+
+	if (slot->eid) {
+		pldm_transport_af_mctp_index_remove(ctx,
+						    slot - ctx->tid_index);
+	}
+}
+
+static void pldm_transport_af_mctp_set_fqe(struct pldm_transport_af_mctp *ctx,
+					   pldm_tid_t tid, uint32_t network,
+					   mctp_eid_t eid)
+{
+	struct mctp_fq_addr prev = ctx->tid_map[tid];
+
+	ctx->tid_map[tid].net = network;
+	ctx->tid_map[tid].eid = eid;
+	pldm_transport_af_mctp_index_update(ctx, prev.net, prev.eid);
+	pldm_transport_af_mctp_index_update(ctx, network, eid);
+}
+
+static int pldm_transport_af_mctp_find_tid(struct pldm_transport_af_mctp *ctx,
+					   uint32_t network, mctp_eid_t eid,
+					   pldm_tid_t *tid)
+{
+	struct pldm_transport_af_mctp_tid_slot *slot;
+
+	slot = pldm_transport_af_mctp_probe(ctx, network, eid);
+	if (!slot->eid) {
+		return -1;
+	}
+
+	*tid = slot->tid;
+	return 0;
 }
 
 LIBPLDM_ABI_TESTING
@@ -96,8 +205,7 @@ LIBPLDM_ABI_STABLE
 int pldm_transport_af_mctp_map_tid(struct pldm_transport_af_mctp *ctx,
 				   pldm_tid_t tid, mctp_eid_t eid)
 {
-	ctx->tid_map[tid].net = MCTP_NET_ANY;
-	ctx->tid_map[tid].eid = eid;
+	pldm_transport_af_mctp_set_fqe(ctx, tid, MCTP_NET_ANY, eid);
 	return 0;
 }
 
@@ -106,8 +214,7 @@ int pldm_transport_af_mctp_unmap_tid(struct pldm_transport_af_mctp *ctx,
 				     pldm_tid_t tid,
 				     LIBPLDM_CC_UNUSED mctp_eid_t eid)
 {
-	ctx->tid_map[tid].net = 0;
-	ctx->tid_map[tid].eid = 0;
+	pldm_transport_af_mctp_set_fqe(ctx, tid, 0, 0);
 	return 0;
 }
 
@@ -116,8 +223,7 @@ int pldm_transport_af_mctp_map_tid_fqe(struct pldm_transport_af_mctp *ctx,
 				       pldm_tid_t tid, uint32_t network,
 				       mctp_eid_t eid)
 {
-	ctx->tid_map[tid].net = network;
-	ctx->tid_map[tid].eid = eid;
+	pldm_transport_af_mctp_set_fqe(ctx, tid, network, eid);
 	return 0;
 }
 
@@ -125,8 +231,47 @@ LIBPLDM_ABI_STABLE
 int pldm_transport_af_mctp_unmap_tid_fqe(struct pldm_transport_af_mctp *ctx,
 					 pldm_tid_t tid)
 {
-	ctx->tid_map[tid].net = 0;
-	ctx->tid_map[tid].eid = 0;
+	pldm_transport_af_mctp_set_fqe(ctx, tid, 0, 0);
+	return 0;
+}
+
+int pldm_transport_af_mctp_accept(struct pldm_transport_af_mctp *af_mctp,
+				  const struct sockaddr_mctp *addr,
+				  const struct pldm_msg_hdr *hdr,
+				  pldm_tid_t *tid)
+{
+	struct pldm_responder_cookie_af_mctp *cookie;
+	struct pldm_responder_cookie *req;
+	int rc;
+
+	rc = pldm_transport_af_mctp_get_tid(af_mctp, addr->smctp_network,
+					    addr->smctp_addr.s_addr, tid);
+	if (rc) {
+		return -ENOENT;
+	}
+
+	if (!af_mctp->bound || !hdr->request) {
+		return 0;
+	}
+
+	req = pldm_responder_cookie_alloc(&af_mctp->cookie_jar);
+	if (!req) {
+		return -ENOBUFS;
+	}
+
+	cookie = cookie_to_af_mctp(req);
+	cookie->req.tid = *tid;
+	cookie->req.instance_id = hdr->instance_id;
+	cookie->req.type = hdr->type;
+	cookie->req.command = hdr->command;
+	cookie->smctp = *addr;
+
+	rc = pldm_responder_cookie_track(&af_mctp->cookie_jar, req);
+	if (rc) {
+		pldm_responder_cookie_free(&af_mctp->cookie_jar, req);
+		return rc;
+	}
+
 	return 0;
 }
 
@@ -138,7 +283,6 @@ static pldm_requester_rc_t pldm_transport_af_mctp_recv(struct pldm_transport *t,
 	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
 	struct sockaddr_mctp addr = { 0 };
 	socklen_t addrlen = sizeof(addr);
-	struct pldm_msg_hdr *hdr;
 	pldm_requester_rc_t res;
 	ssize_t length;
 	void *msg;
@@ -161,38 +305,12 @@ static pldm_requester_rc_t pldm_transport_af_mctp_recv(struct pldm_transport *t,
 		goto cleanup_msg;
 	}
 
-	rc = pldm_transport_af_mctp_get_tid(af_mctp, addr.smctp_network,
-					    addr.smctp_addr.s_addr, tid);
+	rc = pldm_transport_af_mctp_accept(af_mctp, &addr, msg, tid);
 	if (rc) {
 		res = PLDM_REQUESTER_RECV_FAIL;
 		goto cleanup_msg;
 	}
 
-	hdr = msg;
-
-	if (af_mctp->bound && hdr->request) {
-		struct pldm_responder_cookie_af_mctp *cookie;
-
-		cookie = malloc(sizeof(*cookie));
-		if (!cookie) {
-			res = PLDM_REQUESTER_RECV_FAIL;
-			goto cleanup_msg;
-		}
-
-		cookie->req.tid = *tid,
-		cookie->req.instance_id = hdr->instance_id,
-		cookie->req.type = hdr->type,
-		cookie->req.command = hdr->command;
-		cookie->smctp = addr;
-
-		rc = pldm_responder_cookie_track(&af_mctp->cookie_jar,
-						 &cookie->req);
-		if (rc) {
-			res = PLDM_REQUESTER_RECV_FAIL;
-			goto cleanup_msg;
-		}
-	}
-
 	*pldm_msg = msg;
 	*msg_len = length;
 
@@ -204,20 +322,66 @@ cleanup_msg:
 	return res;
 }
 
-static pldm_requester_rc_t pldm_transport_af_mctp_send(struct pldm_transport *t,
-						       pldm_tid_t tid,
-						       const void *pldm_msg,
-						       size_t msg_len)
+static int pldm_transport_af_mctp_recv_batch(struct pldm_transport *t,
+					     struct pldm_transport_msg *msgs,
+					     size_t count)
 {
 	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
-	const struct pldm_msg_hdr *hdr;
-	struct sockaddr_mctp addr = { 0 };
+	struct sockaddr_mctp addrs[PLDM_TRANSPORT_RECV_BATCH_MAX] = { 0 };
+	struct mmsghdr mmsgs[PLDM_TRANSPORT_RECV_BATCH_MAX] = { 0 };
+	struct iovec iovs[PLDM_TRANSPORT_RECV_BATCH_MAX];
+	size_t received;
+	size_t n = 0;
+	int rc;
 
-	if (msg_len < (ssize_t)sizeof(struct pldm_msg_hdr)) {
-		return PLDM_REQUESTER_SEND_FAIL;
+	if (count > PLDM_TRANSPORT_RECV_BATCH_MAX) {
+		count = PLDM_TRANSPORT_RECV_BATCH_MAX;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		iovs[i].iov_base = msgs[i].msg;
+		iovs[i].iov_len = msgs[i].len;
+		mmsgs[i].msg_hdr.msg_name = &addrs[i];
+		mmsgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		mmsgs[i].msg_hdr.msg_iov = &iovs[i];
+		mmsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	rc = recvmmsg(af_mctp->socket, mmsgs, count, MSG_WAITFORONE, NULL);
+	if (rc < 0) {
+		return -errno;
+	}
+
+	received = rc;
+	for (size_t i = 0; i < received; i++) {
+		size_t length = mmsgs[i].msg_len;
+		pldm_tid_t tid;
+
+		if ((mmsgs[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+		    length < sizeof(struct pldm_msg_hdr)) {
+			pldm_transport_stats_count(
+				t, PLDM_TRANSPORT_STATS_NO_TID,
+				PLDM_TRANSPORT_STAT(rx_invalid_len), 1);
+			continue;
+		}
+
+		if (pldm_transport_af_mctp_accept(af_mctp, &addrs[i],
+						  iovs[i].iov_base, &tid)) {
+			continue;
+		}
+
+		pldm_transport_msg_keep(msgs, i, n++, tid, length);
 	}
 
-	hdr = pldm_msg;
+	return (int)n;
+}
+
+int pldm_transport_af_mctp_route(struct pldm_transport_af_mctp *af_mctp,
+				 pldm_tid_t tid, const struct pldm_msg_hdr *hdr,
+				 struct sockaddr_mctp *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+
 	if (af_mctp->bound && !hdr->request) {
 		struct pldm_responder_cookie_af_mctp *cookie;
 		struct pldm_responder_cookie *req;
@@ -226,27 +390,46 @@ static pldm_requester_rc_t pldm_transport_af_mctp_send(struct pldm_transport *t,
 						    hdr->instance_id, hdr->type,
 						    hdr->command);
 		if (!req) {
-			return PLDM_REQUESTER_SEND_FAIL;
+			return -ENOENT;
 		}
 
 		cookie = cookie_to_af_mctp(req);
-		addr = cookie->smctp;
+		*addr = cookie->smctp;
 		/* Clear the TO to indicate a response */
-		addr.smctp_tag &= ~MCTP_TAG_OWNER;
-		free(cookie);
+		addr->smctp_tag &= ~MCTP_TAG_OWNER;
+		pldm_responder_cookie_free(&af_mctp->cookie_jar, req);
 	} else {
 		mctp_eid_t eid = 0;
 		uint32_t network = 0;
 		if (pldm_transport_af_mctp_lookup_fqe(af_mctp, tid, &network,
 						      &eid)) {
-			return PLDM_REQUESTER_SEND_FAIL;
+			return -ENOENT;
 		}
 
-		addr.smctp_family = AF_MCTP;
-		addr.smctp_addr.s_addr = eid;
-		addr.smctp_network = network;
-		addr.smctp_type = MCTP_MSG_TYPE_PLDM;
-		addr.smctp_tag = MCTP_TAG_OWNER;
+		addr->smctp_family = AF_MCTP;
+		addr->smctp_addr.s_addr = eid;
+		addr->smctp_network = network;
+		addr->smctp_type = MCTP_MSG_TYPE_PLDM;
+		addr->smctp_tag = MCTP_TAG_OWNER;
+	}
+
+	return 0;
+}
+
+static pldm_requester_rc_t pldm_transport_af_mctp_send(struct pldm_transport *t,
+						       pldm_tid_t tid,
+						       const void *pldm_msg,
+						       size_t msg_len)
+{
+	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
+	struct sockaddr_mctp addr;
+
+	if (msg_len < (ssize_t)sizeof(struct pldm_msg_hdr)) {
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	if (pldm_transport_af_mctp_route(af_mctp, tid, pldm_msg, &addr)) {
+		return PLDM_REQUESTER_SEND_FAIL;
 	}
 
 	if (msg_len > INT_MAX ||
@@ -264,9 +447,99 @@ static pldm_requester_rc_t pldm_transport_af_mctp_send(struct pldm_transport *t,
 	return PLDM_REQUESTER_SUCCESS;
 }
 
+static int pldm_transport_af_mctp_send_batch(
+	struct pldm_transport *t, const struct pldm_transport_msgv *msgs,
+	size_t count)
+{
+	struct pldm_transport_af_mctp *af_mctp = transport_to_af_mctp(t);
+	struct sockaddr_mctp addrs[PLDM_TRANSPORT_SEND_BATCH_MAX];
+	struct mmsghdr mmsgs[PLDM_TRANSPORT_SEND_BATCH_MAX];
+	size_t sent = 0;
+	int rc;
+
+	while (sent < count) {
+		size_t batch = count - sent;
+		size_t max_len = 0;
+
+		if (batch > PLDM_TRANSPORT_SEND_BATCH_MAX) {
+			batch = PLDM_TRANSPORT_SEND_BATCH_MAX;
+		}
+
+		memset(mmsgs, 0, batch * sizeof(mmsgs[0]));
+		for (size_t i = 0; i < batch; i++) {
+			const struct pldm_transport_msgv *msg = &msgs[sent + i];
+			size_t len = pldm_transport_msgv_len(msg);
+			struct pldm_msg_hdr hdr;
+
+			pldm_transport_msgv_peek(msg, &hdr, sizeof(hdr));
+			if (pldm_transport_af_mctp_route(af_mctp, msg->tid,
+							 &hdr, &addrs[i])) {
+				/* Send what we have so far */
+				batch = i;
+				break;
+			}
+
+			if (len > max_len) {
+				max_len = len;
+			}
+
+			mmsgs[i].msg_hdr.msg_name = &addrs[i];
+			mmsgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			mmsgs[i].msg_hdr.msg_iov = (struct iovec *)msg->iov;
+			mmsgs[i].msg_hdr.msg_iovlen = msg->iovlen;
+		}
+
+		if (!batch) {
+			break;
+		}
+
+		/* One adjustment of the send buffer covers the whole batch */
+		if (max_len > INT_MAX ||
+		    pldm_socket_sndbuf_accomodate(&af_mctp->socket_send_buf,
+						  (int)max_len)) {
+			break;
+		}
+
+		rc = sendmmsg(af_mctp->socket, mmsgs, batch, 0);
+		if (rc < 0) {
+			if (!sent) {
+				return -errno;
+			}
+			break;
+		}
+
+		sent += rc;
+		if ((size_t)rc < batch) {
+			break;
+		}
+	}
+
+	return sent ? (int)sent : -EIO;
+}
+
+static int pldm_transport_af_mctp_setup(struct pldm_transport_af_mctp *af_mctp,
+					int socket)
+{
+	af_mctp->transport.name = AF_MCTP_NAME;
+	af_mctp->transport.version = 1;
+	af_mctp->transport.recv = pldm_transport_af_mctp_recv;
+	af_mctp->transport.send = pldm_transport_af_mctp_send;
+	af_mctp->transport.init_pollfd = pldm_transport_af_mctp_init_pollfd;
+	af_mctp->transport.recv_batch = pldm_transport_af_mctp_recv_batch;
+	af_mctp->transport.send_batch = pldm_transport_af_mctp_send_batch;
+	af_mctp->bound = false;
+	af_mctp->socket = socket;
+	af_mctp->socket_send_buf.transport = &af_mctp->transport;
+
+	return pldm_socket_sndbuf_init(&af_mctp->socket_send_buf,
+				       af_mctp->socket);
+}
+
 LIBPLDM_ABI_STABLE
 int pldm_transport_af_mctp_init(struct pldm_transport_af_mctp **ctx)
 {
+	int socket_fd;
+
 	if (!ctx || *ctx) {
 		return -EINVAL;
 	}
@@ -277,22 +550,14 @@ int pldm_transport_af_mctp_init(struct pldm_transport_af_mctp **ctx)
 		return -ENOMEM;
 	}
 
-	af_mctp->transport.name = AF_MCTP_NAME;
-	af_mctp->transport.version = 1;
-	af_mctp->transport.recv = pldm_transport_af_mctp_recv;
-	af_mctp->transport.send = pldm_transport_af_mctp_send;
-	af_mctp->transport.init_pollfd = pldm_transport_af_mctp_init_pollfd;
-	af_mctp->bound = false;
-	af_mctp->cookie_jar.next = NULL;
-	af_mctp->socket = socket(AF_MCTP, SOCK_DGRAM, 0);
-	if (af_mctp->socket == -1) {
+	socket_fd = socket(AF_MCTP, SOCK_DGRAM, 0);
+	if (socket_fd == -1) {
 		free(af_mctp);
 		return -1;
 	}
 
-	if (pldm_socket_sndbuf_init(&af_mctp->socket_send_buf,
-				    af_mctp->socket)) {
-		close(af_mctp->socket);
+	if (pldm_transport_af_mctp_setup(af_mctp, socket_fd)) {
+		close(socket_fd);
 		free(af_mctp);
 		return -1;
 	}
@@ -301,16 +566,90 @@ int pldm_transport_af_mctp_init(struct pldm_transport_af_mctp **ctx)
 	return 0;
 }
 
+LIBPLDM_ABI_TESTING
+int pldm_transport_af_mctp_init_standin(struct pldm_transport_af_mctp **ctx,
+					int fd,
+					const struct sockaddr_mctp *peer)
+{
+	struct pldm_transport_af_mctp *af_mctp;
+	int socket_fd;
+	int rc;
+
+	if (!ctx || *ctx || !peer) {
+		return -EINVAL;
+	}
+
+	af_mctp = calloc(1, sizeof(*af_mctp));
+	if (!af_mctp) {
+		return -ENOMEM;
+	}
+
+	/* Duplicate so destruction doesn't close the caller's descriptor */
+	socket_fd = dup(fd);
+	if (socket_fd == -1) {
+		rc = -errno;
+		goto cleanup_af_mctp;
+	}
+
+	if (pldm_transport_af_mctp_setup(af_mctp, socket_fd)) {
+		rc = -EIO;
+		goto cleanup_socket;
+	}
+
+	af_mctp->standin = true;
+	af_mctp->standin_peer = *peer;
+	*ctx = af_mctp;
+
+	return 0;
+
+cleanup_socket:
+	close(socket_fd);
+cleanup_af_mctp:
+	free(af_mctp);
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_af_mctp_reserve_send_buffer(
+	struct pldm_transport_af_mctp *ctx, size_t max_msg_len)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	return pldm_socket_sndbuf_reserve(&ctx->socket_send_buf, max_msg_len);
+}
+
 LIBPLDM_ABI_STABLE
 void pldm_transport_af_mctp_destroy(struct pldm_transport_af_mctp *ctx)
 {
 	if (!ctx) {
 		return;
 	}
+#if HAVE_IO_URING_BUF_RING
+	pldm_transport_af_mctp_uring_destroy(ctx);
+#endif
+	pldm_responder_cookie_jar_fini(&ctx->cookie_jar);
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
 	close(ctx->socket);
 	free(ctx);
 }
 
+#if !HAVE_IO_URING_BUF_RING
+LIBPLDM_ABI_TESTING
+int pldm_transport_af_mctp_enable_uring(struct pldm_transport_af_mctp *ctx,
+					size_t max_msg_len)
+{
+	if (!ctx || max_msg_len < sizeof(struct pldm_msg_hdr) ||
+	    max_msg_len > INT_MAX) {
+		return -EINVAL;
+	}
+
+	return -EOPNOTSUPP;
+}
+#endif
+
 LIBPLDM_ABI_STABLE
 int pldm_transport_af_mctp_bind(struct pldm_transport_af_mctp *transport,
 				const struct sockaddr_mctp *smctp, size_t len)
@@ -346,6 +685,14 @@ int pldm_transport_af_mctp_bind(struct pldm_transport_af_mctp *transport,
 		return PLDM_REQUESTER_INVALID_SETUP;
 	}
 
+	if (!transport->cookie_jar.slab &&
+	    pldm_responder_cookie_jar_init(
+		    &transport->cookie_jar,
+		    sizeof(struct pldm_responder_cookie_af_mctp),
+		    PLDM_AF_MCTP_COOKIES_MAX)) {
+		return PLDM_REQUESTER_SETUP_FAIL;
+	}
+
 	rc = bind(transport->socket, (const struct sockaddr *)smctp,
 		  sizeof(*smctp));
 	if (rc) {
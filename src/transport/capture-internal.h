@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+
+/* The layout of a capture, see <libpldm/transport/capture.h> */
+
+struct pldm_capture_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct pldm_capture_record {
+	uint64_t timestamp;
+	uint32_t len;
+	uint8_t tid;
+	uint8_t direction;
+	uint16_t reserved;
+};
+
+static_assert(sizeof(struct pldm_capture_header) == 16,
+	      "Unexpected capture header size");
+static_assert(sizeof(struct pldm_capture_record) == 16,
+	      "Unexpected capture record size");
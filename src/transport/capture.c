@@ -0,0 +1,352 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "capture-internal.h"
+#include "container-of.h"
+#include "environ/errno.h"
+#include "environ/time.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/capture.h>
+
+#include <endian.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define CAPTURE_NAME "CAPTURE"
+
+/* Records are buffered and written out in chunks of this size */
+#define PLDM_CAPTURE_BUFFER_SIZE 65536
+
+struct pldm_transport_capture {
+	struct pldm_transport transport;
+	struct pldm_transport *inner;
+	int fd;
+	int error;
+	size_t used;
+	unsigned char *buf;
+};
+
+#define transport_to_capture(ptr)                                              \
+	container_of(ptr, struct pldm_transport_capture, transport)
+
+/* Write all of @len bytes from @buf, returning 0 or a negative errno value */
+static int pldm_capture_write_all(int fd, const unsigned char *buf, size_t len)
+{
+	ssize_t written;
+
+	while (len) {
+		written = write(fd, buf, len);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -errno;
+		}
+
+		buf += written;
+		len -= written;
+	}
+
+	return 0;
+}
+
+static void pldm_capture_drain(struct pldm_transport_capture *capture)
+{
+	int rc;
+
+	if (capture->error || !capture->used) {
+		capture->used = 0;
+		return;
+	}
+
+	rc = pldm_capture_write_all(capture->fd, capture->buf, capture->used);
+	if (rc) {
+		capture->error = rc;
+	}
+
+	capture->used = 0;
+}
+
+static uint64_t pldm_capture_timestamp(void)
+{
+	struct timespec now;
+
+	if (libpldm_clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* Append a record whose payload is gathered from @iov */
+static void pldm_capture_record(struct pldm_transport_capture *capture,
+				uint64_t timestamp, pldm_tid_t tid,
+				enum pldm_transport_capture_direction direction,
+				const struct iovec *iov, size_t iovlen,
+				size_t len)
+{
+	struct pldm_capture_record record = { 0 };
+	size_t size = sizeof(record) + len;
+	unsigned char *dst;
+
+	if (capture->error || len > UINT32_MAX) {
+		return;
+	}
+
+	record.timestamp = htole64(timestamp);
+	record.len = htole32((uint32_t)len);
+	record.tid = tid;
+	record.direction = direction;
+
+	if (capture->used + size > PLDM_CAPTURE_BUFFER_SIZE) {
+		pldm_capture_drain(capture);
+	}
+
+	/* Oversized records bypass the buffer */
+	if (size > PLDM_CAPTURE_BUFFER_SIZE) {
+		int rc;
+
+		rc = pldm_capture_write_all(capture->fd,
+					    (const unsigned char *)&record,
+					    sizeof(record));
+		for (size_t i = 0; !rc && i < iovlen; i++) {
+			rc = pldm_capture_write_all(capture->fd,
+						    iov[i].iov_base,
+						    iov[i].iov_len);
+		}
+		if (rc) {
+			capture->error = rc;
+		}
+		return;
+	}
+
+	dst = capture->buf + capture->used;
+	memcpy(dst, &record, sizeof(record));
+	dst += sizeof(record);
+	for (size_t i = 0; i < iovlen; i++) {
+		memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+		dst += iov[i].iov_len;
+	}
+
+	capture->used += size;
+}
+
+static void pldm_capture_record_msg(struct pldm_transport_capture *capture,
+				    pldm_tid_t tid,
+				    enum pldm_transport_capture_direction dir,
+				    const void *msg, size_t len)
+{
+	const struct iovec iov = {
+		.iov_base = (void *)msg,
+		.iov_len = len,
+	};
+
+	pldm_capture_record(capture, pldm_capture_timestamp(), tid, dir, &iov,
+			    1, len);
+}
+
+static int pldm_transport_capture_init_pollfd(struct pldm_transport *t,
+					      struct pollfd *pollfd)
+{
+	struct pldm_transport_capture *capture = transport_to_capture(t);
+
+	if (!capture->inner->init_pollfd) {
+		return PLDM_REQUESTER_POLL_FAIL;
+	}
+
+	return capture->inner->init_pollfd(capture->inner, pollfd);
+}
+
+static pldm_requester_rc_t
+pldm_transport_capture_recv(struct pldm_transport *t, pldm_tid_t *tid,
+			    void **pldm_msg, size_t *msg_len)
+{
+	struct pldm_transport_capture *capture = transport_to_capture(t);
+	pldm_requester_rc_t rc;
+
+	rc = capture->inner->recv(capture->inner, tid, pldm_msg, msg_len);
+	if (rc == PLDM_REQUESTER_SUCCESS) {
+		pldm_capture_record_msg(capture, *tid,
+					PLDM_TRANSPORT_CAPTURE_RX, *pldm_msg,
+					*msg_len);
+	}
+
+	return rc;
+}
+
+static int pldm_transport_capture_recv_batch(struct pldm_transport *t,
+					     struct pldm_transport_msg *msgs,
+					     size_t count)
+{
+	struct pldm_transport_capture *capture = transport_to_capture(t);
+	uint64_t timestamp;
+	int rc;
+
+	rc = capture->inner->recv_batch(capture->inner, msgs, count);
+	if (rc <= 0) {
+		return rc;
+	}
+
+	/* Messages received together share their timestamp */
+	timestamp = pldm_capture_timestamp();
+	for (int i = 0; i < rc; i++) {
+		const struct iovec iov = {
+			.iov_base = msgs[i].msg,
+			.iov_len = msgs[i].len,
+		};
+
+		pldm_capture_record(capture, timestamp, msgs[i].tid,
+				    PLDM_TRANSPORT_CAPTURE_RX, &iov, 1,
+				    msgs[i].len);
+	}
+
+	return rc;
+}
+
+static pldm_requester_rc_t
+pldm_transport_capture_send(struct pldm_transport *t, pldm_tid_t tid,
+			    const void *pldm_msg, size_t msg_len)
+{
+	struct pldm_transport_capture *capture = transport_to_capture(t);
+	pldm_requester_rc_t rc;
+
+	rc = capture->inner->send(capture->inner, tid, pldm_msg, msg_len);
+	if (rc == PLDM_REQUESTER_SUCCESS) {
+		pldm_capture_record_msg(capture, tid, PLDM_TRANSPORT_CAPTURE_TX,
+					pldm_msg, msg_len);
+	}
+
+	return rc;
+}
+
+static int
+pldm_transport_capture_send_batch(struct pldm_transport *t,
+				  const struct pldm_transport_msgv *msgs,
+				  size_t count)
+{
+	struct pldm_transport_capture *capture = transport_to_capture(t);
+	uint64_t timestamp;
+	int rc;
+
+	rc = capture->inner->send_batch(capture->inner, msgs, count);
+	if (rc <= 0) {
+		return rc;
+	}
+
+	timestamp = pldm_capture_timestamp();
+	for (int i = 0; i < rc; i++) {
+		pldm_capture_record(capture, timestamp, msgs[i].tid,
+				    PLDM_TRANSPORT_CAPTURE_TX, msgs[i].iov,
+				    msgs[i].iovlen,
+				    pldm_transport_msgv_len(&msgs[i]));
+	}
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+struct pldm_transport *
+pldm_transport_capture_core(struct pldm_transport_capture *ctx)
+{
+	return &ctx->transport;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_capture_init(struct pldm_transport_capture **ctx,
+				struct pldm_transport *inner, int fd)
+{
+	struct pldm_capture_header header = { 0 };
+	struct pldm_transport_capture *capture;
+	struct stat st;
+	int rc;
+
+	if (!ctx || *ctx || !inner || fd < 0) {
+		return -EINVAL;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		return -errno;
+	}
+
+	capture = calloc(1, sizeof(*capture));
+	if (!capture) {
+		return -ENOMEM;
+	}
+
+	capture->buf = malloc(PLDM_CAPTURE_BUFFER_SIZE);
+	if (!capture->buf) {
+		rc = -ENOMEM;
+		goto cleanup_capture;
+	}
+
+	if (!st.st_size) {
+		memcpy(header.magic, PLDM_TRANSPORT_CAPTURE_MAGIC,
+		       sizeof(header.magic));
+		header.version = htole32(PLDM_TRANSPORT_CAPTURE_VERSION);
+		rc = pldm_capture_write_all(fd, (const unsigned char *)&header,
+					    sizeof(header));
+		if (rc) {
+			goto cleanup_buf;
+		}
+	}
+
+	capture->transport.name = CAPTURE_NAME;
+	capture->transport.version = 1;
+	capture->transport.recv = pldm_transport_capture_recv;
+	capture->transport.send = pldm_transport_capture_send;
+	capture->transport.init_pollfd = pldm_transport_capture_init_pollfd;
+	if (inner->recv_batch) {
+		capture->transport.recv_batch =
+			pldm_transport_capture_recv_batch;
+	}
+	if (inner->send_batch) {
+		capture->transport.send_batch =
+			pldm_transport_capture_send_batch;
+	}
+	capture->inner = inner;
+	capture->fd = fd;
+
+	*ctx = capture;
+
+	return 0;
+
+cleanup_buf:
+	free(capture->buf);
+cleanup_capture:
+	free(capture);
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_capture_flush(struct pldm_transport_capture *ctx)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	pldm_capture_drain(ctx);
+
+	return ctx->error;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_capture_destroy(struct pldm_transport_capture *ctx)
+{
+	if (!ctx) {
+		return;
+	}
+
+	pldm_capture_drain(ctx);
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
+	free(ctx->buf);
+	free(ctx);
+}
@@ -0,0 +1,413 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "container-of.h"
+#include "environ/errno.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/loopback.h>
+
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define LOOPBACK_NAME "LOOPBACK"
+
+/* The largest ring accepted by pldm_transport_loopback_init_pair() */
+#define PLDM_LOOPBACK_DEPTH_MAX (1UL << 20)
+
+/* Keep the indices of the producer and consumer on separate cache lines */
+#define PLDM_LOOPBACK_CACHELINE 64
+
+struct pldm_loopback_slot {
+	void *msg;
+	size_t len;
+};
+
+/*
+ * A single-producer, single-consumer ring of heap-allocated messages. The
+ * producer allocates each message and the consumer takes ownership of it, so
+ * pldm_transport_recv_msg() needs no copy.
+ *
+ * The consumer is woken through the eventfd with the pldm_transport_wakeup_*()
+ * helpers.
+ */
+struct pldm_loopback_ring {
+	/* Advanced only by the consumer */
+	size_t head;
+	unsigned char pad_head[PLDM_LOOPBACK_CACHELINE - sizeof(size_t)];
+	/* Advanced only by the producer */
+	size_t tail;
+	unsigned char pad_tail[PLDM_LOOPBACK_CACHELINE - sizeof(size_t)];
+	uint32_t signalled;
+	struct pldm_loopback_slot *slots;
+	size_t mask;
+	int efd;
+};
+
+struct pldm_loopback_pair;
+
+struct pldm_transport_loopback {
+	struct pldm_transport transport;
+	struct pldm_loopback_pair *pair;
+	struct pldm_loopback_ring *rx;
+	struct pldm_loopback_ring *tx;
+	pldm_tid_t peer;
+};
+
+struct pldm_loopback_pair {
+	struct pldm_transport_loopback ends[2];
+	struct pldm_loopback_ring rings[2];
+	int refs;
+};
+
+#define transport_to_loopback(ptr)                                             \
+	container_of(ptr, struct pldm_transport_loopback, transport)
+
+/* Make @count slots starting at the producer's tail visible to the consumer */
+static void pldm_loopback_publish(struct pldm_loopback_ring *ring,
+				  size_t tail, size_t count)
+{
+	__atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+	pldm_transport_wakeup_publish(&ring->signalled, ring->efd);
+}
+
+/*
+ * Called by the consumer once it has found the ring empty. Returns the
+ * producer's tail.
+ */
+static size_t pldm_loopback_settle(struct pldm_loopback_ring *ring)
+{
+	size_t tail;
+
+	pldm_transport_wakeup_clear(&ring->signalled, ring->efd);
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (tail != ring->head) {
+		/* Keep the eventfd readable for what remains */
+		pldm_transport_wakeup_signal(&ring->signalled, ring->efd);
+	}
+
+	return tail;
+}
+
+/* Returns the number of messages available to the consumer */
+static size_t pldm_loopback_available(struct pldm_loopback_ring *ring)
+{
+	size_t tail;
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (tail == ring->head) {
+		tail = pldm_loopback_settle(ring);
+	}
+
+	return tail - ring->head;
+}
+
+/* Returns the number of slots free for the producer */
+static size_t pldm_loopback_space(struct pldm_loopback_ring *ring)
+{
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	return ring->mask + 1 - (ring->tail - head);
+}
+
+LIBPLDM_ABI_TESTING
+struct pldm_transport *
+pldm_transport_loopback_core(struct pldm_transport_loopback *ctx)
+{
+	return &ctx->transport;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_loopback_init_pollfd(struct pldm_transport *t,
+					struct pollfd *pollfd)
+{
+	struct pldm_transport_loopback *loopback = transport_to_loopback(t);
+
+	pollfd->fd = loopback->rx->efd;
+	pollfd->events = POLLIN;
+
+	return 0;
+}
+
+static pldm_requester_rc_t
+pldm_transport_loopback_recv(struct pldm_transport *t, pldm_tid_t *tid,
+			     void **pldm_msg, size_t *msg_len)
+{
+	struct pldm_transport_loopback *loopback = transport_to_loopback(t);
+	struct pldm_loopback_ring *ring = loopback->rx;
+	struct pldm_loopback_slot *slot;
+
+	if (!pldm_loopback_available(ring)) {
+		errno = EAGAIN;
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	slot = &ring->slots[ring->head & ring->mask];
+	*tid = loopback->peer;
+	*pldm_msg = slot->msg;
+	*msg_len = slot->len;
+
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+static int pldm_transport_loopback_recv_batch(struct pldm_transport *t,
+					      struct pldm_transport_msg *msgs,
+					      size_t count)
+{
+	struct pldm_transport_loopback *loopback = transport_to_loopback(t);
+	struct pldm_loopback_ring *ring = loopback->rx;
+	size_t available;
+	size_t n = 0;
+
+	available = pldm_loopback_available(ring);
+	if (!available) {
+		return -EAGAIN;
+	}
+
+	if (count > available) {
+		count = available;
+	}
+
+	if (count > INT_MAX) {
+		count = INT_MAX;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct pldm_loopback_slot *slot =
+			&ring->slots[(ring->head + i) & ring->mask];
+
+		if (slot->len > msgs[i].len) {
+			pldm_transport_stats_count(
+				t, PLDM_TRANSPORT_STATS_NO_TID,
+				PLDM_TRANSPORT_STAT(rx_invalid_len), 1);
+		} else {
+			memcpy(msgs[i].msg, slot->msg, slot->len);
+			pldm_transport_msg_keep(msgs, i, n++, loopback->peer,
+						slot->len);
+		}
+
+		free(slot->msg);
+	}
+
+	__atomic_store_n(&ring->head, ring->head + count, __ATOMIC_RELEASE);
+
+	return (int)n;
+}
+
+static pldm_requester_rc_t
+pldm_transport_loopback_send(struct pldm_transport *t, pldm_tid_t tid,
+			     const void *pldm_msg, size_t msg_len)
+{
+	struct pldm_transport_loopback *loopback = transport_to_loopback(t);
+	struct pldm_loopback_ring *ring = loopback->tx;
+	struct pldm_loopback_slot *slot;
+	void *msg;
+
+	if (tid != loopback->peer) {
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	if (!pldm_loopback_space(ring)) {
+		errno = EAGAIN;
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	msg = malloc(msg_len);
+	if (!msg) {
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	memcpy(msg, pldm_msg, msg_len);
+
+	slot = &ring->slots[ring->tail & ring->mask];
+	slot->msg = msg;
+	slot->len = msg_len;
+	pldm_loopback_publish(ring, ring->tail, 1);
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+static int
+pldm_transport_loopback_send_batch(struct pldm_transport *t,
+				   const struct pldm_transport_msgv *msgs,
+				   size_t count)
+{
+	struct pldm_transport_loopback *loopback = transport_to_loopback(t);
+	struct pldm_loopback_ring *ring = loopback->tx;
+	size_t space;
+	size_t n;
+
+	space = pldm_loopback_space(ring);
+	if (!space) {
+		return -EAGAIN;
+	}
+
+	if (count > space) {
+		count = space;
+	}
+
+	/* Fill the slots, then publish them to the consumer at once */
+	for (n = 0; n < count; n++) {
+		const struct pldm_transport_msgv *msg = &msgs[n];
+		struct pldm_loopback_slot *slot;
+		size_t len;
+		void *buf;
+
+		if (msg->tid != loopback->peer) {
+			break;
+		}
+
+		len = pldm_transport_msgv_len(msg);
+		buf = malloc(len);
+		if (!buf) {
+			break;
+		}
+
+		pldm_transport_msgv_peek(msg, buf, len);
+
+		slot = &ring->slots[(ring->tail + n) & ring->mask];
+		slot->msg = buf;
+		slot->len = len;
+	}
+
+	if (!n) {
+		return -EIO;
+	}
+
+	pldm_loopback_publish(ring, ring->tail, n);
+
+	return (int)n;
+}
+
+static int pldm_loopback_ring_init(struct pldm_loopback_ring *ring,
+				   size_t depth)
+{
+	ring->slots = calloc(depth, sizeof(*ring->slots));
+	if (!ring->slots) {
+		return -ENOMEM;
+	}
+
+	ring->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (ring->efd < 0) {
+		free(ring->slots);
+		return -errno;
+	}
+
+	ring->mask = depth - 1;
+
+	return 0;
+}
+
+static void pldm_loopback_ring_fini(struct pldm_loopback_ring *ring)
+{
+	for (size_t i = ring->head; i != ring->tail; i++) {
+		free(ring->slots[i & ring->mask].msg);
+	}
+
+	close(ring->efd);
+	free(ring->slots);
+}
+
+static void pldm_loopback_end_init(struct pldm_loopback_pair *pair, int i,
+				   pldm_tid_t peer)
+{
+	struct pldm_transport_loopback *end = &pair->ends[i];
+
+	end->transport.name = LOOPBACK_NAME;
+	end->transport.version = 1;
+	end->transport.recv = pldm_transport_loopback_recv;
+	end->transport.send = pldm_transport_loopback_send;
+	end->transport.init_pollfd = pldm_transport_loopback_init_pollfd;
+	end->transport.recv_batch = pldm_transport_loopback_recv_batch;
+	end->transport.send_batch = pldm_transport_loopback_send_batch;
+	end->pair = pair;
+	end->rx = &pair->rings[i];
+	end->tx = &pair->rings[!i];
+	end->peer = peer;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_loopback_init_pair(struct pldm_transport_loopback **a,
+				      pldm_tid_t a_tid,
+				      struct pldm_transport_loopback **b,
+				      pldm_tid_t b_tid, size_t depth)
+{
+	struct pldm_loopback_pair *pair;
+	size_t size;
+	int rc;
+
+	if (!a || *a || !b || *b || a == b) {
+		return -EINVAL;
+	}
+
+	if (!depth || depth > PLDM_LOOPBACK_DEPTH_MAX) {
+		return -EINVAL;
+	}
+
+	for (size = 1; size < depth; size <<= 1)
+		;
+
+	pair = calloc(1, sizeof(*pair));
+	if (!pair) {
+		return -ENOMEM;
+	}
+
+	rc = pldm_loopback_ring_init(&pair->rings[0], size);
+	if (rc) {
+		goto cleanup_pair;
+	}
+
+	rc = pldm_loopback_ring_init(&pair->rings[1], size);
+	if (rc) {
+		goto cleanup_ring;
+	}
+
+	/* Each end receives from its own ring and reports its peer's TID */
+	pldm_loopback_end_init(pair, 0, b_tid);
+	pldm_loopback_end_init(pair, 1, a_tid);
+	pair->refs = 2;
+
+	*a = &pair->ends[0];
+	*b = &pair->ends[1];
+
+	return 0;
+
+cleanup_ring:
+	pldm_loopback_ring_fini(&pair->rings[0]);
+cleanup_pair:
+	free(pair);
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_loopback_destroy(struct pldm_transport_loopback *ctx)
+{
+	struct pldm_loopback_pair *pair;
+
+	if (!ctx) {
+		return;
+	}
+
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
+
+	pair = ctx->pair;
+	if (__atomic_sub_fetch(&pair->refs, 1, __ATOMIC_ACQ_REL)) {
+		return;
+	}
+
+	pldm_loopback_ring_fini(&pair->rings[0]);
+	pldm_loopback_ring_fini(&pair->rings[1]);
+	free(pair);
+}
@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pldm_transport_mctp_demux;
+
+struct pldm_transport_mctp_demux *
+pldm_transport_mctp_demux_init_with_fd(int mctp_fd);
+
+int pldm_transport_mctp_demux_get_socket_fd(
+	struct pldm_transport_mctp_demux *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,6 +3,7 @@
 #include "container-of.h"
 #include "environ/errno.h"
 #include "mctp-defines.h"
+#include "mctp-demux-internal.h"
 #include "socket.h"
 #include "transport.h"
 
@@ -30,7 +31,12 @@ struct pldm_transport_mctp_demux {
 	/* In the future this probably needs to move to a tid-eid-uuid/network
 	 * id mapping for multi mctp networks */
 	pldm_tid_t tid_eid_map[MCTP_MAX_NUM_EID];
+	/* The reverse of tid_eid_map, holding EID + 1 so zero is unmapped */
+	uint16_t eid_tid_map[PLDM_MAX_TIDS];
 	struct pldm_socket_sndbuf socket_send_buf;
+	/* Receive buffer for pldm_transport_mctp_demux_enable_recv_buffer() */
+	uint8_t *rx_buf;
+	size_t rx_buf_len;
 };
 
 #define transport_to_demux(ptr)                                                \
@@ -84,17 +90,59 @@ static int
 pldm_transport_mctp_demux_get_eid(struct pldm_transport_mctp_demux *ctx,
 				  pldm_tid_t tid, mctp_eid_t *eid)
 {
-	int i;
-	for (i = 0; i < MCTP_MAX_NUM_EID; i++) {
-		if (ctx->tid_eid_map[i] == tid) {
-			*eid = i;
-			return 0;
+	if (ctx->eid_tid_map[tid]) {
+		*eid = ctx->eid_tid_map[tid] - 1;
+		return 0;
+	}
+
+	/* TID 0 isn't indexed, and resolves to the lowest unmapped EID */
+	if (!tid) {
+		for (int i = 0; i < MCTP_MAX_NUM_EID; i++) {
+			if (!ctx->tid_eid_map[i]) {
+				*eid = i;
+				return 0;
+			}
 		}
 	}
+
 	*eid = -1;
 	return -1;
 }
 
+/*
+ * Re-resolve a TID after the map changed. Mapping is not on the message path,
+ * so simply search for the lowest EID that remains mapped to the TID.
+ */
+static void
+pldm_transport_mctp_demux_update_eid(struct pldm_transport_mctp_demux *ctx,
+				     pldm_tid_t tid)
+{
+	ctx->eid_tid_map[tid] = 0;
+
+	/* A zero entry in tid_eid_map is unmapped */
+	if (!tid) {
+		return;
+	}
+
+	for (int i = 0; i < MCTP_MAX_NUM_EID; i++) {
+		if (ctx->tid_eid_map[i] == tid) {
+			ctx->eid_tid_map[tid] = i + 1;
+			return;
+		}
+	}
+}
+
+static void
+pldm_transport_mctp_demux_set_tid(struct pldm_transport_mctp_demux *ctx,
+				  mctp_eid_t eid, pldm_tid_t tid)
+{
+	pldm_tid_t prev = ctx->tid_eid_map[eid];
+
+	ctx->tid_eid_map[eid] = tid;
+	pldm_transport_mctp_demux_update_eid(ctx, prev);
+	pldm_transport_mctp_demux_update_eid(ctx, tid);
+}
+
 static int
 pldm_transport_mctp_demux_get_tid(struct pldm_transport_mctp_demux *ctx,
 				  mctp_eid_t eid, pldm_tid_t *tid)
@@ -111,7 +159,7 @@ LIBPLDM_ABI_STABLE
 int pldm_transport_mctp_demux_map_tid(struct pldm_transport_mctp_demux *ctx,
 				      pldm_tid_t tid, mctp_eid_t eid)
 {
-	ctx->tid_eid_map[eid] = tid;
+	pldm_transport_mctp_demux_set_tid(ctx, eid, tid);
 
 	return 0;
 }
@@ -121,11 +169,67 @@ int pldm_transport_mctp_demux_unmap_tid(struct pldm_transport_mctp_demux *ctx,
 					LIBPLDM_CC_UNUSED pldm_tid_t tid,
 					mctp_eid_t eid)
 {
-	ctx->tid_eid_map[eid] = 0;
+	pldm_transport_mctp_demux_set_tid(ctx, eid, 0);
 
 	return 0;
 }
 
+/*
+ * Receive with a single recvmsg() into the preallocated buffer, allocating
+ * only once the length of the message is known.
+ */
+static pldm_requester_rc_t
+pldm_transport_mctp_demux_recv_buffered(struct pldm_transport_mctp_demux *demux,
+					pldm_tid_t *tid, void **pldm_msg,
+					size_t *msg_len)
+{
+	uint8_t mctp_prefix[2];
+	struct msghdr msg = { 0 };
+	struct iovec iov[2];
+	size_t pldm_len;
+	ssize_t bytes;
+	void *buf;
+
+	iov[0].iov_base = mctp_prefix;
+	iov[0].iov_len = sizeof(mctp_prefix);
+	iov[1].iov_base = demux->rx_buf;
+	iov[1].iov_len = demux->rx_buf_len;
+
+	msg.msg_iov = iov;
+	msg.msg_iovlen = sizeof(iov) / sizeof(iov[0]);
+
+	bytes = recvmsg(demux->socket, &msg, 0);
+	if (bytes <= 0) {
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	/* Messages exceeding the buffer are discarded by the truncation */
+	if ((msg.msg_flags & MSG_TRUNC) ||
+	    (size_t)bytes < sizeof(mctp_prefix) + sizeof(struct pldm_msg_hdr)) {
+		return PLDM_REQUESTER_INVALID_RECV_LEN;
+	}
+
+	if (mctp_prefix[1] != mctp_msg_type) {
+		return PLDM_REQUESTER_NOT_PLDM_MSG;
+	}
+
+	if (pldm_transport_mctp_demux_get_tid(demux, mctp_prefix[0], tid)) {
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	pldm_len = bytes - sizeof(mctp_prefix);
+	buf = malloc(pldm_len);
+	if (!buf) {
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	memcpy(buf, demux->rx_buf, pldm_len);
+	*pldm_msg = buf;
+	*msg_len = pldm_len;
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
 static pldm_requester_rc_t
 pldm_transport_mctp_demux_recv(struct pldm_transport *t, pldm_tid_t *tid,
 			       void **pldm_msg, size_t *msg_len)
@@ -144,6 +248,12 @@ pldm_transport_mctp_demux_recv(struct pldm_transport *t, pldm_tid_t *tid,
 	uint8_t *buf;
 	int rc;
 
+	if (demux->rx_buf) {
+		return pldm_transport_mctp_demux_recv_buffered(demux, tid,
+							       pldm_msg,
+							       msg_len);
+	}
+
 	min_len = sizeof(eid) + sizeof(mctp_msg_type) +
 		  sizeof(struct pldm_msg_hdr);
 	length = recv(demux->socket, NULL, 0, MSG_PEEK | MSG_TRUNC);
@@ -201,6 +311,70 @@ cleanup_buf:
 	return res;
 }
 
+static int pldm_transport_mctp_demux_recv_batch(struct pldm_transport *t,
+						struct pldm_transport_msg *msgs,
+						size_t count)
+{
+	struct pldm_transport_mctp_demux *demux = transport_to_demux(t);
+	struct mmsghdr mmsgs[PLDM_TRANSPORT_RECV_BATCH_MAX] = { 0 };
+	struct iovec iovs[PLDM_TRANSPORT_RECV_BATCH_MAX][2];
+	uint8_t prefixes[PLDM_TRANSPORT_RECV_BATCH_MAX][2];
+	const size_t min_len =
+		sizeof(prefixes[0]) + sizeof(struct pldm_msg_hdr);
+	size_t received;
+	size_t n = 0;
+	int rc;
+
+	if (count > PLDM_TRANSPORT_RECV_BATCH_MAX) {
+		count = PLDM_TRANSPORT_RECV_BATCH_MAX;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		iovs[i][0].iov_base = prefixes[i];
+		iovs[i][0].iov_len = sizeof(prefixes[i]);
+		iovs[i][1].iov_base = msgs[i].msg;
+		iovs[i][1].iov_len = msgs[i].len;
+		mmsgs[i].msg_hdr.msg_iov = iovs[i];
+		mmsgs[i].msg_hdr.msg_iovlen = 2;
+	}
+
+	rc = recvmmsg(demux->socket, mmsgs, count, MSG_WAITFORONE, NULL);
+	if (rc < 0) {
+		return -errno;
+	}
+
+	received = rc;
+	for (size_t i = 0; i < received; i++) {
+		size_t length = mmsgs[i].msg_len;
+		pldm_tid_t tid;
+
+		if ((mmsgs[i].msg_hdr.msg_flags & MSG_TRUNC) ||
+		    length < min_len) {
+			pldm_transport_stats_count(
+				t, PLDM_TRANSPORT_STATS_NO_TID,
+				PLDM_TRANSPORT_STAT(rx_invalid_len), 1);
+			continue;
+		}
+
+		if (prefixes[i][1] != mctp_msg_type) {
+			pldm_transport_stats_count(
+				t, PLDM_TRANSPORT_STATS_NO_TID,
+				PLDM_TRANSPORT_STAT(rx_not_pldm), 1);
+			continue;
+		}
+
+		if (pldm_transport_mctp_demux_get_tid(demux, prefixes[i][0],
+						      &tid)) {
+			continue;
+		}
+
+		pldm_transport_msg_keep(msgs, i, n++, tid,
+					length - sizeof(prefixes[i]));
+	}
+
+	return (int)n;
+}
+
 static pldm_requester_rc_t
 pldm_transport_mctp_demux_send(struct pldm_transport *t, pldm_tid_t tid,
 			       const void *pldm_msg, size_t msg_len)
@@ -254,12 +428,14 @@ int pldm_transport_mctp_demux_init(struct pldm_transport_mctp_demux **ctx)
 	demux->transport.recv = pldm_transport_mctp_demux_recv;
 	demux->transport.send = pldm_transport_mctp_demux_send;
 	demux->transport.init_pollfd = pldm_transport_mctp_demux_init_pollfd;
+	demux->transport.recv_batch = pldm_transport_mctp_demux_recv_batch;
 	demux->socket = pldm_transport_mctp_demux_open();
 	if (demux->socket == -1) {
 		free(demux);
 		return -1;
 	}
 
+	demux->socket_send_buf.transport = &demux->transport;
 	if (pldm_socket_sndbuf_init(&demux->socket_send_buf, demux->socket)) {
 		close(demux->socket);
 		free(demux);
@@ -270,17 +446,54 @@ int pldm_transport_mctp_demux_init(struct pldm_transport_mctp_demux **ctx)
 	return 0;
 }
 
+LIBPLDM_ABI_TESTING
+int pldm_transport_mctp_demux_enable_recv_buffer(
+	struct pldm_transport_mctp_demux *ctx, size_t max_msg_len)
+{
+	if (!ctx || max_msg_len < sizeof(struct pldm_msg_hdr)) {
+		return -EINVAL;
+	}
+
+	if (ctx->rx_buf) {
+		return -EBUSY;
+	}
+
+	ctx->rx_buf = malloc(max_msg_len);
+	if (!ctx->rx_buf) {
+		return -ENOMEM;
+	}
+
+	ctx->rx_buf_len = max_msg_len;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_mctp_demux_reserve_send_buffer(
+	struct pldm_transport_mctp_demux *ctx, size_t max_msg_len)
+{
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	return pldm_socket_sndbuf_reserve(&ctx->socket_send_buf, max_msg_len);
+}
+
 LIBPLDM_ABI_STABLE
 void pldm_transport_mctp_demux_destroy(struct pldm_transport_mctp_demux *ctx)
 {
 	if (!ctx) {
 		return;
 	}
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
 	close(ctx->socket);
+	free(ctx->rx_buf);
 	free(ctx);
 }
 
 /* Temporary for old API */
+LIBPLDM_ABI_TESTING
 struct pldm_transport_mctp_demux *
 pldm_transport_mctp_demux_init_with_fd(int mctp_fd)
 {
@@ -295,6 +508,7 @@ pldm_transport_mctp_demux_init_with_fd(int mctp_fd)
 	demux->transport.recv = pldm_transport_mctp_demux_recv;
 	demux->transport.send = pldm_transport_mctp_demux_send;
 	demux->transport.init_pollfd = pldm_transport_mctp_demux_init_pollfd;
+	demux->transport.recv_batch = pldm_transport_mctp_demux_recv_batch;
 	/* dup is so we can call pldm_transport_mctp_demux_destroy which closes
 	 * the socket, without closing the fd that is being used by the consumer
 	 */
@@ -304,6 +518,7 @@ pldm_transport_mctp_demux_init_with_fd(int mctp_fd)
 		return NULL;
 	}
 
+	demux->socket_send_buf.transport = &demux->transport;
 	if (pldm_socket_sndbuf_init(&demux->socket_send_buf, demux->socket)) {
 		close(demux->socket);
 		free(demux);
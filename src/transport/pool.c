@@ -0,0 +1,203 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "compiler.h"
+#include "environ/errno.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/transport.h>
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The free list link is stored unaligned at the start of each free buffer */
+static void *pldm_transport_pool_next(void *buf)
+{
+	void *next;
+
+	memcpy(&next, buf, sizeof(next));
+
+	return next;
+}
+
+static size_t pldm_transport_pool_index(struct pldm_transport_pool *pool,
+					void *buf)
+{
+	return ((unsigned char *)buf - pool->base) / pool->size;
+}
+
+static bool pldm_transport_pool_busy(struct pldm_transport_pool *pool,
+				     size_t i)
+{
+	return pool->in_use[i / CHAR_BIT] & (1u << (i % CHAR_BIT));
+}
+
+static void pldm_transport_pool_push(struct pldm_transport_pool *pool,
+				     void *buf)
+{
+	size_t i = pldm_transport_pool_index(pool, buf);
+
+	pool->in_use[i / CHAR_BIT] &= ~(1u << (i % CHAR_BIT));
+	memcpy(buf, &pool->free, sizeof(pool->free));
+	pool->free = buf;
+	pool->avail++;
+}
+
+static void *pldm_transport_pool_pop(struct pldm_transport_pool *pool)
+{
+	void *buf = pool->free;
+
+	if (buf) {
+		size_t i = pldm_transport_pool_index(pool, buf);
+
+		pool->in_use[i / CHAR_BIT] |= 1u << (i % CHAR_BIT);
+		pool->free = pldm_transport_pool_next(buf);
+		pool->avail--;
+	}
+
+	return buf;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_pool_init(struct pldm_transport *transport, void *slab,
+			     size_t size, size_t count)
+{
+	struct pldm_transport_pool *pool;
+
+	if (!transport || !slab || !count) {
+		return -EINVAL;
+	}
+
+	if (size < sizeof(struct pldm_msg_hdr) || size < sizeof(void *)) {
+		return -EINVAL;
+	}
+
+	if (count > SIZE_MAX / size) {
+		return -EINVAL;
+	}
+
+	pool = &transport->pool;
+	if (pool->base) {
+		return -EBUSY;
+	}
+
+	pool->in_use = calloc((count + CHAR_BIT - 1) / CHAR_BIT, 1);
+	if (!pool->in_use) {
+		return -ENOMEM;
+	}
+
+	pool->base = slab;
+	pool->size = size;
+	pool->count = count;
+	pool->avail = 0;
+	pool->free = NULL;
+
+	/* Push in reverse so buffers are handed out in address order */
+	for (size_t i = count; i > 0; i--) {
+		pldm_transport_pool_push(pool, pool->base + (i - 1) * size);
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_pool_fini(struct pldm_transport *transport)
+{
+	struct pldm_transport_pool *pool;
+
+	if (!transport || !transport->pool.base) {
+		return -EINVAL;
+	}
+
+	pool = &transport->pool;
+	if (pool->avail != pool->count) {
+		return -EBUSY;
+	}
+
+	pldm_transport_pool_destroy(transport);
+
+	return 0;
+}
+
+void pldm_transport_pool_destroy(struct pldm_transport *transport)
+{
+	free(transport->pool.in_use);
+	memset(&transport->pool, 0, sizeof(transport->pool));
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_recv_pooled(struct pldm_transport *transport,
+			       struct pldm_transport_msg *msgs, size_t count)
+{
+	struct pldm_transport_pool *pool;
+	size_t taken;
+	int rc;
+
+	if (!transport || !msgs) {
+		return -EINVAL;
+	}
+
+	pool = &transport->pool;
+	if (!pool->base) {
+		return -EINVAL;
+	}
+
+	if (!count) {
+		return 0;
+	}
+
+	if (!pool->avail) {
+		return -ENOBUFS;
+	}
+
+	for (taken = 0; taken < count && pool->avail; taken++) {
+		msgs[taken].msg = pldm_transport_pool_pop(pool);
+		msgs[taken].len = pool->size;
+	}
+
+	rc = pldm_transport_recv_batch(transport, msgs, taken);
+
+	/* Return the buffers that didn't receive a message */
+	for (size_t i = rc > 0 ? (size_t)rc : 0; i < taken; i++) {
+		pldm_transport_pool_push(pool, msgs[i].msg);
+		msgs[i].msg = NULL;
+		msgs[i].len = 0;
+	}
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_pool_release(struct pldm_transport *transport, void *msg)
+{
+	struct pldm_transport_pool *pool;
+	uintptr_t offset;
+
+	if (!transport || !msg) {
+		return -EINVAL;
+	}
+
+	pool = &transport->pool;
+	if (!pool->base) {
+		return -EINVAL;
+	}
+
+	offset = (uintptr_t)msg - (uintptr_t)pool->base;
+	if ((uintptr_t)msg < (uintptr_t)pool->base ||
+	    offset / pool->size >= pool->count || offset % pool->size) {
+		return -EINVAL;
+	}
+
+	/* Reject buffers that were never handed out or are already released */
+	if (!pldm_transport_pool_busy(pool, offset / pool->size)) {
+		return -EINVAL;
+	}
+
+	pldm_transport_pool_push(pool, msg);
+
+	return 0;
+}
@@ -0,0 +1,471 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "array.h"
+#include "container-of.h"
+#include "environ/errno.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/bios.h>
+#include <libpldm/platform.h>
+#include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/priority.h>
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define PRIORITY_NAME "PRIORITY"
+
+/* The number of PLDM types expressible in the 6-bit header field */
+#define PLDM_PRIORITY_TYPES 64
+
+/*
+ * The inner transport is only drained while fewer messages than this are
+ * held, which bounds the lanes to twice the batch size
+ */
+#define PLDM_PRIORITY_HELD_MAX PLDM_TRANSPORT_RECV_BATCH_MAX
+
+struct pldm_priority_msg {
+	struct pldm_priority_msg *next;
+	void *msg;
+	size_t len;
+	pldm_tid_t tid;
+};
+
+struct pldm_priority_lane {
+	struct pldm_priority_msg *head;
+	struct pldm_priority_msg *tail;
+};
+
+struct pldm_transport_priority {
+	struct pldm_transport transport;
+	struct pldm_transport *inner;
+	uint8_t lane_of[PLDM_PRIORITY_TYPES][256];
+	struct pldm_priority_lane lanes[PLDM_TRANSPORT_PRIORITY_LANES];
+	size_t held;
+	/*
+	 * The pollfd is an epoll set of the inner transport's pollfd and an
+	 * eventfd kept readable while messages are held
+	 */
+	int epollfd;
+	int efd;
+	uint32_t signalled;
+	int inner_fd;
+	short inner_events;
+	/* Lane entries are taken from a fixed set, threaded on a free list */
+	struct pldm_priority_msg entries[2 * PLDM_PRIORITY_HELD_MAX];
+	struct pldm_priority_msg *free;
+	/* Receive buffers for the inner transport's batch receive path */
+	unsigned char *slab;
+	size_t slab_size;
+};
+
+#define transport_to_priority(ptr)                                             \
+	container_of(ptr, struct pldm_transport_priority, transport)
+
+static enum pldm_transport_priority_lane
+pldm_priority_lane(struct pldm_transport_priority *priority, const void *msg,
+		   size_t len)
+{
+	const struct pldm_msg_hdr *hdr = msg;
+
+	/* Let the caller reject runt messages without delay */
+	if (len < sizeof(*hdr)) {
+		return PLDM_TRANSPORT_PRIORITY_HIGH;
+	}
+
+	return priority->lane_of[hdr->type][hdr->command];
+}
+
+static void pldm_priority_push(struct pldm_transport_priority *priority,
+			       pldm_tid_t tid, void *msg, size_t len)
+{
+	struct pldm_priority_lane *lane;
+	struct pldm_priority_msg *entry;
+
+	lane = &priority->lanes[pldm_priority_lane(priority, msg, len)];
+	entry = priority->free;
+	priority->free = entry->next;
+
+	entry->next = NULL;
+	entry->msg = msg;
+	entry->len = len;
+	entry->tid = tid;
+
+	if (lane->tail) {
+		lane->tail->next = entry;
+	} else {
+		lane->head = entry;
+	}
+	lane->tail = entry;
+	if (!priority->held++) {
+		pldm_transport_wakeup_signal(&priority->signalled,
+					     priority->efd);
+	}
+}
+
+static struct pldm_priority_msg *
+pldm_priority_pop(struct pldm_transport_priority *priority)
+{
+	struct pldm_priority_msg *entry;
+	struct pldm_priority_lane *lane;
+
+	for (size_t i = 0; i < PLDM_TRANSPORT_PRIORITY_LANES; i++) {
+		lane = &priority->lanes[i];
+		entry = lane->head;
+		if (!entry) {
+			continue;
+		}
+
+		lane->head = entry->next;
+		if (!lane->head) {
+			lane->tail = NULL;
+		}
+		entry->next = priority->free;
+		priority->free = entry;
+		if (!--priority->held) {
+			pldm_transport_wakeup_clear(&priority->signalled,
+						    priority->efd);
+		}
+
+		return entry;
+	}
+
+	return NULL;
+}
+
+/* Returns true if a message is available without blocking */
+static bool pldm_priority_ready(struct pldm_transport_priority *priority)
+{
+	struct pollfd pollfd;
+
+	if (!priority->inner->init_pollfd ||
+	    priority->inner->init_pollfd(priority->inner, &pollfd) < 0) {
+		return false;
+	}
+
+	pollfd.events = POLLIN;
+
+	return poll(&pollfd, 1, 0) > 0 && (pollfd.revents & POLLIN);
+}
+
+static pldm_requester_rc_t
+pldm_priority_drain_batch(struct pldm_transport_priority *priority)
+{
+	struct pldm_transport_msg msgs[PLDM_TRANSPORT_RECV_BATCH_MAX];
+	struct pldm_transport *inner = priority->inner;
+	int rc;
+
+	for (size_t i = 0; i < PLDM_TRANSPORT_RECV_BATCH_MAX; i++) {
+		msgs[i].msg = priority->slab + i * priority->slab_size;
+		msgs[i].len = priority->slab_size;
+	}
+
+	rc = inner->recv_batch(inner, msgs, PLDM_TRANSPORT_RECV_BATCH_MAX);
+	if (rc < 0) {
+		errno = -rc;
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	for (int i = 0; i < rc; i++) {
+		void *msg = malloc(msgs[i].len);
+
+		/* The remainder of the batch is dropped */
+		if (!msg) {
+			return i ? PLDM_REQUESTER_SUCCESS :
+				   PLDM_REQUESTER_RECV_FAIL;
+		}
+
+		memcpy(msg, msgs[i].msg, msgs[i].len);
+		pldm_priority_push(priority, msgs[i].tid, msg, msgs[i].len);
+	}
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+/*
+ * Move available messages from the inner transport into the lanes. Only
+ * waits for a message if none are held.
+ */
+static pldm_requester_rc_t
+pldm_priority_drain(struct pldm_transport_priority *priority)
+{
+	struct pldm_transport *inner = priority->inner;
+	pldm_requester_rc_t rc;
+	size_t msg_len;
+	pldm_tid_t tid;
+	void *msg;
+
+	if (priority->held >= PLDM_PRIORITY_HELD_MAX) {
+		return PLDM_REQUESTER_SUCCESS;
+	}
+
+	if (priority->held && !pldm_priority_ready(priority)) {
+		return PLDM_REQUESTER_SUCCESS;
+	}
+
+	if (inner->recv_batch) {
+		return pldm_priority_drain_batch(priority);
+	}
+
+	rc = inner->recv(inner, &tid, &msg, &msg_len);
+	if (rc == PLDM_REQUESTER_SUCCESS) {
+		pldm_priority_push(priority, tid, msg, msg_len);
+	}
+
+	return rc;
+}
+
+static int pldm_transport_priority_init_pollfd(struct pldm_transport *t,
+					       struct pollfd *pollfd)
+{
+	struct pldm_transport_priority *priority = transport_to_priority(t);
+	struct epoll_event event = { 0 };
+	struct pollfd inner;
+	int rc;
+
+	if (!priority->inner->init_pollfd) {
+		return PLDM_REQUESTER_POLL_FAIL;
+	}
+
+	rc = priority->inner->init_pollfd(priority->inner, &inner);
+	if (rc < 0) {
+		return rc;
+	}
+
+	/* The inner transport may have switched fds or events since */
+	if (inner.fd != priority->inner_fd ||
+	    inner.events != priority->inner_events) {
+		event.events = inner.events;
+		event.data.fd = inner.fd;
+		if (inner.fd == priority->inner_fd) {
+			rc = epoll_ctl(priority->epollfd, EPOLL_CTL_MOD,
+				       inner.fd, &event);
+		} else {
+			if (priority->inner_fd >= 0) {
+				epoll_ctl(priority->epollfd, EPOLL_CTL_DEL,
+					  priority->inner_fd, NULL);
+			}
+			rc = epoll_ctl(priority->epollfd, EPOLL_CTL_ADD,
+				       inner.fd, &event);
+		}
+		if (rc < 0) {
+			priority->inner_fd = -1;
+			return PLDM_REQUESTER_POLL_FAIL;
+		}
+		priority->inner_fd = inner.fd;
+		priority->inner_events = inner.events;
+	}
+
+	pollfd->fd = priority->epollfd;
+	pollfd->events = POLLIN;
+
+	return 0;
+}
+
+static pldm_requester_rc_t
+pldm_transport_priority_recv(struct pldm_transport *t, pldm_tid_t *tid,
+			     void **pldm_msg, size_t *msg_len)
+{
+	struct pldm_transport_priority *priority = transport_to_priority(t);
+	struct pldm_priority_msg *entry;
+	pldm_requester_rc_t rc;
+
+	rc = pldm_priority_drain(priority);
+	if (rc != PLDM_REQUESTER_SUCCESS && !priority->held) {
+		return rc;
+	}
+
+	entry = pldm_priority_pop(priority);
+	if (!entry) {
+		errno = EAGAIN;
+		return PLDM_REQUESTER_RECV_FAIL;
+	}
+
+	*tid = entry->tid;
+	*pldm_msg = entry->msg;
+	*msg_len = entry->len;
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+static pldm_requester_rc_t
+pldm_transport_priority_send(struct pldm_transport *t, pldm_tid_t tid,
+			     const void *pldm_msg, size_t msg_len)
+{
+	struct pldm_transport_priority *priority = transport_to_priority(t);
+
+	return priority->inner->send(priority->inner, tid, pldm_msg, msg_len);
+}
+
+static int
+pldm_transport_priority_send_batch(struct pldm_transport *t,
+				   const struct pldm_transport_msgv *msgs,
+				   size_t count)
+{
+	struct pldm_transport_priority *priority = transport_to_priority(t);
+
+	return priority->inner->send_batch(priority->inner, msgs, count);
+}
+
+LIBPLDM_ABI_TESTING
+struct pldm_transport *
+pldm_transport_priority_core(struct pldm_transport_priority *ctx)
+{
+	return &ctx->transport;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_priority_classify(struct pldm_transport_priority *ctx,
+				     uint8_t type, uint8_t command,
+				     enum pldm_transport_priority_lane lane)
+{
+	if (!ctx || type >= PLDM_PRIORITY_TYPES) {
+		return -EINVAL;
+	}
+
+	if ((unsigned int)lane >= PLDM_TRANSPORT_PRIORITY_LANES) {
+		return -EINVAL;
+	}
+
+	ctx->lane_of[type][command] = lane;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+size_t
+pldm_transport_priority_pending(const struct pldm_transport_priority *ctx)
+{
+	return ctx ? ctx->held : 0;
+}
+
+static void pldm_priority_default_lanes(struct pldm_transport_priority *ctx)
+{
+	memset(ctx->lane_of, PLDM_TRANSPORT_PRIORITY_NORMAL,
+	       sizeof(ctx->lane_of));
+	memset(ctx->lane_of[PLDM_FWUP], PLDM_TRANSPORT_PRIORITY_HIGH,
+	       sizeof(ctx->lane_of[PLDM_FWUP]));
+	ctx->lane_of[PLDM_PLATFORM][PLDM_PLATFORM_EVENT_MESSAGE] =
+		PLDM_TRANSPORT_PRIORITY_HIGH;
+	ctx->lane_of[PLDM_PLATFORM][PLDM_POLL_FOR_PLATFORM_EVENT_MESSAGE] =
+		PLDM_TRANSPORT_PRIORITY_HIGH;
+	ctx->lane_of[PLDM_PLATFORM][PLDM_GET_PDR] = PLDM_TRANSPORT_PRIORITY_LOW;
+	ctx->lane_of[PLDM_BIOS][PLDM_GET_BIOS_TABLE] =
+		PLDM_TRANSPORT_PRIORITY_LOW;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_priority_init(struct pldm_transport_priority **ctx,
+				 struct pldm_transport *inner,
+				 size_t max_msg_len)
+{
+	struct epoll_event event = { .events = EPOLLIN };
+	struct pldm_transport_priority *priority;
+	int rc;
+
+	if (!ctx || *ctx || !inner) {
+		return -EINVAL;
+	}
+
+	if (inner->recv_batch &&
+	    (max_msg_len < sizeof(struct pldm_msg_hdr) ||
+	     max_msg_len > SIZE_MAX / PLDM_TRANSPORT_RECV_BATCH_MAX)) {
+		return -EINVAL;
+	}
+
+	priority = calloc(1, sizeof(*priority));
+	if (!priority) {
+		return -ENOMEM;
+	}
+
+	if (inner->recv_batch) {
+		priority->slab =
+			malloc(max_msg_len * PLDM_TRANSPORT_RECV_BATCH_MAX);
+		if (!priority->slab) {
+			rc = -ENOMEM;
+			goto cleanup_priority;
+		}
+		priority->slab_size = max_msg_len;
+	}
+
+	priority->epollfd = epoll_create1(EPOLL_CLOEXEC);
+	if (priority->epollfd < 0) {
+		rc = -errno;
+		goto cleanup_slab;
+	}
+
+	priority->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (priority->efd < 0) {
+		rc = -errno;
+		goto cleanup_epollfd;
+	}
+
+	event.data.fd = priority->efd;
+	if (epoll_ctl(priority->epollfd, EPOLL_CTL_ADD, priority->efd,
+		      &event) < 0) {
+		rc = -errno;
+		goto cleanup_efd;
+	}
+	priority->inner_fd = -1;
+
+	for (size_t i = 0; i < ARRAY_SIZE(priority->entries); i++) {
+		priority->entries[i].next = priority->free;
+		priority->free = &priority->entries[i];
+	}
+
+	pldm_priority_default_lanes(priority);
+
+	priority->transport.name = PRIORITY_NAME;
+	priority->transport.version = 1;
+	priority->transport.recv = pldm_transport_priority_recv;
+	priority->transport.send = pldm_transport_priority_send;
+	priority->transport.init_pollfd = pldm_transport_priority_init_pollfd;
+	if (inner->send_batch) {
+		priority->transport.send_batch =
+			pldm_transport_priority_send_batch;
+	}
+	priority->inner = inner;
+
+	*ctx = priority;
+
+	return 0;
+
+cleanup_efd:
+	close(priority->efd);
+cleanup_epollfd:
+	close(priority->epollfd);
+cleanup_slab:
+	free(priority->slab);
+cleanup_priority:
+	free(priority);
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_priority_destroy(struct pldm_transport_priority *ctx)
+{
+	struct pldm_priority_msg *entry;
+
+	if (!ctx) {
+		return;
+	}
+
+	while ((entry = pldm_priority_pop(ctx))) {
+		free(entry->msg);
+	}
+
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
+	close(ctx->efd);
+	close(ctx->epollfd);
+	free(ctx->slab);
+	free(ctx);
+}
@@ -0,0 +1,295 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "container-of.h"
+#include "environ/errno.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/queue.h>
+
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUEUE_NAME "QUEUE"
+
+struct pldm_queue_msg {
+	struct pldm_queue_msg *next;
+	size_t len;
+	unsigned char data[];
+};
+
+/* The messages awaiting a TID, oldest first */
+struct pldm_queue_tid {
+	struct pldm_queue_msg *head;
+	struct pldm_queue_msg *tail;
+	size_t depth;
+};
+
+struct pldm_transport_queue {
+	struct pldm_transport transport;
+	struct pldm_transport *inner;
+	size_t max_depth;
+	size_t pending;
+	struct pldm_queue_tid tids[PLDM_MAX_TIDS];
+	/*
+	 * The round-robin schedule: a ring of the TIDs with queued messages,
+	 * each of which appears exactly once
+	 */
+	pldm_tid_t active[PLDM_MAX_TIDS];
+	size_t active_head;
+	size_t active_count;
+};
+
+#define transport_to_queue(ptr)                                                \
+	container_of(ptr, struct pldm_transport_queue, transport)
+
+static bool pldm_queue_would_block(pldm_requester_rc_t rc)
+{
+	return rc == PLDM_REQUESTER_SEND_FAIL &&
+	       (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static void pldm_queue_schedule(struct pldm_transport_queue *queue,
+				pldm_tid_t tid)
+{
+	size_t slot = (queue->active_head + queue->active_count) %
+		      PLDM_MAX_TIDS;
+
+	queue->active[slot] = tid;
+	queue->active_count++;
+}
+
+static int pldm_queue_push(struct pldm_transport_queue *queue, pldm_tid_t tid,
+			   const void *msg, size_t len)
+{
+	struct pldm_queue_tid *q = &queue->tids[tid];
+	struct pldm_queue_msg *entry;
+
+	if (q->depth >= queue->max_depth) {
+		return -ENOBUFS;
+	}
+
+	entry = malloc(sizeof(*entry) + len);
+	if (!entry) {
+		return -ENOMEM;
+	}
+
+	entry->next = NULL;
+	entry->len = len;
+	memcpy(entry->data, msg, len);
+
+	if (q->tail) {
+		q->tail->next = entry;
+	} else {
+		q->head = entry;
+	}
+	q->tail = entry;
+
+	if (!q->depth++) {
+		pldm_queue_schedule(queue, tid);
+	}
+	queue->pending++;
+
+	return 0;
+}
+
+/* Release the oldest message of the TID at the front of the schedule */
+static void pldm_queue_pop(struct pldm_transport_queue *queue)
+{
+	pldm_tid_t tid = queue->active[queue->active_head];
+	struct pldm_queue_tid *q = &queue->tids[tid];
+	struct pldm_queue_msg *entry = q->head;
+
+	q->head = entry->next;
+	if (!q->head) {
+		q->tail = NULL;
+	}
+	q->depth--;
+	queue->pending--;
+	free(entry);
+
+	/* Move the TID to the back of the schedule if it has more to send */
+	queue->active_head = (queue->active_head + 1) % PLDM_MAX_TIDS;
+	queue->active_count--;
+	if (q->depth) {
+		pldm_queue_schedule(queue, tid);
+	}
+}
+
+static int pldm_transport_queue_init_pollfd(struct pldm_transport *t,
+					    struct pollfd *pollfd)
+{
+	struct pldm_transport_queue *queue = transport_to_queue(t);
+	int rc;
+
+	if (!queue->inner->init_pollfd) {
+		return PLDM_REQUESTER_POLL_FAIL;
+	}
+
+	rc = queue->inner->init_pollfd(queue->inner, pollfd);
+	if (rc < 0) {
+		return rc;
+	}
+
+	if (queue->pending) {
+		pollfd->events |= POLLOUT;
+	}
+
+	return rc;
+}
+
+static pldm_requester_rc_t pldm_transport_queue_recv(struct pldm_transport *t,
+						     pldm_tid_t *tid,
+						     void **pldm_msg,
+						     size_t *msg_len)
+{
+	struct pldm_transport_queue *queue = transport_to_queue(t);
+
+	return queue->inner->recv(queue->inner, tid, pldm_msg, msg_len);
+}
+
+static int pldm_transport_queue_recv_batch(struct pldm_transport *t,
+					   struct pldm_transport_msg *msgs,
+					   size_t count)
+{
+	struct pldm_transport_queue *queue = transport_to_queue(t);
+
+	return queue->inner->recv_batch(queue->inner, msgs, count);
+}
+
+static pldm_requester_rc_t pldm_transport_queue_send(struct pldm_transport *t,
+						     pldm_tid_t tid,
+						     const void *pldm_msg,
+						     size_t msg_len)
+{
+	struct pldm_transport_queue *queue = transport_to_queue(t);
+	pldm_requester_rc_t rc;
+	int err;
+
+	/* Don't overtake queued messages */
+	if (!queue->pending) {
+		/* Transports may fail without setting errno */
+		errno = 0;
+		rc = queue->inner->send(queue->inner, tid, pldm_msg, msg_len);
+		if (!pldm_queue_would_block(rc)) {
+			return rc;
+		}
+	}
+
+	err = pldm_queue_push(queue, tid, pldm_msg, msg_len);
+	if (err) {
+		errno = -err;
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_queue_flush(struct pldm_transport_queue *ctx)
+{
+	struct pldm_queue_msg *entry;
+	pldm_requester_rc_t rc;
+	int sent = 0;
+	pldm_tid_t tid;
+
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	while (ctx->active_count && sent < INT_MAX) {
+		tid = ctx->active[ctx->active_head];
+		entry = ctx->tids[tid].head;
+
+		errno = 0;
+		rc = ctx->inner->send(ctx->inner, tid, entry->data,
+				      entry->len);
+		if (pldm_queue_would_block(rc)) {
+			break;
+		}
+
+		if (rc != PLDM_REQUESTER_SUCCESS) {
+			int err = errno ? -errno : -EIO;
+
+			pldm_queue_pop(ctx);
+			return err;
+		}
+
+		pldm_queue_pop(ctx);
+		sent++;
+	}
+
+	return sent;
+}
+
+LIBPLDM_ABI_TESTING
+size_t pldm_transport_queue_depth(const struct pldm_transport_queue *ctx,
+				  pldm_tid_t tid)
+{
+	return ctx ? ctx->tids[tid].depth : 0;
+}
+
+LIBPLDM_ABI_TESTING
+size_t pldm_transport_queue_pending(const struct pldm_transport_queue *ctx)
+{
+	return ctx ? ctx->pending : 0;
+}
+
+LIBPLDM_ABI_TESTING
+struct pldm_transport *
+pldm_transport_queue_core(struct pldm_transport_queue *ctx)
+{
+	return &ctx->transport;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_queue_init(struct pldm_transport_queue **ctx,
+			      struct pldm_transport *inner, size_t max_depth)
+{
+	struct pldm_transport_queue *queue;
+
+	if (!ctx || *ctx || !inner || !max_depth) {
+		return -EINVAL;
+	}
+
+	queue = calloc(1, sizeof(*queue));
+	if (!queue) {
+		return -ENOMEM;
+	}
+
+	queue->transport.name = QUEUE_NAME;
+	queue->transport.version = 1;
+	queue->transport.recv = pldm_transport_queue_recv;
+	queue->transport.send = pldm_transport_queue_send;
+	queue->transport.init_pollfd = pldm_transport_queue_init_pollfd;
+	if (inner->recv_batch) {
+		queue->transport.recv_batch = pldm_transport_queue_recv_batch;
+	}
+	queue->inner = inner;
+	queue->max_depth = max_depth;
+
+	*ctx = queue;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_queue_destroy(struct pldm_transport_queue *ctx)
+{
+	if (!ctx) {
+		return;
+	}
+
+	while (ctx->active_count) {
+		pldm_queue_pop(ctx);
+	}
+
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
+	free(ctx);
+}
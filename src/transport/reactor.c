@@ -0,0 +1,600 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "compiler.h"
+#include "container-of.h"
+#include "environ/errno.h"
+#include "environ/time.h"
+#include "requester/timer-wheel.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/reactor.h>
+#include <libpldm/transport.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Bound the work done for one transport before servicing the others */
+#define PLDM_REACTOR_DRAIN_BUDGET 64
+#define PLDM_REACTOR_POOL_BATCH	  16
+#define PLDM_REACTOR_MAX_EVENTS	  16
+
+struct pldm_reactor_source {
+	struct pldm_reactor_source *next;
+	/* Linked on pldm_reactor.ready while messages may remain */
+	struct pldm_reactor_source *ready_next;
+	struct pldm_transport *transport;
+	void (*handler)(void *data, struct pldm_transport *transport,
+			pldm_tid_t tid, const void *msg, size_t len);
+	void *data;
+	int fd;
+	bool ready;
+	bool removed;
+};
+
+struct pldm_reactor_timer {
+	struct pldm_timer timer;
+	/* Linked while the timer's handler is due to be invoked */
+	struct pldm_reactor_timer *fire_next;
+	/* Linked while release is deferred until dispatch completes */
+	struct pldm_reactor_timer *zombie_next;
+	uint32_t period_ms;
+	void (*handler)(void *data);
+	void *data;
+	bool removed;
+};
+
+struct pldm_reactor {
+	int epollfd;
+	int timerfd;
+	/* The tick for which timerfd is armed, or zero if disarmed */
+	uint64_t armed;
+	struct pldm_timer_wheel wheel;
+	struct pldm_reactor_source *sources;
+	struct pldm_reactor_source *ready;
+	struct pldm_reactor_timer *zombies;
+	/* Set while handlers may be invoked, deferring the release of state */
+	bool dispatching;
+};
+
+#define timer_to_reactor_timer(ptr)                                            \
+	container_of(ptr, struct pldm_reactor_timer, timer)
+
+static int pldm_reactor_now_ms(uint64_t *now)
+{
+	struct timespec ts;
+
+	if (libpldm_clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+		return -errno;
+	}
+
+	*now = (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+
+	return 0;
+}
+
+static int pldm_reactor_arm(struct pldm_reactor *ctx)
+{
+	struct itimerspec its = { 0 };
+	uint64_t tick;
+
+	if (!pldm_timer_wheel_next(&ctx->wheel, &tick)) {
+		tick = 0;
+	}
+
+	if (tick == ctx->armed) {
+		return 0;
+	}
+
+	if (tick) {
+		its.it_value.tv_sec = (time_t)(tick / 1000);
+		its.it_value.tv_nsec = (long)(tick % 1000) * 1000000;
+	}
+
+	if (timerfd_settime(ctx->timerfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+		return -errno;
+	}
+
+	ctx->armed = tick;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_reactor_init(struct pldm_reactor **ctx)
+{
+	struct epoll_event event = { 0 };
+	struct pldm_reactor *reactor;
+	uint64_t now;
+	int rc;
+
+	if (!ctx || *ctx) {
+		return -EINVAL;
+	}
+
+	rc = pldm_reactor_now_ms(&now);
+	if (rc) {
+		return rc;
+	}
+
+	reactor = calloc(1, sizeof(*reactor));
+	if (!reactor) {
+		return -ENOMEM;
+	}
+
+	pldm_timer_wheel_init(&reactor->wheel, now);
+
+	reactor->epollfd = epoll_create1(EPOLL_CLOEXEC);
+	if (reactor->epollfd < 0) {
+		rc = -errno;
+		goto cleanup_reactor;
+	}
+
+	reactor->timerfd =
+		timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (reactor->timerfd < 0) {
+		rc = -errno;
+		goto cleanup_epollfd;
+	}
+
+	/* Sources are identified by pointer, the timer by its absence */
+	event.events = EPOLLIN | EPOLLET;
+	event.data.ptr = NULL;
+	if (epoll_ctl(reactor->epollfd, EPOLL_CTL_ADD, reactor->timerfd,
+		      &event) < 0) {
+		rc = -errno;
+		goto cleanup_timerfd;
+	}
+
+	*ctx = reactor;
+
+	return 0;
+
+cleanup_timerfd:
+	close(reactor->timerfd);
+cleanup_epollfd:
+	close(reactor->epollfd);
+cleanup_reactor:
+	free(reactor);
+	return rc;
+}
+
+static void pldm_reactor_reap(struct pldm_reactor *ctx)
+{
+	struct pldm_reactor_source **link = &ctx->sources;
+	struct pldm_reactor_source *source;
+	struct pldm_reactor_timer *timer;
+
+	while ((source = *link)) {
+		if (source->removed) {
+			*link = source->next;
+			free(source);
+		} else {
+			link = &source->next;
+		}
+	}
+
+	while ((timer = ctx->zombies)) {
+		ctx->zombies = timer->zombie_next;
+		free(timer);
+	}
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_reactor_destroy(struct pldm_reactor *ctx)
+{
+	struct pldm_reactor_source *source;
+	struct pldm_timer *expired;
+
+	if (!ctx) {
+		return;
+	}
+
+	while ((source = ctx->sources)) {
+		ctx->sources = source->next;
+		free(source);
+	}
+
+	/* Flush all timers from the wheel, regardless of their expiry */
+	expired = pldm_timer_wheel_advance(&ctx->wheel, UINT64_MAX);
+	while (expired) {
+		struct pldm_reactor_timer *timer =
+			timer_to_reactor_timer(expired);
+
+		expired = expired->next;
+		free(timer);
+	}
+
+	pldm_reactor_reap(ctx);
+	close(ctx->timerfd);
+	close(ctx->epollfd);
+	free(ctx);
+}
+
+static struct pldm_reactor_source *
+pldm_reactor_find(struct pldm_reactor *ctx, struct pldm_transport *transport)
+{
+	struct pldm_reactor_source *source;
+
+	for (source = ctx->sources; source; source = source->next) {
+		if (source->transport == transport && !source->removed) {
+			return source;
+		}
+	}
+
+	return NULL;
+}
+
+static void pldm_reactor_mark_ready(struct pldm_reactor *ctx,
+				    struct pldm_reactor_source *source)
+{
+	if (source->ready) {
+		return;
+	}
+
+	source->ready = true;
+	source->ready_next = ctx->ready;
+	ctx->ready = source;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_reactor_add_transport(
+	struct pldm_reactor *ctx, struct pldm_transport *transport,
+	void (*handler)(void *data, struct pldm_transport *transport,
+			pldm_tid_t tid, const void *msg, size_t len),
+	void *data)
+{
+	struct pldm_reactor_source *source;
+	struct epoll_event event = { 0 };
+	struct pollfd pollfd;
+	int flags;
+	int rc;
+
+	if (!ctx || !transport || !handler) {
+		return -EINVAL;
+	}
+
+	if (!transport->init_pollfd) {
+		return -ENOTSUP;
+	}
+
+	if (pldm_reactor_find(ctx, transport)) {
+		return -EEXIST;
+	}
+
+	if (transport->init_pollfd(transport, &pollfd)) {
+		return -EIO;
+	}
+
+	flags = fcntl(pollfd.fd, F_GETFL);
+	if (flags < 0 || fcntl(pollfd.fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return -errno;
+	}
+
+	source = calloc(1, sizeof(*source));
+	if (!source) {
+		return -ENOMEM;
+	}
+
+	source->transport = transport;
+	source->handler = handler;
+	source->data = data;
+	source->fd = pollfd.fd;
+
+	event.events = EPOLLIN | EPOLLET;
+	event.data.ptr = source;
+	if (epoll_ctl(ctx->epollfd, EPOLL_CTL_ADD, source->fd, &event) < 0) {
+		rc = -errno;
+		goto cleanup_source;
+	}
+
+	source->next = ctx->sources;
+	ctx->sources = source;
+
+	/* Messages may have arrived before the edge we'll now wait for */
+	pldm_reactor_mark_ready(ctx, source);
+
+	return 0;
+
+cleanup_source:
+	free(source);
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_reactor_remove_transport(struct pldm_reactor *ctx,
+				  struct pldm_transport *transport)
+{
+	struct pldm_reactor_source **link;
+	struct pldm_reactor_source *source;
+
+	if (!ctx || !transport) {
+		return -EINVAL;
+	}
+
+	source = pldm_reactor_find(ctx, transport);
+	if (!source) {
+		return -ENOENT;
+	}
+
+	epoll_ctl(ctx->epollfd, EPOLL_CTL_DEL, source->fd, NULL);
+	source->removed = true;
+
+	for (link = &ctx->ready; *link; link = &(*link)->ready_next) {
+		if (*link == source) {
+			*link = source->ready_next;
+			break;
+		}
+	}
+	source->ready = false;
+
+	if (!ctx->dispatching) {
+		pldm_reactor_reap(ctx);
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_reactor_add_timer(struct pldm_reactor *ctx, uint32_t period_ms,
+			   void (*handler)(void *data), void *data,
+			   struct pldm_reactor_timer **timer)
+{
+	struct pldm_reactor_timer *rt;
+	uint64_t now;
+	int rc;
+
+	if (!ctx || !period_ms || !handler || !timer) {
+		return -EINVAL;
+	}
+
+	rc = pldm_reactor_now_ms(&now);
+	if (rc) {
+		return rc;
+	}
+
+	rt = calloc(1, sizeof(*rt));
+	if (!rt) {
+		return -ENOMEM;
+	}
+
+	rt->period_ms = period_ms;
+	rt->handler = handler;
+	rt->data = data;
+	pldm_timer_wheel_add(&ctx->wheel, &rt->timer, now + period_ms);
+
+	rc = pldm_reactor_arm(ctx);
+	if (rc) {
+		pldm_timer_wheel_del(&ctx->wheel, &rt->timer);
+		free(rt);
+		return rc;
+	}
+
+	*timer = rt;
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_reactor_remove_timer(struct pldm_reactor *ctx,
+			       struct pldm_reactor_timer *timer)
+{
+	if (!ctx || !timer || timer->removed) {
+		return;
+	}
+
+	pldm_timer_wheel_del(&ctx->wheel, &timer->timer);
+	timer->removed = true;
+
+	/* The timer may be queued for dispatch */
+	if (ctx->dispatching) {
+		timer->zombie_next = ctx->zombies;
+		ctx->zombies = timer;
+	} else {
+		free(timer);
+	}
+
+	/* A stale deadline only results in a spurious wake-up */
+	(void)pldm_reactor_arm(ctx);
+}
+
+static int pldm_reactor_expire(struct pldm_reactor *ctx)
+{
+	struct pldm_reactor_timer *fire = NULL;
+	struct pldm_reactor_timer **tail = &fire;
+	struct pldm_timer *expired;
+	uint64_t expirations;
+	int dispatched = 0;
+	uint64_t now;
+	int rc;
+
+	if (read(ctx->timerfd, &expirations, sizeof(expirations)) < 0 &&
+	    errno != EAGAIN) {
+		return -errno;
+	}
+
+	ctx->armed = 0;
+
+	rc = pldm_reactor_now_ms(&now);
+	if (rc) {
+		return rc;
+	}
+
+	/* Reschedule before dispatch so handlers may freely remove timers */
+	expired = pldm_timer_wheel_advance(&ctx->wheel, now);
+	while (expired) {
+		struct pldm_reactor_timer *timer =
+			timer_to_reactor_timer(expired);
+
+		expired = expired->next;
+		pldm_timer_wheel_add(&ctx->wheel, &timer->timer,
+				     now + timer->period_ms);
+		timer->fire_next = NULL;
+		*tail = timer;
+		tail = &timer->fire_next;
+	}
+
+	for (; fire; fire = fire->fire_next) {
+		if (!fire->removed) {
+			fire->handler(fire->data);
+			dispatched++;
+		}
+	}
+
+	rc = pldm_reactor_arm(ctx);
+	if (rc) {
+		return rc;
+	}
+
+	return dispatched;
+}
+
+static void pldm_reactor_deliver(struct pldm_reactor_source *source,
+				 pldm_tid_t tid, const void *msg, size_t len)
+{
+	source->handler(source->data, source->transport, tid, msg, len);
+}
+
+/*
+ * Returns the number of messages delivered. *more is set if the budget was
+ * exhausted while messages may remain.
+ */
+static int pldm_reactor_drain(struct pldm_reactor_source *source, bool *more)
+{
+	struct pldm_transport *transport = source->transport;
+	int delivered = 0;
+	int budget;
+
+	*more = false;
+
+	for (budget = PLDM_REACTOR_DRAIN_BUDGET; budget > 0 && !source->removed;
+	     budget--) {
+		pldm_requester_rc_t rc;
+		size_t msg_len;
+		pldm_tid_t tid;
+		void *msg;
+
+		if (transport->pool.avail) {
+			struct pldm_transport_msg msgs[PLDM_REACTOR_POOL_BATCH];
+			int received;
+
+			received = pldm_transport_recv_pooled(
+				transport, msgs, PLDM_REACTOR_POOL_BATCH);
+			if (received < 0) {
+				/* Drained, or the transport has failed */
+				return delivered;
+			}
+
+			for (int i = 0; i < received; i++) {
+				if (!source->removed) {
+					pldm_reactor_deliver(source,
+							     msgs[i].tid,
+							     msgs[i].msg,
+							     msgs[i].len);
+					delivered++;
+				}
+				pldm_transport_pool_release(transport,
+							    msgs[i].msg);
+			}
+
+			continue;
+		}
+
+		errno = 0;
+		rc = pldm_transport_recv_msg(transport, &tid, &msg, &msg_len);
+		if (rc != PLDM_REQUESTER_SUCCESS) {
+			/* Drained, or the transport has failed */
+			if (errno) {
+				return delivered;
+			}
+
+			/*
+			 * The message was consumed but discarded, which is
+			 * progress, so keep going
+			 */
+			continue;
+		}
+
+		pldm_reactor_deliver(source, tid, msg, msg_len);
+		free(msg);
+		delivered++;
+	}
+
+	/* Sources are edge-triggered, so requeue unless drained */
+	*more = !source->removed;
+
+	return delivered;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_reactor_run_once(struct pldm_reactor *ctx, int timeout)
+{
+	struct epoll_event events[PLDM_REACTOR_MAX_EVENTS];
+	struct pldm_reactor_source *ready;
+	bool expire = false;
+	int dispatched = 0;
+	int rc;
+
+	if (!ctx) {
+		return -EINVAL;
+	}
+
+	rc = epoll_wait(ctx->epollfd, events, PLDM_REACTOR_MAX_EVENTS,
+			ctx->ready ? 0 : timeout);
+	if (rc < 0) {
+		return errno == EINTR ? 0 : -errno;
+	}
+
+	for (int i = 0; i < rc; i++) {
+		if (events[i].data.ptr) {
+			pldm_reactor_mark_ready(ctx, events[i].data.ptr);
+		} else {
+			expire = true;
+		}
+	}
+
+	ctx->dispatching = true;
+
+	if (expire) {
+		rc = pldm_reactor_expire(ctx);
+		if (rc < 0) {
+			goto out;
+		}
+		dispatched += rc;
+	}
+
+	/* Sources left with messages pending are queued for the next call */
+	ready = ctx->ready;
+	ctx->ready = NULL;
+	while (ready) {
+		struct pldm_reactor_source *source = ready;
+		bool more;
+
+		ready = source->ready_next;
+		source->ready = false;
+		if (source->removed) {
+			continue;
+		}
+
+		dispatched += pldm_reactor_drain(source, &more);
+		if (more) {
+			pldm_reactor_mark_ready(ctx, source);
+		}
+	}
+
+	rc = dispatched;
+
+out:
+	ctx->dispatching = false;
+	pldm_reactor_reap(ctx);
+
+	return rc;
+}
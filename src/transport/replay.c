@@ -0,0 +1,275 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "capture-internal.h"
+#include "environ/errno.h"
+#include "replay.h"
+#include "test.h"
+
+#include <libpldm/api.h>
+#include <libpldm/transport/capture.h>
+
+#include <endian.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct pldm_transport_replay {
+	struct pldm_transport_test *test;
+	struct pldm_transport_test_descriptor *seq;
+};
+
+/* Read from @fd until end of file into a buffer to be released with free() */
+static int pldm_replay_read_all(int fd, unsigned char **data, size_t *len)
+{
+	unsigned char *buf = NULL;
+	size_t size = 0;
+	size_t used = 0;
+	ssize_t got;
+	void *grown;
+
+	for (;;) {
+		if (used == size) {
+			size = size ? 2 * size : 65536;
+			grown = realloc(buf, size);
+			if (!grown) {
+				free(buf);
+				return -ENOMEM;
+			}
+			buf = grown;
+		}
+
+		got = read(fd, buf + used, size - used);
+		if (got < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			free(buf);
+			return -errno;
+		}
+
+		if (!got) {
+			break;
+		}
+
+		used += got;
+	}
+
+	*data = buf;
+	*len = used;
+
+	return 0;
+}
+
+static void pldm_replay_record(const unsigned char *data,
+			       struct pldm_capture_record *record)
+{
+	memcpy(record, data, sizeof(*record));
+	record->timestamp = le64toh(record->timestamp);
+	record->len = le32toh(record->len);
+}
+
+static void pldm_replay_latency(struct pldm_transport_test_descriptor *desc,
+				uint64_t gap)
+{
+	desc->type = PLDM_TRANSPORT_TEST_ELEMENT_LATENCY;
+	memset(&desc->latency, 0, sizeof(desc->latency));
+	desc->latency.it_value.tv_sec = gap / 1000000000ULL;
+	desc->latency.it_value.tv_nsec = gap % 1000000000ULL;
+}
+
+static void pldm_replay_msg(struct pldm_transport_test_descriptor *desc,
+			    const struct pldm_capture_record *record,
+			    const void *msg)
+{
+	if (record->direction == PLDM_TRANSPORT_CAPTURE_TX) {
+		desc->type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND;
+		desc->send_msg.dst = record->tid;
+		desc->send_msg.msg = msg;
+		desc->send_msg.len = record->len;
+	} else {
+		desc->type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV;
+		desc->recv_msg.src = record->tid;
+		desc->recv_msg.msg = msg;
+		desc->recv_msg.len = record->len;
+	}
+}
+
+/*
+ * Walk the records in @data, filling @seq and copying messages to @payload if
+ * they are provided. Returns the number of elements, or -EPROTO.
+ */
+static ssize_t pldm_replay_parse(const unsigned char *data, size_t len,
+				 uint32_t flags,
+				 struct pldm_transport_test_descriptor *seq,
+				 unsigned char *payload, size_t *payload_len)
+{
+	const bool realtime = flags & PLDM_TRANSPORT_REPLAY_REALTIME;
+	struct pldm_capture_record record;
+	uint64_t prev = 0;
+	size_t total = 0;
+	size_t off = 0;
+	ssize_t n = 0;
+
+	while (off < len) {
+		if (len - off < sizeof(record)) {
+			return -EPROTO;
+		}
+
+		pldm_replay_record(data + off, &record);
+		off += sizeof(record);
+
+		if (record.len > len - off ||
+		    (record.direction != PLDM_TRANSPORT_CAPTURE_TX &&
+		     record.direction != PLDM_TRANSPORT_CAPTURE_RX)) {
+			return -EPROTO;
+		}
+
+		/* The test transport only waits out latency before a receive */
+		if (realtime && record.direction == PLDM_TRANSPORT_CAPTURE_RX &&
+		    n && record.timestamp > prev) {
+			if (seq) {
+				pldm_replay_latency(&seq[n],
+						    record.timestamp - prev);
+			}
+			n++;
+		}
+
+		if (seq) {
+			memcpy(payload + total, data + off, record.len);
+			pldm_replay_msg(&seq[n], &record, payload + total);
+		}
+
+		prev = record.timestamp;
+		total += record.len;
+		off += record.len;
+		n++;
+	}
+
+	*payload_len = total;
+
+	return n;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_replay_load(int fd, uint32_t flags,
+			       struct pldm_transport_test_descriptor **seq,
+			       size_t *count)
+{
+	struct pldm_transport_test_descriptor *elems;
+	struct pldm_capture_header header;
+	unsigned char *data;
+	size_t payload_len;
+	ssize_t n;
+	size_t len;
+	int rc;
+
+	if (fd < 0 || !seq || !count) {
+		return -EINVAL;
+	}
+
+	if (flags & ~PLDM_TRANSPORT_REPLAY_REALTIME) {
+		return -EINVAL;
+	}
+
+	rc = pldm_replay_read_all(fd, &data, &len);
+	if (rc) {
+		return rc;
+	}
+
+	if (len < sizeof(header)) {
+		rc = -EPROTO;
+		goto cleanup_data;
+	}
+
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, PLDM_TRANSPORT_CAPTURE_MAGIC,
+		   sizeof(header.magic)) ||
+	    le32toh(header.version) != PLDM_TRANSPORT_CAPTURE_VERSION) {
+		rc = -EPROTO;
+		goto cleanup_data;
+	}
+
+	/* Size the sequence, then fill it along with a copy of the messages */
+	n = pldm_replay_parse(data + sizeof(header), len - sizeof(header),
+			      flags, NULL, NULL, &payload_len);
+	if (n < 0) {
+		rc = (int)n;
+		goto cleanup_data;
+	}
+
+	elems = malloc(n * sizeof(*elems) + payload_len + 1);
+	if (!elems) {
+		rc = -ENOMEM;
+		goto cleanup_data;
+	}
+
+	pldm_replay_parse(data + sizeof(header), len - sizeof(header), flags,
+			  elems, (unsigned char *)(elems + n), &payload_len);
+
+	*seq = elems;
+	*count = n;
+	rc = 0;
+
+cleanup_data:
+	free(data);
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_replay_init(struct pldm_transport_replay **ctx, int fd,
+			       uint32_t flags)
+{
+	struct pldm_transport_replay *replay;
+	size_t count;
+	int rc;
+
+	if (!ctx || *ctx) {
+		return -EINVAL;
+	}
+
+	replay = calloc(1, sizeof(*replay));
+	if (!replay) {
+		return -ENOMEM;
+	}
+
+	rc = pldm_transport_replay_load(fd, flags, &replay->seq, &count);
+	if (rc) {
+		goto cleanup_replay;
+	}
+
+	rc = pldm_transport_test_init(&replay->test, replay->seq, count);
+	if (rc) {
+		goto cleanup_seq;
+	}
+
+	*ctx = replay;
+
+	return 0;
+
+cleanup_seq:
+	free(replay->seq);
+cleanup_replay:
+	free(replay);
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+struct pldm_transport *
+pldm_transport_replay_core(struct pldm_transport_replay *ctx)
+{
+	return pldm_transport_test_core(ctx->test);
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_replay_destroy(struct pldm_transport_replay *ctx)
+{
+	if (!ctx) {
+		return;
+	}
+
+	pldm_transport_test_destroy(ctx->test);
+	free(ctx->seq);
+	free(ctx);
+}
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#pragma once
+
+#include "test.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pace received messages with the gaps recorded in the capture */
+#define PLDM_TRANSPORT_REPLAY_REALTIME 0x1
+
+/**
+ * @brief Convert a capture into a test transport sequence
+ *
+ * Sent messages become PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND elements and
+ * received messages PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV elements. With
+ * PLDM_TRANSPORT_REPLAY_REALTIME, each received message is preceded by a
+ * PLDM_TRANSPORT_TEST_ELEMENT_LATENCY element covering the time since the
+ * previous record.
+ *
+ * @param[in] fd - the capture, read from its current offset to the end
+ * @param[in] flags - PLDM_TRANSPORT_REPLAY_* flags
+ * @param[out] seq - the sequence, to be released with free()
+ * @param[out] count - the number of elements in @p seq
+ *
+ * @return 0 on success, -EINVAL if the arguments are invalid, -EPROTO if the
+ *	   capture is malformed, or another negative errno value on failure
+ */
+int pldm_transport_replay_load(int fd, uint32_t flags,
+			       struct pldm_transport_test_descriptor **seq,
+			       size_t *count);
+
+struct pldm_transport_replay;
+
+/* Create a test transport replaying the capture read from @fd */
+int pldm_transport_replay_init(struct pldm_transport_replay **ctx, int fd,
+			       uint32_t flags);
+void pldm_transport_replay_destroy(struct pldm_transport_replay *ctx);
+struct pldm_transport *
+pldm_transport_replay_core(struct pldm_transport_replay *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,679 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "container-of.h"
+#include "environ/errno.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/shm.h>
+
+#include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define SHM_NAME "SHM"
+
+#define PLDM_SHM_MAGIC 0x4d48534cU
+#define PLDM_SHM_VERSION 1
+
+#define PLDM_SHM_RING_MIN 256UL
+#define PLDM_SHM_RING_MAX (1UL << 28)
+
+/* Flags in the header word of a record */
+#define PLDM_SHM_REC_COMMITTED 0x1U
+#define PLDM_SHM_REC_PAD 0x2U
+
+/*
+ * The region holds a struct pldm_shm_header, followed for each endpoint by a
+ * struct pldm_shm_ring and then ring_size bytes of records.
+ *
+ * A record is a 64-bit header word holding the payload length, the sender's
+ * TID and flags, followed by the payload padded to a multiple of eight bytes.
+ * Producers reserve space by advancing the tail with a compare-and-swap,
+ * write the payload in place and then publish the header word. A record that
+ * would straddle the end of the ring is preceded by a pad record filling the
+ * remainder. The consumer takes records in reservation order and zeroes each
+ * before advancing the head, so space not yet written by a producer never
+ * reads as a published header.
+ *
+ * The owner is woken through its eventfd with the pldm_transport_wakeup_*()
+ * helpers, treating its ring as empty once it finds no published record at
+ * the head.
+ */
+struct pldm_shm_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;
+	uint64_t ring_size;
+	unsigned char reserved[48];
+};
+
+struct pldm_shm_ring {
+	/* Advanced only by the owner */
+	uint64_t head;
+	unsigned char pad_head[56];
+	/* Advanced by any producer */
+	uint64_t tail;
+	unsigned char pad_tail[56];
+	uint32_t signalled;
+	uint8_t tid;
+	unsigned char reserved[59];
+};
+
+static_assert(sizeof(struct pldm_shm_header) == 64, "Unexpected header size");
+static_assert(sizeof(struct pldm_shm_ring) == 192, "Unexpected ring size");
+
+struct pldm_transport_shm {
+	struct pldm_transport transport;
+	unsigned char *base;
+	size_t size;
+	size_t ring_size;
+	size_t count;
+	size_t self;
+	pldm_tid_t tid;
+	/* The ring index plus one for each TID, or zero if it has no ring */
+	uint8_t tid_ring[PLDM_MAX_TIDS];
+	int efds[PLDM_TRANSPORT_SHM_ENDPOINTS_MAX];
+};
+
+#define transport_to_shm(ptr)                                                  \
+	container_of(ptr, struct pldm_transport_shm, transport)
+
+/* Returns the size of a region, or zero if it is not addressable */
+static size_t pldm_shm_region_size(size_t count, size_t ring_size)
+{
+	const size_t stride = sizeof(struct pldm_shm_ring) + ring_size;
+
+	if (count > (SIZE_MAX - sizeof(struct pldm_shm_header)) / stride) {
+		return 0;
+	}
+
+	return sizeof(struct pldm_shm_header) + count * stride;
+}
+
+static struct pldm_shm_ring *pldm_shm_ring(unsigned char *base,
+					   size_t ring_size, size_t i)
+{
+	const size_t stride = sizeof(struct pldm_shm_ring) + ring_size;
+
+	return (struct pldm_shm_ring *)(base + sizeof(struct pldm_shm_header) +
+					i * stride);
+}
+
+static unsigned char *pldm_shm_ring_data(struct pldm_shm_ring *ring)
+{
+	return (unsigned char *)(ring + 1);
+}
+
+static uint64_t *pldm_shm_ring_word(struct pldm_transport_shm *shm,
+				    struct pldm_shm_ring *ring, uint64_t pos)
+{
+	unsigned char *data = pldm_shm_ring_data(ring);
+
+	return (uint64_t *)(data + (pos & (shm->ring_size - 1)));
+}
+
+static uint64_t pldm_shm_rec_word(size_t len, pldm_tid_t tid, unsigned flags)
+{
+	return (uint64_t)len | (uint64_t)tid << 32 | (uint64_t)flags << 40;
+}
+
+static size_t pldm_shm_rec_len(uint64_t word)
+{
+	return (uint32_t)word;
+}
+
+static pldm_tid_t pldm_shm_rec_tid(uint64_t word)
+{
+	return (word >> 32) & 0xff;
+}
+
+static unsigned pldm_shm_rec_flags(uint64_t word)
+{
+	return (word >> 40) & 0xff;
+}
+
+/* Returns the space a record with a @len byte payload occupies in a ring */
+static size_t pldm_shm_rec_size(size_t len)
+{
+	return (sizeof(uint64_t) + len + sizeof(uint64_t) - 1) &
+	       ~(sizeof(uint64_t) - 1);
+}
+
+/*
+ * Write a message in place into the ring owned by @dst. Returns 0 on success,
+ * -EAGAIN if the ring is full, or another negative errno value.
+ */
+static int pldm_transport_shm_write(struct pldm_transport_shm *shm,
+				    pldm_tid_t dst, const struct iovec *iov,
+				    size_t iovlen, size_t len)
+{
+	struct pldm_shm_ring *ring;
+	uint64_t head, tail;
+	unsigned char *rec;
+	size_t need, pad;
+	size_t off;
+	size_t i;
+
+	i = shm->tid_ring[dst];
+	if (!i--) {
+		return -ENOENT;
+	}
+
+	need = pldm_shm_rec_size(len);
+	if (len > UINT32_MAX || need > shm->ring_size / 2) {
+		return -EMSGSIZE;
+	}
+
+	ring = pldm_shm_ring(shm->base, shm->ring_size, i);
+	do {
+		/* Load the head first so it can't be ahead of the tail */
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		off = tail & (shm->ring_size - 1);
+		pad = off + need > shm->ring_size ? shm->ring_size - off : 0;
+		if (tail + pad + need - head > shm->ring_size) {
+			return -EAGAIN;
+		}
+	} while (!__atomic_compare_exchange_n(&ring->tail, &tail,
+					      tail + pad + need, false,
+					      __ATOMIC_ACQ_REL,
+					      __ATOMIC_RELAXED));
+
+	if (pad) {
+		__atomic_store_n(pldm_shm_ring_word(shm, ring, tail),
+				 pldm_shm_rec_word(pad - sizeof(uint64_t), 0,
+						   PLDM_SHM_REC_COMMITTED |
+							   PLDM_SHM_REC_PAD),
+				 __ATOMIC_RELEASE);
+	}
+
+	rec = (unsigned char *)pldm_shm_ring_word(shm, ring, tail + pad);
+	off = sizeof(uint64_t);
+	for (size_t j = 0; j < iovlen; j++) {
+		memcpy(rec + off, iov[j].iov_base, iov[j].iov_len);
+		off += iov[j].iov_len;
+	}
+
+	__atomic_store_n((uint64_t *)rec,
+			 pldm_shm_rec_word(len, shm->tid,
+					   PLDM_SHM_REC_COMMITTED),
+			 __ATOMIC_RELEASE);
+
+	pldm_transport_wakeup_publish(&ring->signalled, shm->efds[i]);
+
+	return 0;
+}
+
+/*
+ * Called by the owner once it finds no published record at the head. Returns
+ * the header word at the head, looked at again after clearing the eventfd.
+ */
+static uint64_t pldm_transport_shm_settle(struct pldm_transport_shm *shm,
+					  struct pldm_shm_ring *ring,
+					  uint64_t *hdr)
+{
+	int efd = shm->efds[shm->self];
+	uint64_t word;
+
+	pldm_transport_wakeup_clear(&ring->signalled, efd);
+
+	word = __atomic_load_n(hdr, __ATOMIC_ACQUIRE);
+	if (pldm_shm_rec_flags(word) & PLDM_SHM_REC_COMMITTED) {
+		/* Keep the eventfd readable for what remains */
+		pldm_transport_wakeup_signal(&ring->signalled, efd);
+	}
+
+	return word;
+}
+
+/*
+ * Find the next published message at or after @pos in the owner's ring,
+ * releasing any pad records on the way. Returns 0 and the message's header
+ * word, -EAGAIN if there is none, or -EPROTO if the ring is corrupt.
+ */
+static int pldm_transport_shm_next(struct pldm_transport_shm *shm,
+				   struct pldm_shm_ring *ring, uint64_t *pos,
+				   uint64_t *word)
+{
+	size_t off;
+	size_t len;
+	uint64_t *hdr;
+
+	for (;;) {
+		hdr = pldm_shm_ring_word(shm, ring, *pos);
+		*word = __atomic_load_n(hdr, __ATOMIC_ACQUIRE);
+		if (!(pldm_shm_rec_flags(*word) & PLDM_SHM_REC_COMMITTED)) {
+			*word = pldm_transport_shm_settle(shm, ring, hdr);
+			if (!(pldm_shm_rec_flags(*word) &
+			      PLDM_SHM_REC_COMMITTED)) {
+				return -EAGAIN;
+			}
+		}
+
+		off = *pos & (shm->ring_size - 1);
+		len = pldm_shm_rec_len(*word);
+		if (len > shm->ring_size - off - sizeof(uint64_t)) {
+			return -EPROTO;
+		}
+
+		if (!(pldm_shm_rec_flags(*word) & PLDM_SHM_REC_PAD)) {
+			return 0;
+		}
+
+		memset(hdr, 0, pldm_shm_rec_size(len));
+		*pos += pldm_shm_rec_size(len);
+	}
+}
+
+/* Zero the record at @pos so the space reads as unpublished when reused */
+static void pldm_transport_shm_release(struct pldm_transport_shm *shm,
+				       struct pldm_shm_ring *ring,
+				       uint64_t *pos, uint64_t word)
+{
+	size_t size = pldm_shm_rec_size(pldm_shm_rec_len(word));
+
+	memset(pldm_shm_ring_word(shm, ring, *pos), 0, size);
+	*pos += size;
+}
+
+LIBPLDM_ABI_TESTING
+struct pldm_transport *pldm_transport_shm_core(struct pldm_transport_shm *ctx)
+{
+	return &ctx->transport;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_shm_init_pollfd(struct pldm_transport *t,
+				   struct pollfd *pollfd)
+{
+	struct pldm_transport_shm *shm = transport_to_shm(t);
+
+	pollfd->fd = shm->efds[shm->self];
+	pollfd->events = POLLIN;
+
+	return 0;
+}
+
+static pldm_requester_rc_t pldm_transport_shm_recv(struct pldm_transport *t,
+						   pldm_tid_t *tid,
+						   void **pldm_msg,
+						   size_t *msg_len)
+{
+	struct pldm_transport_shm *shm = transport_to_shm(t);
+	struct pldm_shm_ring *ring;
+	pldm_requester_rc_t res;
+	uint64_t word;
+	uint64_t pos;
+	size_t len;
+	void *msg;
+	int rc;
+
+	ring = pldm_shm_ring(shm->base, shm->ring_size, shm->self);
+	pos = ring->head;
+
+	rc = pldm_transport_shm_next(shm, ring, &pos, &word);
+	if (rc) {
+		res = PLDM_REQUESTER_RECV_FAIL;
+		errno = -rc;
+		goto publish_head;
+	}
+
+	len = pldm_shm_rec_len(word);
+	if (len < sizeof(struct pldm_msg_hdr)) {
+		res = PLDM_REQUESTER_INVALID_RECV_LEN;
+		goto release_record;
+	}
+
+	msg = malloc(len);
+	if (!msg) {
+		res = PLDM_REQUESTER_RECV_FAIL;
+		goto publish_head;
+	}
+
+	memcpy(msg, pldm_shm_ring_word(shm, ring, pos) + 1, len);
+	*tid = pldm_shm_rec_tid(word);
+	*pldm_msg = msg;
+	*msg_len = len;
+	res = PLDM_REQUESTER_SUCCESS;
+
+release_record:
+	pldm_transport_shm_release(shm, ring, &pos, word);
+publish_head:
+	__atomic_store_n(&ring->head, pos, __ATOMIC_RELEASE);
+
+	return res;
+}
+
+static int pldm_transport_shm_recv_batch(struct pldm_transport *t,
+					 struct pldm_transport_msg *msgs,
+					 size_t count)
+{
+	struct pldm_transport_shm *shm = transport_to_shm(t);
+	struct pldm_shm_ring *ring;
+	uint64_t word;
+	uint64_t pos;
+	size_t n = 0;
+	size_t len;
+	int rc = 0;
+
+	if (count > PLDM_TRANSPORT_RECV_BATCH_MAX) {
+		count = PLDM_TRANSPORT_RECV_BATCH_MAX;
+	}
+
+	ring = pldm_shm_ring(shm->base, shm->ring_size, shm->self);
+	pos = ring->head;
+
+	while (n < count) {
+		rc = pldm_transport_shm_next(shm, ring, &pos, &word);
+		if (rc) {
+			break;
+		}
+
+		len = pldm_shm_rec_len(word);
+		if (len < sizeof(struct pldm_msg_hdr) || len > msgs[n].len) {
+			pldm_transport_stats_count(
+				t, PLDM_TRANSPORT_STATS_NO_TID,
+				PLDM_TRANSPORT_STAT(rx_invalid_len), 1);
+		} else {
+			memcpy(msgs[n].msg,
+			       pldm_shm_ring_word(shm, ring, pos) + 1, len);
+			msgs[n].tid = pldm_shm_rec_tid(word);
+			msgs[n].len = len;
+			n++;
+		}
+
+		pldm_transport_shm_release(shm, ring, &pos, word);
+	}
+
+	__atomic_store_n(&ring->head, pos, __ATOMIC_RELEASE);
+
+	if (!n && rc) {
+		return rc;
+	}
+
+	return (int)n;
+}
+
+static pldm_requester_rc_t pldm_transport_shm_send(struct pldm_transport *t,
+						   pldm_tid_t tid,
+						   const void *pldm_msg,
+						   size_t msg_len)
+{
+	struct pldm_transport_shm *shm = transport_to_shm(t);
+	struct iovec iov = {
+		.iov_base = (void *)pldm_msg,
+		.iov_len = msg_len,
+	};
+	int rc;
+
+	rc = pldm_transport_shm_write(shm, tid, &iov, 1, msg_len);
+	if (rc) {
+		errno = -rc;
+		return PLDM_REQUESTER_SEND_FAIL;
+	}
+
+	return PLDM_REQUESTER_SUCCESS;
+}
+
+static int pldm_transport_shm_send_batch(struct pldm_transport *t,
+					 const struct pldm_transport_msgv *msgs,
+					 size_t count)
+{
+	struct pldm_transport_shm *shm = transport_to_shm(t);
+	size_t sent;
+	int rc = 0;
+
+	/* Each message is gathered straight into the destination ring */
+	for (sent = 0; sent < count; sent++) {
+		const struct pldm_transport_msgv *msg = &msgs[sent];
+
+		rc = pldm_transport_shm_write(shm, msg->tid, msg->iov,
+					      msg->iovlen,
+					      pldm_transport_msgv_len(msg));
+		if (rc) {
+			break;
+		}
+	}
+
+	return sent ? (int)sent : rc;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_shm_region_create(const pldm_tid_t *tids, size_t count,
+				     size_t ring_size)
+{
+	bool seen[PLDM_MAX_TIDS] = { 0 };
+	struct pldm_shm_header *header;
+	unsigned char *base;
+	size_t size;
+	int rc;
+	int fd;
+
+	if (!tids || !count || count > PLDM_TRANSPORT_SHM_ENDPOINTS_MAX) {
+		return -EINVAL;
+	}
+
+	if (ring_size < PLDM_SHM_RING_MIN || ring_size > PLDM_SHM_RING_MAX ||
+	    (ring_size & (ring_size - 1))) {
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (!tids[i] || seen[tids[i]]) {
+			return -EINVAL;
+		}
+		seen[tids[i]] = true;
+	}
+
+	size = pldm_shm_region_size(count, ring_size);
+	if (!size || size > (size_t)INT64_MAX) {
+		return -EINVAL;
+	}
+
+	fd = memfd_create("libpldm-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	if (ftruncate(fd, (off_t)size) < 0) {
+		rc = -errno;
+		goto cleanup_fd;
+	}
+
+	base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED) {
+		rc = -errno;
+		goto cleanup_fd;
+	}
+
+	/* The region is zero-filled, so only identities need to be written */
+	header = (struct pldm_shm_header *)base;
+	header->magic = PLDM_SHM_MAGIC;
+	header->version = PLDM_SHM_VERSION;
+	header->count = count;
+	header->ring_size = ring_size;
+	for (size_t i = 0; i < count; i++) {
+		pldm_shm_ring(base, ring_size, i)->tid = tids[i];
+	}
+
+	munmap(base, size);
+
+	if (fcntl(fd, F_ADD_SEALS,
+		  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+		rc = -errno;
+		goto cleanup_fd;
+	}
+
+	return fd;
+
+cleanup_fd:
+	close(fd);
+
+	return rc;
+}
+
+/* Map the region and check it is well-formed and matches @count */
+static int pldm_transport_shm_map(struct pldm_transport_shm *shm, int memfd,
+				  size_t count)
+{
+	struct pldm_shm_header header;
+	struct stat st;
+	ssize_t got;
+	int seals;
+
+	seals = fcntl(memfd, F_GET_SEALS);
+	if (seals < 0) {
+		return -errno;
+	}
+
+	/* A peer must not be able to fault us by truncating the region */
+	if (!(seals & F_SEAL_SHRINK)) {
+		return -EPROTO;
+	}
+
+	if (fstat(memfd, &st) < 0) {
+		return -errno;
+	}
+
+	got = pread(memfd, &header, sizeof(header), 0);
+	if (got < 0) {
+		return -errno;
+	}
+
+	if ((size_t)got != sizeof(header) || header.magic != PLDM_SHM_MAGIC ||
+	    header.version != PLDM_SHM_VERSION) {
+		return -EPROTO;
+	}
+
+	if (header.ring_size < PLDM_SHM_RING_MIN ||
+	    header.ring_size > PLDM_SHM_RING_MAX ||
+	    (header.ring_size & (header.ring_size - 1))) {
+		return -EPROTO;
+	}
+
+	if (header.count != count) {
+		return -EINVAL;
+	}
+
+	shm->ring_size = header.ring_size;
+	shm->count = count;
+	shm->size = pldm_shm_region_size(count, shm->ring_size);
+	if (!shm->size || (uint64_t)st.st_size < shm->size) {
+		return -EPROTO;
+	}
+
+	shm->base = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 memfd, 0);
+	if (shm->base == MAP_FAILED) {
+		shm->base = NULL;
+		return -errno;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct pldm_shm_ring *ring;
+		pldm_tid_t tid;
+
+		ring = pldm_shm_ring(shm->base, shm->ring_size, i);
+		tid = ring->tid;
+		if (!tid || shm->tid_ring[tid]) {
+			munmap(shm->base, shm->size);
+			shm->base = NULL;
+			return -EPROTO;
+		}
+		shm->tid_ring[tid] = i + 1;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_shm_init(struct pldm_transport_shm **ctx, int memfd,
+			    pldm_tid_t tid, const int *efds, size_t count)
+{
+	struct pldm_transport_shm *shm;
+	size_t dups;
+	int rc;
+
+	if (!ctx || *ctx || !efds || !count ||
+	    count > PLDM_TRANSPORT_SHM_ENDPOINTS_MAX) {
+		return -EINVAL;
+	}
+
+	shm = calloc(1, sizeof(*shm));
+	if (!shm) {
+		return -ENOMEM;
+	}
+
+	rc = pldm_transport_shm_map(shm, memfd, count);
+	if (rc) {
+		goto cleanup_shm;
+	}
+
+	if (!shm->tid_ring[tid]) {
+		rc = -EINVAL;
+		goto cleanup_map;
+	}
+
+	shm->tid = tid;
+	shm->self = shm->tid_ring[tid] - 1;
+
+	for (dups = 0; dups < count; dups++) {
+		shm->efds[dups] = fcntl(efds[dups], F_DUPFD_CLOEXEC, 0);
+		if (shm->efds[dups] < 0) {
+			rc = -errno;
+			goto cleanup_efds;
+		}
+	}
+
+	shm->transport.name = SHM_NAME;
+	shm->transport.version = 1;
+	shm->transport.recv = pldm_transport_shm_recv;
+	shm->transport.send = pldm_transport_shm_send;
+	shm->transport.init_pollfd = pldm_transport_shm_init_pollfd;
+	shm->transport.recv_batch = pldm_transport_shm_recv_batch;
+	shm->transport.send_batch = pldm_transport_shm_send_batch;
+
+	*ctx = shm;
+
+	return 0;
+
+cleanup_efds:
+	while (dups--) {
+		close(shm->efds[dups]);
+	}
+cleanup_map:
+	munmap(shm->base, shm->size);
+cleanup_shm:
+	free(shm);
+
+	return rc;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_shm_destroy(struct pldm_transport_shm *ctx)
+{
+	if (!ctx) {
+		return;
+	}
+
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
+
+	for (size_t i = 0; i < ctx->count; i++) {
+		close(ctx->efds[i]);
+	}
+
+	munmap(ctx->base, ctx->size);
+	free(ctx);
+}
@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
 #include "environ/errno.h"
 #include "socket.h"
+#include "transport.h"
 
 #include <limits.h>
 #include <stddef.h>
@@ -8,41 +9,65 @@
 #include <stdlib.h>
 #include <sys/socket.h>
 
-int pldm_socket_sndbuf_init(struct pldm_socket_sndbuf *ctx, int socket)
+/* The system's send buffer limit, or -1 until it is first needed */
+static int pldm_socket_wmem_max = -1;
+
+/* Returns the system's send buffer limit, or INT_MAX if it is unknown */
+static int pldm_socket_read_wmem_max(void)
 {
-	FILE *fp;
 	long max_buf_size;
 	char line[128];
 	char *endptr;
+	FILE *fp;
 
-	if (socket == -1) {
-		return -1;
-	}
-	ctx->socket = socket;
-
-	fp = fopen("/proc/sys/net/core/wmem_max", "r");
+	fp = fopen("/proc/sys/net/core/wmem_max", "re");
 	if (fp == NULL) {
-		return -1;
+		return INT_MAX;
 	}
 
 	if (fgets(line, sizeof(line), fp) == NULL) {
 		fclose(fp);
-		return -1;
+		return INT_MAX;
 	}
 
+	fclose(fp);
+
 	errno = 0;
 	max_buf_size = strtol(line, &endptr, 10);
-	if (errno != 0 || endptr == line) {
-		fclose(fp);
-		return -1;
+	if (errno != 0 || endptr == line || max_buf_size < 0) {
+		return INT_MAX;
 	}
 
-	fclose(fp);
-
 	if (max_buf_size > INT_MAX) {
 		max_buf_size = INT_MAX;
 	}
-	ctx->max_size = (int)max_buf_size;
+
+	return (int)max_buf_size;
+}
+
+/*
+ * The limit is read at most once per process, and only once a send buffer
+ * must grow. Racing readers store the same value, so no lock is required.
+ */
+static int pldm_socket_sndbuf_max(void)
+{
+	int max = __atomic_load_n(&pldm_socket_wmem_max, __ATOMIC_RELAXED);
+
+	if (max < 0) {
+		max = pldm_socket_read_wmem_max();
+		__atomic_store_n(&pldm_socket_wmem_max, max, __ATOMIC_RELAXED);
+	}
+
+	return max;
+}
+
+int pldm_socket_sndbuf_init(struct pldm_socket_sndbuf *ctx, int socket)
+{
+	if (socket == -1) {
+		return -1;
+	}
+	ctx->socket = socket;
+	ctx->max_size = 0;
 
 	if (pldm_socket_sndbuf_get(ctx)) {
 		return -1;
@@ -53,6 +78,8 @@ int pldm_socket_sndbuf_init(struct pldm_socket_sndbuf *ctx, int socket)
 
 int pldm_socket_sndbuf_accomodate(struct pldm_socket_sndbuf *ctx, int msg_len)
 {
+	int max_size;
+
 	if (msg_len < ctx->size) {
 		return 0;
 	}
@@ -60,10 +87,14 @@ int pldm_socket_sndbuf_accomodate(struct pldm_socket_sndbuf *ctx, int msg_len)
 	 * the buffer to the max size and see what happens. We don't know how
 	 * much of the extra space the kernel actually uses so let it tell us if
 	 * there wasn't enough space */
-	if (msg_len > ctx->max_size) {
-		msg_len = ctx->max_size;
+	max_size = pldm_socket_sndbuf_max();
+	if (ctx->max_size && ctx->max_size < max_size) {
+		max_size = ctx->max_size;
+	}
+	if (msg_len > max_size) {
+		msg_len = max_size;
 	}
-	if (ctx->size == ctx->max_size) {
+	if (ctx->size >= max_size) {
 		return 0;
 	}
 	int rc = setsockopt(ctx->socket, SOL_SOCKET, SO_SNDBUF, &(msg_len),
@@ -71,7 +102,33 @@ int pldm_socket_sndbuf_accomodate(struct pldm_socket_sndbuf *ctx, int msg_len)
 	if (rc == -1) {
 		return -1;
 	}
-	ctx->size = msg_len;
+	/* The limit may be unknown, so check what the kernel actually granted.
+	 * If it clamped the request the buffer can't grow any further, and
+	 * later sends must not retry the resize */
+	if (pldm_socket_sndbuf_get(ctx)) {
+		ctx->size = msg_len;
+	} else if (ctx->size < msg_len) {
+		ctx->max_size = ctx->size;
+	}
+	if (ctx->transport) {
+		pldm_transport_stats_count(ctx->transport,
+					   PLDM_TRANSPORT_STATS_NO_TID,
+					   PLDM_TRANSPORT_STAT(sndbuf_resizes),
+					   1);
+	}
+	return 0;
+}
+
+int pldm_socket_sndbuf_reserve(struct pldm_socket_sndbuf *ctx, size_t len)
+{
+	if (len > INT_MAX) {
+		return -EINVAL;
+	}
+
+	if (pldm_socket_sndbuf_accomodate(ctx, (int)len)) {
+		return -errno;
+	}
+
 	return 0;
 }
 
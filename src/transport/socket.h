@@ -1,12 +1,26 @@
 /* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
 #pragma once
 
+#include <stddef.h>
+
+struct pldm_transport;
+
 struct pldm_socket_sndbuf {
 	int size;
-	int socket;
+	/* The size the kernel clamped a resize to, or 0 if it never has */
 	int max_size;
+	int socket;
+	/* Optional, to count resizes */
+	struct pldm_transport *transport;
 };
 
 int pldm_socket_sndbuf_init(struct pldm_socket_sndbuf *ctx, int socket);
 int pldm_socket_sndbuf_accomodate(struct pldm_socket_sndbuf *ctx, int msg_len);
+
+/*
+ * Grow the send buffer ahead of sending messages of up to @len bytes.
+ * Returns 0 or a negative errno value.
+ */
+int pldm_socket_sndbuf_reserve(struct pldm_socket_sndbuf *ctx, size_t len);
+
 int pldm_socket_sndbuf_get(struct pldm_socket_sndbuf *ctx);
@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+#include "compiler.h"
+#include "environ/errno.h"
+#include "environ/time.h"
+#include "transport.h"
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/transport.h>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLDM_TRANSPORT_STATS_COUNTERS                                          \
+	(sizeof(struct pldm_transport_stats) / sizeof(uint64_t))
+
+static_assert(sizeof(struct pldm_transport_stats) % sizeof(uint64_t) == 0,
+	      "pldm_transport_stats must consist only of counters");
+
+/*
+ * Counters are updated with atomic increments so a snapshot can be taken from
+ * any thread, and so concurrent senders on the transport don't lose counts.
+ */
+struct pldm_transport_stats_state {
+	uint64_t total[PLDM_TRANSPORT_STATS_COUNTERS];
+	uint64_t tids[PLDM_MAX_TIDS][PLDM_TRANSPORT_STATS_COUNTERS];
+};
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_stats_enable(struct pldm_transport *transport)
+{
+	if (!transport) {
+		return -EINVAL;
+	}
+
+	if (transport->stats) {
+		return -EBUSY;
+	}
+
+	transport->stats = calloc(1, sizeof(*transport->stats));
+	if (!transport->stats) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+void pldm_transport_stats_disable(struct pldm_transport *transport)
+{
+	if (!transport) {
+		return;
+	}
+
+	free(transport->stats);
+	transport->stats = NULL;
+}
+
+static void pldm_transport_stats_read(const uint64_t *counters,
+				      struct pldm_transport_stats *stats)
+{
+	uint64_t snapshot[PLDM_TRANSPORT_STATS_COUNTERS];
+
+	for (size_t i = 0; i < PLDM_TRANSPORT_STATS_COUNTERS; i++) {
+		snapshot[i] = __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+	}
+
+	memcpy(stats, snapshot, sizeof(*stats));
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_stats_snapshot(struct pldm_transport *transport,
+				  struct pldm_transport_stats *stats)
+{
+	if (!transport || !stats) {
+		return -EINVAL;
+	}
+
+	if (!transport->stats) {
+		return -ENODATA;
+	}
+
+	pldm_transport_stats_read(transport->stats->total, stats);
+
+	return 0;
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_stats_snapshot_tid(struct pldm_transport *transport,
+				      pldm_tid_t tid,
+				      struct pldm_transport_stats *stats)
+{
+	if (!transport || !stats) {
+		return -EINVAL;
+	}
+
+	if (!transport->stats) {
+		return -ENODATA;
+	}
+
+	pldm_transport_stats_read(transport->stats->tids[tid], stats);
+
+	return 0;
+}
+
+void pldm_transport_stats_add(struct pldm_transport *transport, int tid,
+			      size_t counter, uint64_t n)
+{
+	struct pldm_transport_stats_state *state = transport->stats;
+
+	__atomic_fetch_add(&state->total[counter], n, __ATOMIC_RELAXED);
+
+	if (tid >= 0 && tid < PLDM_MAX_TIDS) {
+		__atomic_fetch_add(&state->tids[tid][counter], n,
+				   __ATOMIC_RELAXED);
+	}
+}
+
+uint64_t pldm_transport_stats_clock_us(void)
+{
+	struct timespec now;
+
+	if (libpldm_clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
+		return 0;
+	}
+
+	return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+void pldm_transport_stats_add_rtt(struct pldm_transport *transport,
+				  pldm_tid_t tid, uint64_t start_us)
+{
+	uint64_t now = pldm_transport_stats_clock_us();
+	uint64_t rtt;
+	size_t bucket;
+
+	if (now < start_us) {
+		return;
+	}
+
+	/* Bucket by the position of the most significant set bit */
+	rtt = now - start_us;
+	bucket = 63 - __builtin_clzll(rtt | 1);
+	if (bucket >= PLDM_TRANSPORT_STATS_RTT_BUCKETS) {
+		bucket = PLDM_TRANSPORT_STATS_RTT_BUCKETS - 1;
+	}
+
+	pldm_transport_stats_add(transport, tid,
+				 PLDM_TRANSPORT_STAT(rtt) + bucket, 1);
+}
@@ -138,7 +138,7 @@ static pldm_requester_rc_t pldm_transport_test_send(struct pldm_transport *ctx,
 	struct pldm_transport_test *test = transport_to_test(ctx);
 	const struct pldm_transport_test_descriptor *desc;
 
-	if (test->cursor > test->count) {
+	if (test->cursor >= test->count) {
 		return PLDM_REQUESTER_SEND_FAIL;
 	}
 
@@ -176,7 +176,7 @@ int pldm_transport_test_init(struct pldm_transport_test **ctx,
 		return -EINVAL;
 	}
 
-	struct pldm_transport_test *test = malloc(sizeof(*test));
+	struct pldm_transport_test *test = calloc(1, sizeof(*test));
 	if (!test) {
 		return -ENOMEM;
 	}
@@ -207,6 +207,8 @@ cleanup_test:
 LIBPLDM_ABI_TESTING
 void pldm_transport_test_destroy(struct pldm_transport_test *ctx)
 {
+	pldm_transport_stats_disable(&ctx->transport);
+	pldm_transport_pool_destroy(&ctx->transport);
 	close(ctx->timerfd);
 	free(ctx);
 }
@@ -13,8 +13,11 @@
 #include <poll.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -52,6 +55,8 @@ pldm_requester_rc_t pldm_transport_send_msg(struct pldm_transport *transport,
 					    const void *pldm_msg,
 					    size_t msg_len)
 {
+	pldm_requester_rc_t rc;
+
 	if (!transport || !pldm_msg) {
 		return PLDM_REQUESTER_INVALID_SETUP;
 	}
@@ -60,7 +65,116 @@ pldm_requester_rc_t pldm_transport_send_msg(struct pldm_transport *transport,
 		return PLDM_REQUESTER_NOT_REQ_MSG;
 	}
 
-	return transport->send(transport, tid, pldm_msg, msg_len);
+	rc = transport->send(transport, tid, pldm_msg, msg_len);
+	if (rc == PLDM_REQUESTER_SUCCESS) {
+		pldm_transport_stats_tx(transport, tid, msg_len);
+	}
+
+	return rc;
+}
+
+size_t pldm_transport_msgv_len(const struct pldm_transport_msgv *msg)
+{
+	size_t len = 0;
+
+	if (msg->iovlen && !msg->iov) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < msg->iovlen; i++) {
+		if (msg->iov[i].iov_len > SIZE_MAX - len) {
+			return 0;
+		}
+		if (msg->iov[i].iov_len && !msg->iov[i].iov_base) {
+			return 0;
+		}
+		len += msg->iov[i].iov_len;
+	}
+
+	return len;
+}
+
+void pldm_transport_msgv_peek(const struct pldm_transport_msgv *msg, void *buf,
+			      size_t len)
+{
+	unsigned char *dst = buf;
+
+	for (size_t i = 0; i < msg->iovlen && len; i++) {
+		size_t chunk = msg->iov[i].iov_len < len ? msg->iov[i].iov_len :
+							   len;
+
+		memcpy(dst, msg->iov[i].iov_base, chunk);
+		dst += chunk;
+		len -= chunk;
+	}
+}
+
+LIBPLDM_ABI_TESTING
+int pldm_transport_send_batch(struct pldm_transport *transport,
+			      const struct pldm_transport_msgv *msgs,
+			      size_t count)
+{
+	size_t sent;
+
+	if (!transport || !msgs) {
+		return -EINVAL;
+	}
+
+	if (count > INT_MAX) {
+		count = INT_MAX;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (pldm_transport_msgv_len(&msgs[i]) <
+		    sizeof(struct pldm_msg_hdr)) {
+			return -EINVAL;
+		}
+	}
+
+	if (!count) {
+		return 0;
+	}
+
+	if (transport->send_batch) {
+		int rc = transport->send_batch(transport, msgs, count);
+
+		for (int i = 0; i < rc && transport->stats; i++) {
+			pldm_transport_stats_tx(
+				transport, msgs[i].tid,
+				pldm_transport_msgv_len(&msgs[i]));
+		}
+
+		return rc;
+	}
+
+	for (sent = 0; sent < count; sent++) {
+		const struct pldm_transport_msgv *msg = &msgs[sent];
+		size_t len = pldm_transport_msgv_len(msg);
+		pldm_requester_rc_t rc;
+		void *buf;
+
+		if (msg->iovlen == 1) {
+			rc = transport->send(transport, msg->tid,
+					     msg->iov[0].iov_base, len);
+		} else {
+			buf = malloc(len);
+			if (!buf) {
+				break;
+			}
+
+			pldm_transport_msgv_peek(msg, buf, len);
+			rc = transport->send(transport, msg->tid, buf, len);
+			free(buf);
+		}
+
+		if (rc != PLDM_REQUESTER_SUCCESS) {
+			break;
+		}
+
+		pldm_transport_stats_tx(transport, msg->tid, len);
+	}
+
+	return sent ? (int)sent : -EIO;
 }
 
 LIBPLDM_ABI_STABLE
@@ -74,18 +188,93 @@ pldm_requester_rc_t pldm_transport_recv_msg(struct pldm_transport *transport,
 
 	pldm_requester_rc_t rc =
 		transport->recv(transport, tid, pldm_msg, msg_len);
+	if (rc == PLDM_REQUESTER_NOT_PLDM_MSG) {
+		pldm_transport_stats_count(transport,
+					   PLDM_TRANSPORT_STATS_NO_TID,
+					   PLDM_TRANSPORT_STAT(rx_not_pldm), 1);
+	} else if (rc == PLDM_REQUESTER_INVALID_RECV_LEN) {
+		pldm_transport_stats_count(
+			transport, PLDM_TRANSPORT_STATS_NO_TID,
+			PLDM_TRANSPORT_STAT(rx_invalid_len), 1);
+	}
 	if (rc != PLDM_REQUESTER_SUCCESS) {
 		return rc;
 	}
 
 	if (*msg_len < sizeof(struct pldm_msg_hdr)) {
+		pldm_transport_stats_count(transport, *tid,
+					   PLDM_TRANSPORT_STAT(rx_invalid_len),
+					   1);
 		free(*pldm_msg);
 		*pldm_msg = NULL;
 		return PLDM_REQUESTER_INVALID_RECV_LEN;
 	}
+
+	pldm_transport_stats_rx(transport, *tid, *msg_len);
+
 	return PLDM_REQUESTER_SUCCESS;
 }
 
+LIBPLDM_ABI_TESTING
+int pldm_transport_recv_batch(struct pldm_transport *transport,
+			      struct pldm_transport_msg *msgs, size_t count)
+{
+	pldm_requester_rc_t rc;
+	size_t msg_len;
+	pldm_tid_t tid;
+	void *msg;
+
+	if (!transport || !msgs) {
+		return -EINVAL;
+	}
+
+	if (!count) {
+		return 0;
+	}
+
+	if (transport->recv_batch) {
+		int received = transport->recv_batch(transport, msgs, count);
+
+		for (int i = 0; i < received && transport->stats; i++) {
+			pldm_transport_stats_rx(transport, msgs[i].tid,
+						msgs[i].len);
+		}
+
+		return received;
+	}
+
+	/* Without further insight only one message is known to be available */
+	errno = 0;
+	rc = pldm_transport_recv_msg(transport, &tid, &msg, &msg_len);
+
+	/* The message was consumed but discarded, as on the batch paths */
+	if (rc == PLDM_REQUESTER_NOT_PLDM_MSG ||
+	    rc == PLDM_REQUESTER_INVALID_RECV_LEN) {
+		return 0;
+	}
+
+	if (rc != PLDM_REQUESTER_SUCCESS) {
+		if (rc == PLDM_REQUESTER_RECV_FAIL && errno) {
+			return -errno;
+		}
+		return -EIO;
+	}
+
+	if (msg_len > msgs[0].len) {
+		pldm_transport_stats_count(transport, tid,
+					   PLDM_TRANSPORT_STAT(rx_invalid_len),
+					   1);
+		free(msg);
+		return 0;
+	}
+
+	memcpy(msgs[0].msg, msg, msg_len);
+	pldm_transport_msg_keep(msgs, 0, 0, tid, msg_len);
+	free(msg);
+
+	return 1;
+}
+
 static void timespec_to_timeval(const struct timespec *ts, struct timeval *tv)
 {
 	tv->tv_sec = ts->tv_sec;
@@ -131,6 +320,34 @@ static int clock_gettimeval(clockid_t clockid, struct timeval *tv)
 	return 0;
 }
 
+/* Avoid allocating to receive the message if a pool is registered */
+static void pldm_transport_discard_msg(struct pldm_transport *transport)
+{
+	struct pldm_transport_msg pooled;
+	pldm_requester_rc_t rc;
+	size_t msg_len;
+	pldm_tid_t tid;
+	void *msg;
+
+	if (transport->pool.avail) {
+		if (pldm_transport_recv_pooled(transport, &pooled, 1) == 1) {
+			pldm_transport_stats_count(
+				transport, pooled.tid,
+				PLDM_TRANSPORT_STAT(rx_discarded), 1);
+			pldm_transport_pool_release(transport, pooled.msg);
+		}
+		return;
+	}
+
+	rc = pldm_transport_recv_msg(transport, &tid, &msg, &msg_len);
+	if (rc == PLDM_REQUESTER_SUCCESS) {
+		pldm_transport_stats_count(transport, tid,
+					   PLDM_TRANSPORT_STAT(rx_discarded),
+					   1);
+		free(msg);
+	}
+}
+
 LIBPLDM_ABI_STABLE
 pldm_requester_rc_t
 pldm_transport_send_recv_msg(struct pldm_transport *transport, pldm_tid_t tid,
@@ -149,6 +366,7 @@ pldm_transport_send_recv_msg(struct pldm_transport *transport, pldm_tid_t tid,
 	const struct pldm_msg_hdr *req_hdr;
 	struct timeval remaining;
 	pldm_requester_rc_t rc;
+	uint64_t start;
 	struct timeval now;
 	struct timeval end;
 	int ret;
@@ -167,18 +385,14 @@ pldm_transport_send_recv_msg(struct pldm_transport *transport, pldm_tid_t tid,
 	for (cnt = 0; cnt <= (PLDM_INSTANCE_MAX + 1) * PLDM_MAX_TIDS &&
 		      pldm_transport_poll(transport, 0) == 1;
 	     cnt++) {
-		pldm_tid_t l_tid;
-		rc = pldm_transport_recv_msg(transport, &l_tid, pldm_resp_msg,
-					     resp_msg_len);
-		if (rc == PLDM_REQUESTER_SUCCESS) {
-			/* This isn't the message we wanted */
-			free(*pldm_resp_msg);
-		}
+		/* This isn't the message we wanted */
+		pldm_transport_discard_msg(transport);
 	}
 	if (cnt == (PLDM_INSTANCE_MAX + 1) * PLDM_MAX_TIDS) {
 		return PLDM_REQUESTER_TRANSPORT_BUSY;
 	}
 
+	start = pldm_transport_stats_stamp(transport);
 	rc = pldm_transport_send_msg(transport, tid, pldm_req_msg, req_msg_len);
 	if (rc != PLDM_REQUESTER_SUCCESS) {
 		return rc;
@@ -203,6 +417,11 @@ pldm_transport_send_recv_msg(struct pldm_transport *transport, pldm_tid_t tid,
 		/* 0 <= `timeval_to_msec()` <= 4800, and 4800 < INT_MAX */
 		ret = pldm_transport_poll(transport,
 					  (int)(timeval_to_msec(&remaining)));
+		if (ret == 0) {
+			pldm_transport_stats_count(
+				transport, tid, PLDM_TRANSPORT_STAT(timeouts),
+				1);
+		}
 		if (ret <= 0) {
 			return PLDM_REQUESTER_RECV_FAIL;
 		}
@@ -220,12 +439,59 @@ pldm_transport_send_recv_msg(struct pldm_transport *transport, pldm_tid_t tid,
 
 		if (src_tid != tid || !pldm_msg_hdr_correlate_response(
 					      pldm_req_msg, *pldm_resp_msg)) {
+			pldm_transport_stats_count(
+				transport, src_tid,
+				PLDM_TRANSPORT_STAT(rx_discarded), 1);
 			free(*pldm_resp_msg);
 			continue;
 		}
 
+		pldm_transport_stats_rtt(transport, tid, start);
+
 		return PLDM_REQUESTER_SUCCESS;
 	}
 
+	pldm_transport_stats_count(transport, tid,
+				   PLDM_TRANSPORT_STAT(timeouts), 1);
+
 	return PLDM_REQUESTER_RECV_FAIL;
 }
+
+void pldm_transport_wakeup_signal(uint32_t *signalled, int efd)
+{
+	const uint64_t one = 1;
+	ssize_t rc;
+
+	if (__atomic_exchange_n(signalled, 1, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+
+	/* Failure means the counter is saturated, which is still readable */
+	rc = write(efd, &one, sizeof(one));
+	(void)rc;
+}
+
+void pldm_transport_wakeup_publish(uint32_t *signalled, int efd)
+{
+	/* Pairs with the fence in pldm_transport_wakeup_clear() */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (!__atomic_load_n(signalled, __ATOMIC_RELAXED)) {
+		pldm_transport_wakeup_signal(signalled, efd);
+	}
+}
+
+void pldm_transport_wakeup_clear(uint32_t *signalled, int efd)
+{
+	uint64_t count;
+	ssize_t rc;
+
+	if (__atomic_load_n(signalled, __ATOMIC_RELAXED)) {
+		__atomic_store_n(signalled, 0, __ATOMIC_SEQ_CST);
+		/* Fails with EAGAIN if the counter is already clear */
+		rc = read(efd, &count, sizeof(count));
+		(void)rc;
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
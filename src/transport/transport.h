@@ -3,7 +3,34 @@
 
 #include <libpldm/base.h>
 #include <libpldm/pldm.h>
+#include <libpldm/transport.h>
+
+#include <stddef.h>
+
 struct pollfd;
+struct pldm_transport_stats_state;
+
+/**
+ * @brief A caller-registered slab of fixed-size receive buffers
+ *
+ * Free buffers are linked through their first bytes. A bitmap records the
+ * buffers handed out, so that only those may be released.
+ *
+ * @param base - the start of the slab, or NULL if no pool is registered
+ * @param size - the size of each buffer in the slab
+ * @param count - the number of buffers in the slab
+ * @param avail - the number of buffers on the free list
+ * @param free - the most recently released buffer
+ * @param in_use - a bit per buffer, set while the buffer is handed out
+ */
+struct pldm_transport_pool {
+	unsigned char *base;
+	size_t size;
+	size_t count;
+	size_t avail;
+	void *free;
+	unsigned char *in_use;
+};
 
 /**
  * @brief Generic PLDM transport struct
@@ -13,6 +40,12 @@ struct pollfd;
  * @param recv - pointer to the transport specific function to receive a message
  * @param send - pointer to the transport specific function to send a message
  * @param init_pollfd - pointer to the transport specific init_pollfd function
+ * @param recv_batch - optional pointer to the transport specific function to
+ *		       receive several messages at once
+ * @param send_batch - optional pointer to the transport specific function to
+ *		       send several messages at once
+ * @param pool - receive buffers registered with pldm_transport_pool_init()
+ * @param stats - counters allocated by pldm_transport_stats_enable(), or NULL
  */
 struct pldm_transport {
 	const char *name;
@@ -25,4 +58,131 @@ struct pldm_transport {
 				    size_t msg_len);
 	int (*init_pollfd)(struct pldm_transport *transport,
 			   struct pollfd *pollfd);
+	int (*recv_batch)(struct pldm_transport *transport,
+			  struct pldm_transport_msg *msgs, size_t count);
+	int (*send_batch)(struct pldm_transport *transport,
+			  const struct pldm_transport_msgv *msgs, size_t count);
+	struct pldm_transport_pool pool;
+	struct pldm_transport_stats_state *stats;
 };
+
+/*
+ * Wake-ups for a consumer polling an eventfd while producers publish to a
+ * queue it drains. The eventfd is kept readable while the queue may hold
+ * messages. Producers write to it only when @signalled is clear, and the
+ * consumer clears both only once it has found the queue empty, so a stream of
+ * messages to a busy consumer costs no system calls.
+ */
+
+/* Make @efd readable unless it already is */
+void pldm_transport_wakeup_signal(uint32_t *signalled, int efd);
+
+/* Called by a producer once it has published a message */
+void pldm_transport_wakeup_publish(uint32_t *signalled, int efd);
+
+/*
+ * Called by the consumer once it has found the queue empty. Clears @efd, after
+ * which the consumer must look again and call pldm_transport_wakeup_signal()
+ * if anything remains. A message published concurrently is then either seen
+ * by the consumer or signalled afresh by its producer.
+ */
+void pldm_transport_wakeup_clear(uint32_t *signalled, int efd);
+
+/* Release a pool still registered when its transport is destroyed */
+void pldm_transport_pool_destroy(struct pldm_transport *transport);
+
+/* The maximum number of messages received by one recv_batch() call */
+#define PLDM_TRANSPORT_RECV_BATCH_MAX 64
+
+/* The maximum number of messages sent by one send_batch() system call */
+#define PLDM_TRANSPORT_SEND_BATCH_MAX 64
+
+/* Returns the total length of @p msg, or zero if it is invalid */
+size_t pldm_transport_msgv_len(const struct pldm_transport_msgv *msg);
+
+/* Gather the first @p len bytes of @p msg into @p buf */
+void pldm_transport_msgv_peek(const struct pldm_transport_msgv *msg, void *buf,
+			      size_t len);
+
+/*
+ * Retain msgs[i] as the n'th received message. Entries holding discarded
+ * messages are swapped towards the end so no caller buffer is lost.
+ */
+static inline void pldm_transport_msg_keep(struct pldm_transport_msg *msgs,
+					   size_t i, size_t n, pldm_tid_t tid,
+					   size_t len)
+{
+	if (i != n) {
+		struct pldm_transport_msg tmp = msgs[n];
+
+		msgs[n] = msgs[i];
+		msgs[i] = tmp;
+	}
+
+	msgs[n].tid = tid;
+	msgs[n].len = len;
+}
+
+/* Attribute statistics only to the transport as a whole */
+#define PLDM_TRANSPORT_STATS_NO_TID (-1)
+
+/* The index of a counter in struct pldm_transport_stats */
+#define PLDM_TRANSPORT_STAT(field)                                             \
+	(offsetof(struct pldm_transport_stats, field) / sizeof(uint64_t))
+
+void pldm_transport_stats_add(struct pldm_transport *transport, int tid,
+			      size_t counter, uint64_t n);
+
+/* Returns a CLOCK_MONOTONIC timestamp in microseconds, or zero on failure */
+uint64_t pldm_transport_stats_clock_us(void);
+
+void pldm_transport_stats_add_rtt(struct pldm_transport *transport,
+				  pldm_tid_t tid, uint64_t start_us);
+
+/* The following are cheap no-ops unless statistics are enabled */
+
+static inline void pldm_transport_stats_count(struct pldm_transport *transport,
+					      int tid, size_t counter,
+					      uint64_t n)
+{
+	if (transport->stats) {
+		pldm_transport_stats_add(transport, tid, counter, n);
+	}
+}
+
+static inline void pldm_transport_stats_tx(struct pldm_transport *transport,
+					   pldm_tid_t tid, size_t len)
+{
+	if (transport->stats) {
+		pldm_transport_stats_add(transport, tid,
+					 PLDM_TRANSPORT_STAT(tx_msgs), 1);
+		pldm_transport_stats_add(transport, tid,
+					 PLDM_TRANSPORT_STAT(tx_bytes), len);
+	}
+}
+
+static inline void pldm_transport_stats_rx(struct pldm_transport *transport,
+					   pldm_tid_t tid, size_t len)
+{
+	if (transport->stats) {
+		pldm_transport_stats_add(transport, tid,
+					 PLDM_TRANSPORT_STAT(rx_msgs), 1);
+		pldm_transport_stats_add(transport, tid,
+					 PLDM_TRANSPORT_STAT(rx_bytes), len);
+	}
+}
+
+/* Returns the start of a round trip for pldm_transport_stats_rtt() */
+static inline uint64_t
+pldm_transport_stats_stamp(struct pldm_transport *transport)
+{
+	return transport->stats ? pldm_transport_stats_clock_us() : 0;
+}
+
+static inline void pldm_transport_stats_rtt(struct pldm_transport *transport,
+					    pldm_tid_t tid, uint64_t start_us)
+{
+	if (transport->stats && start_us) {
+		pldm_transport_stats_add_rtt(transport, tid, start_us);
+	}
+}
@@ -0,0 +1,687 @@
+/*
+ * Drive a requester against a farm of emulated termini and report where the
+ * time goes as the farm grows.
+ *
+ * Usage: farm [TERMINI [LATENCY_US [LOSS_PERCENT [PDRS]]]]
+ *
+ * The termini are served in-process by an in-memory transport that reaches
+ * each of them by TID. Each terminus answers the PLDM base commands through
+ * its own pldm_control, and GetPDR from a synthetic repository of PDRS
+ * records, with responses built by the library's encoders. Responses are
+ * delivered LATENCY_US after the request is sent, and LOSS_PERCENT of the
+ * requests are silently dropped, leaving the requester to retry them.
+ *
+ * For farms of 1, 2, 4, ... up to TERMINI termini, every terminus is first
+ * discovered with GetTID, then its PDRs are aggregated into a single
+ * repository with one GetPDR outstanding per terminus. Instance IDs are
+ * allocated from a private instance ID database. Each row reports the time
+ * taken by each phase, along with the mean cost of allocating and releasing
+ * an instance ID and of adding a PDR to the aggregate repository, so that
+ * costs growing with the number of termini stand out.
+ */
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/control.h>
+#include <libpldm/instance-id.h>
+#include <libpldm/pdr.h>
+#include <libpldm/platform.h>
+#include <libpldm/requester.h>
+#include <libpldm/sizes.h>
+#include <libpldm/transport.h>
+
+#include "transport/transport.h"
+
+#include <endian.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+/* TIDs 0 and 0xff are reserved */
+static constexpr int maxTermini = PLDM_MAX_TIDS - 2;
+
+/* The record data following the common header of each synthetic PDR */
+static constexpr size_t pdrBodyLen = 32;
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct Terminus
+{
+    alignas(std::max_align_t)
+        std::array<uint8_t, PLDM_SIZEOF_PLDM_CONTROL> controlStorage;
+    pldm_pdr* repo;
+
+    Terminus(pldm_tid_t tid, int pdrs) : repo(pldm_pdr_init())
+    {
+        std::array<uint8_t, sizeof(struct pldm_pdr_hdr) + pdrBodyLen> pdr{};
+        auto* hdr = reinterpret_cast<struct pldm_pdr_hdr*>(pdr.data());
+
+        if (!repo || pldm_control_setup(control(), controlStorage.size()))
+        {
+            abort();
+        }
+
+        hdr->version = 1;
+        hdr->type = PLDM_NUMERIC_SENSOR_PDR;
+        hdr->length = htole16(pdrBodyLen);
+        for (int i = 0; i < pdrs; i++)
+        {
+            uint32_t handle = 0;
+
+            pdr[sizeof(*hdr)] = tid;
+            pdr[sizeof(*hdr) + 1] = i;
+            if (pldm_pdr_add(repo, pdr.data(), pdr.size(), false, tid,
+                             &handle))
+            {
+                abort();
+            }
+        }
+    }
+
+    ~Terminus()
+    {
+        pldm_pdr_destroy(repo);
+    }
+
+    Terminus(const Terminus&) = delete;
+    Terminus& operator=(const Terminus&) = delete;
+
+    struct pldm_control* control()
+    {
+        return reinterpret_cast<struct pldm_control*>(controlStorage.data());
+    }
+
+    std::vector<uint8_t> handleGetPdr(const struct pldm_msg* req, size_t len)
+    {
+        std::vector<uint8_t> resp(sizeof(struct pldm_msg_hdr) +
+                                  PLDM_GET_PDR_MIN_RESP_BYTES);
+        auto* msg = reinterpret_cast<struct pldm_msg*>(resp.data());
+        uint32_t xferHandle;
+        uint32_t handle;
+        uint32_t next;
+        uint16_t count;
+        uint16_t change;
+        uint32_t size;
+        uint8_t* data;
+        uint8_t op;
+        int rc;
+
+        rc = decode_get_pdr_req(req, len - sizeof(req->hdr), &handle,
+                                &xferHandle, &op, &count, &change);
+        if (rc != PLDM_SUCCESS)
+        {
+            encode_cc_only_resp(req->hdr.instance_id, PLDM_PLATFORM,
+                                PLDM_GET_PDR, rc, msg);
+            resp.resize(sizeof(struct pldm_msg_hdr) + 1);
+            return resp;
+        }
+
+        /* Records are small enough to be transferred in one part */
+        if (!pldm_pdr_find_record(repo, handle, &data, &size, &next) ||
+            size > count)
+        {
+            encode_cc_only_resp(req->hdr.instance_id, PLDM_PLATFORM,
+                                PLDM_GET_PDR,
+                                PLDM_PLATFORM_INVALID_RECORD_HANDLE, msg);
+            resp.resize(sizeof(struct pldm_msg_hdr) + 1);
+            return resp;
+        }
+
+        resp.resize(resp.size() + size);
+        msg = reinterpret_cast<struct pldm_msg*>(resp.data());
+        encode_get_pdr_resp(req->hdr.instance_id, PLDM_SUCCESS, next, 0,
+                            PLDM_START_AND_END, size, data, 0, msg);
+
+        return resp;
+    }
+
+    std::vector<uint8_t> handle(const void* req, size_t len)
+    {
+        const auto* msg = static_cast<const struct pldm_msg*>(req);
+        std::vector<uint8_t> resp(256);
+        size_t respLen = resp.size();
+
+        if (msg->hdr.type == PLDM_PLATFORM && msg->hdr.command == PLDM_GET_PDR)
+        {
+            return handleGetPdr(msg, len);
+        }
+
+        if (pldm_control_handle_msg(control(), req, len, resp.data(),
+                                    &respLen))
+        {
+            respLen = 0;
+        }
+        resp.resize(respLen);
+
+        return resp;
+    }
+};
+
+struct Delivery
+{
+    uint64_t due;
+    uint64_t seq;
+    pldm_tid_t tid;
+    std::vector<uint8_t> msg;
+
+    bool operator>(const Delivery& other) const
+    {
+        return due != other.due ? due > other.due : seq > other.seq;
+    }
+};
+
+/*
+ * An in-memory transport to the termini. Requests are handled as they are
+ * sent, and the responses are released through a timerfd once their latency
+ * has elapsed.
+ */
+struct Farm
+{
+    struct pldm_transport transport;
+    std::array<std::unique_ptr<Terminus>, PLDM_MAX_TIDS> termini;
+    std::priority_queue<Delivery, std::vector<Delivery>, std::greater<>>
+        inflight;
+    std::minstd_rand rng;
+    uint64_t latencyNs;
+    unsigned int loss;
+    uint64_t seq = 0;
+    uint64_t dropped = 0;
+    uint64_t handlerNs = 0;
+    int timerfd;
+
+    void rearm()
+    {
+        struct itimerspec its = {};
+
+        if (!inflight.empty())
+        {
+            its.it_value.tv_sec = inflight.top().due / 1000000000;
+            its.it_value.tv_nsec = inflight.top().due % 1000000000;
+        }
+
+        timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &its, nullptr);
+    }
+};
+
+static pldm_requester_rc_t farmSend(struct pldm_transport* t, pldm_tid_t tid,
+                                    const void* msg, size_t len)
+{
+    auto* farm = reinterpret_cast<Farm*>(t);
+    Terminus* terminus = farm->termini[tid].get();
+    uint64_t start;
+
+    if (!terminus)
+    {
+        errno = EHOSTUNREACH;
+        return PLDM_REQUESTER_SEND_FAIL;
+    }
+
+    if (farm->loss && farm->rng() % 100 < farm->loss)
+    {
+        farm->dropped++;
+        return PLDM_REQUESTER_SUCCESS;
+    }
+
+    start = nowNs();
+    std::vector<uint8_t> resp = terminus->handle(msg, len);
+    farm->handlerNs += nowNs() - start;
+    if (resp.empty())
+    {
+        return PLDM_REQUESTER_SUCCESS;
+    }
+
+    farm->inflight.push(
+        {start + farm->latencyNs, farm->seq++, tid, std::move(resp)});
+    farm->rearm();
+
+    return PLDM_REQUESTER_SUCCESS;
+}
+
+static pldm_requester_rc_t farmRecv(struct pldm_transport* t, pldm_tid_t* tid,
+                                    void** msg, size_t* len)
+{
+    auto* farm = reinterpret_cast<Farm*>(t);
+
+    if (farm->inflight.empty() || farm->inflight.top().due > nowNs())
+    {
+        errno = EAGAIN;
+        return PLDM_REQUESTER_RECV_FAIL;
+    }
+
+    const Delivery& delivery = farm->inflight.top();
+    *msg = malloc(delivery.msg.size());
+    if (!*msg)
+    {
+        return PLDM_REQUESTER_RECV_FAIL;
+    }
+    memcpy(*msg, delivery.msg.data(), delivery.msg.size());
+    *len = delivery.msg.size();
+    *tid = delivery.tid;
+    farm->inflight.pop();
+    farm->rearm();
+
+    return PLDM_REQUESTER_SUCCESS;
+}
+
+static int farmInitPollfd(struct pldm_transport* t, struct pollfd* pollfd)
+{
+    auto* farm = reinterpret_cast<Farm*>(t);
+
+    pollfd->fd = farm->timerfd;
+    pollfd->events = POLLIN;
+
+    return 0;
+}
+
+/* The requesting side's view of one terminus */
+struct Peer
+{
+    pldm_tid_t tid;
+    pldm_instance_id_t iid;
+    std::array<uint8_t, sizeof(struct pldm_msg_hdr) + PLDM_GET_PDR_REQ_BYTES>
+        req;
+    size_t reqLen;
+    uint32_t nextRecord;
+    int pdrs;
+    bool failed;
+};
+
+struct Load
+{
+    struct pldm_instance_db* db;
+    struct pldm_requester* requester;
+    pldm_pdr* aggregate;
+    std::vector<Peer> peers;
+    std::vector<Peer*> ready;
+    size_t outstanding = 0;
+    uint64_t iidOps = 0;
+    uint64_t iidNs = 0;
+    uint64_t pdrAdds = 0;
+    uint64_t pdrAddNs = 0;
+    uint64_t failures = 0;
+};
+
+static Load* load;
+
+static void releaseIid(Peer* peer)
+{
+    uint64_t start = nowNs();
+
+    pldm_instance_id_free(load->db, peer->tid, peer->iid);
+    load->iidNs += nowNs() - start;
+}
+
+static int allocIid(Peer* peer)
+{
+    uint64_t start = nowNs();
+    int rc;
+
+    rc = pldm_instance_id_alloc(load->db, peer->tid, &peer->iid);
+    load->iidNs += nowNs() - start;
+    load->iidOps++;
+
+    return rc;
+}
+
+static void discovered(void* data, int rc, pldm_tid_t /*tid*/,
+                       const void* /*resp*/, size_t /*len*/)
+{
+    auto* peer = static_cast<Peer*>(data);
+
+    releaseIid(peer);
+    load->outstanding--;
+    if (rc)
+    {
+        peer->failed = true;
+        load->failures++;
+    }
+}
+
+static void pdrReceived(void* data, int rc, pldm_tid_t tid, const void* resp,
+                        size_t len)
+{
+    std::array<uint8_t, sizeof(struct pldm_pdr_hdr) + pdrBodyLen> record;
+    auto* peer = static_cast<Peer*>(data);
+    uint32_t nextXfer;
+    uint8_t flag;
+    uint16_t count;
+    uint8_t crc;
+    uint8_t cc;
+
+    releaseIid(peer);
+    load->outstanding--;
+
+    if (!rc)
+    {
+        rc = decode_get_pdr_resp(
+            static_cast<const struct pldm_msg*>(resp),
+            len - sizeof(struct pldm_msg_hdr), &cc, &peer->nextRecord,
+            &nextXfer, &flag, &count, record.data(), record.size(), &crc);
+    }
+
+    if (rc || cc != PLDM_SUCCESS)
+    {
+        peer->failed = true;
+        load->failures++;
+        return;
+    }
+
+    uint32_t handle = 0;
+    uint64_t start = nowNs();
+    pldm_pdr_add(load->aggregate, record.data(), count, true, tid, &handle);
+    load->pdrAddNs += nowNs() - start;
+    load->pdrAdds++;
+    peer->pdrs++;
+
+    if (peer->nextRecord)
+    {
+        load->ready.push_back(peer);
+    }
+}
+
+static int submitGetTid(Peer* peer)
+{
+    auto* msg = reinterpret_cast<struct pldm_msg*>(peer->req.data());
+    int rc;
+
+    rc = allocIid(peer);
+    if (rc)
+    {
+        return rc;
+    }
+
+    encode_get_tid_req(peer->iid, msg);
+    peer->reqLen = sizeof(struct pldm_msg_hdr);
+    rc = pldm_requester_submit(load->requester, peer->tid, peer->req.data(),
+                               peer->reqLen, discovered, peer);
+    if (rc)
+    {
+        releaseIid(peer);
+        return rc;
+    }
+    load->outstanding++;
+
+    return 0;
+}
+
+static int submitGetPdr(Peer* peer)
+{
+    auto* msg = reinterpret_cast<struct pldm_msg*>(peer->req.data());
+    int rc;
+
+    rc = allocIid(peer);
+    if (rc)
+    {
+        return rc;
+    }
+
+    encode_get_pdr_req(peer->iid, peer->nextRecord, 0, PLDM_GET_FIRSTPART,
+                       sizeof(struct pldm_pdr_hdr) + pdrBodyLen, 0, msg,
+                       PLDM_GET_PDR_REQ_BYTES);
+    peer->reqLen = peer->req.size();
+    rc = pldm_requester_submit(load->requester, peer->tid, peer->req.data(),
+                               peer->reqLen, pdrReceived, peer);
+    if (rc)
+    {
+        releaseIid(peer);
+        return rc;
+    }
+    load->outstanding++;
+
+    return 0;
+}
+
+/* Service the requester until every outstanding request is resolved */
+static int drain()
+{
+    while (load->outstanding || !load->ready.empty())
+    {
+        while (!load->ready.empty())
+        {
+            Peer* peer = load->ready.back();
+
+            load->ready.pop_back();
+            if (submitGetPdr(peer))
+            {
+                peer->failed = true;
+                load->failures++;
+            }
+        }
+
+        if (!load->outstanding)
+        {
+            break;
+        }
+
+        int rc = pldm_requester_poll(load->requester, -1);
+        if (rc < 0)
+        {
+            return rc;
+        }
+
+        while (rc > 0)
+        {
+            pldm_tid_t tid;
+            size_t len;
+            void* msg;
+
+            rc = pldm_requester_recv(load->requester, &tid, &msg, &len);
+            if (rc == 1)
+            {
+                /* Late responses to requests that were retried */
+                free(msg);
+            }
+            else if (rc < 0)
+            {
+                return rc;
+            }
+
+            rc = pldm_requester_poll(load->requester, 0);
+            if (rc < 0)
+            {
+                return rc;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int run(int termini, uint64_t latencyUs, unsigned int loss, int pdrs)
+{
+    static constexpr struct pldm_requester_retry_policy policy = {
+        .timeout_ms = 300,
+        .retries = 3,
+        .backoff = 1,
+    };
+    double discoveryMs;
+    double pdrMs;
+    Load state{};
+    Farm farm{};
+    int rc;
+
+    farm.transport.name = "FARM";
+    farm.transport.version = 1;
+    farm.transport.send = farmSend;
+    farm.transport.recv = farmRecv;
+    farm.transport.init_pollfd = farmInitPollfd;
+    farm.latencyNs = latencyUs * 1000;
+    farm.loss = loss;
+    farm.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (farm.timerfd < 0)
+    {
+        return -errno;
+    }
+
+    load = &state;
+    state.aggregate = pldm_pdr_init();
+    if (!state.aggregate)
+    {
+        rc = -ENOMEM;
+        goto cleanup_timerfd;
+    }
+
+    rc = pldm_requester_init(&state.requester, &farm.transport);
+    if (rc)
+    {
+        goto cleanup_aggregate;
+    }
+
+    {
+        /* A private database, as the default may be in use by others */
+        char path[] = "/tmp/farm-iid-XXXXXX";
+        int fd = mkstemp(path);
+
+        if (fd < 0)
+        {
+            rc = -errno;
+            goto cleanup_requester;
+        }
+
+        rc = ftruncate(fd, PLDM_MAX_TIDS * 32) ? -errno : 0;
+        if (!rc)
+        {
+            rc = pldm_instance_db_init(&state.db, path);
+        }
+        unlink(path);
+        close(fd);
+        if (rc)
+        {
+            goto cleanup_requester;
+        }
+    }
+
+    state.peers.resize(termini);
+    for (int i = 0; i < termini; i++)
+    {
+        pldm_tid_t tid = i + 1;
+
+        farm.termini[tid] = std::make_unique<Terminus>(tid, pdrs);
+        state.peers[i].tid = tid;
+        pldm_requester_set_retry_policy(state.requester, tid, &policy);
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto& peer : state.peers)
+        {
+            if (submitGetTid(&peer))
+            {
+                peer.failed = true;
+                state.failures++;
+            }
+        }
+        rc = drain();
+        discoveryMs = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+        if (rc)
+        {
+            goto cleanup_db;
+        }
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        for (auto& peer : state.peers)
+        {
+            if (!peer.failed)
+            {
+                state.ready.push_back(&peer);
+            }
+        }
+        rc = drain();
+        pdrMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+        if (rc)
+        {
+            goto cleanup_db;
+        }
+    }
+
+    printf("%7d %12.3f %12.3f %8u %10.3f %10.3f %10.3f %8" PRIu64
+           " %8" PRIu64 "\n",
+           termini, discoveryMs, pdrMs,
+           pldm_pdr_get_record_count(state.aggregate),
+           state.iidOps ? (double)state.iidNs / state.iidOps / 1000 : 0.0,
+           state.pdrAdds ? (double)state.pdrAddNs / state.pdrAdds / 1000 : 0.0,
+           state.iidOps ? (double)farm.handlerNs / state.iidOps / 1000 : 0.0,
+           farm.dropped, state.failures);
+
+cleanup_db:
+    pldm_instance_db_destroy(state.db);
+cleanup_requester:
+    pldm_requester_destroy(state.requester);
+cleanup_aggregate:
+    pldm_pdr_destroy(state.aggregate);
+cleanup_timerfd:
+    close(farm.timerfd);
+    load = nullptr;
+
+    return rc;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int loss = argc > 3 ? strtoul(argv[3], nullptr, 0) : 0;
+    uint64_t latencyUs = argc > 2 ? strtoull(argv[2], nullptr, 0) : 0;
+    int termini = argc > 1 ? strtol(argv[1], nullptr, 0) : maxTermini;
+    int pdrs = argc > 4 ? strtol(argv[4], nullptr, 0) : 64;
+
+    if (termini < 1 || termini > maxTermini || loss > 100 || pdrs < 1)
+    {
+        fprintf(stderr,
+                "Usage: %s [TERMINI [LATENCY_US [LOSS_PERCENT [PDRS]]]]\n"
+                "TERMINI must lie in [1, %d]\n",
+                argv[0], maxTermini);
+        return EXIT_FAILURE;
+    }
+
+    printf("%7s %12s %12s %8s %10s %10s %10s %8s %8s\n", "termini",
+           "discovery/ms", "pdrs/ms", "records", "iid/us", "pdr_add/us",
+           "handler/us", "dropped", "failed");
+
+    for (int n = 1;; n = n * 2 < termini ? n * 2 : termini)
+    {
+        int rc = run(n, latencyUs, loss, pdrs);
+
+        if (rc)
+        {
+            fprintf(stderr, "Farm of %d termini failed: %s\n", n,
+                    strerror(-rc));
+            return EXIT_FAILURE;
+        }
+
+        if (n == termini)
+        {
+            break;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
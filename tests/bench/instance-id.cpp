@@ -0,0 +1,333 @@
+/*
+ * Contend for the instance IDs of one TID from several processes and threads
+ * sharing a database file, and report the allocation throughput.
+ *
+ * Usage: instance-id [PROCESSES [THREADS [DURATION_MS [lock|shared
+ *                    [single|batch]]]]]
+ *
+ * For 1, 2, ... up to PROCESSES processes, each process runs THREADS threads
+ * that each open their own database object on a common file, either as an
+ * OFD lock database or as a shared memory database. For DURATION_MS every
+ * thread repeatedly allocates a few instance IDs and frees them again, either
+ * one at a time with pldm_instance_id_alloc(), the default, or together with
+ * pldm_instance_id_alloc_batch().
+ * Each row reports the combined allocation rate along with the statistics
+ * gathered by the database objects, so that the cost of contention can be
+ * seen growing with the number of processes.
+ */
+
+#include <libpldm/api.h>
+#include <libpldm/instance-id.h>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr pldm_tid_t tid = 1;
+
+/* The instance IDs each thread holds at once */
+static constexpr unsigned int window = 4;
+
+/* The size of a lock database covering every TID */
+static constexpr off_t dbSize = 256 * 32;
+
+/* The outcome of one thread, written to memory shared with the parent */
+struct result
+{
+    struct pldm_instance_db_stats stats;
+    std::chrono::nanoseconds::rep elapsedNs;
+    int rc;
+};
+
+static int openDb(struct pldm_instance_db** db, const char* path, bool shared)
+{
+    return shared ? pldm_instance_db_init_shared(db, path)
+                  : pldm_instance_db_init(db, path);
+}
+
+/* Allocate up to window IDs for the TID, one at a time or as a batch */
+static int allocate(struct pldm_instance_db* db, bool batch, uint32_t* iids)
+{
+    pldm_instance_id_t iid;
+    int rc;
+
+    if (batch)
+    {
+        return pldm_instance_id_alloc_batch(db, tid, window, iids);
+    }
+
+    *iids = 0;
+    for (unsigned int i = 0; i < window; i++)
+    {
+        rc = pldm_instance_id_alloc(db, tid, &iid);
+        if (rc)
+        {
+            break;
+        }
+        *iids |= UINT32_C(1) << iid;
+    }
+
+    /* Report those allocated before the TID ran out */
+    if (*iids && rc == -EAGAIN)
+    {
+        return 0;
+    }
+
+    return rc;
+}
+
+static int contend(const char* path, bool shared, bool batch,
+                   std::chrono::milliseconds duration, struct result* result)
+{
+    struct pldm_instance_db* db = nullptr;
+    int rc;
+
+    rc = openDb(&db, path, shared);
+    if (rc)
+    {
+        return rc < 0 ? rc : -rc;
+    }
+
+    rc = pldm_instance_db_stats_enable(db);
+    if (rc)
+    {
+        goto cleanup_db;
+    }
+
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + duration;
+
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            uint32_t iids;
+
+            rc = allocate(db, batch, &iids);
+            if (rc == -EAGAIN)
+            {
+                continue;
+            }
+
+            if (rc < 0)
+            {
+                goto cleanup_db;
+            }
+
+            for (; iids; iids &= iids - 1)
+            {
+                rc = pldm_instance_id_free(db, tid, __builtin_ctz(iids));
+                if (rc)
+                {
+                    goto cleanup_db;
+                }
+            }
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        result->elapsedNs =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count();
+    }
+
+    rc = pldm_instance_db_stats_snapshot(db, &result->stats);
+
+cleanup_db:
+    pldm_instance_db_destroy(db);
+
+    return rc;
+}
+
+static void runProcess(const char* path, bool shared, bool batch, int threads,
+                       std::chrono::milliseconds duration,
+                       struct result* results)
+{
+    std::vector<std::thread> workers;
+
+    for (int i = 0; i < threads; i++)
+    {
+        workers.emplace_back([=]() {
+            results[i].rc =
+                contend(path, shared, batch, duration, &results[i]);
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+static int run(const char* path, bool shared, bool batch, int processes,
+               int threads, std::chrono::milliseconds duration,
+               struct result* results)
+{
+    struct pldm_instance_db_stats total = {};
+    std::vector<pid_t> children;
+    double rate = 0;
+    int rc = 0;
+
+    memset(results, 0, sizeof(*results) * processes * threads);
+
+    for (int p = 0; p < processes; p++)
+    {
+        pid_t pid = fork();
+
+        if (pid < 0)
+        {
+            rc = -errno;
+            break;
+        }
+
+        if (!pid)
+        {
+            runProcess(path, shared, batch, threads, duration,
+                       &results[p * threads]);
+            _exit(EXIT_SUCCESS);
+        }
+
+        children.push_back(pid);
+    }
+
+    for (pid_t pid : children)
+    {
+        int status;
+
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != EXIT_SUCCESS)
+        {
+            rc = rc ? rc : -ECHILD;
+        }
+    }
+
+    if (rc)
+    {
+        return rc;
+    }
+
+    for (int i = 0; i < processes * threads; i++)
+    {
+        const struct result* r = &results[i];
+
+        if (r->rc)
+        {
+            return r->rc;
+        }
+
+        total.allocs += r->stats.allocs;
+        total.probes += r->stats.probes;
+        total.eagain += r->stats.eagain;
+        total.lock_calls += r->stats.lock_calls;
+        total.lock_ns += r->stats.lock_ns;
+        if (r->stats.peak > total.peak)
+        {
+            total.peak = r->stats.peak;
+        }
+
+        if (r->elapsedNs)
+        {
+            rate += r->stats.allocs * 1e9 / r->elapsedNs;
+        }
+    }
+
+    printf("%9d %12.0f %12.3f %10" PRIu64 " %12.3f %10.1f %6" PRIu64 "\n",
+           processes, rate,
+           total.allocs ? double(total.probes) / total.allocs : 0,
+           total.eagain,
+           total.allocs ? double(total.lock_calls) / total.allocs : 0,
+           total.lock_calls ? double(total.lock_ns) / total.lock_calls : 0,
+           total.peak);
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string mode = argc > 5 ? argv[5] : "single";
+    std::string backend = argc > 4 ? argv[4] : "lock";
+    int durationMs = argc > 3 ? strtol(argv[3], nullptr, 0) : 200;
+    int threads = argc > 2 ? strtol(argv[2], nullptr, 0) : 2;
+    int processes = argc > 1 ? strtol(argv[1], nullptr, 0) : 4;
+    char path[] = "/tmp/pldm-instance-db-bench-XXXXXX";
+    struct result* results;
+    size_t resultsSize;
+    bool shared;
+    bool batch;
+    int rc = 0;
+    int fd;
+
+    if (processes < 1 || processes > 64 || threads < 1 || threads > 64 ||
+        durationMs < 1 || (backend != "lock" && backend != "shared") ||
+        (mode != "single" && mode != "batch"))
+    {
+        fprintf(stderr,
+                "Usage: %s [PROCESSES [THREADS [DURATION_MS [lock|shared "
+                "[single|batch]]]]]\n"
+                "PROCESSES and THREADS must lie in [1, 64]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    shared = backend == "shared";
+    batch = mode == "batch";
+
+    fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+
+    /* The shared memory database sizes the file itself */
+    if (!shared && ftruncate(fd, dbSize) < 0)
+    {
+        perror("ftruncate");
+        close(fd);
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    /* Results are written by the children before they exit */
+    resultsSize = sizeof(*results) * processes * threads;
+    results = static_cast<struct result*>(mmap(nullptr, resultsSize,
+                                               PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_ANONYMOUS, -1,
+                                               0));
+    if (results == MAP_FAILED)
+    {
+        perror("mmap");
+        unlink(path);
+        return EXIT_FAILURE;
+    }
+
+    printf("%9s %12s %12s %10s %12s %10s %6s\n", "processes", "allocs/s",
+           "probes/alloc", "eagain", "locks/alloc", "ns/lock", "peak");
+
+    for (int p = 1; p <= processes; p++)
+    {
+        rc = run(path, shared, batch, p, threads,
+                 std::chrono::milliseconds(durationMs), results);
+        if (rc)
+        {
+            fprintf(stderr, "Contention between %d processes failed: %s\n", p,
+                    strerror(-rc));
+            break;
+        }
+    }
+
+    munmap(results, resultsSize);
+    unlink(path);
+
+    return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
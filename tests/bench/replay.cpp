@@ -0,0 +1,204 @@
+/*
+ * Replay a capture through the test transport, decoding or handling each
+ * received message, and report the achieved message rate.
+ *
+ * Usage: replay [CAPTURE]
+ *
+ * Without a capture, one is synthesised by recording GetTID exchanges between
+ * a requester and a pldm_control responder over a loopback transport pair.
+ */
+
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/control.h>
+#include <libpldm/sizes.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/capture.h>
+#include <libpldm/transport/loopback.h>
+
+#include "transport/replay.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr int synthesisedExchanges = 100000;
+
+alignas(std::max_align_t) static std::array<uint8_t, PLDM_SIZEOF_PLDM_CONTROL>
+    controlStorage;
+static auto* control = reinterpret_cast<struct pldm_control*>(
+    controlStorage.data());
+
+static int synthesise(int fd)
+{
+    struct pldm_transport_capture* capture = nullptr;
+    struct pldm_transport_loopback* a = nullptr;
+    struct pldm_transport_loopback* b = nullptr;
+    struct pldm_transport* requester;
+    struct pldm_transport* responder;
+    int rc;
+
+    rc = pldm_transport_loopback_init_pair(&a, 1, &b, 2, 4);
+    if (rc)
+    {
+        return rc;
+    }
+
+    rc = pldm_transport_capture_init(&capture, pldm_transport_loopback_core(a),
+                                     fd);
+    if (rc)
+    {
+        goto cleanup_pair;
+    }
+
+    requester = pldm_transport_capture_core(capture);
+    responder = pldm_transport_loopback_core(b);
+
+    for (int i = 0; i < synthesisedExchanges; i++)
+    {
+        std::array<uint8_t, sizeof(struct pldm_msg_hdr)> req{};
+        std::array<uint8_t, 64> resp{};
+        size_t resp_len = resp.size();
+        pldm_tid_t tid;
+        size_t len;
+        void* msg;
+
+        encode_get_tid_req(i & 0x1f, reinterpret_cast<pldm_msg*>(req.data()));
+        pldm_transport_send_msg(requester, 2, req.data(), req.size());
+        pldm_transport_recv_msg(responder, &tid, &msg, &len);
+        pldm_control_handle_msg(control, msg, len, resp.data(), &resp_len);
+        free(msg);
+        pldm_transport_send_msg(responder, tid, resp.data(), resp_len);
+        pldm_transport_recv_msg(requester, &tid, &msg, &len);
+        free(msg);
+    }
+
+    rc = pldm_transport_capture_flush(capture);
+    pldm_transport_capture_destroy(capture);
+
+cleanup_pair:
+    pldm_transport_loopback_destroy(a);
+    pldm_transport_loopback_destroy(b);
+
+    return rc;
+}
+
+/* Hand a received message to the decoder or handler for it */
+static void dispatch(const void* msg, size_t len)
+{
+    const auto* hdr = static_cast<const struct pldm_msg_hdr*>(msg);
+    std::array<uint8_t, 256> resp;
+    size_t resp_len = resp.size();
+
+    if (hdr->request)
+    {
+        pldm_control_handle_msg(control, msg, len, resp.data(), &resp_len);
+    }
+    else if (hdr->type == PLDM_BASE && hdr->command == PLDM_GET_TID)
+    {
+        struct pldm_base_get_tid_resp tid;
+
+        decode_pldm_base_get_tid_resp(static_cast<const struct pldm_msg*>(msg),
+                                      len - sizeof(*hdr), &tid);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    struct pldm_transport_test_descriptor* seq = nullptr;
+    struct pldm_transport_replay* replay = nullptr;
+    struct pldm_transport* transport;
+    size_t received = 0;
+    size_t count;
+    int rc;
+    int fd;
+
+    if (pldm_control_setup(control, controlStorage.size()))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 1)
+    {
+        fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            perror("open");
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        fd = memfd_create("capture", MFD_CLOEXEC);
+        if (fd < 0 || synthesise(fd) || lseek(fd, 0, SEEK_SET))
+        {
+            fprintf(stderr, "Failed to synthesise a capture\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* The replay transport needs the sequence to send what was recorded */
+    rc = pldm_transport_replay_load(fd, 0, &seq, &count);
+    if (!rc)
+    {
+        lseek(fd, 0, SEEK_SET);
+        rc = pldm_transport_replay_init(&replay, fd, 0);
+    }
+    close(fd);
+    if (rc)
+    {
+        fprintf(stderr, "Failed to load the capture: %s\n", strerror(-rc));
+        free(seq);
+        return EXIT_FAILURE;
+    }
+
+    transport = pldm_transport_replay_core(replay);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+        const struct pldm_transport_test_descriptor* desc = &seq[i];
+        pldm_tid_t tid;
+        size_t len;
+        void* msg;
+
+        if (desc->type == PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND)
+        {
+            rc = pldm_transport_send_msg(transport, desc->send_msg.dst,
+                                         desc->send_msg.msg,
+                                         desc->send_msg.len);
+        }
+        else
+        {
+            rc = pldm_transport_recv_msg(transport, &tid, &msg, &len);
+            if (rc == PLDM_REQUESTER_SUCCESS)
+            {
+                dispatch(msg, len);
+                free(msg);
+                received++;
+            }
+        }
+
+        if (rc != PLDM_REQUESTER_SUCCESS)
+        {
+            fprintf(stderr, "Replay diverged at element %zu: %d\n", i, rc);
+            break;
+        }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    printf("%zu elements, %zu received in %.3fs: %.0f msgs/s\n", count,
+           received, elapsed.count(), (double)count / elapsed.count());
+
+    pldm_transport_replay_destroy(replay);
+    free(seq);
+
+    return rc == PLDM_REQUESTER_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+}
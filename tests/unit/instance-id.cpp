@@ -1,13 +1,44 @@
+#include <libpldm/api.h>
 #include <libpldm/base.h>
 #include <libpldm/instance-id.h>
 
+#include <array>
+#include <atomic>
 #include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 
+extern "C" {
+#include "environ/time.h"
+
+/* Seconds added to the monotonic clock, to step time in expiry tests */
+static std::atomic<time_t> clockOffset{0};
+int libpldm_clock_gettime(clockid_t clockid, struct timespec* ts)
+{
+    int rc = clock_gettime(clockid, ts);
+
+    if (!rc)
+    {
+        ts->tv_sec += clockOffset;
+    }
+
+    return rc;
+}
+}
+
 static constexpr auto pldmMaxInstanceIds = 32;
 static const std::filesystem::path nonexistentDb = {"remove-this-file"};
 
@@ -341,3 +372,783 @@ TEST_F(PldmInstanceDbTest, freeUnallocatedInstanceId)
     EXPECT_NE(pldm_instance_id_free(db, tid, 0), 0);
     ASSERT_EQ(pldm_instance_db_destroy(db), 0);
 }
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(InstanceId, localInitInvalid)
+{
+    struct pldm_instance_db* db = reinterpret_cast<struct pldm_instance_db*>(8);
+
+    EXPECT_EQ(pldm_instance_db_init_local(nullptr), -EINVAL);
+    EXPECT_EQ(pldm_instance_db_init_local(&db), -EINVAL);
+}
+
+TEST(InstanceId, localAllocAllInstanceIds)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    std::array<pldm_instance_id_t, pldmMaxInstanceIds> iids = {};
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t extra;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+
+    for (size_t i = 0; i < iids.size(); i++)
+    {
+        EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iids[i]), 0);
+        EXPECT_EQ(iids[i], i);
+    }
+
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &extra), -EAGAIN);
+
+    /* Other TIDs are unaffected */
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid + 1, &extra), 0);
+    EXPECT_EQ(extra, 0);
+    EXPECT_EQ(pldm_instance_id_free(db, tid + 1, extra), 0);
+
+    for (auto& iid : iids)
+    {
+        EXPECT_EQ(pldm_instance_id_free(db, tid, iid), 0);
+    }
+
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &extra), 0);
+    EXPECT_EQ(extra, 0);
+    EXPECT_EQ(pldm_instance_id_free(db, tid, extra), 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST(InstanceId, localAllocAfterPrevious)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t first;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+
+    /* Released IDs aren't reused until the others have been allocated */
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &first), 0);
+    for (int i = 1; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+        EXPECT_EQ(iid, i);
+        ASSERT_EQ(pldm_instance_id_free(db, tid, iid), 0);
+    }
+
+    /* Allocation wraps, skipping the ID still held */
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    EXPECT_EQ(iid, 1);
+    ASSERT_EQ(pldm_instance_id_free(db, tid, iid), 0);
+    ASSERT_EQ(pldm_instance_id_free(db, tid, first), 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST(InstanceId, localFreeUnallocated)
+{
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    EXPECT_EQ(pldm_instance_id_free(db, 1, 0), -EINVAL);
+    EXPECT_EQ(pldm_instance_id_free(db, 1, pldmMaxInstanceIds), -EINVAL);
+    ASSERT_EQ(pldm_instance_id_alloc(db, 1, &iid), 0);
+    EXPECT_EQ(pldm_instance_id_free(db, 1, iid), 0);
+    EXPECT_EQ(pldm_instance_id_free(db, 1, iid), -EINVAL);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST(InstanceId, localConcurrentAllocations)
+{
+    static constexpr pldm_tid_t tid = 1;
+    static constexpr int rounds = 20000;
+
+    std::array<std::atomic<int>, pldmMaxInstanceIds> holders{};
+    struct pldm_instance_db* db = nullptr;
+    std::atomic<int> conflicts = 0;
+    std::vector<std::thread> threads;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([db, &holders, &conflicts]() {
+            for (int i = 0; i < rounds; i++)
+            {
+                pldm_instance_id_t iid;
+
+                if (pldm_instance_id_alloc(db, tid, &iid))
+                {
+                    continue;
+                }
+
+                /* No other thread may hold the ID we were allocated */
+                if (holders[iid]++)
+                {
+                    conflicts++;
+                }
+                holders[iid]--;
+
+                if (pldm_instance_id_free(db, tid, iid))
+                {
+                    conflicts++;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_EQ(conflicts, 0);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+class PldmInstanceDbSharedTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        shmPath = std::filesystem::temp_directory_path() /
+                  ("pldm-instance-db." + std::to_string(::getpid()));
+        std::filesystem::remove(shmPath);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(shmPath);
+    }
+
+    std::filesystem::path shmPath;
+};
+
+TEST_F(PldmInstanceDbSharedTest, initInvalid)
+{
+    struct pldm_instance_db* db = reinterpret_cast<struct pldm_instance_db*>(8);
+
+    EXPECT_EQ(pldm_instance_db_init_shared(nullptr, shmPath.c_str()), -EINVAL);
+    EXPECT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), -EINVAL);
+    db = nullptr;
+    EXPECT_EQ(pldm_instance_db_init_shared(&db, nullptr), -EINVAL);
+    EXPECT_NE(pldm_instance_db_init_shared(&db, ""), 0);
+    EXPECT_EQ(db, nullptr);
+}
+
+TEST_F(PldmInstanceDbSharedTest, initForeignSegment)
+{
+    struct pldm_instance_db* db = nullptr;
+    auto fill = [this](size_t len) {
+        std::vector<char> garbage(len, 'x');
+        FILE* f = fopen(shmPath.c_str(), "w");
+
+        ASSERT_NE(f, nullptr);
+        ASSERT_EQ(fwrite(garbage.data(), 1, garbage.size(), f), len);
+        fclose(f);
+    };
+
+    /* Files of another size or layout are rejected and left untouched */
+    fill(16);
+    EXPECT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), -EPROTO);
+    EXPECT_EQ(std::filesystem::file_size(shmPath), 16U);
+
+    fill(1 << 16);
+    EXPECT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), -EPROTO);
+    EXPECT_EQ(db, nullptr);
+
+    /* A new segment is stamped, and then accepted by others */
+    std::filesystem::remove(shmPath);
+    ASSERT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+    db = nullptr;
+    ASSERT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST_F(PldmInstanceDbSharedTest, allocDistinctAcrossObjects)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    std::array<pldm_instance_id_t, pldmMaxInstanceIds> iids = {};
+    struct pldm_instance_db* a = nullptr;
+    struct pldm_instance_db* b = nullptr;
+    pldm_instance_id_t extra;
+    uint32_t seen = 0;
+
+    ASSERT_EQ(pldm_instance_db_init_shared(&a, shmPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_init_shared(&b, shmPath.c_str()), 0);
+
+    /* Allocations alternate between the objects, continuing the sequence */
+    for (size_t i = 0; i < iids.size(); i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(i & 1 ? b : a, tid, &iids[i]), 0);
+        EXPECT_EQ(iids[i], i);
+        seen |= 1UL << iids[i];
+    }
+    EXPECT_EQ(seen, UINT32_MAX);
+
+    EXPECT_EQ(pldm_instance_id_alloc(a, tid, &extra), -EAGAIN);
+    EXPECT_EQ(pldm_instance_id_alloc(b, tid, &extra), -EAGAIN);
+
+    /* An object may only release the IDs allocated through it */
+    EXPECT_EQ(pldm_instance_id_free(b, tid, iids[0]), -EINVAL);
+    EXPECT_EQ(pldm_instance_id_free(a, tid, iids[0]), 0);
+    EXPECT_EQ(pldm_instance_id_free(a, tid, iids[0]), -EINVAL);
+
+    ASSERT_EQ(pldm_instance_id_alloc(b, tid, &extra), 0);
+    EXPECT_EQ(extra, iids[0]);
+
+    /* Destroying an object releases the IDs allocated through it */
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+    a = nullptr;
+    ASSERT_EQ(pldm_instance_db_init_shared(&a, shmPath.c_str()), 0);
+    for (size_t i = 2; i < iids.size(); i += 2)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(a, tid, &extra), 0);
+        EXPECT_EQ(extra % 2, 0);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(a, tid, &extra), -EAGAIN);
+
+    ASSERT_EQ(pldm_instance_db_destroy(b), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+}
+
+TEST_F(PldmInstanceDbSharedTest, reclaimExitedProcess)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+    int status;
+    pid_t pid;
+
+    pid = fork();
+    ASSERT_NE(pid, -1);
+    if (!pid)
+    {
+        struct pldm_instance_db* child = nullptr;
+
+        /* Exhaust the TID, then exit without releasing the IDs */
+        if (pldm_instance_db_init_shared(&child, shmPath.c_str()))
+        {
+            _exit(EXIT_FAILURE);
+        }
+
+        for (int i = 0; i < pldmMaxInstanceIds; i++)
+        {
+            if (pldm_instance_id_alloc(child, tid, &iid))
+            {
+                _exit(EXIT_FAILURE);
+            }
+        }
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+
+    /* The exited process' leases are reclaimed once the TID is exhausted */
+    ASSERT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), 0);
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+/* Mirrors the layout of a shared memory database segment */
+struct SharedTid
+{
+    uint32_t allocations;
+    uint64_t owners[pldmMaxInstanceIds];
+    uint8_t next;
+};
+
+struct SharedDb
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t pidNs;
+    SharedTid tids[PLDM_MAX_TIDS];
+};
+
+TEST_F(PldmInstanceDbSharedTest, reclaimReusedPid)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+    SharedDb* shm;
+    int fd;
+
+    ASSERT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), 0);
+    ASSERT_EQ(std::filesystem::file_size(shmPath), sizeof(SharedDb));
+    fd = open(shmPath.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    shm = static_cast<SharedDb*>(mmap(nullptr, sizeof(SharedDb),
+                                      PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                                      0));
+    close(fd);
+    ASSERT_NE(shm, MAP_FAILED);
+
+    /*
+     * Lease the IDs to an earlier process with our PID. Half were left
+     * between stamping the owner and setting the bit.
+     */
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        shm->tids[tid].owners[i] = (UINT64_C(1) << 22) | ::getpid();
+    }
+    shm->tids[tid].allocations = 0x55555555;
+
+    /* The leases are reclaimed once the TID is exhausted */
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+    EXPECT_EQ(shm->tids[tid].allocations, UINT32_MAX);
+
+    munmap(shm, sizeof(SharedDb));
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST_F(PldmInstanceDbSharedTest, initOtherPidNamespace)
+{
+    struct pldm_instance_db* db = nullptr;
+    int status;
+    pid_t pid;
+
+    ASSERT_EQ(pldm_instance_db_init_shared(&db, shmPath.c_str()), 0);
+
+    pid = fork();
+    ASSERT_NE(pid, -1);
+    if (!pid)
+    {
+        struct pldm_instance_db* child = nullptr;
+        pid_t inner;
+
+        if (unshare(CLONE_NEWPID))
+        {
+            _exit(2);
+        }
+
+        /* Only children of the caller enter the new namespace */
+        inner = fork();
+        if (!inner)
+        {
+            _exit(pldm_instance_db_init_shared(&child, shmPath.c_str()) ==
+                          -EXDEV
+                      ? EXIT_SUCCESS
+                      : EXIT_FAILURE);
+        }
+
+        if (inner < 0 || waitpid(inner, &status, 0) != inner ||
+            !WIFEXITED(status))
+        {
+            _exit(EXIT_FAILURE);
+        }
+        _exit(WEXITSTATUS(status));
+    }
+
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    if (WEXITSTATUS(status) == 2)
+    {
+        GTEST_SKIP() << "Creating a PID namespace isn't permitted";
+    }
+    EXPECT_EQ(WEXITSTATUS(status), EXIT_SUCCESS);
+}
+
+TEST(InstanceId, freeAllForTid)
+{
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+
+    EXPECT_EQ(pldm_instance_id_free_all(nullptr, 1), -EINVAL);
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    for (int i = 0; i < 5; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(db, 1, &iid), 0);
+    }
+    ASSERT_EQ(pldm_instance_id_alloc(db, 2, &iid), 0);
+
+    EXPECT_EQ(pldm_instance_id_free_all(db, 1), 5);
+    EXPECT_EQ(pldm_instance_id_free_all(db, 1), 0);
+
+    /* Other TIDs are unaffected */
+    EXPECT_EQ(pldm_instance_id_free(db, 2, iid), 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST_F(PldmInstanceDbTest, freeAllForTid)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* a = nullptr;
+    struct pldm_instance_db* b = nullptr;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init(&a, dbPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_init(&b, dbPath.c_str()), 0);
+
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(a, tid, &iid), 0);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(b, tid, &iid), -EAGAIN);
+
+    /* The locks are released for other connections */
+    EXPECT_EQ(pldm_instance_id_free_all(a, tid), pldmMaxInstanceIds);
+    EXPECT_EQ(pldm_instance_id_alloc(b, tid, &iid), 0);
+    EXPECT_EQ(pldm_instance_id_free(b, tid, iid), 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(b), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+}
+
+TEST(InstanceId, setExpiryInvalid)
+{
+    struct pldm_instance_db* db = nullptr;
+
+    EXPECT_EQ(pldm_instance_db_set_expiry(nullptr, 5000), -EINVAL);
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    EXPECT_EQ(pldm_instance_db_set_expiry(db, 4999), -EINVAL);
+    EXPECT_EQ(pldm_instance_db_set_expiry(db, 5000), 0);
+    EXPECT_EQ(pldm_instance_db_set_expiry(db, 0), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST(InstanceId, expireLeakedInstanceIds)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    ASSERT_EQ(pldm_instance_db_set_expiry(db, 5000), 0);
+
+    /* Leak every ID for the TID */
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+
+    /* Once PT3 has passed the leaked IDs are reclaimed */
+    clockOffset += 4;
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+    clockOffset += 2;
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+        EXPECT_EQ(iid, i);
+    }
+
+    /* The reclaimed IDs were allocated afresh, so haven't expired */
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+    clockOffset = 0;
+}
+
+TEST(InstanceId, lateFreeAfterExpiry)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    ASSERT_EQ(pldm_instance_db_set_expiry(db, 5000), 0);
+
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    }
+
+    /* Expire the IDs and reallocate the first */
+    clockOffset += 6;
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    ASSERT_EQ(iid, 0);
+
+    /* The original holder's late free leaves the new holder's ID allocated */
+    EXPECT_EQ(pldm_instance_id_free(db, tid, 0), 0);
+    for (int i = 1; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+        EXPECT_EQ(iid, i);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+
+    /* The new holder's free releases it */
+    EXPECT_EQ(pldm_instance_id_free(db, tid, 0), 0);
+    EXPECT_EQ(pldm_instance_id_free(db, tid, 0), -EINVAL);
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    EXPECT_EQ(iid, 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+    clockOffset = 0;
+}
+
+TEST_F(PldmInstanceDbTest, lateFreeAfterExpiry)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* a = nullptr;
+    struct pldm_instance_db* b = nullptr;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init(&a, dbPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_init(&b, dbPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_set_expiry(a, 5000), 0);
+
+    for (int i = 0; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(a, tid, &iid), 0);
+    }
+
+    /* Expire the IDs and reallocate the first */
+    clockOffset += 6;
+    ASSERT_EQ(pldm_instance_id_alloc(a, tid, &iid), 0);
+    ASSERT_EQ(iid, 0);
+
+    /* The late free doesn't drop the lock held for the new holder */
+    EXPECT_EQ(pldm_instance_id_free(a, tid, 0), 0);
+    for (int i = 1; i < pldmMaxInstanceIds; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(b, tid, &iid), 0);
+        EXPECT_EQ(iid, i);
+    }
+    EXPECT_EQ(pldm_instance_id_alloc(b, tid, &iid), -EAGAIN);
+
+    EXPECT_EQ(pldm_instance_id_free(a, tid, 0), 0);
+    ASSERT_EQ(pldm_instance_id_alloc(b, tid, &iid), 0);
+    EXPECT_EQ(iid, 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(b), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+    clockOffset = 0;
+}
+
+TEST(InstanceId, allocBatchInvalid)
+{
+    struct pldm_instance_db* db = nullptr;
+    uint32_t iids;
+
+    EXPECT_EQ(pldm_instance_id_alloc_batch(nullptr, 1, 1, &iids), -EINVAL);
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    EXPECT_EQ(pldm_instance_id_alloc_batch(db, 1, 1, nullptr), -EINVAL);
+    EXPECT_EQ(pldm_instance_id_alloc_batch(db, 1, 0, &iids), -EINVAL);
+    EXPECT_EQ(pldm_instance_id_alloc_batch(db, 1, pldmMaxInstanceIds + 1,
+                                           &iids),
+              -EINVAL);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST(InstanceId, localAllocBatch)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    pldm_instance_id_t iid;
+    uint32_t iids;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    EXPECT_EQ(iid, 0);
+
+    EXPECT_EQ(pldm_instance_id_alloc_batch(db, tid, 8, &iids), 8);
+    EXPECT_EQ(iids, 0x1feU);
+
+    /* The batch continues the sequence of single allocations */
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    EXPECT_EQ(iid, 9);
+
+    /* Fewer IDs than requested may be allocated */
+    EXPECT_EQ(pldm_instance_id_alloc_batch(db, tid, pldmMaxInstanceIds, &iids),
+              22);
+    EXPECT_EQ(iids, 0xfffffc00U);
+    EXPECT_EQ(pldm_instance_id_alloc_batch(db, tid, 1, &iids), -EAGAIN);
+
+    EXPECT_EQ(pldm_instance_id_free_all(db, tid), pldmMaxInstanceIds);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST_F(PldmInstanceDbTest, allocBatchContended)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* a = nullptr;
+    struct pldm_instance_db* b = nullptr;
+    pldm_instance_id_t iid;
+    uint32_t iids;
+
+    ASSERT_EQ(pldm_instance_db_init(&a, dbPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_init(&b, dbPath.c_str()), 0);
+
+    /* Leave IDs 0 and 2 reserved by the second connection */
+    for (int i = 0; i < 3; i++)
+    {
+        ASSERT_EQ(pldm_instance_id_alloc(b, tid, &iid), 0);
+        EXPECT_EQ(iid, i);
+    }
+    ASSERT_EQ(pldm_instance_id_free(b, tid, 1), 0);
+
+    /* The batch skips the IDs reserved elsewhere */
+    EXPECT_EQ(pldm_instance_id_alloc_batch(a, tid, 4, &iids), 4);
+    EXPECT_EQ(iids, 0x3aU);
+
+    /* And the IDs it reserved aren't available to others */
+    ASSERT_EQ(pldm_instance_id_alloc(b, tid, &iid), 0);
+    EXPECT_EQ(iid, 6);
+
+    EXPECT_EQ(pldm_instance_id_free_all(a, tid), 4);
+    EXPECT_EQ(pldm_instance_id_free_all(b, tid), 3);
+
+    /* Released IDs may be allocated again as a single run */
+    EXPECT_EQ(pldm_instance_id_alloc_batch(b, tid, pldmMaxInstanceIds, &iids),
+              pldmMaxInstanceIds);
+    EXPECT_EQ(iids, UINT32_MAX);
+    EXPECT_EQ(pldm_instance_id_alloc(a, tid, &iid), -EAGAIN);
+
+    ASSERT_EQ(pldm_instance_db_destroy(b), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+}
+
+TEST_F(PldmInstanceDbSharedTest, allocBatch)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* a = nullptr;
+    struct pldm_instance_db* b = nullptr;
+    uint32_t first;
+    uint32_t second;
+
+    ASSERT_EQ(pldm_instance_db_init_shared(&a, shmPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_init_shared(&b, shmPath.c_str()), 0);
+
+    EXPECT_EQ(pldm_instance_id_alloc_batch(a, tid, 16, &first), 16);
+    EXPECT_EQ(pldm_instance_id_alloc_batch(b, tid, pldmMaxInstanceIds,
+                                           &second),
+              16);
+    EXPECT_EQ(first & second, 0U);
+    EXPECT_EQ(first | second, UINT32_MAX);
+
+    EXPECT_EQ(pldm_instance_id_free(b, tid, __builtin_ctz(first)), -EINVAL);
+    EXPECT_EQ(pldm_instance_id_free(a, tid, __builtin_ctz(first)), 0);
+
+    ASSERT_EQ(pldm_instance_db_destroy(b), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+}
+TEST(InstanceId, statsInvalid)
+{
+    struct pldm_instance_db* db = nullptr;
+    struct pldm_instance_db_stats stats;
+
+    EXPECT_EQ(pldm_instance_db_stats_enable(nullptr), -EINVAL);
+    EXPECT_EQ(pldm_instance_db_stats_snapshot(nullptr, &stats), -EINVAL);
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    EXPECT_EQ(pldm_instance_db_stats_snapshot(db, &stats), -ENODATA);
+    EXPECT_EQ(pldm_instance_db_stats_snapshot_tid(db, 1, &stats), -ENODATA);
+    ASSERT_EQ(pldm_instance_db_stats_enable(db), 0);
+    EXPECT_EQ(pldm_instance_db_stats_enable(db), -EBUSY);
+    EXPECT_EQ(pldm_instance_db_stats_snapshot(db, nullptr), -EINVAL);
+    pldm_instance_db_stats_disable(db);
+    EXPECT_EQ(pldm_instance_db_stats_snapshot(db, &stats), -ENODATA);
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST(InstanceId, localStats)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* db = nullptr;
+    struct pldm_instance_db_stats stats;
+    pldm_instance_id_t iid;
+    uint32_t iids;
+
+    ASSERT_EQ(pldm_instance_db_init_local(&db), 0);
+    ASSERT_EQ(pldm_instance_db_stats_enable(db), 0);
+
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid, &iid), 0);
+    ASSERT_EQ(pldm_instance_id_alloc_batch(db, tid, 4, &iids), 4);
+    EXPECT_EQ(pldm_instance_id_free_all(db, tid), 5);
+
+    /* Fill the TID, wrapping around the search */
+    ASSERT_EQ(pldm_instance_id_alloc_batch(db, tid, pldmMaxInstanceIds, &iids),
+              pldmMaxInstanceIds);
+    EXPECT_EQ(pldm_instance_id_alloc(db, tid, &iid), -EAGAIN);
+
+    ASSERT_EQ(pldm_instance_db_stats_snapshot_tid(db, tid, &stats), 0);
+    EXPECT_EQ(stats.allocs, 37U);
+    EXPECT_EQ(stats.probes, 37U);
+    EXPECT_EQ(stats.eagain, 1U);
+    EXPECT_EQ(stats.lock_calls, 0U);
+    EXPECT_EQ(stats.peak, static_cast<uint64_t>(pldmMaxInstanceIds));
+
+    /* Other TIDs are unaffected */
+    ASSERT_EQ(pldm_instance_id_alloc(db, tid + 1, &iid), 0);
+    ASSERT_EQ(pldm_instance_db_stats_snapshot_tid(db, tid + 1, &stats), 0);
+    EXPECT_EQ(stats.allocs, 1U);
+    EXPECT_EQ(stats.peak, 1U);
+
+    /* The totals sum the counters, but not the peaks */
+    ASSERT_EQ(pldm_instance_db_stats_snapshot(db, &stats), 0);
+    EXPECT_EQ(stats.allocs, 38U);
+    EXPECT_EQ(stats.eagain, 1U);
+    EXPECT_EQ(stats.peak, static_cast<uint64_t>(pldmMaxInstanceIds));
+
+    ASSERT_EQ(pldm_instance_db_destroy(db), 0);
+}
+
+TEST_F(PldmInstanceDbTest, statsLockCalls)
+{
+    static constexpr pldm_tid_t tid = 1;
+
+    struct pldm_instance_db* a = nullptr;
+    struct pldm_instance_db* b = nullptr;
+    struct pldm_instance_db_stats stats;
+    pldm_instance_id_t iid;
+
+    ASSERT_EQ(pldm_instance_db_init(&a, dbPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_db_init(&b, dbPath.c_str()), 0);
+    ASSERT_EQ(pldm_instance_id_alloc(b, tid, &iid), 0);
+    ASSERT_EQ(iid, 0);
+
+    ASSERT_EQ(pldm_instance_db_stats_enable(a), 0);
+    ASSERT_EQ(pldm_instance_id_alloc(a, tid, &iid), 0);
+    EXPECT_EQ(iid, 1);
+
+    /* The ID reserved by the other connection was probed and skipped */
+    ASSERT_EQ(pldm_instance_db_stats_snapshot(a, &stats), 0);
+    EXPECT_EQ(stats.allocs, 1U);
+    EXPECT_EQ(stats.probes, 2U);
+    EXPECT_EQ(stats.eagain, 0U);
+    EXPECT_EQ(stats.lock_calls, 5U);
+    EXPECT_GT(stats.lock_ns, 0U);
+
+    ASSERT_EQ(pldm_instance_id_free(a, tid, iid), 0);
+    ASSERT_EQ(pldm_instance_db_stats_snapshot(a, &stats), 0);
+    EXPECT_EQ(stats.lock_calls, 6U);
+
+    ASSERT_EQ(pldm_instance_db_destroy(b), 0);
+    ASSERT_EQ(pldm_instance_db_destroy(a), 0);
+}
+
+#endif
@@ -1,59 +1,60 @@
 // NOLINTNEXTLINE(bugprone-suspicious-include)
 #include "responder.c"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
 TEST(Responder, track_untrack_one)
 {
-    struct pldm_responder_cookie jar{};
+    struct pldm_responder_cookie_jar jar{};
     struct pldm_responder_cookie cookie = {
         .tid = 1,
         .instance_id = 1,
         .type = 0,
         .command = 0x01, /* SetTID */
         .next = nullptr,
+        .older = nullptr,
+        .newer = nullptr,
     };
 
     ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookie), 0);
-    ASSERT_NE(jar.next, nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), &cookie);
-    ASSERT_EQ(jar.next, nullptr);
+    ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), nullptr);
 }
 
 TEST(Responder, untrack_none)
 {
-    struct pldm_responder_cookie jar{};
+    struct pldm_responder_cookie_jar jar{};
 
-    ASSERT_EQ(jar.next, nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), nullptr);
-    ASSERT_EQ(jar.next, nullptr);
 }
 
 TEST(Responder, track_one_untrack_bad)
 {
-    struct pldm_responder_cookie jar{};
+    struct pldm_responder_cookie_jar jar{};
     struct pldm_responder_cookie cookie = {
         .tid = 1,
         .instance_id = 1,
         .type = 0,
         .command = 0x01, /* SetTID */
         .next = nullptr,
+        .older = nullptr,
+        .newer = nullptr,
     };
 
     ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookie), 0);
-    ASSERT_NE(jar.next, nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 2, 1, 0, 0x01), nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 2, 0, 0x01), nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 1, 0x01), nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x02), nullptr);
-    ASSERT_NE(jar.next, nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), &cookie);
-    ASSERT_EQ(jar.next, nullptr);
+    ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), nullptr);
 }
 
 TEST(Responder, track_untrack_two)
 {
-    struct pldm_responder_cookie jar{};
+    struct pldm_responder_cookie_jar jar{};
     struct pldm_responder_cookie cookies[] = {
         {
             .tid = 1,
@@ -61,6 +62,8 @@ TEST(Responder, track_untrack_two)
             .type = 0,
             .command = 0x01, /* SetTID */
             .next = nullptr,
+            .older = nullptr,
+            .newer = nullptr,
         },
         {
             .tid = 2,
@@ -68,13 +71,172 @@ TEST(Responder, track_untrack_two)
             .type = 0,
             .command = 0x01, /* SetTID */
             .next = nullptr,
+            .older = nullptr,
+            .newer = nullptr,
         },
     };
 
     ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookies[0]), 0);
     ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookies[1]), 0);
-    ASSERT_NE(jar.next, nullptr);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 2, 1, 0, 0x01), &cookies[1]);
     ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), &cookies[0]);
-    ASSERT_EQ(jar.next, nullptr);
+    ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), nullptr);
+}
+
+TEST(Responder, track_duplicate)
+{
+    struct pldm_responder_cookie_jar jar{};
+    struct pldm_responder_cookie cookies[2] = {};
+
+    for (auto& cookie : cookies)
+    {
+        cookie.tid = 1;
+        cookie.instance_id = 1;
+        cookie.command = 0x01; /* SetTID */
+    }
+
+    ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookies[0]), 0);
+    ASSERT_NE(pldm_responder_cookie_track(&jar, &cookies[0]), 0);
+
+    /* A request reusing the key replaces the unanswered one */
+    ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookies[1]), 0);
+    ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), &cookies[1]);
+    ASSERT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0x01), nullptr);
+}
+
+TEST(Responder, jar_slab)
+{
+    struct pldm_responder_cookie_jar jar{};
+    struct pldm_responder_cookie* cookies[4];
+
+    ASSERT_EQ(pldm_responder_cookie_jar_init(&jar, 1, 4), -EINVAL);
+    ASSERT_EQ(pldm_responder_cookie_jar_init(
+                  &jar, sizeof(struct pldm_responder_cookie) + 4, 4),
+              0);
+    ASSERT_EQ(pldm_responder_cookie_jar_init(
+                  &jar, sizeof(struct pldm_responder_cookie), 4),
+              -EBUSY);
+
+    for (auto& cookie : cookies)
+    {
+        cookie = pldm_responder_cookie_alloc(&jar);
+        ASSERT_NE(cookie, nullptr);
+    }
+    EXPECT_EQ(pldm_responder_cookie_alloc(&jar), nullptr);
+
+    pldm_responder_cookie_free(&jar, cookies[2]);
+    EXPECT_EQ(pldm_responder_cookie_alloc(&jar), cookies[2]);
+
+    pldm_responder_cookie_jar_fini(&jar);
+}
+
+TEST(Responder, jar_reclaim)
+{
+    struct pldm_responder_cookie_jar jar{};
+    struct pldm_responder_cookie* cookies[4];
+    struct pldm_responder_cookie* cookie;
+
+    ASSERT_EQ(pldm_responder_cookie_jar_init(
+                  &jar, sizeof(struct pldm_responder_cookie), 4),
+              0);
+
+    for (size_t i = 0; i < 4; i++)
+    {
+        cookies[i] = pldm_responder_cookie_alloc(&jar);
+        ASSERT_NE(cookies[i], nullptr);
+        cookies[i]->tid = 1;
+        cookies[i]->instance_id = i;
+        cookies[i]->type = 0;
+        cookies[i]->command = 0;
+        ASSERT_EQ(pldm_responder_cookie_track(&jar, cookies[i]), 0);
+    }
+
+    /* The slab is exhausted, so the oldest request is abandoned */
+    cookie = pldm_responder_cookie_alloc(&jar);
+    EXPECT_EQ(cookie, cookies[0]);
+    EXPECT_EQ(pldm_responder_cookie_untrack(&jar, 1, 0, 0, 0), nullptr);
+
+    /* Replacing a cookie returns the stale one to the slab */
+    cookie->tid = 1;
+    cookie->instance_id = 1;
+    ASSERT_EQ(pldm_responder_cookie_track(&jar, cookie), 0);
+    EXPECT_EQ(pldm_responder_cookie_alloc(&jar), cookies[1]);
+    EXPECT_EQ(pldm_responder_cookie_untrack(&jar, 1, 1, 0, 0), cookie);
+
+    /* The next oldest follows */
+    EXPECT_EQ(pldm_responder_cookie_alloc(&jar), cookies[2]);
+    EXPECT_EQ(pldm_responder_cookie_untrack(&jar, 1, 3, 0, 0), cookies[3]);
+    EXPECT_EQ(pldm_responder_cookie_alloc(&jar), nullptr);
+    EXPECT_EQ(jar.oldest, nullptr);
+    EXPECT_EQ(jar.newest, nullptr);
+
+    pldm_responder_cookie_jar_fini(&jar);
+}
+
+/* A transport's jar keeps accepting requests that are never answered */
+TEST(Responder, unanswered_requests)
+{
+    constexpr int count = 512;
+    struct pldm_responder_cookie_jar jar{};
+    struct pldm_responder_cookie* cookie;
+
+    ASSERT_EQ(pldm_responder_cookie_jar_init(
+                  &jar, sizeof(struct pldm_responder_cookie), count),
+              0);
+
+    /* Accept requests as af-mctp does, never responding */
+    for (int i = 0; i < 3 * count; i++)
+    {
+        cookie = pldm_responder_cookie_alloc(&jar);
+        ASSERT_NE(cookie, nullptr);
+        cookie->tid = 1;
+        cookie->instance_id = i % 32;
+        cookie->type = 0;
+        cookie->command = i / 32;
+        ASSERT_EQ(pldm_responder_cookie_track(&jar, cookie), 0);
+    }
+
+    /* The newest requests can still be answered, the older can't */
+    EXPECT_EQ(pldm_responder_cookie_untrack(&jar, 1, 31, 0, 2 * count / 32 - 1),
+              nullptr);
+    cookie = pldm_responder_cookie_untrack(&jar, 1, 0, 0, 2 * count / 32);
+    ASSERT_NE(cookie, nullptr);
+    pldm_responder_cookie_free(&jar, cookie);
+
+    pldm_responder_cookie_jar_fini(&jar);
+}
+
+/* Many outstanding requests share buckets without being confused */
+TEST(Responder, track_untrack_many)
+{
+    struct pldm_responder_cookie_jar jar{};
+    std::vector<struct pldm_responder_cookie> cookies;
+
+    for (int tid = 1; tid <= 16; tid++)
+    {
+        for (int iid = 0; iid <= PLDM_INSTANCE_MAX; iid++)
+        {
+            cookies.push_back({static_cast<pldm_tid_t>(tid),
+                               static_cast<pldm_instance_id_t>(iid), 2, 0x11,
+                               nullptr, nullptr, nullptr});
+        }
+    }
+
+    for (auto& cookie : cookies)
+    {
+        ASSERT_EQ(pldm_responder_cookie_track(&jar, &cookie), 0);
+    }
+
+    /* Untrack in reverse to exercise removal from the middle of chains */
+    for (auto it = cookies.rbegin(); it != cookies.rend(); it++)
+    {
+        EXPECT_EQ(pldm_responder_cookie_untrack(&jar, it->tid, it->instance_id,
+                                                2, 0x11),
+                  &*it);
+    }
+
+    for (auto* bucket : jar.buckets)
+    {
+        EXPECT_EQ(bucket, nullptr);
+    }
 }
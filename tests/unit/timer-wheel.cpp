@@ -0,0 +1,127 @@
+// NOLINTNEXTLINE(bugprone-suspicious-include)
+#include "requester/timer-wheel.c"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static std::vector<struct pldm_timer*> collect(struct pldm_timer* list)
+{
+    std::vector<struct pldm_timer*> timers;
+
+    for (; list; list = list->next)
+    {
+        timers.push_back(list);
+    }
+
+    return timers;
+}
+
+TEST(TimerWheel, empty)
+{
+    struct pldm_timer_wheel wheel;
+    uint64_t tick;
+
+    pldm_timer_wheel_init(&wheel, 1000);
+    EXPECT_FALSE(pldm_timer_wheel_next(&wheel, &tick));
+    EXPECT_EQ(pldm_timer_wheel_advance(&wheel, 5000), nullptr);
+    EXPECT_EQ(wheel.now, 5000);
+}
+
+TEST(TimerWheel, expire_level_zero)
+{
+    struct pldm_timer_wheel wheel;
+    struct pldm_timer timer{};
+    uint64_t tick;
+
+    pldm_timer_wheel_init(&wheel, 1000);
+    pldm_timer_wheel_add(&wheel, &timer, 1010);
+    EXPECT_TRUE(pldm_timer_pending(&timer));
+    ASSERT_TRUE(pldm_timer_wheel_next(&wheel, &tick));
+    EXPECT_EQ(tick, 1010);
+    EXPECT_EQ(pldm_timer_wheel_advance(&wheel, 1009), nullptr);
+    EXPECT_EQ(collect(pldm_timer_wheel_advance(&wheel, 1010)),
+              std::vector<struct pldm_timer*>{&timer});
+    EXPECT_FALSE(pldm_timer_pending(&timer));
+    EXPECT_FALSE(pldm_timer_wheel_next(&wheel, &tick));
+}
+
+TEST(TimerWheel, expire_overdue)
+{
+    struct pldm_timer_wheel wheel;
+    struct pldm_timer timer{};
+
+    pldm_timer_wheel_init(&wheel, 1000);
+    pldm_timer_wheel_add(&wheel, &timer, 10);
+    EXPECT_EQ(collect(pldm_timer_wheel_advance(&wheel, 1001)),
+              std::vector<struct pldm_timer*>{&timer});
+}
+
+TEST(TimerWheel, cascade_preserves_expiry)
+{
+    static constexpr uint64_t expiries[] = {
+        64, 70, 100, 4095, 4096, 4800, 300000, 20000000,
+    };
+    struct pldm_timer timers[std::size(expiries)]{};
+    struct pldm_timer_wheel wheel;
+
+    pldm_timer_wheel_init(&wheel, 0);
+    for (size_t i = 0; i < std::size(expiries); i++)
+    {
+        pldm_timer_wheel_add(&wheel, &timers[i], expiries[i]);
+    }
+
+    for (size_t i = 0; i < std::size(expiries); i++)
+    {
+        uint64_t tick;
+
+        ASSERT_EQ(pldm_timer_wheel_advance(&wheel, expiries[i] - 1), nullptr);
+
+        /* The lower bound must never skip past the expiry */
+        ASSERT_TRUE(pldm_timer_wheel_next(&wheel, &tick));
+        EXPECT_LE(tick, expiries[i]);
+
+        EXPECT_EQ(collect(pldm_timer_wheel_advance(&wheel, expiries[i])),
+                  std::vector<struct pldm_timer*>{&timers[i]});
+    }
+
+    EXPECT_EQ(wheel.count, 0);
+}
+
+TEST(TimerWheel, next_accounts_for_cascade)
+{
+    struct pldm_timer_wheel wheel;
+    struct pldm_timer early{};
+    struct pldm_timer late{};
+    uint64_t tick;
+
+    pldm_timer_wheel_init(&wheel, 0);
+    /* Lands on level 1, due before the level 0 timer added below */
+    pldm_timer_wheel_add(&wheel, &early, 70);
+    ASSERT_EQ(pldm_timer_wheel_advance(&wheel, 40), nullptr);
+    pldm_timer_wheel_add(&wheel, &late, 100);
+
+    ASSERT_TRUE(pldm_timer_wheel_next(&wheel, &tick));
+    EXPECT_LE(tick, 70);
+    EXPECT_EQ(collect(pldm_timer_wheel_advance(&wheel, 70)),
+              std::vector<struct pldm_timer*>{&early});
+    EXPECT_EQ(collect(pldm_timer_wheel_advance(&wheel, 100)),
+              std::vector<struct pldm_timer*>{&late});
+}
+
+TEST(TimerWheel, del)
+{
+    struct pldm_timer_wheel wheel;
+    struct pldm_timer first{};
+    struct pldm_timer second{};
+
+    pldm_timer_wheel_init(&wheel, 0);
+    pldm_timer_wheel_add(&wheel, &first, 10);
+    pldm_timer_wheel_add(&wheel, &second, 10);
+    pldm_timer_wheel_del(&wheel, &first);
+    EXPECT_FALSE(pldm_timer_pending(&first));
+    pldm_timer_wheel_del(&wheel, &first);
+    EXPECT_EQ(collect(pldm_timer_wheel_advance(&wheel, 10)),
+              std::vector<struct pldm_timer*>{&second});
+    EXPECT_EQ(wheel.count, 0);
+}
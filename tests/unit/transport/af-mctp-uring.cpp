@@ -0,0 +1,301 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/af-mctp.h>
+
+#include "mctp-defines.h"
+#include "transport/af-mctp-internal.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+class AfMctpUring : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        const struct sockaddr_mctp peer = {
+            .smctp_family = AF_MCTP,
+            .__smctp_pad0 = 0,
+            .smctp_network = 1,
+            .smctp_addr = {.s_addr = 8},
+            .smctp_type = MCTP_MSG_TYPE_PLDM,
+            .smctp_tag = MCTP_TAG_OWNER,
+            .__smctp_pad1 = 0,
+        };
+        int rc;
+
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair.data()), 0);
+        ASSERT_EQ(pldm_transport_af_mctp_init_standin(&ctx, pair[0], &peer),
+                  0);
+        ASSERT_EQ(pldm_transport_af_mctp_map_tid_fqe(ctx, 1, 1, 8), 0);
+
+        rc = pldm_transport_af_mctp_enable_uring(ctx, 64);
+        if (rc == -EOPNOTSUPP)
+        {
+            GTEST_SKIP() << "io_uring is unavailable";
+        }
+        ASSERT_EQ(rc, 0);
+    }
+
+    void TearDown() override
+    {
+        pldm_transport_af_mctp_destroy(ctx);
+        close(pair[0]);
+        close(pair[1]);
+    }
+
+    void inject(uint8_t command)
+    {
+        const uint8_t msg[] = {0x01, 0x00, command};
+
+        ASSERT_EQ(write(pair[1], msg, sizeof(msg)), (ssize_t)sizeof(msg));
+    }
+
+    bool ready(int timeout)
+    {
+        struct pollfd pollfd;
+
+        EXPECT_EQ(pldm_transport_af_mctp_init_pollfd(transport(), &pollfd), 0);
+
+        return poll(&pollfd, 1, timeout) == 1;
+    }
+
+    struct pldm_transport* transport()
+    {
+        return pldm_transport_af_mctp_core(ctx);
+    }
+
+    struct pldm_transport_af_mctp* ctx = nullptr;
+    std::array<int, 2> pair{};
+};
+
+TEST(AfMctpUringEnable, invalid)
+{
+    struct pldm_transport_af_mctp* ctx = nullptr;
+    const struct sockaddr_mctp peer{};
+    std::array<int, 2> pair{};
+    int rc;
+
+    EXPECT_EQ(pldm_transport_af_mctp_enable_uring(nullptr, 64), -EINVAL);
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair.data()), 0);
+    ASSERT_EQ(pldm_transport_af_mctp_init_standin(&ctx, pair[0], &peer), 0);
+
+    EXPECT_EQ(pldm_transport_af_mctp_enable_uring(ctx, 2), -EINVAL);
+
+    rc = pldm_transport_af_mctp_enable_uring(ctx, 64);
+    if (rc == 0)
+    {
+        EXPECT_EQ(pldm_transport_af_mctp_enable_uring(ctx, 64), -EBUSY);
+    }
+    else
+    {
+        EXPECT_EQ(rc, -EOPNOTSUPP);
+    }
+
+    pldm_transport_af_mctp_destroy(ctx);
+    close(pair[0]);
+    close(pair[1]);
+}
+
+/* Whether io_uring can be enabled on an idle socket */
+static bool uringAvailable()
+{
+    struct pldm_transport_af_mctp* ctx = nullptr;
+    const struct sockaddr_mctp peer{};
+    std::array<int, 2> pair{};
+    int rc;
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair.data()))
+    {
+        return false;
+    }
+
+    rc = pldm_transport_af_mctp_init_standin(&ctx, pair[0], &peer);
+    if (!rc)
+    {
+        rc = pldm_transport_af_mctp_enable_uring(ctx, 64);
+        pldm_transport_af_mctp_destroy(ctx);
+    }
+    close(pair[0]);
+    close(pair[1]);
+
+    return !rc;
+}
+
+TEST(AfMctpUringEnable, queued_message)
+{
+    const struct sockaddr_mctp peer = {
+        .smctp_family = AF_MCTP,
+        .__smctp_pad0 = 0,
+        .smctp_network = 1,
+        .smctp_addr = {.s_addr = 8},
+        .smctp_type = MCTP_MSG_TYPE_PLDM,
+        .smctp_tag = MCTP_TAG_OWNER,
+        .__smctp_pad1 = 0,
+    };
+    const uint8_t req[] = {0x01, 0x00, 0x02};
+    struct pldm_transport_af_mctp* ctx = nullptr;
+    std::array<int, 2> pair{};
+    void* msg = nullptr;
+    size_t len = 0;
+    pldm_tid_t tid;
+
+    if (!uringAvailable())
+    {
+        GTEST_SKIP() << "io_uring is unavailable";
+    }
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair.data()), 0);
+    ASSERT_EQ(pldm_transport_af_mctp_init_standin(&ctx, pair[0], &peer), 0);
+    ASSERT_EQ(pldm_transport_af_mctp_map_tid_fqe(ctx, 1, 1, 8), 0);
+
+    /* A message waiting on the socket completes the receive at once */
+    ASSERT_EQ(write(pair[1], req, sizeof(req)), (ssize_t)sizeof(req));
+    ASSERT_EQ(pldm_transport_af_mctp_enable_uring(ctx, 64), 0);
+
+    ASSERT_EQ(pldm_transport_recv_msg(pldm_transport_af_mctp_core(ctx), &tid,
+                                      &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 1);
+    EXPECT_EQ(len, sizeof(req));
+    free(msg);
+
+    pldm_transport_af_mctp_destroy(ctx);
+    close(pair[0]);
+    close(pair[1]);
+}
+
+TEST_F(AfMctpUring, recv_without_blocking)
+{
+    void* msg = nullptr;
+    size_t len = 0;
+    pldm_tid_t tid;
+
+    errno = 0;
+    EXPECT_EQ(pldm_transport_recv_msg(transport(), &tid, &msg, &len),
+              PLDM_REQUESTER_RECV_FAIL);
+    EXPECT_EQ(errno, EAGAIN);
+
+    inject(0x02);
+    ASSERT_TRUE(ready(1000));
+    ASSERT_EQ(pldm_transport_recv_msg(transport(), &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 1);
+    ASSERT_EQ(len, 3);
+    EXPECT_EQ(static_cast<uint8_t*>(msg)[2], 0x02);
+    free(msg);
+}
+
+TEST_F(AfMctpUring, recv_batch)
+{
+    std::array<std::array<uint8_t, 16>, 4> bufs{};
+    std::array<struct pldm_transport_msg, 4> msgs{};
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        inject(i);
+    }
+
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        msgs[i].msg = bufs[i].data();
+        msgs[i].len = bufs[i].size();
+    }
+
+    ASSERT_TRUE(ready(1000));
+    ASSERT_EQ(pldm_transport_recv_batch(transport(), msgs.data(), msgs.size()),
+              3);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(msgs[i].tid, 1);
+        EXPECT_EQ(msgs[i].len, 3);
+        EXPECT_EQ(bufs[i][2], i);
+    }
+
+    EXPECT_EQ(pldm_transport_recv_batch(transport(), msgs.data(), msgs.size()),
+              -EAGAIN);
+}
+
+TEST_F(AfMctpUring, recv_recycles_buffers)
+{
+    void* msg = nullptr;
+    size_t len = 0;
+    pldm_tid_t tid;
+
+    /* Exceed the provided buffer count so the receive must be re-armed */
+    for (int round = 0; round < 3; round++)
+    {
+        for (int i = 0; i < 48; i++)
+        {
+            inject(i);
+        }
+
+        for (int i = 0; i < 48; i++)
+        {
+            if (pldm_transport_recv_msg(transport(), &tid, &msg, &len) !=
+                PLDM_REQUESTER_SUCCESS)
+            {
+                ASSERT_TRUE(ready(1000));
+                ASSERT_EQ(
+                    pldm_transport_recv_msg(transport(), &tid, &msg, &len),
+                    PLDM_REQUESTER_SUCCESS);
+            }
+            ASSERT_EQ(len, 3);
+            EXPECT_EQ(static_cast<uint8_t*>(msg)[2], i);
+            free(msg);
+        }
+    }
+}
+
+TEST_F(AfMctpUring, send)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    uint8_t buf[16];
+
+    ASSERT_EQ(pldm_transport_send_msg(transport(), 1, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(read(pair[1], buf, sizeof(buf)), (ssize_t)sizeof(req));
+    EXPECT_EQ(memcmp(buf, req, sizeof(req)), 0);
+
+    /* Invalid TIDs and oversized messages are rejected */
+    EXPECT_EQ(pldm_transport_send_msg(transport(), 0, req, sizeof(req)),
+              PLDM_REQUESTER_SEND_FAIL);
+    std::vector<uint8_t> large(65, 0x81);
+    EXPECT_EQ(
+        pldm_transport_send_msg(transport(), 1, large.data(), large.size()),
+        PLDM_REQUESTER_SEND_FAIL);
+}
+
+TEST_F(AfMctpUring, send_batch)
+{
+    const uint8_t hdr[] = {0x81, 0x00};
+    std::array<uint8_t, 3> cmds{0x01, 0x02, 0x03};
+    std::array<std::array<struct iovec, 2>, 3> iovs{};
+    std::array<struct pldm_transport_msgv, 3> msgs{};
+    uint8_t buf[16];
+
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        iovs[i][0] = {const_cast<uint8_t*>(hdr), sizeof(hdr)};
+        iovs[i][1] = {&cmds[i], 1};
+        msgs[i] = {iovs[i].data(), iovs[i].size(), 1};
+    }
+
+    ASSERT_EQ(pldm_transport_send_batch(transport(), msgs.data(), msgs.size()),
+              3);
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        ASSERT_EQ(read(pair[1], buf, sizeof(buf)), 3);
+        EXPECT_EQ(buf[2], cmds[i]);
+    }
+}
+#endif
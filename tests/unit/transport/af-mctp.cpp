@@ -93,3 +93,76 @@ TEST(AfMctpTidLookup, exact_network_preferred_over_any_net)
         pldm_transport_af_mctp_get_tid(&ctx, network, unmappedEid, &found3), 0);
 }
 #endif
+
+/* Remapping and unmapping keep lookups consistent with the TID map */
+#if HAVE_LIBPLDM_API_TESTING
+TEST(AfMctpTidLookup, remap_and_unmap)
+{
+    struct pldm_transport_af_mctp ctx{};
+    constexpr uint32_t network = 7;
+    constexpr mctp_eid_t eid = 8;
+    constexpr mctp_eid_t otherEid = 9;
+    pldm_tid_t found = 0;
+
+    ASSERT_EQ(pldm_transport_af_mctp_map_tid_fqe(&ctx, 3, network, eid), 0);
+    ASSERT_EQ(pldm_transport_af_mctp_map_tid_fqe(&ctx, 2, network, eid), 0);
+
+    /* The lowest TID mapped to an address is resolved */
+    EXPECT_EQ(pldm_transport_af_mctp_get_tid(&ctx, network, eid, &found), 0);
+    EXPECT_EQ(found, 2);
+
+    /* Moving TID 2 away exposes TID 3 */
+    ASSERT_EQ(
+        pldm_transport_af_mctp_map_tid_fqe(&ctx, 2, network, otherEid), 0);
+    EXPECT_EQ(pldm_transport_af_mctp_get_tid(&ctx, network, eid, &found), 0);
+    EXPECT_EQ(found, 3);
+    EXPECT_EQ(
+        pldm_transport_af_mctp_get_tid(&ctx, network, otherEid, &found), 0);
+    EXPECT_EQ(found, 2);
+
+    ASSERT_EQ(pldm_transport_af_mctp_unmap_tid_fqe(&ctx, 3), 0);
+    EXPECT_NE(pldm_transport_af_mctp_get_tid(&ctx, network, eid, &found), 0);
+
+    ASSERT_EQ(pldm_transport_af_mctp_unmap_tid(&ctx, 2, otherEid), 0);
+    EXPECT_NE(
+        pldm_transport_af_mctp_get_tid(&ctx, network, otherEid, &found), 0);
+}
+#endif
+
+/* Lookups remain correct with every TID mapped and entries removed */
+#if HAVE_LIBPLDM_API_TESTING
+TEST(AfMctpTidLookup, full_map)
+{
+    struct pldm_transport_af_mctp ctx{};
+    pldm_tid_t found = 0;
+
+    for (int tid = 1; tid < PLDM_MAX_TIDS; tid++)
+    {
+        ASSERT_EQ(pldm_transport_af_mctp_map_tid_fqe(&ctx, tid, 1 + tid % 3,
+                                                     tid),
+                  0);
+    }
+
+    /* Remove every other mapping to exercise deletion from probe chains */
+    for (int tid = 1; tid < PLDM_MAX_TIDS; tid += 2)
+    {
+        ASSERT_EQ(pldm_transport_af_mctp_unmap_tid_fqe(&ctx, tid), 0);
+    }
+
+    for (int tid = 1; tid < PLDM_MAX_TIDS; tid++)
+    {
+        int rc = pldm_transport_af_mctp_get_tid(&ctx, 1 + tid % 3, tid,
+                                                &found);
+
+        if (tid % 2)
+        {
+            EXPECT_NE(rc, 0);
+        }
+        else
+        {
+            ASSERT_EQ(rc, 0);
+            EXPECT_EQ(found, tid);
+        }
+    }
+}
+#endif
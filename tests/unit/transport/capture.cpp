@@ -0,0 +1,231 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/capture.h>
+#include <libpldm/transport/loopback.h>
+
+#include "transport/replay.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+class Capture : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        fd = memfd_create("capture", MFD_CLOEXEC);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(pldm_transport_loopback_init_pair(&a, 1, &b, 2, 16), 0);
+    }
+
+    void TearDown() override
+    {
+        free(seq);
+        pldm_transport_loopback_destroy(a);
+        pldm_transport_loopback_destroy(b);
+        close(fd);
+    }
+
+    void load()
+    {
+        free(seq);
+        seq = nullptr;
+        ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+        ASSERT_EQ(pldm_transport_replay_load(fd, 0, &seq, &count), 0);
+    }
+
+    static void expectSend(const struct pldm_transport_test_descriptor& desc,
+                           pldm_tid_t dst, const void* msg, size_t len)
+    {
+        ASSERT_EQ(desc.type, PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND);
+        EXPECT_EQ(desc.send_msg.dst, dst);
+        ASSERT_EQ(desc.send_msg.len, len);
+        EXPECT_EQ(memcmp(desc.send_msg.msg, msg, len), 0);
+    }
+
+    static void expectRecv(const struct pldm_transport_test_descriptor& desc,
+                           pldm_tid_t src, const void* msg, size_t len)
+    {
+        ASSERT_EQ(desc.type, PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV);
+        EXPECT_EQ(desc.recv_msg.src, src);
+        ASSERT_EQ(desc.recv_msg.len, len);
+        EXPECT_EQ(memcmp(desc.recv_msg.msg, msg, len), 0);
+    }
+
+    struct pldm_transport_loopback* a = nullptr;
+    struct pldm_transport_loopback* b = nullptr;
+    struct pldm_transport_test_descriptor* seq = nullptr;
+    size_t count = 0;
+    int fd = -1;
+};
+
+TEST_F(Capture, invalid)
+{
+    struct pldm_transport_capture* capture = nullptr;
+
+    EXPECT_EQ(pldm_transport_capture_init(nullptr,
+                                          pldm_transport_loopback_core(a), fd),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_capture_init(&capture, nullptr, fd), -EINVAL);
+    EXPECT_EQ(pldm_transport_capture_init(&capture,
+                                          pldm_transport_loopback_core(a), -1),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_capture_flush(nullptr), -EINVAL);
+    pldm_transport_capture_destroy(nullptr);
+}
+
+TEST_F(Capture, records_traffic)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    const uint8_t resp[] = {0x01, 0x00, 0x02, 0x00, 0x02};
+    struct pldm_transport_capture* capture = nullptr;
+    struct pldm_transport* ta;
+    struct pldm_transport* tb = pldm_transport_loopback_core(b);
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_capture_init(
+                  &capture, pldm_transport_loopback_core(a), fd),
+              0);
+    ta = pldm_transport_capture_core(capture);
+
+    ASSERT_EQ(pldm_transport_send_msg(ta, 2, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(pldm_transport_recv_msg(tb, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(msg);
+    ASSERT_EQ(pldm_transport_send_msg(tb, 1, resp, sizeof(resp)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(pldm_transport_recv_msg(ta, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(msg);
+
+    /* Failed sends aren't recorded */
+    EXPECT_EQ(pldm_transport_send_msg(ta, 3, req, sizeof(req)),
+              PLDM_REQUESTER_SEND_FAIL);
+
+    /* Records stay buffered until flushed */
+    EXPECT_EQ(lseek(fd, 0, SEEK_END), 16);
+    EXPECT_EQ(pldm_transport_capture_flush(capture), 0);
+    pldm_transport_capture_destroy(capture);
+
+    load();
+    ASSERT_EQ(count, 2);
+    expectSend(seq[0], 2, req, sizeof(req));
+    expectRecv(seq[1], 2, resp, sizeof(resp));
+}
+
+TEST_F(Capture, records_batches)
+{
+    const uint8_t hdr[] = {0x81, 0x00};
+    std::array<uint8_t, 2> cmds{0x01, 0x02};
+    std::array<std::array<struct iovec, 2>, 2> iovs{};
+    std::array<struct pldm_transport_msgv, 2> out{};
+    std::array<std::array<uint8_t, 8>, 2> bufs{};
+    std::array<struct pldm_transport_msg, 2> in{};
+    struct pldm_transport_capture* capture = nullptr;
+    struct pldm_transport* tb;
+
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        iovs[i][0] = {const_cast<uint8_t*>(hdr), sizeof(hdr)};
+        iovs[i][1] = {&cmds[i], 1};
+        out[i] = {iovs[i].data(), iovs[i].size(), 1};
+        in[i] = {bufs[i].data(), bufs[i].size(), 0};
+    }
+
+    ASSERT_EQ(pldm_transport_capture_init(
+                  &capture, pldm_transport_loopback_core(b), fd),
+              0);
+    tb = pldm_transport_capture_core(capture);
+
+    ASSERT_EQ(pldm_transport_send_batch(tb, out.data(), out.size()), 2);
+    ASSERT_EQ(pldm_transport_recv_batch(pldm_transport_loopback_core(a),
+                                        in.data(), in.size()),
+              2);
+    for (auto& msg : out)
+    {
+        msg.tid = 2;
+    }
+    ASSERT_EQ(pldm_transport_send_batch(pldm_transport_loopback_core(a),
+                                        out.data(), out.size()),
+              2);
+    ASSERT_EQ(pldm_transport_recv_batch(tb, in.data(), in.size()), 2);
+    pldm_transport_capture_destroy(capture);
+
+    load();
+    ASSERT_EQ(count, 4);
+    for (size_t i = 0; i < 2; i++)
+    {
+        const uint8_t msg[] = {0x81, 0x00, cmds[i]};
+
+        expectSend(seq[i], 1, msg, sizeof(msg));
+        expectRecv(seq[i + 2], 1, msg, sizeof(msg));
+    }
+}
+
+TEST_F(Capture, appends)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    struct pldm_transport_capture* capture = nullptr;
+
+    for (int i = 0; i < 2; i++)
+    {
+        ASSERT_EQ(pldm_transport_capture_init(
+                      &capture, pldm_transport_loopback_core(a), fd),
+                  0);
+        ASSERT_EQ(pldm_transport_send_msg(pldm_transport_capture_core(capture),
+                                          2, req, sizeof(req)),
+                  PLDM_REQUESTER_SUCCESS);
+        pldm_transport_capture_destroy(capture);
+        capture = nullptr;
+    }
+
+    /* The second session continues the first without a new file header */
+    load();
+    ASSERT_EQ(count, 2);
+    expectSend(seq[0], 2, req, sizeof(req));
+    expectSend(seq[1], 2, req, sizeof(req));
+}
+
+TEST_F(Capture, write_failure)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    struct pldm_transport_capture* capture = nullptr;
+    std::string path;
+    int ro;
+
+    ASSERT_EQ(write(fd, "x", 1), 1);
+    path = "/proc/self/fd/" + std::to_string(fd);
+    ro = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_GE(ro, 0);
+
+    ASSERT_EQ(pldm_transport_capture_init(
+                  &capture, pldm_transport_loopback_core(a), ro),
+              0);
+
+    /* Traffic continues while the capture reports its failure */
+    EXPECT_EQ(pldm_transport_send_msg(pldm_transport_capture_core(capture), 2,
+                                      req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(pldm_transport_capture_flush(capture), -EBADF);
+    EXPECT_EQ(pldm_transport_send_msg(pldm_transport_capture_core(capture), 2,
+                                      req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(pldm_transport_capture_flush(capture), -EBADF);
+
+    pldm_transport_capture_destroy(capture);
+    close(ro);
+}
+#endif
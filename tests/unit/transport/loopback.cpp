@@ -0,0 +1,291 @@
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/control.h>
+#include <libpldm/sizes.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/loopback.h>
+
+#include <poll.h>
+#include <sys/uio.h>
+
+#include <array>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+class Loopback : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(pldm_transport_loopback_init_pair(&a, 1, &b, 2, 4), 0);
+    }
+
+    void TearDown() override
+    {
+        pldm_transport_loopback_destroy(a);
+        pldm_transport_loopback_destroy(b);
+    }
+
+    static bool ready(struct pldm_transport* transport, int timeout)
+    {
+        struct pollfd pollfd;
+
+        EXPECT_EQ(pldm_transport_loopback_init_pollfd(transport, &pollfd), 0);
+
+        return poll(&pollfd, 1, timeout) == 1;
+    }
+
+    struct pldm_transport_loopback* a = nullptr;
+    struct pldm_transport_loopback* b = nullptr;
+};
+
+TEST(LoopbackInit, invalid)
+{
+    struct pldm_transport_loopback* a = nullptr;
+    struct pldm_transport_loopback* b = nullptr;
+
+    EXPECT_EQ(pldm_transport_loopback_init_pair(nullptr, 1, &b, 2, 4),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_loopback_init_pair(&a, 1, nullptr, 2, 4),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_loopback_init_pair(&a, 1, &a, 2, 4), -EINVAL);
+    EXPECT_EQ(pldm_transport_loopback_init_pair(&a, 1, &b, 2, 0), -EINVAL);
+
+    ASSERT_EQ(pldm_transport_loopback_init_pair(&a, 1, &b, 2, 3), 0);
+    EXPECT_EQ(pldm_transport_loopback_init_pair(&a, 1, &b, 2, 4), -EINVAL);
+
+    pldm_transport_loopback_destroy(a);
+    pldm_transport_loopback_destroy(b);
+    pldm_transport_loopback_destroy(nullptr);
+}
+
+TEST_F(Loopback, send_recv)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    const uint8_t resp[] = {0x01, 0x00, 0x02, 0x00};
+    pldm_tid_t tid = 0;
+    void* msg = nullptr;
+    size_t len = 0;
+
+    ASSERT_EQ(
+        pldm_transport_send_msg(pldm_transport_loopback_core(a), 2, req,
+                                sizeof(req)),
+        PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(pldm_transport_recv_msg(pldm_transport_loopback_core(b), &tid,
+                                      &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 1);
+    ASSERT_EQ(len, sizeof(req));
+    EXPECT_EQ(memcmp(msg, req, sizeof(req)), 0);
+    free(msg);
+
+    ASSERT_EQ(
+        pldm_transport_send_msg(pldm_transport_loopback_core(b), 1, resp,
+                                sizeof(resp)),
+        PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(pldm_transport_recv_msg(pldm_transport_loopback_core(a), &tid,
+                                      &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 2);
+    ASSERT_EQ(len, sizeof(resp));
+    EXPECT_EQ(memcmp(msg, resp, sizeof(resp)), 0);
+    free(msg);
+
+    /* Each end only reaches its peer */
+    EXPECT_EQ(pldm_transport_send_msg(pldm_transport_loopback_core(a), 1, req,
+                                      sizeof(req)),
+              PLDM_REQUESTER_SEND_FAIL);
+}
+
+TEST_F(Loopback, full_and_empty)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    struct pldm_transport* ta = pldm_transport_loopback_core(a);
+    struct pldm_transport* tb = pldm_transport_loopback_core(b);
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    EXPECT_FALSE(ready(tb, 0));
+    errno = 0;
+    EXPECT_EQ(pldm_transport_recv_msg(tb, &tid, &msg, &len),
+              PLDM_REQUESTER_RECV_FAIL);
+    EXPECT_EQ(errno, EAGAIN);
+
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_EQ(pldm_transport_send_msg(ta, 2, req, sizeof(req)),
+                  PLDM_REQUESTER_SUCCESS);
+    }
+
+    errno = 0;
+    EXPECT_EQ(pldm_transport_send_msg(ta, 2, req, sizeof(req)),
+              PLDM_REQUESTER_SEND_FAIL);
+    EXPECT_EQ(errno, EAGAIN);
+
+    /* The receiver stays readable until it finds the ring empty */
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_TRUE(ready(tb, 0));
+        ASSERT_EQ(pldm_transport_recv_msg(tb, &tid, &msg, &len),
+                  PLDM_REQUESTER_SUCCESS);
+        free(msg);
+    }
+
+    EXPECT_EQ(pldm_transport_recv_msg(tb, &tid, &msg, &len),
+              PLDM_REQUESTER_RECV_FAIL);
+    EXPECT_FALSE(ready(tb, 0));
+
+    /* Messages left queued are released with the pair */
+    ASSERT_EQ(pldm_transport_send_msg(ta, 2, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_TRUE(ready(tb, 0));
+}
+
+TEST_F(Loopback, batch)
+{
+    const uint8_t hdr[] = {0x81, 0x00};
+    std::array<uint8_t, 3> cmds{0x01, 0x02, 0x03};
+    std::array<std::array<struct iovec, 2>, 3> iovs{};
+    std::array<struct pldm_transport_msgv, 3> out{};
+    std::array<std::array<uint8_t, 8>, 4> bufs{};
+    std::array<struct pldm_transport_msg, 4> in{};
+    uint8_t large[16] = {0x81, 0x00, 0x04};
+    struct pldm_transport* ta = pldm_transport_loopback_core(a);
+    struct pldm_transport* tb = pldm_transport_loopback_core(b);
+
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        iovs[i][0] = {const_cast<uint8_t*>(hdr), sizeof(hdr)};
+        iovs[i][1] = {&cmds[i], 1};
+        out[i] = {iovs[i].data(), iovs[i].size(), 2};
+    }
+
+    ASSERT_EQ(pldm_transport_send_batch(ta, out.data(), out.size()), 3);
+    /* Only one slot remains */
+    ASSERT_EQ(pldm_transport_send_batch(ta, out.data(), out.size()), 1);
+    EXPECT_EQ(pldm_transport_send_batch(ta, out.data(), out.size()), -EAGAIN);
+
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        in[i].msg = bufs[i].data();
+        in[i].len = bufs[i].size();
+    }
+
+    ASSERT_TRUE(ready(tb, 0));
+    ASSERT_EQ(pldm_transport_recv_batch(tb, in.data(), 2), 2);
+    ASSERT_EQ(pldm_transport_recv_batch(tb, in.data() + 2, 2), 2);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(in[i].tid, 1);
+        EXPECT_EQ(in[i].len, 3);
+        EXPECT_EQ(static_cast<uint8_t*>(in[i].msg)[2], cmds[i % 3]);
+    }
+    EXPECT_EQ(pldm_transport_recv_batch(tb, in.data(), in.size()), -EAGAIN);
+
+    /* Messages too large for the caller's buffer are dropped */
+    ASSERT_EQ(pldm_transport_send_msg(ta, 2, large, sizeof(large)),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(pldm_transport_recv_batch(tb, in.data(), in.size()), 0);
+}
+
+TEST_F(Loopback, threaded_stream)
+{
+    constexpr int count = 10000;
+    struct pldm_transport* ta = pldm_transport_loopback_core(a);
+    struct pldm_transport* tb = pldm_transport_loopback_core(b);
+
+    std::thread producer([ta]() {
+        for (int i = 0; i < count; i++)
+        {
+            const uint8_t req[] = {0x81, 0x00, static_cast<uint8_t>(i),
+                                   static_cast<uint8_t>(i >> 8)};
+
+            while (pldm_transport_send_msg(ta, 2, req, sizeof(req)) !=
+                   PLDM_REQUESTER_SUCCESS)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (int i = 0; i < count; i++)
+    {
+        pldm_tid_t tid;
+        size_t len;
+        void* msg;
+
+        while (pldm_transport_recv_msg(tb, &tid, &msg, &len) !=
+               PLDM_REQUESTER_SUCCESS)
+        {
+            ASSERT_TRUE(ready(tb, 5000));
+        }
+
+        const auto* bytes = static_cast<const uint8_t*>(msg);
+        ASSERT_EQ(len, 4);
+        EXPECT_EQ(bytes[2] | bytes[3] << 8, i);
+        free(msg);
+    }
+
+    producer.join();
+}
+
+TEST_F(Loopback, control_responder)
+{
+    alignas(std::max_align_t) std::array<uint8_t, PLDM_SIZEOF_PLDM_CONTROL>
+        storage{};
+    auto* control = reinterpret_cast<struct pldm_control*>(storage.data());
+    struct pldm_transport* ta = pldm_transport_loopback_core(a);
+    struct pldm_transport* tb = pldm_transport_loopback_core(b);
+    constexpr int rounds = 1000;
+
+    ASSERT_EQ(pldm_control_setup(control, sizeof(storage)), 0);
+
+    std::thread responder([tb, control]() {
+        for (int i = 0; i < rounds; i++)
+        {
+            std::array<uint8_t, 64> resp{};
+            size_t resp_len = resp.size();
+            pldm_tid_t tid;
+            size_t len;
+            void* msg;
+
+            while (pldm_transport_recv_msg(tb, &tid, &msg, &len) !=
+                   PLDM_REQUESTER_SUCCESS)
+            {
+                ASSERT_TRUE(ready(tb, 5000));
+            }
+
+            ASSERT_EQ(pldm_control_handle_msg(control, msg, len, resp.data(),
+                                              &resp_len),
+                      0);
+            free(msg);
+            ASSERT_EQ(pldm_transport_send_msg(tb, tid, resp.data(), resp_len),
+                      PLDM_REQUESTER_SUCCESS);
+        }
+    });
+
+    for (int i = 0; i < rounds; i++)
+    {
+        std::array<uint8_t, sizeof(struct pldm_msg_hdr)> req{};
+        auto* request = reinterpret_cast<struct pldm_msg*>(req.data());
+        void* msg = nullptr;
+        size_t len = 0;
+
+        ASSERT_EQ(encode_get_tid_req(i & 0x1f, request), PLDM_SUCCESS);
+        ASSERT_EQ(pldm_transport_send_recv_msg(ta, 2, req.data(), req.size(),
+                                               &msg, &len),
+                  PLDM_REQUESTER_SUCCESS);
+        ASSERT_GE(len, sizeof(struct pldm_msg_hdr) + 1);
+        EXPECT_EQ(static_cast<uint8_t*>(msg)[sizeof(struct pldm_msg_hdr)],
+                  PLDM_SUCCESS);
+        free(msg);
+    }
+
+    responder.join();
+}
+#endif
@@ -0,0 +1,252 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/mctp-demux.h>
+
+#include "mctp-defines.h"
+#include "transport/mctp-demux-internal.h"
+#include "transport/transport.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+class MctpDemux : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds.data()), 0);
+        demux = pldm_transport_mctp_demux_init_with_fd(fds[0]);
+        ASSERT_NE(demux, nullptr);
+        ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 1, 8), 0);
+        ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 2, 9), 0);
+    }
+
+    void TearDown() override
+    {
+        pldm_transport_mctp_demux_destroy(demux);
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    void inject(const std::vector<uint8_t>& packet)
+    {
+        ASSERT_EQ(write(fds[1], packet.data(), packet.size()),
+                  (ssize_t)packet.size());
+    }
+
+    std::array<int, 2> fds{};
+    struct pldm_transport_mctp_demux* demux = nullptr;
+};
+
+TEST_F(MctpDemux, send_follows_map)
+{
+    struct pldm_transport* ctx = pldm_transport_mctp_demux_core(demux);
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    uint8_t buf[16];
+
+    ASSERT_EQ(pldm_transport_send_msg(ctx, 1, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(read(fds[1], buf, sizeof(buf)), (ssize_t)sizeof(req) + 2);
+    EXPECT_EQ(buf[0], 8);
+
+    /* The lowest EID mapped to the TID is used */
+    ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 1, 7), 0);
+    ASSERT_EQ(pldm_transport_send_msg(ctx, 1, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(read(fds[1], buf, sizeof(buf)), (ssize_t)sizeof(req) + 2);
+    EXPECT_EQ(buf[0], 7);
+
+    ASSERT_EQ(pldm_transport_mctp_demux_unmap_tid(demux, 1, 7), 0);
+    ASSERT_EQ(pldm_transport_send_msg(ctx, 1, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(read(fds[1], buf, sizeof(buf)), (ssize_t)sizeof(req) + 2);
+    EXPECT_EQ(buf[0], 8);
+
+    /* Remapping the EID to another TID leaves the original unmapped */
+    ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 3, 8), 0);
+    EXPECT_EQ(pldm_transport_send_msg(ctx, 1, req, sizeof(req)),
+              PLDM_REQUESTER_SEND_FAIL);
+
+    /* TID 0 still goes to the lowest unmapped EID */
+    ASSERT_EQ(pldm_transport_send_msg(ctx, 0, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(read(fds[1], buf, sizeof(buf)), (ssize_t)sizeof(req) + 2);
+    EXPECT_EQ(buf[0], 0);
+}
+
+TEST_F(MctpDemux, recv_batch)
+{
+    std::array<struct pldm_transport_msg, 8> msgs{};
+    std::set<void*> buffers;
+    uint8_t bufs[8][8];
+
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        msgs[i].msg = bufs[i];
+        msgs[i].len = sizeof(bufs[i]);
+    }
+
+    inject({8, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00});
+    /* Not PLDM, unmapped EID, too short and truncated are discarded */
+    inject({8, 0x7e, 0x01, 0x00, 0x02, 0x00});
+    inject({10, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00});
+    inject({9, MCTP_MSG_TYPE_PLDM, 0x01});
+    inject({9, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00, 0, 0, 0, 0, 0});
+    inject({9, MCTP_MSG_TYPE_PLDM, 0x02, 0x00, 0x03, 0x00, 0xaa});
+
+    ASSERT_EQ(pldm_transport_recv_batch(pldm_transport_mctp_demux_core(demux), msgs.data(),
+                                        msgs.size()),
+              2);
+    EXPECT_EQ(msgs[0].tid, 1);
+    EXPECT_EQ(msgs[0].len, 4);
+    EXPECT_EQ(memcmp(msgs[0].msg, "\x01\x00\x02\x00", 4), 0);
+    EXPECT_EQ(msgs[1].tid, 2);
+    EXPECT_EQ(msgs[1].len, 5);
+    EXPECT_EQ(memcmp(msgs[1].msg, "\x02\x00\x03\x00\xaa", 5), 0);
+
+    /* Reordering the entries must not lose any of the caller's buffers */
+    for (const auto& entry : msgs)
+    {
+        buffers.insert(entry.msg);
+    }
+    EXPECT_EQ(buffers.size(), msgs.size());
+}
+
+TEST_F(MctpDemux, recv_batch_caps_count)
+{
+    std::array<struct pldm_transport_msg, PLDM_TRANSPORT_RECV_BATCH_MAX + 1>
+        msgs{};
+    uint8_t bufs[PLDM_TRANSPORT_RECV_BATCH_MAX + 1][4];
+
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        msgs[i].msg = bufs[i];
+        msgs[i].len = sizeof(bufs[i]);
+        inject({8, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00});
+    }
+
+    EXPECT_EQ(pldm_transport_recv_batch(pldm_transport_mctp_demux_core(demux), msgs.data(),
+                                        msgs.size()),
+              PLDM_TRANSPORT_RECV_BATCH_MAX);
+    EXPECT_EQ(pldm_transport_recv_batch(pldm_transport_mctp_demux_core(demux), msgs.data(),
+                                        msgs.size()),
+              1);
+}
+
+TEST_F(MctpDemux, recv_pooled)
+{
+    struct pldm_transport* ctx = pldm_transport_mctp_demux_core(demux);
+    std::array<struct pldm_transport_msg, 4> msgs{};
+    uint8_t slab[4][8];
+
+    ASSERT_EQ(pldm_transport_pool_init(ctx, slab, sizeof(slab[0]), 4), 0);
+
+    inject({8, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00});
+    inject({9, MCTP_MSG_TYPE_PLDM, 0x02, 0x00, 0x03, 0x00});
+
+    /* Messages land directly in the slab */
+    ASSERT_EQ(pldm_transport_recv_pooled(ctx, msgs.data(), msgs.size()), 2);
+    EXPECT_EQ(msgs[0].msg, slab[0]);
+    EXPECT_EQ(msgs[0].tid, 1);
+    EXPECT_EQ(msgs[1].msg, slab[1]);
+    EXPECT_EQ(msgs[1].tid, 2);
+    EXPECT_EQ(msgs[2].msg, nullptr);
+
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), -EBUSY);
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[0].msg), 0);
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[1].msg), 0);
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), 0);
+}
+
+TEST_F(MctpDemux, recv_buffer)
+{
+    struct pldm_transport* ctx = pldm_transport_mctp_demux_core(demux);
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    EXPECT_EQ(pldm_transport_mctp_demux_enable_recv_buffer(nullptr, 8),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_mctp_demux_enable_recv_buffer(demux, 2), -EINVAL);
+    ASSERT_EQ(pldm_transport_mctp_demux_enable_recv_buffer(demux, 5), 0);
+    EXPECT_EQ(pldm_transport_mctp_demux_enable_recv_buffer(demux, 5), -EBUSY);
+
+    inject({9, MCTP_MSG_TYPE_PLDM, 0x02, 0x00, 0x03, 0x00, 0xaa});
+    ASSERT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 2);
+    ASSERT_EQ(len, 5);
+    EXPECT_EQ(memcmp(msg, "\x02\x00\x03\x00\xaa", 5), 0);
+    free(msg);
+
+    /* Oversized, too short, not PLDM and unmapped EIDs are each consumed */
+    inject({8, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00, 0, 0});
+    inject({9, MCTP_MSG_TYPE_PLDM, 0x01});
+    inject({8, 0x7e, 0x01, 0x00, 0x02, 0x00});
+    inject({10, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00});
+    inject({8, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02, 0x00});
+    EXPECT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_INVALID_RECV_LEN);
+    EXPECT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_INVALID_RECV_LEN);
+    EXPECT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_NOT_PLDM_MSG);
+    EXPECT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_RECV_FAIL);
+    ASSERT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 1);
+    EXPECT_EQ(len, 4);
+    free(msg);
+}
+
+TEST_F(MctpDemux, reserve_send_buffer)
+{
+    struct pldm_transport* ctx = pldm_transport_mctp_demux_core(demux);
+    std::vector<uint8_t> req(32768);
+    std::vector<uint8_t> buf(req.size() + 2);
+
+    EXPECT_EQ(pldm_transport_mctp_demux_reserve_send_buffer(nullptr, 64),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_mctp_demux_reserve_send_buffer(
+                  demux, (size_t)INT_MAX + 1),
+              -EINVAL);
+    ASSERT_EQ(pldm_transport_mctp_demux_reserve_send_buffer(demux, req.size()),
+              0);
+
+    req[0] = 0x81;
+    ASSERT_EQ(pldm_transport_send_msg(ctx, 1, req.data(), req.size()),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(read(fds[1], buf.data(), buf.size()), (ssize_t)buf.size());
+}
+
+TEST_F(MctpDemux, reserve_send_buffer_clamped)
+{
+    struct pldm_transport* ctx = pldm_transport_mctp_demux_core(demux);
+    struct pldm_transport_stats stats{};
+
+    ASSERT_EQ(pldm_transport_stats_enable(ctx), 0);
+
+    /* The kernel limits the buffer well below the request */
+    ASSERT_EQ(
+        pldm_transport_mctp_demux_reserve_send_buffer(demux, INT_MAX / 4), 0);
+    ASSERT_EQ(pldm_transport_stats_snapshot(ctx, &stats), 0);
+    EXPECT_EQ(stats.sndbuf_resizes, 1);
+
+    /* Once it has, asking for more leaves the buffer alone */
+    ASSERT_EQ(
+        pldm_transport_mctp_demux_reserve_send_buffer(demux, INT_MAX / 2), 0);
+    ASSERT_EQ(pldm_transport_stats_snapshot(ctx, &stats), 0);
+    EXPECT_EQ(stats.sndbuf_resizes, 1);
+}
+#endif
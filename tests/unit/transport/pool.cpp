@@ -0,0 +1,189 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+
+#include "array.h"
+#include "transport/test.h"
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(TransportPool, init_invalid)
+{
+    struct pldm_transport_test* test = NULL;
+    struct pldm_transport* ctx;
+    uint8_t slab[4][8];
+
+    ASSERT_EQ(pldm_transport_test_init(&test, NULL, 0), 0);
+    ctx = pldm_transport_test_core(test);
+
+    EXPECT_EQ(pldm_transport_pool_init(NULL, slab, 8, 4), -EINVAL);
+    EXPECT_EQ(pldm_transport_pool_init(ctx, NULL, 8, 4), -EINVAL);
+    EXPECT_EQ(pldm_transport_pool_init(ctx, slab, 2, 4), -EINVAL);
+    EXPECT_EQ(pldm_transport_pool_init(ctx, slab, 8, 0), -EINVAL);
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), -EINVAL);
+
+    ASSERT_EQ(pldm_transport_pool_init(ctx, slab, 8, 4), 0);
+    EXPECT_EQ(pldm_transport_pool_init(ctx, slab, 8, 4), -EBUSY);
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), 0);
+
+    pldm_transport_test_destroy(test);
+}
+
+TEST(TransportPool, recv_release)
+{
+    uint8_t msg[] = {0x01, 0x00, 0x01, 0x00};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = 1,
+                    .msg = msg,
+                    .len = sizeof(msg),
+                },
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = 2,
+                    .msg = msg,
+                    .len = sizeof(msg),
+                },
+        },
+    };
+    struct pldm_transport_test* test = NULL;
+    struct pldm_transport_msg msgs[2];
+    struct pldm_transport* ctx;
+    uint8_t slab[1][8];
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ctx = pldm_transport_test_core(test);
+    ASSERT_EQ(pldm_transport_pool_init(ctx, slab, sizeof(slab[0]), 1), 0);
+
+    ASSERT_EQ(pldm_transport_recv_pooled(ctx, msgs, ARRAY_SIZE(msgs)), 1);
+    EXPECT_EQ(msgs[0].msg, slab[0]);
+    EXPECT_EQ(msgs[0].len, sizeof(msg));
+    EXPECT_EQ(msgs[0].tid, 1);
+    EXPECT_EQ(memcmp(msgs[0].msg, msg, sizeof(msg)), 0);
+
+    /* The only buffer is outstanding */
+    EXPECT_EQ(pldm_transport_recv_pooled(ctx, msgs, 1), -ENOBUFS);
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), -EBUSY);
+
+    EXPECT_EQ(pldm_transport_pool_release(ctx, &slab[0][1]), -EINVAL);
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[0].msg), 0);
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[0].msg), -EINVAL);
+
+    ASSERT_EQ(pldm_transport_recv_pooled(ctx, msgs, 1), 1);
+    EXPECT_EQ(msgs[0].tid, 2);
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[0].msg), 0);
+
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), 0);
+    pldm_transport_test_destroy(test);
+}
+
+TEST(TransportPool, double_release)
+{
+    uint8_t msg[] = {0x01, 0x00, 0x01, 0x00};
+    struct pldm_transport_test_descriptor seq[5];
+    struct pldm_transport_test* test = NULL;
+    struct pldm_transport_msg msgs[3];
+    struct pldm_transport* ctx;
+    uint8_t slab[4][8];
+
+    for (size_t i = 0; i < ARRAY_SIZE(seq); i++)
+    {
+        seq[i].type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV;
+        seq[i].recv_msg.src = i + 1;
+        seq[i].recv_msg.msg = msg;
+        seq[i].recv_msg.len = sizeof(msg);
+    }
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ctx = pldm_transport_test_core(test);
+    ASSERT_EQ(pldm_transport_pool_init(ctx, slab, sizeof(slab[0]), 4), 0);
+
+    /* A buffer not yet handed out can't be released */
+    EXPECT_EQ(pldm_transport_pool_release(ctx, slab[3]), -EINVAL);
+
+    for (auto& m : msgs)
+    {
+        ASSERT_EQ(pldm_transport_recv_pooled(ctx, &m, 1), 1);
+    }
+
+    /* Released twice while other buffers are still outstanding */
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[0].msg), 0);
+    EXPECT_EQ(pldm_transport_pool_release(ctx, msgs[0].msg), -EINVAL);
+
+    /* So the next receives don't share a buffer */
+    ASSERT_EQ(pldm_transport_recv_pooled(ctx, &msgs[0], 1), 1);
+    EXPECT_EQ(msgs[0].tid, 4);
+    ASSERT_EQ(pldm_transport_pool_release(ctx, msgs[1].msg), 0);
+    ASSERT_EQ(pldm_transport_recv_pooled(ctx, &msgs[1], 1), 1);
+    EXPECT_EQ(msgs[1].tid, 5);
+    EXPECT_NE(msgs[0].msg, msgs[1].msg);
+
+    for (auto& m : msgs)
+    {
+        EXPECT_EQ(pldm_transport_pool_release(ctx, m.msg), 0);
+    }
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), 0);
+    pldm_transport_test_destroy(test);
+}
+
+TEST(TransportPool, send_recv_discards_into_pool)
+{
+    uint8_t unwanted[] = {0x01, 0x00, 0x01, 0x01};
+    uint8_t req[] = {0x81, 0x00, 0x01, 0x01};
+    uint8_t resp[] = {0x01, 0x00, 0x01, 0x00};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = 2,
+                    .msg = unwanted,
+                    .len = sizeof(unwanted),
+                },
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg =
+                {
+                    .dst = 1,
+                    .msg = req,
+                    .len = sizeof(req),
+                },
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = 1,
+                    .msg = resp,
+                    .len = sizeof(resp),
+                },
+        },
+    };
+    struct pldm_transport_test* test = NULL;
+    struct pldm_transport* ctx;
+    uint8_t slab[2][8];
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ctx = pldm_transport_test_core(test);
+    ASSERT_EQ(pldm_transport_pool_init(ctx, slab, sizeof(slab[0]), 2), 0);
+    ASSERT_EQ(pldm_transport_send_recv_msg(ctx, 1, req, sizeof(req), &msg,
+                                           &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(len, sizeof(resp));
+    EXPECT_EQ(memcmp(msg, resp, len), 0);
+    free(msg);
+    EXPECT_EQ(pldm_transport_pool_fini(ctx), 0);
+    pldm_transport_test_destroy(test);
+}
+#endif
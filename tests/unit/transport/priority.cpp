@@ -0,0 +1,225 @@
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/bios.h>
+#include <libpldm/firmware_update.h>
+#include <libpldm/platform.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/loopback.h>
+#include <libpldm/transport/mctp-demux.h>
+#include <libpldm/transport/priority.h>
+
+#include "mctp-defines.h"
+#include "transport/mctp-demux-internal.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdlib>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+class Priority : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(pldm_transport_loopback_init_pair(&a, 1, &b, 2, 16), 0);
+        ASSERT_EQ(pldm_transport_priority_init(
+                      &priority, pldm_transport_loopback_core(b), 64),
+                  0);
+        ctx = pldm_transport_priority_core(priority);
+    }
+
+    void TearDown() override
+    {
+        pldm_transport_priority_destroy(priority);
+        pldm_transport_loopback_destroy(a);
+        pldm_transport_loopback_destroy(b);
+    }
+
+    void send(uint8_t type, uint8_t command)
+    {
+        const uint8_t req[] = {0x80, type, command};
+
+        ASSERT_EQ(pldm_transport_send_msg(pldm_transport_loopback_core(a), 2,
+                                          req, sizeof(req)),
+                  PLDM_REQUESTER_SUCCESS);
+    }
+
+    std::vector<uint8_t> receive()
+    {
+        std::vector<uint8_t> commands;
+        pldm_tid_t tid;
+        size_t len;
+        void* msg;
+
+        while (pldm_transport_recv_msg(ctx, &tid, &msg, &len) ==
+               PLDM_REQUESTER_SUCCESS)
+        {
+            EXPECT_EQ(tid, 1);
+            commands.push_back(static_cast<uint8_t*>(msg)[2]);
+            free(msg);
+        }
+
+        EXPECT_EQ(pldm_transport_priority_pending(priority), 0);
+
+        return commands;
+    }
+
+    struct pldm_transport_loopback* a = nullptr;
+    struct pldm_transport_loopback* b = nullptr;
+    struct pldm_transport_priority* priority = nullptr;
+    struct pldm_transport* ctx = nullptr;
+};
+
+TEST_F(Priority, invalid)
+{
+    struct pldm_transport_priority* other = nullptr;
+
+    EXPECT_EQ(pldm_transport_priority_init(
+                  nullptr, pldm_transport_loopback_core(a), 64),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_priority_init(&other, nullptr, 64), -EINVAL);
+    EXPECT_EQ(pldm_transport_priority_init(
+                  &other, pldm_transport_loopback_core(a), 2),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_priority_classify(nullptr, PLDM_BASE,
+                                               PLDM_GET_TID,
+                                               PLDM_TRANSPORT_PRIORITY_LOW),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_priority_classify(priority, 64, PLDM_GET_TID,
+                                               PLDM_TRANSPORT_PRIORITY_LOW),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_priority_classify(
+                  priority, PLDM_BASE, PLDM_GET_TID,
+                  static_cast<enum pldm_transport_priority_lane>(
+                      PLDM_TRANSPORT_PRIORITY_LANES)),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_priority_pending(nullptr), 0);
+    pldm_transport_priority_destroy(nullptr);
+}
+
+TEST_F(Priority, default_lanes)
+{
+    send(PLDM_PLATFORM, PLDM_GET_PDR);
+    send(PLDM_BIOS, PLDM_GET_BIOS_TABLE);
+    send(PLDM_BASE, PLDM_GET_TID);
+    send(PLDM_PLATFORM, PLDM_PLATFORM_EVENT_MESSAGE);
+    send(PLDM_PLATFORM, PLDM_GET_PDR);
+    send(PLDM_FWUP, PLDM_REQUEST_FIRMWARE_DATA);
+
+    EXPECT_EQ(receive(),
+              (std::vector<uint8_t>{
+                  PLDM_PLATFORM_EVENT_MESSAGE, PLDM_REQUEST_FIRMWARE_DATA,
+                  PLDM_GET_TID, PLDM_GET_PDR, PLDM_GET_BIOS_TABLE,
+                  PLDM_GET_PDR}));
+}
+
+TEST_F(Priority, classify)
+{
+    ASSERT_EQ(pldm_transport_priority_classify(priority, PLDM_BASE,
+                                               PLDM_GET_TID,
+                                               PLDM_TRANSPORT_PRIORITY_LOW),
+              0);
+    ASSERT_EQ(pldm_transport_priority_classify(priority, PLDM_PLATFORM,
+                                               PLDM_GET_PDR,
+                                               PLDM_TRANSPORT_PRIORITY_HIGH),
+              0);
+
+    send(PLDM_BASE, PLDM_GET_TID);
+    send(PLDM_BASE, PLDM_GET_PLDM_TYPES);
+    send(PLDM_PLATFORM, PLDM_GET_PDR);
+
+    EXPECT_EQ(receive(), (std::vector<uint8_t>{PLDM_GET_PDR,
+                                               PLDM_GET_PLDM_TYPES,
+                                               PLDM_GET_TID}));
+}
+
+TEST_F(Priority, late_arrivals_overtake)
+{
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    send(PLDM_BIOS, PLDM_GET_BIOS_TABLE);
+    send(PLDM_BIOS, PLDM_GET_BIOS_TABLE);
+    ASSERT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(msg);
+    EXPECT_EQ(pldm_transport_priority_pending(priority), 1);
+
+    /* An event arriving while bulk traffic is held is served first */
+    send(PLDM_PLATFORM, PLDM_PLATFORM_EVENT_MESSAGE);
+    EXPECT_EQ(receive(), (std::vector<uint8_t>{PLDM_PLATFORM_EVENT_MESSAGE,
+                                               PLDM_GET_BIOS_TABLE}));
+}
+
+TEST(PriorityDemux, poll_after_partial_receive)
+{
+    const uint8_t packet[] = {8, MCTP_MSG_TYPE_PLDM, 0x80, PLDM_BASE,
+                              PLDM_GET_TID};
+    struct pldm_transport_priority* priority = nullptr;
+    struct pldm_transport_mctp_demux* demux;
+    struct pldm_transport* ctx;
+    std::array<int, 2> fds{};
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds.data()), 0);
+    demux = pldm_transport_mctp_demux_init_with_fd(fds[0]);
+    ASSERT_NE(demux, nullptr);
+    ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 1, 8), 0);
+    ASSERT_EQ(pldm_transport_priority_init(
+                  &priority, pldm_transport_mctp_demux_core(demux), 64),
+              0);
+    ctx = pldm_transport_priority_core(priority);
+
+    ASSERT_EQ(write(fds[1], packet, sizeof(packet)), (ssize_t)sizeof(packet));
+    ASSERT_EQ(write(fds[1], packet, sizeof(packet)), (ssize_t)sizeof(packet));
+    ASSERT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(msg);
+    ASSERT_EQ(pldm_transport_priority_pending(priority), 1);
+
+    /* The held message keeps the transport ready */
+    EXPECT_EQ(pldm_transport_poll(ctx, 100), 1);
+    ASSERT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(msg);
+    EXPECT_EQ(pldm_transport_priority_pending(priority), 0);
+    EXPECT_EQ(pldm_transport_poll(ctx, 0), 0);
+
+    /* Arrivals on the inner transport are still seen */
+    ASSERT_EQ(write(fds[1], packet, sizeof(packet)), (ssize_t)sizeof(packet));
+    EXPECT_EQ(pldm_transport_poll(ctx, 100), 1);
+    ASSERT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 1);
+    free(msg);
+
+    pldm_transport_priority_destroy(priority);
+    pldm_transport_mctp_demux_destroy(demux);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST_F(Priority, sends_pass_through)
+{
+    const uint8_t req[] = {0x80, PLDM_BASE, PLDM_GET_TID};
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_send_msg(ctx, 1, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(pldm_transport_recv_msg(pldm_transport_loopback_core(a), &tid,
+                                      &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 2);
+    free(msg);
+}
+#endif
@@ -0,0 +1,212 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/queue.h>
+
+#include "transport/transport.h"
+
+#include <poll.h>
+
+#include <cerrno>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+/* Accepts as many messages as it has credit for, then would block */
+struct Congested
+{
+    struct pldm_transport transport;
+    std::vector<pldm_tid_t> sent;
+    size_t credit = 0;
+    int error = 0;
+    /* A TID that can't be reached, failing sends without setting errno */
+    pldm_tid_t unmapped = 0;
+};
+
+static pldm_requester_rc_t congestedSend(struct pldm_transport* t,
+                                         pldm_tid_t tid,
+                                         const void* /*msg*/, size_t /*len*/)
+{
+    auto* inner = reinterpret_cast<Congested*>(t);
+
+    if (inner->unmapped && tid == inner->unmapped)
+    {
+        return PLDM_REQUESTER_SEND_FAIL;
+    }
+
+    if (inner->error)
+    {
+        errno = inner->error;
+        return PLDM_REQUESTER_SEND_FAIL;
+    }
+
+    if (!inner->credit)
+    {
+        errno = EAGAIN;
+        return PLDM_REQUESTER_SEND_FAIL;
+    }
+
+    inner->credit--;
+    inner->sent.push_back(tid);
+
+    return PLDM_REQUESTER_SUCCESS;
+}
+
+static pldm_requester_rc_t congestedRecv(struct pldm_transport* /*t*/,
+                                         pldm_tid_t* /*tid*/,
+                                         void** /*msg*/, size_t* /*len*/)
+{
+    return PLDM_REQUESTER_RECV_FAIL;
+}
+
+static int congestedInitPollfd(struct pldm_transport* /*t*/,
+                               struct pollfd* pollfd)
+{
+    pollfd->fd = -1;
+    pollfd->events = POLLIN;
+
+    return 0;
+}
+
+class Queue : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        inner.transport.name = "CONGESTED";
+        inner.transport.version = 1;
+        inner.transport.send = congestedSend;
+        inner.transport.recv = congestedRecv;
+        inner.transport.init_pollfd = congestedInitPollfd;
+        ASSERT_EQ(pldm_transport_queue_init(&queue, &inner.transport, 3), 0);
+        ctx = pldm_transport_queue_core(queue);
+    }
+
+    void TearDown() override
+    {
+        pldm_transport_queue_destroy(queue);
+    }
+
+    pldm_requester_rc_t send(pldm_tid_t tid)
+    {
+        return pldm_transport_send_msg(ctx, tid, req, sizeof(req));
+    }
+
+    const uint8_t req[3] = {0x81, 0x00, 0x02};
+    Congested inner{};
+    struct pldm_transport_queue* queue = nullptr;
+    struct pldm_transport* ctx = nullptr;
+};
+
+TEST_F(Queue, invalid)
+{
+    struct pldm_transport_queue* other = nullptr;
+
+    EXPECT_EQ(pldm_transport_queue_init(nullptr, &inner.transport, 1),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_queue_init(&other, nullptr, 1), -EINVAL);
+    EXPECT_EQ(pldm_transport_queue_init(&other, &inner.transport, 0),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_queue_init(&queue, &inner.transport, 1),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_queue_flush(nullptr), -EINVAL);
+    EXPECT_EQ(pldm_transport_queue_pending(nullptr), 0);
+    pldm_transport_queue_destroy(nullptr);
+}
+
+TEST_F(Queue, sends_directly)
+{
+    inner.credit = 2;
+    EXPECT_EQ(send(1), PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(send(2), PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(inner.sent, (std::vector<pldm_tid_t>{1, 2}));
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 0);
+
+    /* Other failures aren't queued */
+    inner.error = EIO;
+    EXPECT_EQ(send(1), PLDM_REQUESTER_SEND_FAIL);
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 0);
+}
+
+TEST_F(Queue, stale_errno)
+{
+    /* A would-block left over from an earlier call doesn't queue the send */
+    inner.credit = 1;
+    inner.unmapped = 9;
+    errno = EAGAIN;
+    EXPECT_EQ(send(9), PLDM_REQUESTER_SEND_FAIL);
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 0);
+
+    EXPECT_EQ(send(1), PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(inner.sent, (std::vector<pldm_tid_t>{1}));
+}
+
+TEST_F(Queue, backpressure)
+{
+    struct pollfd pollfd;
+
+    for (int i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(send(1), PLDM_REQUESTER_SUCCESS);
+    }
+    EXPECT_EQ(pldm_transport_queue_depth(queue, 1), 3);
+
+    errno = 0;
+    EXPECT_EQ(send(1), PLDM_REQUESTER_SEND_FAIL);
+    EXPECT_EQ(errno, ENOBUFS);
+
+    /* Other TIDs have their own allowance */
+    EXPECT_EQ(send(2), PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 4);
+
+    ASSERT_EQ(ctx->init_pollfd(ctx, &pollfd), 0);
+    EXPECT_EQ(pollfd.events, POLLIN | POLLOUT);
+
+    /* Nothing moves while the inner transport would block */
+    EXPECT_EQ(pldm_transport_queue_flush(queue), 0);
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 4);
+}
+
+TEST_F(Queue, round_robin)
+{
+    struct pollfd pollfd;
+
+    for (pldm_tid_t tid : {1, 1, 1, 2, 3, 3})
+    {
+        ASSERT_EQ(send(tid), PLDM_REQUESTER_SUCCESS);
+    }
+
+    /* Queued messages aren't overtaken */
+    inner.credit = 2;
+    ASSERT_EQ(send(4), PLDM_REQUESTER_SUCCESS);
+    EXPECT_TRUE(inner.sent.empty());
+
+    EXPECT_EQ(pldm_transport_queue_flush(queue), 2);
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 5);
+
+    inner.credit = 10;
+    EXPECT_EQ(pldm_transport_queue_flush(queue), 5);
+    EXPECT_EQ(inner.sent, (std::vector<pldm_tid_t>{1, 2, 3, 4, 1, 3, 1}));
+    EXPECT_EQ(pldm_transport_queue_pending(queue), 0);
+
+    ASSERT_EQ(ctx->init_pollfd(ctx, &pollfd), 0);
+    EXPECT_EQ(pollfd.events, POLLIN);
+}
+
+TEST_F(Queue, flush_failure)
+{
+    ASSERT_EQ(send(1), PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(send(2), PLDM_REQUESTER_SUCCESS);
+
+    /* The failed message is discarded */
+    inner.error = EIO;
+    EXPECT_EQ(pldm_transport_queue_flush(queue), -EIO);
+    EXPECT_EQ(pldm_transport_queue_depth(queue, 1), 0);
+    EXPECT_EQ(pldm_transport_queue_depth(queue, 2), 1);
+
+    inner.error = 0;
+    inner.credit = 1;
+    EXPECT_EQ(pldm_transport_queue_flush(queue), 1);
+    EXPECT_EQ(inner.sent, (std::vector<pldm_tid_t>{2}));
+}
+#endif
@@ -0,0 +1,277 @@
+#include <libpldm/api.h>
+#include <libpldm/reactor.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/mctp-demux.h>
+
+#include "mctp-defines.h"
+#include "transport/mctp-demux-internal.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+struct Received
+{
+    pldm_tid_t tid;
+    std::vector<uint8_t> msg;
+};
+
+static void collect(void* data, struct pldm_transport* transport
+                    [[maybe_unused]],
+                    pldm_tid_t tid, const void* msg, size_t len)
+{
+    auto* received = static_cast<std::vector<Received>*>(data);
+    const auto* bytes = static_cast<const uint8_t*>(msg);
+
+    received->push_back({tid, {bytes, bytes + len}});
+}
+
+class Reactor : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(pldm_reactor_init(&reactor), 0);
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            ASSERT_EQ(
+                socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pairs[i].data()), 0);
+            demux[i] = pldm_transport_mctp_demux_init_with_fd(pairs[i][0]);
+            ASSERT_NE(demux[i], nullptr);
+            ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux[i], i + 1, 8),
+                      0);
+        }
+    }
+
+    void TearDown() override
+    {
+        pldm_reactor_destroy(reactor);
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            pldm_transport_mctp_demux_destroy(demux[i]);
+            close(pairs[i][0]);
+            close(pairs[i][1]);
+        }
+    }
+
+    void inject(size_t i, uint8_t command, uint8_t eid = 8)
+    {
+        const uint8_t packet[] = {eid, MCTP_MSG_TYPE_PLDM, 0x01, 0x00,
+                                  command};
+
+        ASSERT_EQ(write(pairs[i][1], packet, sizeof(packet)),
+                  (ssize_t)sizeof(packet));
+    }
+
+    struct pldm_transport* transport(size_t i)
+    {
+        return pldm_transport_mctp_demux_core(demux[i]);
+    }
+
+    struct pldm_reactor* reactor = nullptr;
+    std::array<std::array<int, 2>, 2> pairs{};
+    std::array<struct pldm_transport_mctp_demux*, 2> demux{};
+};
+
+TEST(ReactorInit, invalid)
+{
+    struct pldm_reactor* reactor = nullptr;
+
+    EXPECT_EQ(pldm_reactor_init(nullptr), -EINVAL);
+    ASSERT_EQ(pldm_reactor_init(&reactor), 0);
+    EXPECT_EQ(pldm_reactor_init(&reactor), -EINVAL);
+    EXPECT_EQ(pldm_reactor_run_once(nullptr, 0), -EINVAL);
+    pldm_reactor_destroy(reactor);
+}
+
+TEST_F(Reactor, add_remove_transport)
+{
+    std::vector<Received> received;
+
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), collect, &received),
+        0);
+    EXPECT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), collect, &received),
+        -EEXIST);
+    EXPECT_EQ(pldm_reactor_remove_transport(reactor, transport(0)), 0);
+    EXPECT_EQ(pldm_reactor_remove_transport(reactor, transport(0)), -ENOENT);
+}
+
+TEST_F(Reactor, drains_all_transports)
+{
+    std::vector<Received> received;
+
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), collect, &received),
+        0);
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(1), collect, &received),
+        0);
+
+    inject(0, 0x01);
+    inject(0, 0x02);
+    inject(1, 0x03);
+
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 3);
+    ASSERT_EQ(received.size(), 3);
+
+    /* Everything was drained on the edge, so nothing is left */
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 0), 0);
+
+    inject(1, 0x04);
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 1);
+    ASSERT_EQ(received.size(), 4);
+    EXPECT_EQ(received[3].tid, 2);
+    EXPECT_EQ(received[3].msg, (std::vector<uint8_t>{0x01, 0x00, 0x04}));
+}
+
+TEST_F(Reactor, drains_into_pool)
+{
+    std::vector<Received> received;
+    uint8_t slab[4][16];
+
+    ASSERT_EQ(pldm_transport_pool_init(transport(0), slab, sizeof(slab[0]),
+                                       std::size(slab)),
+              0);
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), collect, &received),
+        0);
+
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        inject(0, i);
+    }
+
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 6);
+    ASSERT_EQ(received.size(), 6);
+    EXPECT_EQ(received[5].msg, (std::vector<uint8_t>{0x01, 0x00, 0x05}));
+
+    ASSERT_EQ(pldm_reactor_remove_transport(reactor, transport(0)), 0);
+    EXPECT_EQ(pldm_transport_pool_fini(transport(0)), 0);
+}
+
+TEST_F(Reactor, budget_requeues_transport)
+{
+    std::vector<Received> received;
+
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), collect, &received),
+        0);
+
+    for (int i = 0; i < 80; i++)
+    {
+        inject(0, 0x01);
+    }
+
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 64);
+    /* No new edge, but the remainder is still dispatched */
+    EXPECT_EQ(pldm_reactor_run_once(reactor, -1), 16);
+    EXPECT_EQ(received.size(), 80);
+}
+
+TEST_F(Reactor, budget_ends_on_discarded_message)
+{
+    std::vector<Received> received;
+
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), collect, &received),
+        0);
+
+    /* The last receive of the budget discards a message from an unknown EID */
+    for (int i = 0; i < 63; i++)
+    {
+        inject(0, 0x01);
+    }
+    inject(0, 0x01, 9);
+    for (int i = 0; i < 5; i++)
+    {
+        inject(0, 0x02);
+    }
+
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 63);
+    /* Messages queued behind it are still dispatched without a new edge */
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 0), 5);
+    EXPECT_EQ(received.size(), 68);
+
+    /* A whole budget of discarded messages doesn't strand the next one */
+    for (int i = 0; i < 64; i++)
+    {
+        inject(0, 0x01, 9);
+    }
+    inject(0, 0x03);
+
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 0);
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 0), 1);
+    ASSERT_EQ(received.size(), 69);
+    EXPECT_EQ(received.back().msg[2], 0x03);
+}
+
+static void removeSelf(void* data, struct pldm_transport* transport,
+                       pldm_tid_t tid [[maybe_unused]],
+                       const void* msg [[maybe_unused]],
+                       size_t len [[maybe_unused]])
+{
+    auto* reactor = static_cast<struct pldm_reactor*>(data);
+
+    EXPECT_EQ(pldm_reactor_remove_transport(reactor, transport), 0);
+}
+
+TEST_F(Reactor, remove_from_handler)
+{
+    ASSERT_EQ(
+        pldm_reactor_add_transport(reactor, transport(0), removeSelf, reactor),
+        0);
+
+    inject(0, 0x01);
+    inject(0, 0x02);
+
+    /* Dispatch stops once the transport is removed */
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 1000), 1);
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 0), 0);
+}
+
+struct TimerState
+{
+    struct pldm_reactor* reactor;
+    struct pldm_reactor_timer* timer;
+    int fired;
+    int limit;
+};
+
+static void tick(void* data)
+{
+    auto* state = static_cast<TimerState*>(data);
+
+    if (++state->fired == state->limit)
+    {
+        pldm_reactor_remove_timer(state->reactor, state->timer);
+    }
+}
+
+TEST_F(Reactor, timers)
+{
+    TimerState state{reactor, nullptr, 0, 3};
+    int rc;
+
+    EXPECT_EQ(pldm_reactor_add_timer(reactor, 0, tick, &state, &state.timer),
+              -EINVAL);
+    ASSERT_EQ(pldm_reactor_add_timer(reactor, 5, tick, &state, &state.timer),
+              0);
+
+    while (state.fired < state.limit)
+    {
+        rc = pldm_reactor_run_once(reactor, 1000);
+        ASSERT_GE(rc, 0);
+    }
+
+    /* The timer removed itself, so no further wake-ups occur */
+    EXPECT_EQ(pldm_reactor_run_once(reactor, 50), 0);
+    EXPECT_EQ(state.fired, 3);
+}
+#endif
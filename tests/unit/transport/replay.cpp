@@ -0,0 +1,190 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/capture.h>
+
+#include "transport/replay.h"
+
+#include <endian.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+static const uint8_t getTidReq[] = {0x81, 0x00, 0x02};
+static const uint8_t getTidResp[] = {0x01, 0x00, 0x02, 0x00, 0x09};
+
+class Replay : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        const char magic[8] = PLDM_TRANSPORT_CAPTURE_MAGIC;
+        uint32_t version = htole32(PLDM_TRANSPORT_CAPTURE_VERSION);
+
+        fd = memfd_create("capture", MFD_CLOEXEC);
+        ASSERT_GE(fd, 0);
+
+        append(magic, sizeof(magic));
+        append(&version, sizeof(version));
+        append("\0\0\0\0", 4);
+    }
+
+    void TearDown() override
+    {
+        close(fd);
+    }
+
+    void append(const void* data, size_t len)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+
+        capture.insert(capture.end(), bytes, bytes + len);
+    }
+
+    void record(uint64_t ns, pldm_tid_t tid, uint8_t direction,
+                const void* msg, size_t len)
+    {
+        uint64_t timestamp = htole64(ns);
+        uint32_t length = htole32(len);
+        const uint8_t trailer[] = {tid, direction, 0, 0};
+
+        append(&timestamp, sizeof(timestamp));
+        append(&length, sizeof(length));
+        append(trailer, sizeof(trailer));
+        append(msg, len);
+    }
+
+    void commit()
+    {
+        ASSERT_EQ(write(fd, capture.data(), capture.size()),
+                  (ssize_t)capture.size());
+        ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+    }
+
+    void exchange()
+    {
+        record(1000, 9, PLDM_TRANSPORT_CAPTURE_TX, getTidReq,
+               sizeof(getTidReq));
+        record(20001000, 9, PLDM_TRANSPORT_CAPTURE_RX, getTidResp,
+               sizeof(getTidResp));
+        commit();
+    }
+
+    std::vector<uint8_t> capture;
+    int fd = -1;
+};
+
+TEST_F(Replay, load_invalid)
+{
+    struct pldm_transport_test_descriptor* seq = nullptr;
+    size_t count;
+
+    exchange();
+    EXPECT_EQ(pldm_transport_replay_load(-1, 0, &seq, &count), -EINVAL);
+    EXPECT_EQ(pldm_transport_replay_load(fd, 0, nullptr, &count), -EINVAL);
+    EXPECT_EQ(pldm_transport_replay_load(fd, 0x80, &seq, &count), -EINVAL);
+}
+
+TEST_F(Replay, load_malformed)
+{
+    struct pldm_transport_test_descriptor* seq = nullptr;
+    size_t count;
+
+    /* A record must be complete */
+    record(0, 9, PLDM_TRANSPORT_CAPTURE_RX, getTidResp, sizeof(getTidResp));
+    capture.pop_back();
+    commit();
+    EXPECT_EQ(pldm_transport_replay_load(fd, 0, &seq, &count), -EPROTO);
+
+    /* So must the file header */
+    ASSERT_EQ(ftruncate(fd, 12), 0);
+    ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+    EXPECT_EQ(pldm_transport_replay_load(fd, 0, &seq, &count), -EPROTO);
+
+    /* Directions are limited */
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    capture.resize(16);
+    record(0, 9, 7, getTidResp, sizeof(getTidResp));
+    commit();
+    EXPECT_EQ(pldm_transport_replay_load(fd, 0, &seq, &count), -EPROTO);
+
+    /* As is the magic */
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    capture[0] = 'X';
+    capture.resize(16);
+    commit();
+    EXPECT_EQ(pldm_transport_replay_load(fd, 0, &seq, &count), -EPROTO);
+}
+
+TEST_F(Replay, load_realtime)
+{
+    struct pldm_transport_test_descriptor* seq = nullptr;
+    size_t count;
+
+    exchange();
+    ASSERT_EQ(pldm_transport_replay_load(
+                  fd, PLDM_TRANSPORT_REPLAY_REALTIME, &seq, &count),
+              0);
+    ASSERT_EQ(count, 3);
+    EXPECT_EQ(seq[0].type, PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND);
+    ASSERT_EQ(seq[1].type, PLDM_TRANSPORT_TEST_ELEMENT_LATENCY);
+    EXPECT_EQ(seq[1].latency.it_value.tv_sec, 0);
+    EXPECT_EQ(seq[1].latency.it_value.tv_nsec, 20000000);
+    EXPECT_EQ(seq[2].type, PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV);
+    free(seq);
+}
+
+TEST_F(Replay, maximum_speed)
+{
+    struct pldm_transport_replay* replay = nullptr;
+    size_t len;
+    void* msg;
+
+    exchange();
+    ASSERT_EQ(pldm_transport_replay_init(&replay, fd, 0), 0);
+
+    ASSERT_EQ(pldm_transport_send_recv_msg(pldm_transport_replay_core(replay),
+                                           9, getTidReq, sizeof(getTidReq),
+                                           &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_EQ(len, sizeof(getTidResp));
+    EXPECT_EQ(memcmp(msg, getTidResp, len), 0);
+    free(msg);
+
+    pldm_transport_replay_destroy(replay);
+}
+
+TEST_F(Replay, recorded_speed)
+{
+    struct pldm_transport_replay* replay = nullptr;
+    size_t len;
+    void* msg;
+
+    exchange();
+    ASSERT_EQ(pldm_transport_replay_init(&replay, fd,
+                                         PLDM_TRANSPORT_REPLAY_REALTIME),
+              0);
+
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(pldm_transport_send_recv_msg(pldm_transport_replay_core(replay),
+                                           9, getTidReq, sizeof(getTidReq),
+                                           &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(20));
+    free(msg);
+
+    /* The capture is exhausted */
+    EXPECT_EQ(pldm_transport_send_msg(pldm_transport_replay_core(replay), 9,
+                                      getTidReq, sizeof(getTidReq)),
+              PLDM_REQUESTER_SEND_FAIL);
+
+    pldm_transport_replay_destroy(replay);
+}
+#endif
@@ -0,0 +1,662 @@
+#include <libpldm/api.h>
+#include <libpldm/requester.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/mctp-demux.h>
+
+#include "array.h"
+#include "transport/mctp-demux-internal.h"
+#include "transport/test.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+struct Completion
+{
+    int calls = 0;
+    int rc = 1;
+    pldm_tid_t tid = 0;
+    std::vector<uint8_t> resp;
+};
+
+static void complete(void* data, int rc, pldm_tid_t tid, const void* resp_msg,
+                     size_t resp_len)
+{
+    auto* c = static_cast<Completion*>(data);
+    const auto* resp = static_cast<const uint8_t*>(resp_msg);
+
+    c->calls++;
+    c->rc = rc;
+    c->tid = tid;
+    if (resp)
+    {
+        c->resp.assign(resp, resp + resp_len);
+    }
+}
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, init_invalid)
+{
+    struct pldm_requester* requester = nullptr;
+
+    EXPECT_EQ(pldm_requester_init(nullptr, nullptr), -EINVAL);
+    EXPECT_EQ(pldm_requester_init(&requester, nullptr), -EINVAL);
+    pldm_requester_destroy(nullptr);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, interleaved_responses)
+{
+    uint8_t req1[] = {0x81, 0x00, 0x02};
+    uint8_t req2[] = {0x81, 0x00, 0x02};
+    uint8_t resp1[] = {0x01, 0x00, 0x02, 0x00, 0x01};
+    uint8_t resp2[] = {0x01, 0x00, 0x02, 0x00, 0x02};
+    uint8_t unrelated[] = {0x05, 0x00, 0x02, 0x00, 0x03};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req1, .len = sizeof(req1)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 2, .msg = req2, .len = sizeof(req2)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 2, .msg = resp2, .len = sizeof(resp2)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 3, .msg = unrelated, .len = sizeof(unrelated)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 1, .msg = resp1, .len = sizeof(resp1)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    Completion c1;
+    Completion c2;
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req1, sizeof(req1),
+                                    complete, &c1),
+              0);
+    ASSERT_EQ(pldm_requester_submit(requester, 2, req2, sizeof(req2),
+                                    complete, &c2),
+              0);
+
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    EXPECT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 0);
+    EXPECT_EQ(c1.calls, 0);
+    EXPECT_EQ(c2.calls, 1);
+    EXPECT_EQ(c2.rc, 0);
+    EXPECT_EQ(c2.tid, 2);
+    EXPECT_EQ(c2.resp, std::vector<uint8_t>(resp2, resp2 + sizeof(resp2)));
+
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    ASSERT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 1);
+    EXPECT_EQ(tid, 3);
+    ASSERT_EQ(len, sizeof(unrelated));
+    EXPECT_EQ(memcmp(msg, unrelated, len), 0);
+    free(msg);
+
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    EXPECT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 0);
+    EXPECT_EQ(c1.calls, 1);
+    EXPECT_EQ(c1.rc, 0);
+    EXPECT_EQ(c1.tid, 1);
+    EXPECT_EQ(c1.resp, std::vector<uint8_t>(resp1, resp1 + sizeof(resp1)));
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, duplicate_and_cancel)
+{
+    uint8_t req[] = {0x81, 0x00, 0x02};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    Completion c;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+
+    ASSERT_EQ(
+        pldm_requester_submit(requester, 1, req, sizeof(req), complete, &c),
+        0);
+    EXPECT_EQ(
+        pldm_requester_submit(requester, 1, req, sizeof(req), complete, &c),
+        -EBUSY);
+    EXPECT_EQ(pldm_requester_cancel(requester, 2, req, sizeof(req)), -ENOENT);
+    EXPECT_EQ(pldm_requester_cancel(requester, 1, req, sizeof(req)), 0);
+    EXPECT_EQ(c.calls, 1);
+    EXPECT_EQ(c.rc, -ECANCELED);
+    EXPECT_EQ(pldm_requester_cancel(requester, 1, req, sizeof(req)), -ENOENT);
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, destroy_cancels_outstanding)
+{
+    uint8_t req[] = {0x81, 0x00, 0x02};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    Completion c;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+    ASSERT_EQ(
+        pldm_requester_submit(requester, 1, req, sizeof(req), complete, &c),
+        0);
+    pldm_requester_destroy(requester);
+    EXPECT_EQ(c.calls, 1);
+    EXPECT_EQ(c.rc, -ECANCELED);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, send_recv_retains_unclaimed)
+{
+    uint8_t req[] = {0x82, 0x00, 0x02};
+    uint8_t resp[] = {0x02, 0x00, 0x02, 0x00, 0x01};
+    uint8_t unrelated[] = {0x02, 0x00, 0x02, 0x00, 0x02};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 2, .msg = unrelated, .len = sizeof(unrelated)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 1, .msg = resp, .len = sizeof(resp)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+
+    ASSERT_EQ(
+        pldm_requester_send_recv(requester, 1, req, sizeof(req), &msg, &len),
+        0);
+    ASSERT_EQ(len, sizeof(resp));
+    EXPECT_EQ(memcmp(msg, resp, len), 0);
+    free(msg);
+
+    /* The response from TID 2 was kept rather than discarded */
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    ASSERT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 1);
+    EXPECT_EQ(tid, 2);
+    ASSERT_EQ(len, sizeof(unrelated));
+    EXPECT_EQ(memcmp(msg, unrelated, len), 0);
+    free(msg);
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, retry_policy_invalid)
+{
+    static const struct pldm_requester_retry_policy invalid[] = {
+        {.timeout_ms = 100, .retries = 0, .backoff = 1},
+        {.timeout_ms = 5000, .retries = 0, .backoff = 1},
+        {.timeout_ms = 1000, .retries = 1, .backoff = 0},
+        {.timeout_ms = 1000, .retries = 2, .backoff = 4},
+        {.timeout_ms = 2000, .retries = 3, .backoff = 1},
+    };
+    static const struct pldm_requester_retry_policy valid = {
+        .timeout_ms = 1000, .retries = 2, .backoff = 2};
+    uint8_t req[] = {0x81, 0x00, 0x02};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+
+    EXPECT_EQ(pldm_requester_set_retry_policy(requester, 1, nullptr), -EINVAL);
+    for (const auto& policy : invalid)
+    {
+        EXPECT_EQ(pldm_requester_set_retry_policy(requester, 1, &policy),
+                  -EINVAL);
+    }
+    EXPECT_EQ(pldm_requester_set_retry_policy(requester, 1, &valid), 0);
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, retry_then_timeout)
+{
+    static const struct pldm_requester_retry_policy policy = {
+        .timeout_ms = 300, .retries = 1, .backoff = 1};
+    uint8_t req[] = {0x81, 0x00, 0x02};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_LATENCY,
+            .latency = {.it_interval = {0, 0}, .it_value = {2, 0}},
+        },
+        /* The retry reuses the instance ID of the original request */
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_LATENCY,
+            .latency = {.it_interval = {0, 0}, .it_value = {2, 0}},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    Completion c;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+    ASSERT_EQ(pldm_requester_set_retry_policy(requester, 1, &policy), 0);
+    ASSERT_EQ(pldm_transport_stats_enable(pldm_transport_test_core(test)), 0);
+    ASSERT_EQ(
+        pldm_requester_submit(requester, 1, req, sizeof(req), complete, &c),
+        0);
+
+    while (!c.calls)
+    {
+        ASSERT_EQ(pldm_requester_poll(requester, -1), 0);
+    }
+    EXPECT_EQ(c.rc, -ETIMEDOUT);
+
+    /* Both attempts are accounted to the TID */
+    struct pldm_transport_stats stats{};
+    ASSERT_EQ(pldm_transport_stats_snapshot_tid(pldm_transport_test_core(test),
+                                                1, &stats),
+              0);
+    EXPECT_EQ(stats.tx_msgs, 2);
+    EXPECT_EQ(stats.timeouts, 2);
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, send_recv_timeout)
+{
+    static const struct pldm_requester_retry_policy policy = {
+        .timeout_ms = 300, .retries = 0, .backoff = 1};
+    uint8_t req[] = {0x81, 0x00, 0x02};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req, .len = sizeof(req)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_LATENCY,
+            .latency = {.it_interval = {0, 0}, .it_value = {2, 0}},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+    ASSERT_EQ(pldm_requester_set_retry_policy(requester, 1, &policy), 0);
+    EXPECT_EQ(
+        pldm_requester_send_recv(requester, 1, req, sizeof(req), &msg, &len),
+        -ETIMEDOUT);
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, send_recv_hangup)
+{
+    static const struct pldm_requester_retry_policy policy = {
+        .timeout_ms = 4800, .retries = 0, .backoff = 1};
+    struct pldm_transport_mctp_demux* demux;
+    struct pldm_requester* requester = nullptr;
+    uint8_t req[] = {0x81, 0x00, 0x02};
+    std::array<int, 2> fds{};
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds.data()), 0);
+    demux = pldm_transport_mctp_demux_init_with_fd(fds[0]);
+    ASSERT_NE(demux, nullptr);
+    ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 1, 8), 0);
+    ASSERT_EQ(
+        pldm_requester_init(&requester, pldm_transport_mctp_demux_core(demux)),
+        0);
+    ASSERT_EQ(pldm_requester_set_retry_policy(requester, 1, &policy), 0);
+
+    /* The peer goes away after taking the request */
+    std::thread peer([&]() {
+        uint8_t buf[16];
+
+        EXPECT_GT(read(fds[1], buf, sizeof(buf)), 0);
+        close(fds[1]);
+    });
+
+    EXPECT_EQ(
+        pldm_requester_send_recv(requester, 1, req, sizeof(req), &msg, &len),
+        -EIO);
+    peer.join();
+
+    pldm_requester_destroy(requester);
+    pldm_transport_mctp_demux_destroy(demux);
+    close(fds[0]);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, coalesces_identical_requests)
+{
+    /* GetSensorReading for sensor 1, and for sensor 2 */
+    uint8_t req1[] = {0x81, 0x02, 0x11, 0x01, 0x00, 0x00};
+    uint8_t req2[] = {0x82, 0x02, 0x11, 0x01, 0x00, 0x00};
+    uint8_t req3[] = {0x83, 0x02, 0x11, 0x02, 0x00, 0x00};
+    uint8_t resp1[] = {0x01, 0x02, 0x11, 0x00, 0x01};
+    uint8_t resp3[] = {0x03, 0x02, 0x11, 0x00, 0x03};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req1, .len = sizeof(req1)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req3, .len = sizeof(req3)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 1, .msg = resp1, .len = sizeof(resp1)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 1, .msg = resp3, .len = sizeof(resp3)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    Completion c1;
+    Completion c2;
+    Completion c3;
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+
+    EXPECT_EQ(pldm_requester_set_coalescing(nullptr, 0x02, 0x11, true),
+              -EINVAL);
+    EXPECT_EQ(pldm_requester_set_coalescing(requester, 64, 0x11, true),
+              -EINVAL);
+    ASSERT_EQ(pldm_requester_set_coalescing(requester, 0x02, 0x11, true), 0);
+
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req1, sizeof(req1),
+                                    complete, &c1),
+              0);
+    /* Attached to the first request rather than sent */
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req2, sizeof(req2),
+                                    complete, &c2),
+              0);
+    /* A different payload is a different query */
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req3, sizeof(req3),
+                                    complete, &c3),
+              0);
+
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    EXPECT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 0);
+    EXPECT_EQ(c1.calls, 1);
+    EXPECT_EQ(c1.rc, 0);
+    EXPECT_EQ(c1.resp, std::vector<uint8_t>(resp1, resp1 + sizeof(resp1)));
+    EXPECT_EQ(c2.calls, 1);
+    EXPECT_EQ(c2.rc, 0);
+    EXPECT_EQ(c2.tid, 1);
+    EXPECT_EQ(c2.resp, c1.resp);
+    EXPECT_EQ(c3.calls, 0);
+
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    EXPECT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 0);
+    EXPECT_EQ(c3.calls, 1);
+    EXPECT_EQ(c3.resp, std::vector<uint8_t>(resp3, resp3 + sizeof(resp3)));
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, coalesced_cancel)
+{
+    uint8_t req1[] = {0x81, 0x02, 0x11, 0x01, 0x00, 0x00};
+    uint8_t req2[] = {0x82, 0x02, 0x11, 0x01, 0x00, 0x00};
+    uint8_t req3[] = {0x83, 0x02, 0x11, 0x01, 0x00, 0x00};
+    uint8_t req4[] = {0x84, 0x02, 0x11, 0x01, 0x00, 0x00};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req1, .len = sizeof(req1)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req4, .len = sizeof(req4)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    Completion c1;
+    Completion c2;
+    Completion c3;
+    Completion c4;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+    ASSERT_EQ(pldm_requester_set_coalescing(requester, 0x02, 0x11, true), 0);
+
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req1, sizeof(req1),
+                                    complete, &c1),
+              0);
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req2, sizeof(req2),
+                                    complete, &c2),
+              0);
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req3, sizeof(req3),
+                                    complete, &c3),
+              0);
+
+    /* The instance IDs of attached requests are reserved */
+    EXPECT_EQ(pldm_requester_submit(requester, 1, req2, sizeof(req2),
+                                    complete, &c4),
+              -EBUSY);
+
+    /* Cancelling an attached request leaves the others waiting */
+    EXPECT_EQ(pldm_requester_cancel(requester, 1, req2, sizeof(req2)), 0);
+    EXPECT_EQ(c2.calls, 1);
+    EXPECT_EQ(c2.rc, -ECANCELED);
+    EXPECT_EQ(pldm_requester_cancel(requester, 1, req2, sizeof(req2)),
+              -ENOENT);
+
+    /* The request that was sent can't be cancelled while others wait on it */
+    EXPECT_EQ(pldm_requester_cancel(requester, 1, req1, sizeof(req1)),
+              -EBUSY);
+    EXPECT_EQ(c1.calls, 0);
+    EXPECT_EQ(c3.calls, 0);
+
+    /* Once disabled, identical requests are sent */
+    ASSERT_EQ(pldm_requester_set_coalescing(requester, 0x02, 0x11, false), 0);
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req4, sizeof(req4),
+                                    complete, &c4),
+              0);
+
+    pldm_requester_destroy(requester);
+    EXPECT_EQ(c1.calls, 1);
+    EXPECT_EQ(c1.rc, -ECANCELED);
+    EXPECT_EQ(c3.calls, 1);
+    EXPECT_EQ(c3.rc, -ECANCELED);
+    EXPECT_EQ(c4.calls, 1);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Requester, adaptive_timeout)
+{
+    uint8_t req1[] = {0x81, 0x00, 0x02};
+    uint8_t resp1[] = {0x01, 0x00, 0x02, 0x00, 0x01};
+    uint8_t req2[] = {0x82, 0x00, 0x02};
+    uint8_t req3[] = {0x83, 0x00, 0x02};
+    uint8_t resp3[] = {0x03, 0x00, 0x02, 0x00, 0x01};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req1, .len = sizeof(req1)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 1, .msg = resp1, .len = sizeof(resp1)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req2, .len = sizeof(req2)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_LATENCY,
+            .latency = {.it_interval = {0, 0}, .it_value = {1, 0}},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg = {.dst = 1, .msg = req3, .len = sizeof(req3)},
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg = {.src = 1, .msg = resp3, .len = sizeof(resp3)},
+        },
+    };
+    struct pldm_requester* requester = nullptr;
+    struct pldm_transport_test* test = nullptr;
+    struct pldm_requester_rtt rtt{};
+    Completion c1;
+    Completion c2;
+    Completion c3;
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ASSERT_EQ(pldm_requester_init(&requester, pldm_transport_test_core(test)),
+              0);
+    EXPECT_EQ(pldm_requester_set_adaptive_timeout(nullptr, 1, true), -EINVAL);
+    EXPECT_EQ(pldm_requester_get_rtt(requester, 1, nullptr), -EINVAL);
+    ASSERT_EQ(pldm_requester_set_adaptive_timeout(requester, 1, true), 0);
+
+    /* Without samples the policy's time-out applies */
+    ASSERT_EQ(pldm_requester_get_rtt(requester, 1, &rtt), 0);
+    EXPECT_EQ(rtt.srtt_us, 0);
+    EXPECT_EQ(rtt.timeout_ms, 4800);
+
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req1, sizeof(req1),
+                                    complete, &c1),
+              0);
+    ASSERT_EQ(pldm_requester_poll(requester, 0), 1);
+    ASSERT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 0);
+
+    /* A prompt terminus is given PT2min, unlike those not adapting */
+    ASSERT_EQ(pldm_requester_get_rtt(requester, 1, &rtt), 0);
+    EXPECT_LT(rtt.srtt_us, 300000);
+    EXPECT_EQ(rtt.timeout_ms, 300);
+    EXPECT_FALSE(rtt.degraded);
+    ASSERT_EQ(pldm_requester_get_rtt(requester, 2, &rtt), 0);
+    EXPECT_EQ(rtt.timeout_ms, 4800);
+
+    /* An unanswered request fails after PT2min and degrades the TID */
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req2, sizeof(req2),
+                                    complete, &c2),
+              0);
+    while (!c2.calls)
+    {
+        ASSERT_EQ(pldm_requester_poll(requester, -1), 0);
+    }
+    EXPECT_EQ(c2.rc, -ETIMEDOUT);
+    ASSERT_EQ(pldm_requester_get_rtt(requester, 1, &rtt), 0);
+    EXPECT_TRUE(rtt.degraded);
+    EXPECT_EQ(rtt.timeout_ms, 300);
+
+    /* A response restores it */
+    ASSERT_EQ(pldm_requester_submit(requester, 1, req3, sizeof(req3),
+                                    complete, &c3),
+              0);
+    ASSERT_EQ(pldm_requester_poll(requester, -1), 1);
+    ASSERT_EQ(pldm_requester_recv(requester, &tid, &msg, &len), 0);
+    EXPECT_EQ(c3.rc, 0);
+    ASSERT_EQ(pldm_requester_get_rtt(requester, 1, &rtt), 0);
+    EXPECT_FALSE(rtt.degraded);
+
+    pldm_requester_destroy(requester);
+    pldm_transport_test_destroy(test);
+}
+#endif
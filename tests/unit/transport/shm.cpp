@@ -0,0 +1,394 @@
+#include <libpldm/api.h>
+#include <libpldm/base.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/shm.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+class Shm : public testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        create(256);
+    }
+
+    void TearDown() override
+    {
+        for (auto* endpoint : endpoints)
+        {
+            pldm_transport_shm_destroy(endpoint);
+        }
+        for (int efd : efds)
+        {
+            close(efd);
+        }
+        if (memfd >= 0)
+        {
+            close(memfd);
+        }
+    }
+
+    void create(size_t ringSize)
+    {
+        memfd = pldm_transport_shm_region_create(tids.data(), tids.size(),
+                                                 ringSize);
+        ASSERT_GE(memfd, 0);
+
+        for (size_t i = 0; i < tids.size(); i++)
+        {
+            efds[i] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            ASSERT_GE(efds[i], 0);
+        }
+
+        for (size_t i = 0; i < tids.size(); i++)
+        {
+            ASSERT_EQ(pldm_transport_shm_init(&endpoints[i], memfd, tids[i],
+                                              efds.data(), efds.size()),
+                      0);
+        }
+    }
+
+    struct pldm_transport* transport(size_t i)
+    {
+        return pldm_transport_shm_core(endpoints[i]);
+    }
+
+    bool ready(size_t i, int timeout)
+    {
+        struct pollfd pollfd;
+
+        EXPECT_EQ(pldm_transport_shm_init_pollfd(transport(i), &pollfd), 0);
+
+        return poll(&pollfd, 1, timeout) == 1;
+    }
+
+    const std::array<pldm_tid_t, 3> tids{1, 2, 3};
+    std::array<int, 3> efds{-1, -1, -1};
+    std::array<struct pldm_transport_shm*, 3> endpoints{};
+    int memfd = -1;
+};
+
+TEST(ShmRegion, invalid)
+{
+    const pldm_tid_t tids[] = {1, 2};
+    const pldm_tid_t dup[] = {1, 1};
+    const pldm_tid_t zero[] = {0, 1};
+
+    EXPECT_EQ(pldm_transport_shm_region_create(nullptr, 2, 256), -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_region_create(tids, 0, 256), -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_region_create(
+                  tids, PLDM_TRANSPORT_SHM_ENDPOINTS_MAX + 1, 256),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_region_create(tids, 2, 128), -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_region_create(tids, 2, 300), -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_region_create(dup, 2, 256), -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_region_create(zero, 2, 256), -EINVAL);
+}
+
+TEST(ShmInit, invalid)
+{
+    const pldm_tid_t tids[] = {1, 2};
+    struct pldm_transport_shm* ctx = nullptr;
+    std::array<int, 2> efds{};
+    int memfd;
+    int raw;
+
+    for (auto& efd : efds)
+    {
+        efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        ASSERT_GE(efd, 0);
+    }
+
+    memfd = pldm_transport_shm_region_create(tids, 2, 256);
+    ASSERT_GE(memfd, 0);
+
+    EXPECT_EQ(pldm_transport_shm_init(nullptr, memfd, 1, efds.data(), 2),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_init(&ctx, memfd, 1, nullptr, 2), -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_init(&ctx, memfd, 1, efds.data(), 1),
+              -EINVAL);
+    EXPECT_EQ(pldm_transport_shm_init(&ctx, memfd, 3, efds.data(), 2),
+              -EINVAL);
+
+    /* Regions that peers could truncate are refused */
+    raw = memfd_create("raw", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    ASSERT_GE(raw, 0);
+    ASSERT_EQ(ftruncate(raw, 4096), 0);
+    EXPECT_EQ(pldm_transport_shm_init(&ctx, raw, 1, efds.data(), 2), -EPROTO);
+    close(raw);
+
+    ASSERT_EQ(pldm_transport_shm_init(&ctx, memfd, 1, efds.data(), 2), 0);
+    EXPECT_EQ(pldm_transport_shm_init(&ctx, memfd, 1, efds.data(), 2),
+              -EINVAL);
+    pldm_transport_shm_destroy(ctx);
+    pldm_transport_shm_destroy(nullptr);
+
+    close(memfd);
+    for (int efd : efds)
+    {
+        close(efd);
+    }
+}
+
+TEST_F(Shm, send_recv)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x02};
+    pldm_tid_t tid = 0;
+    void* msg = nullptr;
+    size_t len = 0;
+
+    EXPECT_FALSE(ready(1, 0));
+    errno = 0;
+    EXPECT_EQ(pldm_transport_recv_msg(transport(1), &tid, &msg, &len),
+              PLDM_REQUESTER_RECV_FAIL);
+    EXPECT_EQ(errno, EAGAIN);
+
+    ASSERT_EQ(pldm_transport_send_msg(transport(0), 2, req, sizeof(req)),
+              PLDM_REQUESTER_SUCCESS);
+    ASSERT_TRUE(ready(1, 0));
+    EXPECT_FALSE(ready(2, 0));
+
+    ASSERT_EQ(pldm_transport_recv_msg(transport(1), &tid, &msg, &len),
+              PLDM_REQUESTER_SUCCESS);
+    EXPECT_EQ(tid, 1);
+    ASSERT_EQ(len, sizeof(req));
+    EXPECT_EQ(memcmp(msg, req, sizeof(req)), 0);
+    free(msg);
+
+    /* Readiness clears once the ring is found empty */
+    EXPECT_EQ(pldm_transport_recv_msg(transport(1), &tid, &msg, &len),
+              PLDM_REQUESTER_RECV_FAIL);
+    EXPECT_FALSE(ready(1, 0));
+
+    /* Unknown TIDs are refused */
+    errno = 0;
+    EXPECT_EQ(pldm_transport_send_msg(transport(0), 9, req, sizeof(req)),
+              PLDM_REQUESTER_SEND_FAIL);
+    EXPECT_EQ(errno, ENOENT);
+}
+
+TEST_F(Shm, full_and_oversized)
+{
+    std::vector<uint8_t> msg(56, 0x81);
+    std::vector<uint8_t> large(128, 0x81);
+    int sent = 0;
+
+    errno = 0;
+    EXPECT_EQ(pldm_transport_send_msg(transport(0), 2, large.data(),
+                                      large.size()),
+              PLDM_REQUESTER_SEND_FAIL);
+    EXPECT_EQ(errno, EMSGSIZE);
+
+    while (pldm_transport_send_msg(transport(0), 2, msg.data(), msg.size()) ==
+           PLDM_REQUESTER_SUCCESS)
+    {
+        sent++;
+    }
+    EXPECT_EQ(errno, EAGAIN);
+    EXPECT_EQ(sent, 4);
+
+    /* Draining one message makes room for another */
+    pldm_tid_t tid;
+    size_t len;
+    void* buf;
+    ASSERT_EQ(pldm_transport_recv_msg(transport(1), &tid, &buf, &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(buf);
+    EXPECT_EQ(pldm_transport_send_msg(transport(0), 2, msg.data(), msg.size()),
+              PLDM_REQUESTER_SUCCESS);
+}
+
+TEST_F(Shm, wraps)
+{
+    std::vector<uint8_t> msg;
+    pldm_tid_t tid;
+    size_t len;
+    void* buf;
+
+    /* Odd lengths exercise padding at the end of the ring */
+    for (int i = 0; i < 1000; i++)
+    {
+        msg.assign(3 + i % 61, 0x81);
+        msg.back() = static_cast<uint8_t>(i);
+
+        ASSERT_EQ(pldm_transport_send_msg(transport(2), 1, msg.data(),
+                                          msg.size()),
+                  PLDM_REQUESTER_SUCCESS);
+        ASSERT_EQ(pldm_transport_recv_msg(transport(0), &tid, &buf, &len),
+                  PLDM_REQUESTER_SUCCESS);
+        EXPECT_EQ(tid, 3);
+        ASSERT_EQ(len, msg.size());
+        EXPECT_EQ(memcmp(buf, msg.data(), len), 0);
+        free(buf);
+    }
+}
+
+TEST_F(Shm, batch)
+{
+    const uint8_t hdr[] = {0x81, 0x00};
+    std::array<uint8_t, 3> cmds{0x01, 0x02, 0x03};
+    std::array<std::array<struct iovec, 2>, 3> iovs{};
+    std::array<struct pldm_transport_msgv, 3> out{};
+    std::array<std::array<uint8_t, 8>, 4> bufs{};
+    std::array<struct pldm_transport_msg, 4> in{};
+    uint8_t large[16] = {0x81, 0x00, 0x04};
+
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        iovs[i][0] = {const_cast<uint8_t*>(hdr), sizeof(hdr)};
+        iovs[i][1] = {&cmds[i], 1};
+        out[i] = {iovs[i].data(), iovs[i].size(), 2};
+    }
+
+    ASSERT_EQ(pldm_transport_send_batch(transport(0), out.data(), out.size()),
+              3);
+    ASSERT_EQ(pldm_transport_send_msg(transport(2), 2, large, sizeof(large)),
+              PLDM_REQUESTER_SUCCESS);
+
+    for (size_t i = 0; i < in.size(); i++)
+    {
+        in[i].msg = bufs[i].data();
+        in[i].len = bufs[i].size();
+    }
+
+    /* The last message is too large for the buffers and is dropped */
+    ASSERT_TRUE(ready(1, 0));
+    ASSERT_EQ(pldm_transport_recv_batch(transport(1), in.data(), in.size()),
+              3);
+    for (size_t i = 0; i < 3; i++)
+    {
+        EXPECT_EQ(in[i].tid, 1);
+        EXPECT_EQ(in[i].len, 3);
+        EXPECT_EQ(bufs[i][2], cmds[i]);
+    }
+    EXPECT_EQ(pldm_transport_recv_batch(transport(1), in.data(), in.size()),
+              -EAGAIN);
+}
+
+TEST_F(Shm, producers)
+{
+    constexpr int count = 5000;
+    std::array<int, 3> expected{};
+    std::vector<std::thread> producers;
+
+    TearDown();
+    endpoints = {};
+    create(4096);
+
+    for (size_t p = 1; p < 3; p++)
+    {
+        producers.emplace_back([this, p]() {
+            for (int i = 0; i < count; i++)
+            {
+                const uint8_t req[] = {0x81, 0x00, static_cast<uint8_t>(i),
+                                       static_cast<uint8_t>(i >> 8)};
+
+                while (pldm_transport_send_msg(transport(p), 1, req,
+                                               sizeof(req)) !=
+                       PLDM_REQUESTER_SUCCESS)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 2 * count; i++)
+    {
+        pldm_tid_t tid;
+        size_t len;
+        void* msg;
+
+        while (pldm_transport_recv_msg(transport(0), &tid, &msg, &len) !=
+               PLDM_REQUESTER_SUCCESS)
+        {
+            ASSERT_TRUE(ready(0, 5000));
+        }
+
+        /* Messages from each producer arrive in order */
+        const auto* bytes = static_cast<const uint8_t*>(msg);
+        ASSERT_TRUE(tid == 2 || tid == 3);
+        ASSERT_EQ(len, 4);
+        EXPECT_EQ(bytes[2] | bytes[3] << 8, expected[tid - 1]++);
+        free(msg);
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+}
+
+TEST_F(Shm, across_processes)
+{
+    constexpr int count = 1000;
+    pid_t pid;
+    int status;
+
+    pid = fork();
+    ASSERT_GE(pid, 0);
+    if (!pid)
+    {
+        struct pldm_transport_shm* child = nullptr;
+
+        /* Attach afresh, as an unrelated daemon would */
+        if (pldm_transport_shm_init(&child, memfd, 2, efds.data(),
+                                    efds.size()))
+        {
+            _exit(1);
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            const uint8_t req[] = {0x81, 0x00, static_cast<uint8_t>(i)};
+
+            while (pldm_transport_send_msg(pldm_transport_shm_core(child), 1,
+                                           req, sizeof(req)) !=
+                   PLDM_REQUESTER_SUCCESS)
+            {
+                usleep(100);
+            }
+        }
+
+        pldm_transport_shm_destroy(child);
+        _exit(0);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        pldm_tid_t tid;
+        size_t len;
+        void* msg;
+
+        while (pldm_transport_recv_msg(transport(0), &tid, &msg, &len) !=
+               PLDM_REQUESTER_SUCCESS)
+        {
+            ASSERT_TRUE(ready(0, 5000));
+        }
+
+        EXPECT_EQ(tid, 2);
+        ASSERT_EQ(len, 3);
+        EXPECT_EQ(static_cast<uint8_t*>(msg)[2], static_cast<uint8_t>(i));
+        free(msg);
+    }
+
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+#endif
@@ -0,0 +1,186 @@
+#include <libpldm/api.h>
+#include <libpldm/transport.h>
+#include <libpldm/transport/mctp-demux.h>
+
+#include "array.h"
+#include "mctp-defines.h"
+#include "transport/mctp-demux-internal.h"
+#include "transport/test.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <numeric>
+
+#include <gtest/gtest.h>
+
+#if HAVE_LIBPLDM_API_TESTING
+static uint64_t rttSamples(const struct pldm_transport_stats& stats)
+{
+    return std::accumulate(std::begin(stats.rtt), std::end(stats.rtt),
+                           uint64_t{0});
+}
+
+TEST(TransportStats, enable_disable)
+{
+    struct pldm_transport_test* test = nullptr;
+    struct pldm_transport_stats stats{};
+    struct pldm_transport* ctx;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, nullptr, 0), 0);
+    ctx = pldm_transport_test_core(test);
+
+    EXPECT_EQ(pldm_transport_stats_enable(nullptr), -EINVAL);
+    EXPECT_EQ(pldm_transport_stats_snapshot(ctx, &stats), -ENODATA);
+    EXPECT_EQ(pldm_transport_stats_snapshot_tid(ctx, 1, &stats), -ENODATA);
+
+    ASSERT_EQ(pldm_transport_stats_enable(ctx), 0);
+    EXPECT_EQ(pldm_transport_stats_enable(ctx), -EBUSY);
+    EXPECT_EQ(pldm_transport_stats_snapshot(ctx, nullptr), -EINVAL);
+    EXPECT_EQ(pldm_transport_stats_snapshot(ctx, &stats), 0);
+    EXPECT_EQ(stats.tx_msgs, 0);
+
+    pldm_transport_stats_disable(ctx);
+    EXPECT_EQ(pldm_transport_stats_snapshot(ctx, &stats), -ENODATA);
+
+    /* Destroying the transport releases enabled statistics */
+    ASSERT_EQ(pldm_transport_stats_enable(ctx), 0);
+    pldm_transport_test_destroy(test);
+}
+
+TEST(TransportStats, send_recv)
+{
+    const uint8_t req[] = {0x81, 0x00, 0x01, 0x01};
+    const uint8_t other[] = {0x02, 0x00, 0x01, 0x00};
+    const uint8_t resp[] = {0x01, 0x00, 0x01, 0x00};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg =
+                {
+                    .dst = 1,
+                    .msg = req,
+                    .len = sizeof(req),
+                },
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = 2,
+                    .msg = other,
+                    .len = sizeof(other),
+                },
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = 1,
+                    .msg = resp,
+                    .len = sizeof(resp),
+                },
+        },
+    };
+    struct pldm_transport_test* test = nullptr;
+    struct pldm_transport_stats stats{};
+    struct pldm_transport* ctx;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ctx = pldm_transport_test_core(test);
+    ASSERT_EQ(pldm_transport_stats_enable(ctx), 0);
+
+    ASSERT_EQ(pldm_transport_send_recv_msg(ctx, 1, req, sizeof(req), &msg,
+                                           &len),
+              PLDM_REQUESTER_SUCCESS);
+    free(msg);
+
+    ASSERT_EQ(pldm_transport_stats_snapshot(ctx, &stats), 0);
+    EXPECT_EQ(stats.tx_msgs, 1);
+    EXPECT_EQ(stats.tx_bytes, sizeof(req));
+    EXPECT_EQ(stats.rx_msgs, 2);
+    EXPECT_EQ(stats.rx_bytes, sizeof(other) + sizeof(resp));
+    EXPECT_EQ(stats.rx_discarded, 1);
+    EXPECT_EQ(stats.timeouts, 0);
+    EXPECT_EQ(rttSamples(stats), 1);
+
+    ASSERT_EQ(pldm_transport_stats_snapshot_tid(ctx, 1, &stats), 0);
+    EXPECT_EQ(stats.tx_msgs, 1);
+    EXPECT_EQ(stats.rx_msgs, 1);
+    EXPECT_EQ(stats.rx_discarded, 0);
+    EXPECT_EQ(rttSamples(stats), 1);
+
+    /* The unrelated message is attributed to its source */
+    ASSERT_EQ(pldm_transport_stats_snapshot_tid(ctx, 2, &stats), 0);
+    EXPECT_EQ(stats.tx_msgs, 0);
+    EXPECT_EQ(stats.rx_msgs, 1);
+    EXPECT_EQ(stats.rx_discarded, 1);
+    EXPECT_EQ(rttSamples(stats), 0);
+
+    pldm_transport_test_destroy(test);
+}
+
+TEST(TransportStats, drops)
+{
+    struct pldm_transport_mctp_demux* demux;
+    struct pldm_transport_stats stats{};
+    std::array<struct pldm_transport_msg, 4> msgs{};
+    std::array<int, 2> fds{};
+    struct pldm_transport* ctx;
+    uint8_t bufs[4][8];
+    pldm_tid_t tid;
+    size_t len;
+    void* msg;
+
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds.data()), 0);
+    demux = pldm_transport_mctp_demux_init_with_fd(fds[0]);
+    ASSERT_NE(demux, nullptr);
+    ASSERT_EQ(pldm_transport_mctp_demux_map_tid(demux, 1, 8), 0);
+    ctx = pldm_transport_mctp_demux_core(demux);
+    ASSERT_EQ(pldm_transport_stats_enable(ctx), 0);
+
+    const uint8_t notPldm[] = {8, 0x7e, 0x01, 0x00, 0x02};
+    const uint8_t shortMsg[] = {8, MCTP_MSG_TYPE_PLDM, 0x01};
+    const uint8_t valid[] = {8, MCTP_MSG_TYPE_PLDM, 0x01, 0x00, 0x02};
+
+    /* Through the single message path */
+    ASSERT_EQ(write(fds[1], notPldm, sizeof(notPldm)),
+              (ssize_t)sizeof(notPldm));
+    ASSERT_EQ(write(fds[1], shortMsg, sizeof(shortMsg)),
+              (ssize_t)sizeof(shortMsg));
+    EXPECT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_NOT_PLDM_MSG);
+    EXPECT_EQ(pldm_transport_recv_msg(ctx, &tid, &msg, &len),
+              PLDM_REQUESTER_INVALID_RECV_LEN);
+
+    /* Through the batch path */
+    ASSERT_EQ(write(fds[1], notPldm, sizeof(notPldm)),
+              (ssize_t)sizeof(notPldm));
+    ASSERT_EQ(write(fds[1], shortMsg, sizeof(shortMsg)),
+              (ssize_t)sizeof(shortMsg));
+    ASSERT_EQ(write(fds[1], valid, sizeof(valid)), (ssize_t)sizeof(valid));
+    for (size_t i = 0; i < msgs.size(); i++)
+    {
+        msgs[i].msg = bufs[i];
+        msgs[i].len = sizeof(bufs[i]);
+    }
+    EXPECT_EQ(pldm_transport_recv_batch(ctx, msgs.data(), msgs.size()), 1);
+
+    ASSERT_EQ(pldm_transport_stats_snapshot(ctx, &stats), 0);
+    EXPECT_EQ(stats.rx_not_pldm, 2);
+    EXPECT_EQ(stats.rx_invalid_len, 2);
+    EXPECT_EQ(stats.rx_msgs, 1);
+    EXPECT_EQ(stats.rx_bytes, sizeof(valid) - 2);
+
+    ASSERT_EQ(pldm_transport_stats_snapshot_tid(ctx, 1, &stats), 0);
+    EXPECT_EQ(stats.rx_msgs, 1);
+    EXPECT_EQ(stats.rx_not_pldm, 0);
+
+    pldm_transport_mctp_demux_destroy(demux);
+    close(fds[0]);
+    close(fds[1]);
+}
+#endif
@@ -2,6 +2,12 @@
 
 #include "array.h"
 #include "transport/test.h"
+#include "transport/transport.h"
+
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstdlib>
 
 #include <gtest/gtest.h>
 
@@ -39,6 +45,56 @@ TEST(Transport, send_one)
     pldm_transport_test_destroy(test);
 }
 
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Transport, send_batch_fallback)
+{
+    uint8_t hdr[] = {0x81, 0x00, 0x01};
+    uint8_t payload[] = {0x01};
+    const uint8_t msg[] = {0x81, 0x00, 0x01, 0x01};
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg =
+                {
+                    .dst = 1,
+                    .msg = msg,
+                    .len = sizeof(msg),
+                },
+        },
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_SEND,
+            .send_msg =
+                {
+                    .dst = 2,
+                    .msg = msg,
+                    .len = sizeof(msg),
+                },
+        },
+    };
+    const struct iovec iov[] = {
+        {.iov_base = hdr, .iov_len = sizeof(hdr)},
+        {.iov_base = payload, .iov_len = sizeof(payload)},
+    };
+    const struct pldm_transport_msgv msgs[] = {
+        {.iov = iov, .iovlen = ARRAY_SIZE(iov), .tid = 1},
+        {.iov = iov, .iovlen = ARRAY_SIZE(iov), .tid = 2},
+        /* The test transport rejects messages beyond its sequence */
+        {.iov = iov, .iovlen = ARRAY_SIZE(iov), .tid = 3},
+    };
+    const struct iovec shortIov = {.iov_base = hdr, .iov_len = 2};
+    const struct pldm_transport_msgv shortMsg = {
+        .iov = &shortIov, .iovlen = 1, .tid = 1};
+    struct pldm_transport_test* test = NULL;
+    struct pldm_transport* ctx;
+
+    EXPECT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ctx = pldm_transport_test_core(test);
+    EXPECT_EQ(pldm_transport_send_batch(ctx, &shortMsg, 1), -EINVAL);
+    EXPECT_EQ(pldm_transport_send_batch(ctx, msgs, ARRAY_SIZE(msgs)), 2);
+    pldm_transport_test_destroy(test);
+}
+#endif
+
 TEST(Transport, recv_one)
 {
     uint8_t msg[] = {0x01, 0x00, 0x01, 0x00};
@@ -72,6 +128,115 @@ TEST(Transport, recv_one)
     pldm_transport_test_destroy(test);
 }
 
+#if HAVE_LIBPLDM_API_TESTING
+TEST(Transport, recv_batch_fallback)
+{
+    uint8_t msg[] = {0x01, 0x00, 0x01, 0x00};
+    const pldm_tid_t src_tid = 1;
+    const struct pldm_transport_test_descriptor seq[] = {
+        {
+            .type = PLDM_TRANSPORT_TEST_ELEMENT_MSG_RECV,
+            .recv_msg =
+                {
+                    .src = src_tid,
+                    .msg = msg,
+                    .len = sizeof(msg),
+                },
+        },
+    };
+    struct pldm_transport_test* test = NULL;
+    struct pldm_transport_msg msgs[2];
+    uint8_t bufs[2][8];
+    struct pldm_transport* ctx;
+
+    for (size_t i = 0; i < ARRAY_SIZE(msgs); i++)
+    {
+        msgs[i].msg = bufs[i];
+        msgs[i].len = sizeof(bufs[i]);
+    }
+
+    EXPECT_EQ(pldm_transport_test_init(&test, seq, ARRAY_SIZE(seq)), 0);
+    ctx = pldm_transport_test_core(test);
+    ASSERT_EQ(pldm_transport_recv_batch(ctx, msgs, ARRAY_SIZE(msgs)), 1);
+    EXPECT_EQ(msgs[0].msg, bufs[0]);
+    EXPECT_EQ(msgs[0].len, sizeof(msg));
+    EXPECT_EQ(msgs[0].tid, src_tid);
+    EXPECT_EQ(memcmp(msgs[0].msg, msg, sizeof(msg)), 0);
+    pldm_transport_test_destroy(test);
+}
+
+/* Fails each receive as scripted, or returns a message of the given length */
+struct Scripted
+{
+    struct pldm_transport transport;
+    pldm_requester_rc_t rc;
+    int error;
+    size_t len;
+};
+
+static pldm_requester_rc_t scriptedRecv(struct pldm_transport* t,
+                                        pldm_tid_t* tid, void** msg,
+                                        size_t* len)
+{
+    auto* scripted = reinterpret_cast<Scripted*>(t);
+
+    if (scripted->rc != PLDM_REQUESTER_SUCCESS)
+    {
+        if (scripted->error)
+        {
+            errno = scripted->error;
+        }
+        return scripted->rc;
+    }
+
+    *msg = calloc(1, scripted->len);
+    *len = scripted->len;
+    *tid = 1;
+
+    return *msg ? PLDM_REQUESTER_SUCCESS : PLDM_REQUESTER_RECV_FAIL;
+}
+
+TEST(Transport, recv_batch_fallback_failures)
+{
+    Scripted scripted{};
+    struct pldm_transport* ctx = &scripted.transport;
+    struct pldm_transport_stats stats;
+    struct pldm_transport_msg msgs[1];
+    uint8_t buf[8];
+
+    scripted.transport.name = "SCRIPTED";
+    scripted.transport.version = 1;
+    scripted.transport.recv = scriptedRecv;
+    msgs[0].msg = buf;
+    msgs[0].len = sizeof(buf);
+    ASSERT_EQ(pldm_transport_stats_enable(ctx), 0);
+
+    /* Discarded messages are consumed without error */
+    scripted.rc = PLDM_REQUESTER_NOT_PLDM_MSG;
+    EXPECT_EQ(pldm_transport_recv_batch(ctx, msgs, 1), 0);
+    scripted.rc = PLDM_REQUESTER_INVALID_RECV_LEN;
+    EXPECT_EQ(pldm_transport_recv_batch(ctx, msgs, 1), 0);
+
+    /* Draining is distinguished from failure */
+    errno = 0;
+    scripted.rc = PLDM_REQUESTER_RECV_FAIL;
+    scripted.error = EAGAIN;
+    EXPECT_EQ(pldm_transport_recv_batch(ctx, msgs, 1), -EAGAIN);
+    errno = 0;
+    scripted.error = 0;
+    EXPECT_EQ(pldm_transport_recv_batch(ctx, msgs, 1), -EIO);
+
+    /* Messages too large for the buffer are dropped and counted */
+    scripted.rc = PLDM_REQUESTER_SUCCESS;
+    scripted.len = sizeof(buf) + 1;
+    EXPECT_EQ(pldm_transport_recv_batch(ctx, msgs, 1), 0);
+    ASSERT_EQ(pldm_transport_stats_snapshot_tid(ctx, 1, &stats), 0);
+    EXPECT_EQ(stats.rx_invalid_len, 1U);
+
+    pldm_transport_stats_disable(ctx);
+}
+#endif
+
 TEST(Transport, send_recv_drain_one_unwanted)
 {
     uint8_t unwanted[] = {0x01, 0x00, 0x01, 0x01};